@@ -33,6 +33,43 @@
 %include "controller_brescianini.h"
 %include "power_distribution.h"
 
+// Contiguous float32 arrays, for instance numpy arrays, are passed to C
+// through the buffer protocol without copying
+%define %float_buffer_typemap(TYPE, FLAGS)
+%typemap(in) (TYPE *ARRAY, int SIZE) (Py_buffer view) {
+    if (PyObject_GetBuffer($input, &view, FLAGS | PyBUF_C_CONTIGUOUS | PyBUF_FORMAT) != 0) {
+        SWIG_fail;
+    }
+    if (view.itemsize != sizeof(float) || view.format[strlen(view.format) - 1] != 'f') {
+        PyBuffer_Release(&view);
+        PyErr_SetString(PyExc_TypeError, "Expected a contiguous array of float32");
+        SWIG_fail;
+    }
+    $1 = (TYPE *)view.buf;
+    $2 = (int)(view.len / sizeof(float));
+}
+%typemap(freearg) (TYPE *ARRAY, int SIZE) {
+    if ($1) {
+        PyBuffer_Release(&view$argnum);
+    }
+}
+%enddef
+
+%float_buffer_typemap(float const, PyBUF_SIMPLE)
+%float_buffer_typemap(float, PyBUF_WRITABLE)
+
+%apply (float const *ARRAY, int SIZE) {
+    (float const *t, int n),
+    (float const *data, int n_data)
+};
+%apply (float *ARRAY, int SIZE) {
+    (float *pos, int n_pos),
+    (float *vel, int n_vel),
+    (float *acc, int n_acc),
+    (float *omega, int n_omega),
+    (float *yaw, int n_yaw)
+};
+
 %inline %{
 struct poly4d* piecewise_get(struct piecewise_traj *pp, int i)
 {
@@ -55,6 +92,60 @@ void poly4d_free(struct poly4d *p)
     free(p);
 }
 
+// Evaluates the trajectory at the n points in time in t, the pieces are
+// looked up with a cursor so increasing times are the fastest. pos, vel, acc
+// and omega are n x 3 arrays, yaw is n.
+int piecewise_eval_batch(struct piecewise_traj const *traj, bool reversed,
+    float const *t, int n,
+    float *pos, int n_pos, float *vel, int n_vel, float *acc, int n_acc,
+    float *omega, int n_omega, float *yaw, int n_yaw)
+{
+    if (n_pos != 3 * n || n_vel != 3 * n || n_acc != 3 * n || n_omega != 3 * n || n_yaw != n) {
+        return -1;
+    }
+
+    struct piecewise_cursor cursor;
+    piecewise_cursor_reset(&cursor, traj);
+    for (int i = 0; i < n; ++i) {
+        struct traj_eval ev = reversed ?
+            piecewise_eval_reversed_cursor(traj, &cursor, t[i]) :
+            piecewise_eval_cursor(traj, &cursor, t[i]);
+        vstoref(ev.pos, &pos[3 * i]);
+        vstoref(ev.vel, &vel[3 * i]);
+        vstoref(ev.acc, &acc[3 * i]);
+        vstoref(ev.omega, &omega[3 * i]);
+        yaw[i] = ev.yaw;
+    }
+    return 0;
+}
+
+// Loads all pieces of a trajectory from an n x 33 array. Each row is the
+// duration followed by the coefficients of x, y, z and yaw, in the same
+// layout as the trajectory CSV files. The pieces are allocated with
+// poly4d_malloc() and should be freed with poly4d_free().
+int piecewise_load_batch(struct piecewise_traj *traj, float const *data, int n_data)
+{
+    const int row_size = 1 + 4 * PP_SIZE;
+    int n_pieces = n_data / row_size;
+    if (n_pieces < 1 || n_pieces > UINT8_MAX || n_pieces * row_size != n_data) {
+        return -1;
+    }
+
+    struct poly4d *pieces = poly4d_malloc(n_pieces);
+    if (!pieces) {
+        return -1;
+    }
+    for (int i = 0; i < n_pieces; ++i) {
+        float const *row = &data[i * row_size];
+        pieces[i].duration = row[0];
+        memcpy(pieces[i].p, &row[1], sizeof(pieces[i].p));
+    }
+
+    traj->pieces = pieces;
+    traj->n_pieces = n_pieces;
+    return 0;
+}
+
 struct vec vec2svec(struct vec3_s v)
 {
     return mkvec(v.x, v.y, v.z);
@@ -78,12 +169,13 @@ void collisionAvoidanceUpdateSetpointWrap(
     setpoint_t *setpoint, sensorData_t const *sensorData, state_t const *state)
 {
     nOthers /= 3;
-    float *workspace = malloc(sizeof(float) * 7 * (nOthers + 6));
+    float *workspace = malloc(sizeof(float) * 5 * (nOthers + 6));
     collisionAvoidanceUpdateSetpointCore(
         params,
         collisionState,
         nOthers,
         otherPositions,
+        NULL,
         workspace,
         setpoint, sensorData, state);
     free(workspace);
@@ -99,6 +191,32 @@ void assertFail(char *exp, char *file, int line) {
 
 %pythoncode %{
 import numpy as np
+
+def piecewise_eval_many(traj, t, reversed=False):
+    """Evaluates the trajectory at all points in time in t, in C.
+
+    Returns pos, vel, acc and omega as n x 3 arrays and yaw as an array of n.
+    """
+    t = np.ascontiguousarray(t, dtype=np.float32)
+    n = len(t)
+    pos, vel, acc, omega = (np.empty((n, 3), dtype=np.float32) for _ in range(4))
+    yaw = np.empty(n, dtype=np.float32)
+    if piecewise_eval_batch(traj, reversed, t, pos, vel, acc, omega, yaw) != 0:
+        raise ValueError("Failed to evaluate the trajectory")
+    return pos, vel, acc, omega, yaw
+
+def piecewise_load(traj, data):
+    """Loads all pieces of a trajectory from an n x 33 array, one piece per row.
+
+    Each row is the duration followed by the 8 coefficients of x, y, z and
+    yaw, as in the trajectory CSV files. Free the pieces with
+    poly4d_free(traj.pieces).
+    """
+    data = np.ascontiguousarray(data, dtype=np.float32)
+    if data.ndim != 2 or data.shape[1] != 33:
+        raise ValueError("Expected an n x 33 array")
+    if piecewise_load_batch(traj, data) != 0:
+        raise ValueError("Failed to load the trajectory")
 %}
 
 #define COPY_CTOR(structname) \
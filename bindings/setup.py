@@ -32,6 +32,7 @@ fw_sources = [
     'vendor/CMSIS/CMSIS/DSP/Source/MatrixFunctions/arm_mat_trans_f32.c',
     "src/modules/src/pptraj.c",
     "src/modules/src/pptraj_compressed.c",
+    "src/modules/src/pptraj_stream.c",
     "src/modules/src/planner.c",
     "src/modules/src/collision_avoidance.c",
     "src/modules/src/controller/controller_pid.c",
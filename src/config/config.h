@@ -93,6 +93,7 @@
 #define ERROR_UKF_TASK_PRI      2
 #define LEDSEQCMD_TASK_PRI      1
 #define FLAPPERDECK_TASK_PRI    2
+#define PEER_GOSSIP_TASK_PRI    2
 #define SYSLINK_TASK_PRI        3
 #define USBLINK_TASK_PRI        3
 #define ACTIVE_MARKER_TASK_PRI  3
@@ -158,6 +159,7 @@
 #define CPX_TASK_NAME           "CPX"
 #define APP_TASK_NAME           "APP"
 #define FLAPPERDECK_TASK_NAME   "FLAPPERDECK"
+#define PEER_GOSSIP_TASK_NAME   "PEERGOSSIP"
 
 
 //Task stack sizes
@@ -203,6 +205,7 @@
 #define OA_DECK_TASK_STACKSIZE        (2 * configMINIMAL_STACK_SIZE)
 #define KALMAN_TASK_STACKSIZE         (3 * configMINIMAL_STACK_SIZE)
 #define FLAPPERDECK_TASK_STACKSIZE    (2 * configMINIMAL_STACK_SIZE)
+#define PEER_GOSSIP_TASK_STACKSIZE    (2 * configMINIMAL_STACK_SIZE)
 #define ERROR_UKF_TASK_STACKSIZE      (4 * configMINIMAL_STACK_SIZE)
 
 //The radio channel. From 0 to 125
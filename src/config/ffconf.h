@@ -4,6 +4,8 @@
 
 #define FFCONF_DEF	80196	/* Revision ID */
 
+#include "autoconf.h"
+
 /*---------------------------------------------------------------------------/
 / Function Configurations
 /---------------------------------------------------------------------------*/
@@ -42,11 +44,19 @@
 /* This option switches f_mkfs() function. (0:Disable or 1:Enable) */
 
 
+#ifdef CONFIG_DECK_USD_PREALLOCATE
+#define FF_USE_FASTSEEK	1
+#else
 #define FF_USE_FASTSEEK	0
+#endif
 /* This option switches fast seek function. (0:Disable or 1:Enable) */
 
 
+#ifdef CONFIG_DECK_USD_PREALLOCATE
+#define FF_USE_EXPAND	1
+#else
 #define FF_USE_EXPAND	0
+#endif
 /* This option switches f_expand function. (0:Disable or 1:Enable) */
 
 
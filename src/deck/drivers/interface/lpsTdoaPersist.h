@@ -0,0 +1,52 @@
+/**
+ *    ||          ____  _ __
+ * +------+      / __ )(_) /_______________ _____  ___
+ * | 0xBC |     / __  / / __/ ___/ ___/ __ `/_  / / _ \
+ * +------+    / /_/ / / /_/ /__/ /  / /_/ / / /_/  __/
+ *  ||  ||    /_____/_/\__/\___/_/   \__,_/ /___/\___/
+ *
+ * Crazyflie control firmware
+ *
+ * Copyright (C) 2023 Bitcraze AB
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, in version 3.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ *
+ * lpsTdoaPersist.h - persistent storage of TDoA anchor data
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include "tdoaStorage.h"
+
+// The max number of anchors that are kept in persistent storage
+#define LPS_TDOA_PERSIST_ANCHOR_COUNT 8
+
+/**
+ * @brief Load anchor positions, time of flight and clock correction from persistent storage into the
+ * anchor storage. Should be called after the TDoA engine has been initialized. The restored data is
+ * used until it is replaced by data received from the anchors, see tdoaStorageRestoreAnchor().
+ *
+ * @param anchorStorage The anchor storage of the TDoA engine
+ * @param now_ms The current time
+ */
+void lpsTdoaPersistRestore(tdoaAnchorStorage_t* anchorStorage, const uint32_t now_ms);
+
+/**
+ * @brief Write anchor data to persistent storage if it has changed. Can be called often, the anchors are
+ * checked at a low rate and the writes are done in the worker task.
+ *
+ * @param anchorStorage The anchor storage of the TDoA engine
+ * @param now_ms The current time
+ */
+void lpsTdoaPersistUpdate(tdoaAnchorStorage_t* anchorStorage, const uint32_t now_ms);
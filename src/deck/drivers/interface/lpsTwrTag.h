@@ -10,6 +10,7 @@
 #define LPS_TWR_ANSWER 0x02
 #define LPS_TWR_FINAL 0x03
 #define LPS_TWR_REPORT 0x04 // Report contains all measurement from the anchor
+#define LPS_TWR_POLL_CONCURRENT 0x05 // Broadcast poll, answered by all anchors
 
 #define LPS_TWR_LPP_SHORT 0xF0
 
@@ -22,6 +23,19 @@
 
 #define LPS_TWR_SEND_LPP_PAYLOAD 1
 
+// Concurrent ranging
+// The tag broadcasts a POLL_CONCURRENT with the number of anchors. Anchor n sends its ANSWER
+// in reply slot n, (n + 1) * LPS_TWR_CONCURRENT_REPLY_SLOT_US after the reception of the poll.
+// The tag broadcasts one FINAL with a bit mask of the anchors it received an answer from, and
+// the anchors in the mask send their REPORT in the same reply slots after the final.
+// The tag stops listening when no packet is received within TWR_RECEIVE_TIMEOUT, that is when
+// answers from 3 anchors in a row are missing.
+#define LPS_TWR_CONCURRENT_ANCHOR_COUNT 2
+#define LPS_TWR_CONCURRENT_ANSWER_MASK 2
+#define LPS_TWR_CONCURRENT_REPLY_SLOT_US 300
+
+#define LPS_TWR_BROADCAST_ADDRESS 0xffffffffffffffff
+
 #ifdef LOCODECK_NR_OF_ANCHORS
 #define LOCODECK_NR_OF_TWR_ANCHORS LOCODECK_NR_OF_ANCHORS
 #else
@@ -55,6 +69,9 @@ typedef struct {
   // TWR-TDMA options
   bool useTdma;
   int tdmaSlot;
+
+  // Range to all anchors with one broadcast poll, requires anchors with support for concurrent ranging
+  bool useConcurrentRanging;
 } lpsTwrAlgoOptions_t;
 
 
@@ -51,6 +51,7 @@ The implementation must handle
 #include "lpsTdoa3Tag.h"
 #include "tdoaEngineInstance.h"
 #include "tdoaStats.h"
+#include "lpsTdoaPersist.h"
 #include "estimator.h"
 
 #include "libdw1000.h"
@@ -260,6 +261,10 @@ static uint32_t onEvent(dwDevice_t *dev, uwbEvent_t event) {
   uint32_t now_ms = T2M(xTaskGetTickCount());
   tdoaStatsUpdate(&tdoaEngineState.stats, now_ms);
 
+  #ifdef CONFIG_DECK_LOCO_TDOA_PERSIST_ANCHORS
+  lpsTdoaPersistUpdate(&tdoaEngineState.anchorStorage, now_ms);
+  #endif
+
   return MAX_TIMEOUT;
 }
 
@@ -282,7 +287,7 @@ static bool getAnchorPosition(const uint8_t anchorId, point_t* position) {
   tdoaAnchorContext_t anchorCtx;
   uint32_t now_ms = T2M(xTaskGetTickCount());
 
-  bool contextFound = tdoaStorageGetAnchorCtx(tdoaEngineState.anchorInfoArray, anchorId, now_ms, &anchorCtx);
+  bool contextFound = tdoaStorageGetAnchorCtx(&tdoaEngineState.anchorStorage, anchorId, now_ms, &anchorCtx);
   if (contextFound) {
     tdoaStorageGetAnchorPosition(&anchorCtx, position);
     return true;
@@ -292,18 +297,22 @@ static bool getAnchorPosition(const uint8_t anchorId, point_t* position) {
 }
 
 static uint8_t getAnchorIdList(uint8_t unorderedAnchorList[], const int maxListSize) {
-  return tdoaStorageGetListOfAnchorIds(tdoaEngineState.anchorInfoArray, unorderedAnchorList, maxListSize);
+  return tdoaStorageGetListOfAnchorIds(&tdoaEngineState.anchorStorage, unorderedAnchorList, maxListSize);
 }
 
 static uint8_t getActiveAnchorIdList(uint8_t unorderedAnchorList[], const int maxListSize) {
   uint32_t now_ms = T2M(xTaskGetTickCount());
-  return tdoaStorageGetListOfActiveAnchorIds(tdoaEngineState.anchorInfoArray, unorderedAnchorList, maxListSize, now_ms);
+  return tdoaStorageGetListOfActiveAnchorIds(&tdoaEngineState.anchorStorage, unorderedAnchorList, maxListSize, now_ms);
 }
 
 static void Initialize(dwDevice_t *dev) {
   uint32_t now_ms = T2M(xTaskGetTickCount());
   tdoaEngineInit(&tdoaEngineState, now_ms, sendTdoaToEstimatorCallback, LOCODECK_TS_FREQ, TdoaEngineMatchingAlgorithmRandom);
 
+  #ifdef CONFIG_DECK_LOCO_TDOA_PERSIST_ANCHORS
+  lpsTdoaPersistRestore(&tdoaEngineState.anchorStorage, now_ms);
+  #endif
+
   #ifdef CONFIG_DECK_LOCO_2D_POSITION
   DEBUG_PRINT("2D positioning enabled at %f m height\n", DECK_LOCO_2D_POSITION_HEIGHT);
   #endif
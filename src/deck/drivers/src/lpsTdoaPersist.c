@@ -0,0 +1,277 @@
+/**
+ *    ||          ____  _ __
+ * +------+      / __ )(_) /_______________ _____  ___
+ * | 0xBC |     / __  / / __/ ___/ ___/ __ `/_  / / _ \
+ * +------+    / /_/ / / /_/ /__/ /  / /_/ / / /_/  __/
+ *  ||  ||    /_____/_/\__/\___/_/   \__,_/ /___/\___/
+ *
+ * Crazyflie control firmware
+ *
+ * Copyright (C) 2023 Bitcraze AB
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, in version 3.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ *
+ * lpsTdoaPersist.c - persistent storage of TDoA anchor data
+ *
+ * Anchor positions, time of flight between anchors and clock corrections are
+ * stored in the kve storage, one key per anchor. They are loaded when the TDoA
+ * tag is initialized to avoid waiting for the anchors to send all data before
+ * a position can be estimated.
+ */
+
+#include <string.h>
+#include <stdlib.h>
+#include <math.h>
+
+#include "lpsTdoaPersist.h"
+#include "storage.h"
+#include "worker.h"
+
+#define DEBUG_MODULE "TDOA_STORE"
+#include "debug.h"
+
+#define STORAGE_KEY_ANCHOR "lps/anc/"
+#define KEY_LEN 12
+
+// How often the anchor data is compared to the stored data
+#define UPDATE_INTERVAL_MS (10 * 1000)
+
+// Changes that are large enough to write the anchor data again. Flash
+// is worn by writes, small changes are not worth it.
+#define POSITION_MAX_CHANGE 0.05f
+#define TOF_MAX_CHANGE 20
+// About 1 ppm in Q1.31
+#define CLOCK_CORRECTION_MAX_CHANGE 2147
+
+typedef struct {
+  tdoaPersistedAnchor_t anchor;
+  bool isUsed;
+  bool isDirty;
+  // Id of an anchor that was replaced in the slot and should be deleted from storage, or -1
+  int16_t deleteId;
+} persistSlot_t;
+
+static persistSlot_t slots[LPS_TDOA_PERSIST_ANCHOR_COUNT];
+
+// Set while the worker writes to storage, the slots must not be changed
+static volatile bool isWorkerPending = false;
+static uint32_t nextUpdate_ms = 0;
+
+// Ids of the stored anchors, collected by the storageForeach() callback
+static uint8_t restoreIds[LPS_TDOA_PERSIST_ANCHOR_COUNT];
+static int restoreIdCount;
+
+static void generateStorageKey(char* buf, const uint8_t anchorId) {
+  static const char hex[] = "0123456789abcdef";
+
+  const int baseLen = strlen(STORAGE_KEY_ANCHOR);
+  memcpy(buf, STORAGE_KEY_ANCHOR, baseLen);
+  buf[baseLen] = hex[anchorId >> 4];
+  buf[baseLen + 1] = hex[anchorId & 0x0f];
+  buf[baseLen + 2] = '\0';
+}
+
+static int parseHexDigit(const char c) {
+  if (c >= '0' && c <= '9') {
+    return c - '0';
+  }
+  if (c >= 'a' && c <= 'f') {
+    return c - 'a' + 10;
+  }
+  return -1;
+}
+
+// The storageForeach() callback only gets the first bytes of the value and
+// the storage is locked while it runs. Only collect the ids here, the anchor
+// data is fetched afterwards.
+static bool collectAnchorId(const char* key, void* buffer, size_t length) {
+  const size_t baseLen = strlen(STORAGE_KEY_ANCHOR);
+  if (strlen(key) != baseLen + 2) {
+    return true;
+  }
+
+  const int high = parseHexDigit(key[baseLen]);
+  const int low = parseHexDigit(key[baseLen + 1]);
+  if (high >= 0 && low >= 0 && restoreIdCount < LPS_TDOA_PERSIST_ANCHOR_COUNT) {
+    restoreIds[restoreIdCount] = (high << 4) | low;
+    restoreIdCount++;
+  }
+
+  return true;
+}
+
+void lpsTdoaPersistRestore(tdoaAnchorStorage_t* anchorStorage, const uint32_t now_ms) {
+  if (isWorkerPending) {
+    return;
+  }
+
+  memset(slots, 0, sizeof(slots));
+  for (int i = 0; i < LPS_TDOA_PERSIST_ANCHOR_COUNT; i++) {
+    slots[i].deleteId = -1;
+  }
+
+  restoreIdCount = 0;
+  storageForeach(STORAGE_KEY_ANCHOR, collectAnchorId);
+
+  int restoreCount = 0;
+  char key[KEY_LEN];
+  for (int i = 0; i < restoreIdCount; i++) {
+    generateStorageKey(key, restoreIds[i]);
+
+    // Entries with an unexpected size are from another format, ignore them.
+    // One extra byte is read to detect entries that are too large.
+    uint8_t buffer[sizeof(tdoaPersistedAnchor_t) + 1];
+    const size_t length = storageFetch(key, buffer, sizeof(buffer));
+    if (length == sizeof(tdoaPersistedAnchor_t)) {
+      persistSlot_t* slot = &slots[restoreCount];
+      memcpy(&slot->anchor, buffer, sizeof(tdoaPersistedAnchor_t));
+      if (slot->anchor.id == restoreIds[i]) {
+        slot->isUsed = true;
+        restoreCount++;
+
+        tdoaStorageRestoreAnchor(anchorStorage, &slot->anchor, now_ms);
+      }
+    }
+  }
+
+  if (restoreCount > 0) {
+    DEBUG_PRINT("Restored %i anchors\n", restoreCount);
+  }
+
+  nextUpdate_ms = now_ms + UPDATE_INTERVAL_MS;
+}
+
+static bool isChanged(const tdoaPersistedAnchor_t* stored, const tdoaPersistedAnchor_t* live) {
+  if (fabsf(stored->x - live->x) > POSITION_MAX_CHANGE ||
+      fabsf(stored->y - live->y) > POSITION_MAX_CHANGE ||
+      fabsf(stored->z - live->z) > POSITION_MAX_CHANGE) {
+    return true;
+  }
+
+  if (abs((int32_t)(stored->clockCorrection - live->clockCorrection)) > CLOCK_CORRECTION_MAX_CHANGE) {
+    return true;
+  }
+
+  if (stored->tofCount != live->tofCount) {
+    return true;
+  }
+
+  for (int i = 0; i < live->tofCount; i++) {
+    if (stored->tof[i].id != live->tof[i].id ||
+        abs(stored->tof[i].tof - live->tof[i].tof) > TOF_MAX_CHANGE) {
+      return true;
+    }
+  }
+
+  return false;
+}
+
+static bool isInList(const uint8_t id, const uint8_t list[], const int count) {
+  for (int i = 0; i < count; i++) {
+    if (list[i] == id) {
+      return true;
+    }
+  }
+
+  return false;
+}
+
+static persistSlot_t* findSlot(const uint8_t id, const uint8_t activeIds[], const int activeCount) {
+  persistSlot_t* freeSlot = 0;
+
+  for (int i = 0; i < LPS_TDOA_PERSIST_ANCHOR_COUNT; i++) {
+    persistSlot_t* slot = &slots[i];
+    if (slot->isUsed) {
+      if (slot->anchor.id == id) {
+        return slot;
+      }
+
+      // Anchors that are not heard any more can be replaced
+      if (!freeSlot && !isInList(slot->anchor.id, activeIds, activeCount)) {
+        freeSlot = slot;
+      }
+    } else {
+      if (!freeSlot || freeSlot->isUsed) {
+        freeSlot = slot;
+      }
+    }
+  }
+
+  if (freeSlot && freeSlot->isUsed) {
+    freeSlot->deleteId = freeSlot->anchor.id;
+  }
+
+  return freeSlot;
+}
+
+static void persistWorker(void* arg) {
+  char key[KEY_LEN];
+
+  for (int i = 0; i < LPS_TDOA_PERSIST_ANCHOR_COUNT; i++) {
+    persistSlot_t* slot = &slots[i];
+
+    if (slot->deleteId >= 0) {
+      generateStorageKey(key, slot->deleteId);
+      storageDelete(key);
+      slot->deleteId = -1;
+    }
+
+    if (slot->isDirty) {
+      generateStorageKey(key, slot->anchor.id);
+      if (!storageStore(key, &slot->anchor, sizeof(slot->anchor))) {
+        DEBUG_PRINT("WARNING: Failed to persist data for anchor %i\n", slot->anchor.id);
+      }
+      slot->isDirty = false;
+    }
+  }
+
+  isWorkerPending = false;
+}
+
+void lpsTdoaPersistUpdate(tdoaAnchorStorage_t* anchorStorage, const uint32_t now_ms) {
+  if ((int32_t)(now_ms - nextUpdate_ms) < 0 || isWorkerPending) {
+    return;
+  }
+  nextUpdate_ms = now_ms + UPDATE_INTERVAL_MS;
+
+  uint8_t activeIds[ANCHOR_STORAGE_COUNT];
+  const int activeCount = tdoaStorageGetListOfActiveAnchorIds(anchorStorage, activeIds, ANCHOR_STORAGE_COUNT, now_ms);
+
+  bool isAnyDirty = false;
+  for (int i = 0; i < activeCount; i++) {
+    tdoaAnchorContext_t anchorCtx;
+    tdoaPersistedAnchor_t live;
+    if (!tdoaStorageGetAnchorCtx(anchorStorage, activeIds[i], now_ms, &anchorCtx) ||
+        !tdoaStorageGetPersistedAnchor(&anchorCtx, &live)) {
+      continue;
+    }
+
+    persistSlot_t* slot = findSlot(live.id, activeIds, activeCount);
+    if (!slot) {
+      // All slots are used by active anchors
+      continue;
+    }
+
+    if (!slot->isUsed || slot->anchor.id != live.id || isChanged(&slot->anchor, &live)) {
+      memcpy(&slot->anchor, &live, sizeof(live));
+      slot->isUsed = true;
+      slot->isDirty = true;
+      isAnyDirty = true;
+    }
+  }
+
+  if (isAnyDirty) {
+    isWorkerPending = true;
+    workerSchedule(persistWorker, 0);
+  }
+}
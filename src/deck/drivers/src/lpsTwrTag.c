@@ -71,6 +71,10 @@ static lpsTwrAlgoOptions_t defaultOptions = {
    .tdmaSlot = TDMA_SLOT,
  #endif
 
+ #ifdef CONFIG_DECK_LOCO_TWR_CONCURRENT_RANGING
+   .useConcurrentRanging = true,
+ #endif
+
    // To set a static anchor position from startup, uncomment and modify the
    // following code:
  //   .anchorPosition = {
@@ -124,6 +128,13 @@ static uint8_t current_anchor = 0;
 static bool ranging_complete = false;
 static bool lpp_transaction = false;
 
+// Concurrent ranging, one bit per anchor in the masks
+#define ALL_ANCHORS_MASK ((1 << LOCODECK_NR_OF_TWR_ANCHORS) - 1)
+static dwTime_t concurrent_answer_rx[LOCODECK_NR_OF_TWR_ANCHORS];
+static uint16_t answeredAnchors;
+static uint16_t reportedAnchors;
+static bool concurrentFinalSent;
+
 static lpsLppShortPacket_t lppShortPacket;
 
 // TDMA handling
@@ -142,6 +153,7 @@ static void txcallback(dwDevice_t *dev)
 
   switch (txPacket.payload[0]) {
     case LPS_TWR_POLL:
+    case LPS_TWR_POLL_CONCURRENT:
       poll_tx = departure;
       break;
     case LPS_TWR_FINAL:
@@ -151,6 +163,152 @@ static void txcallback(dwDevice_t *dev)
 }
 
 
+static int findAnchor(const locoAddress_t address) {
+  for (int i=0; i<LOCODECK_NR_OF_TWR_ANCHORS; i++) {
+    if (address == options->anchorAddress[i]) {
+      return i;
+    }
+  }
+
+  return -1;
+}
+
+static void handleLppInAnswer(const packet_t* rxPacket, const int dataLength) {
+  if (dataLength - MAC802154_HEADER_LENGTH > 3) {
+    if (rxPacket->payload[LPS_TWR_LPP_HEADER] == LPP_HEADER_SHORT_PACKET) {
+      int srcId = findAnchor(rxPacket->sourceAddress);
+
+      if (srcId >= 0) {
+        lpsHandleLppShortPacket(srcId, &rxPacket->payload[LPS_TWR_LPP_TYPE]);
+      }
+    }
+  }
+}
+
+static void handleReport(const uint8_t anchor, const dwTime_t* answerRx, const lpsTwrTagReportPayload_t *report) {
+  double tround1, treply1, treply2, tround2, tprop_ctn, tprop;
+
+  memcpy(&poll_rx, &report->pollRx, 5);
+  memcpy(&answer_tx, &report->answerTx, 5);
+  memcpy(&final_rx, &report->finalRx, 5);
+
+  tround1 = answerRx->low32 - poll_tx.low32;
+  treply1 = answer_tx.low32 - poll_rx.low32;
+  tround2 = final_rx.low32 - answer_tx.low32;
+  treply2 = final_tx.low32 - answerRx->low32;
+
+  tprop_ctn = ((tround1*tround2) - (treply1*treply2)) / (tround1 + tround2 + treply1 + treply2);
+
+  tprop = tprop_ctn / LOCODECK_TS_FREQ;
+  state.distance[anchor] = SPEED_OF_LIGHT * tprop;
+  state.pressures[anchor] = report->asl;
+
+  // Outliers rejection
+  rangingStats[anchor].ptr = (rangingStats[anchor].ptr + 1) % RANGING_HISTORY_LENGTH;
+  float32_t mean;
+  float32_t stddev;
+
+  arm_std_f32(rangingStats[anchor].history, RANGING_HISTORY_LENGTH, &stddev);
+  arm_mean_f32(rangingStats[anchor].history, RANGING_HISTORY_LENGTH, &mean);
+  float32_t diff = fabsf(mean - state.distance[anchor]);
+
+  rangingStats[anchor].history[rangingStats[anchor].ptr] = state.distance[anchor];
+
+  rangingOk = true;
+
+  if ((options->combinedAnchorPositionOk || options->anchorPosition[anchor].timestamp) &&
+      (diff < (OUTLIER_TH*stddev))) {
+    distanceMeasurement_t dist;
+    dist.distance = state.distance[anchor];
+    dist.x = options->anchorPosition[anchor].x;
+    dist.y = options->anchorPosition[anchor].y;
+    dist.z = options->anchorPosition[anchor].z;
+    dist.anchorId = anchor;
+    dist.stdDev = 0.25;
+    estimatorEnqueueDistance(&dist);
+  }
+
+  if (options->useTdma && anchor == 0) {
+    // Final packet is sent by us and received by the anchor
+    // We use it as synchonisation time for TDMA
+    dwTime_t offset = { .full =final_tx.full - final_rx.full };
+    frameStart.full = TDMA_LAST_FRAME(final_rx.full) + offset.full;
+    tdmaSynchronized = true;
+  }
+}
+
+static void restartReceive(dwDevice_t *dev) {
+  dwNewReceive(dev);
+  dwSetDefaults(dev);
+  dwStartReceive(dev);
+}
+
+static void sendConcurrentFinal(dwDevice_t *dev) {
+  txPacket.payload[LPS_TWR_TYPE] = LPS_TWR_FINAL;
+  txPacket.payload[LPS_TWR_SEQ] = curr_seq;
+  txPacket.payload[LPS_TWR_CONCURRENT_ANSWER_MASK] = answeredAnchors & 0xff;
+  txPacket.payload[LPS_TWR_CONCURRENT_ANSWER_MASK + 1] = answeredAnchors >> 8;
+
+  txPacket.sourceAddress = options->tagAddress;
+  txPacket.destAddress = LPS_TWR_BROADCAST_ADDRESS;
+
+  dwNewTransmit(dev);
+  dwSetDefaults(dev);
+  dwSetData(dev, (uint8_t*)&txPacket, MAC802154_HEADER_LENGTH+4);
+
+  dwWaitForResponse(dev, true);
+  dwStartTransmit(dev);
+
+  concurrentFinalSent = true;
+}
+
+// All anchors answer the same poll and report the same final, in their reply slots. Keep
+// listening until all expected packets are received or the receiver times out.
+static uint32_t concurrentRxcallback(dwDevice_t *dev, const packet_t* rxPacket, const int dataLength) {
+  dwTime_t arival = { .full=0 };
+  const int anchor = findAnchor(rxPacket->sourceAddress);
+
+  if (anchor >= 0 && rxPacket->payload[LPS_TWR_SEQ] == curr_seq) {
+    const uint16_t anchorBit = 1 << anchor;
+
+    switch(rxPacket->payload[LPS_TWR_TYPE]) {
+      case LPS_TWR_ANSWER:
+        if (concurrentFinalSent) {
+          break;
+        }
+
+        handleLppInAnswer(rxPacket, dataLength);
+
+        dwGetReceiveTimestamp(dev, &arival);
+        arival.full -= (options->antennaDelay / 2);
+        concurrent_answer_rx[anchor] = arival;
+        answeredAnchors |= anchorBit;
+
+        if (answeredAnchors == ALL_ANCHORS_MASK) {
+          sendConcurrentFinal(dev);
+          return MAX_TIMEOUT;
+        }
+        break;
+      case LPS_TWR_REPORT:
+        if (!concurrentFinalSent || !(answeredAnchors & anchorBit) || (reportedAnchors & anchorBit)) {
+          break;
+        }
+
+        handleReport(anchor, &concurrent_answer_rx[anchor], (const lpsTwrTagReportPayload_t *)(rxPacket->payload+2));
+        reportedAnchors |= anchorBit;
+
+        if (reportedAnchors == answeredAnchors) {
+          ranging_complete = true;
+          return 0;
+        }
+        break;
+    }
+  }
+
+  restartReceive(dev);
+  return MAX_TIMEOUT;
+}
+
 static uint32_t rxcallback(dwDevice_t *dev) {
   dwTime_t arival = { .full=0 };
   int dataLength = dwGetDataLength(dev);
@@ -163,12 +321,14 @@ static uint32_t rxcallback(dwDevice_t *dev) {
   dwGetData(dev, (uint8_t*)&rxPacket, dataLength);
 
   if (rxPacket.destAddress != options->tagAddress) {
-    dwNewReceive(dev);
-    dwSetDefaults(dev);
-    dwStartReceive(dev);
+    restartReceive(dev);
     return MAX_TIMEOUT;
   }
 
+  if (options->useConcurrentRanging) {
+    return concurrentRxcallback(dev, &rxPacket, dataLength);
+  }
+
   txPacket.destAddress = rxPacket.sourceAddress;
   txPacket.sourceAddress = rxPacket.destAddress;
 
@@ -179,22 +339,7 @@ static uint32_t rxcallback(dwDevice_t *dev) {
         return 0;
       }
 
-      if (dataLength - MAC802154_HEADER_LENGTH > 3) {
-        if (rxPacket.payload[LPS_TWR_LPP_HEADER] == LPP_HEADER_SHORT_PACKET) {
-          int srcId = -1;
-
-          for (int i=0; i<LOCODECK_NR_OF_TWR_ANCHORS; i++) {
-            if (rxPacket.sourceAddress == options->anchorAddress[i]) {
-              srcId = i;
-              break;
-            }
-          }
-
-          if (srcId >= 0) {
-            lpsHandleLppShortPacket(srcId, &rxPacket.payload[LPS_TWR_LPP_TYPE]);
-          }
-        }
-      }
+      handleLppInAnswer(&rxPacket, dataLength);
 
       txPacket.payload[LPS_TWR_TYPE] = LPS_TWR_FINAL;
       txPacket.payload[LPS_TWR_SEQ] = rxPacket.payload[LPS_TWR_SEQ];
@@ -213,59 +358,12 @@ static uint32_t rxcallback(dwDevice_t *dev) {
     case LPS_TWR_REPORT:
     {
       lpsTwrTagReportPayload_t *report = (lpsTwrTagReportPayload_t *)(rxPacket.payload+2);
-      double tround1, treply1, treply2, tround2, tprop_ctn, tprop;
 
       if (rxPacket.payload[LPS_TWR_SEQ] != curr_seq) {
         return 0;
       }
 
-      memcpy(&poll_rx, &report->pollRx, 5);
-      memcpy(&answer_tx, &report->answerTx, 5);
-      memcpy(&final_rx, &report->finalRx, 5);
-
-      tround1 = answer_rx.low32 - poll_tx.low32;
-      treply1 = answer_tx.low32 - poll_rx.low32;
-      tround2 = final_rx.low32 - answer_tx.low32;
-      treply2 = final_tx.low32 - answer_rx.low32;
-
-      tprop_ctn = ((tround1*tround2) - (treply1*treply2)) / (tround1 + tround2 + treply1 + treply2);
-
-      tprop = tprop_ctn / LOCODECK_TS_FREQ;
-      state.distance[current_anchor] = SPEED_OF_LIGHT * tprop;
-      state.pressures[current_anchor] = report->asl;
-
-      // Outliers rejection
-      rangingStats[current_anchor].ptr = (rangingStats[current_anchor].ptr + 1) % RANGING_HISTORY_LENGTH;
-      float32_t mean;
-      float32_t stddev;
-
-      arm_std_f32(rangingStats[current_anchor].history, RANGING_HISTORY_LENGTH, &stddev);
-      arm_mean_f32(rangingStats[current_anchor].history, RANGING_HISTORY_LENGTH, &mean);
-      float32_t diff = fabsf(mean - state.distance[current_anchor]);
-
-      rangingStats[current_anchor].history[rangingStats[current_anchor].ptr] = state.distance[current_anchor];
-
-      rangingOk = true;
-
-      if ((options->combinedAnchorPositionOk || options->anchorPosition[current_anchor].timestamp) &&
-          (diff < (OUTLIER_TH*stddev))) {
-        distanceMeasurement_t dist;
-        dist.distance = state.distance[current_anchor];
-        dist.x = options->anchorPosition[current_anchor].x;
-        dist.y = options->anchorPosition[current_anchor].y;
-        dist.z = options->anchorPosition[current_anchor].z;
-        dist.anchorId = current_anchor;
-        dist.stdDev = 0.25;
-        estimatorEnqueueDistance(&dist);
-      }
-
-      if (options->useTdma && current_anchor == 0) {
-        // Final packet is sent by us and received by the anchor
-        // We use it as synchonisation time for TDMA
-        dwTime_t offset = { .full =final_tx.full - final_rx.full };
-        frameStart.full = TDMA_LAST_FRAME(final_rx.full) + offset.full;
-        tdmaSynchronized = true;
-      }
+      handleReport(current_anchor, &answer_rx, report);
 
       ranging_complete = true;
 
@@ -314,15 +412,27 @@ static void initiateRanging(dwDevice_t *dev)
 
   dwIdle(dev);
 
-  txPacket.payload[LPS_TWR_TYPE] = LPS_TWR_POLL;
   txPacket.payload[LPS_TWR_SEQ] = ++curr_seq;
-
   txPacket.sourceAddress = options->tagAddress;
-  txPacket.destAddress = options->anchorAddress[current_anchor];
+
+  int dataLength = MAC802154_HEADER_LENGTH+2;
+  if (options->useConcurrentRanging) {
+    answeredAnchors = 0;
+    reportedAnchors = 0;
+    concurrentFinalSent = false;
+
+    txPacket.payload[LPS_TWR_TYPE] = LPS_TWR_POLL_CONCURRENT;
+    txPacket.payload[LPS_TWR_CONCURRENT_ANCHOR_COUNT] = LOCODECK_NR_OF_TWR_ANCHORS;
+    txPacket.destAddress = LPS_TWR_BROADCAST_ADDRESS;
+    dataLength = MAC802154_HEADER_LENGTH+3;
+  } else {
+    txPacket.payload[LPS_TWR_TYPE] = LPS_TWR_POLL;
+    txPacket.destAddress = options->anchorAddress[current_anchor];
+  }
 
   dwNewTransmit(dev);
   dwSetDefaults(dev);
-  dwSetData(dev, (uint8_t*)&txPacket, MAC802154_HEADER_LENGTH+2);
+  dwSetData(dev, (uint8_t*)&txPacket, dataLength);
 
   if (options->useTdma && tdmaSynchronized) {
     dwTime_t txTime = transmitTimeForSlot(options->tdmaSlot);
@@ -351,6 +461,26 @@ static void sendLppShort(dwDevice_t *dev, lpsLppShortPacket_t *packet)
   dwStartTransmit(dev);
 }
 
+static void updateRangingState(uint16_t* rangingState, const uint8_t anchor, const bool isRangingComplete)
+{
+  if (!isRangingComplete) {
+    *rangingState &= ~(1<<anchor);
+    if (state.failedRanging[anchor] < options->rangingFailedThreshold) {
+      state.failedRanging[anchor] ++;
+      *rangingState |= (1<<anchor);
+    }
+
+    locSrvSendRangeFloat(anchor, NAN);
+    failedRanging[anchor]++;
+  } else {
+    *rangingState |= (1<<anchor);
+    state.failedRanging[anchor] = 0;
+
+    locSrvSendRangeFloat(anchor, state.distance[anchor]);
+    succededRanging[anchor]++;
+  }
+}
+
 static uint32_t twrTagOnEvent(dwDevice_t *dev, uwbEvent_t event)
 {
   static uint32_t statisticStartTick = 0;
@@ -374,21 +504,14 @@ static uint32_t twrTagOnEvent(dwDevice_t *dev, uwbEvent_t event)
     case eventTimeout:  // Comes back to timeout after each ranging attempt
       {
         uint16_t rangingState = locoDeckGetRangingState();
-        if (!ranging_complete && !lpp_transaction) {
-          rangingState &= ~(1<<current_anchor);
-          if (state.failedRanging[current_anchor] < options->rangingFailedThreshold) {
-            state.failedRanging[current_anchor] ++;
-            rangingState |= (1<<current_anchor);
+        if (options->useConcurrentRanging) {
+          if (!lpp_transaction) {
+            for (int i=0; i<LOCODECK_NR_OF_TWR_ANCHORS; i++) {
+              updateRangingState(&rangingState, i, reportedAnchors & (1<<i));
+            }
           }
-
-          locSrvSendRangeFloat(current_anchor, NAN);
-          failedRanging[current_anchor]++;
         } else {
-          rangingState |= (1<<current_anchor);
-          state.failedRanging[current_anchor] = 0;
-
-          locSrvSendRangeFloat(current_anchor, state.distance[current_anchor]);
-          succededRanging[current_anchor]++;
+          updateRangingState(&rangingState, current_anchor, ranging_complete || lpp_transaction);
         }
         locoDeckSetRangingState(rangingState);
       }
@@ -422,7 +545,19 @@ static uint32_t twrTagOnEvent(dwDevice_t *dev, uwbEvent_t event)
       return MAX_TIMEOUT;
       break;
     case eventReceiveTimeout:
+      if (options->useConcurrentRanging && !lpp_transaction && !concurrentFinalSent && answeredAnchors) {
+        // No more answers, send the final to the anchors that have answered
+        sendConcurrentFinal(dev);
+        return MAX_TIMEOUT;
+      }
+      return 0;
+      break;
     case eventReceiveFailed:
+      if (options->useConcurrentRanging && !lpp_transaction) {
+        // Probably a collision, other anchors may still answer or report
+        restartReceive(dev);
+        return MAX_TIMEOUT;
+      }
       return 0;
       break;
     default:
@@ -478,6 +613,11 @@ static void twrTagInit(dwDevice_t *dev)
   memset(&final_tx, 0, sizeof(final_tx));
   memset(&final_rx, 0, sizeof(final_rx));
 
+  memset(concurrent_answer_rx, 0, sizeof(concurrent_answer_rx));
+  answeredAnchors = 0;
+  reportedAnchors = 0;
+  concurrentFinalSent = false;
+
   curr_seq = 0;
   current_anchor = 0;
 
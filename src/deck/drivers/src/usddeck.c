@@ -62,6 +62,7 @@
 #include "static_mem.h"
 #include "mem.h"
 #include "eventtrigger.h"
+#include "delta_encoder.h"
 
 #include "autoconf.h"
 
@@ -95,6 +96,27 @@
 #define FIXED_FREQUENCY_EVENT_ID          (0xFFFF)
 #define FIXED_FREQUENCY_EVENT_NAME        "fixedFrequency"
 
+#ifdef CONFIG_DECK_USD_COMPRESSED_LOG
+#define USD_LOG_VERSION                   (3)
+// Event triggers have at most 5 payload variables, see EVENTTRIGGER()
+#define MAX_USD_LOG_PAYLOAD_VARIABLES     (5)
+#define MAX_USD_LOG_FIELDS_PER_EVENT      (MAX_USD_LOG_VARIABLES_PER_EVENT + MAX_USD_LOG_PAYLOAD_VARIABLES)
+#define MAX_USD_LOG_EVENT_BYTES           (MAX_USD_LOG_FIELDS_PER_EVENT * sizeof(uint32_t))
+#define MAX_USD_LOG_RECORD_SIZE           (1 + DELTA_ENCODER_MAX_VARINT64_SIZE + MAX_USD_LOG_FIELDS_PER_EVENT * DELTA_ENCODER_MAX_VARINT32_SIZE)
+#else
+#define USD_LOG_VERSION                   (2)
+#endif
+
+#ifdef CONFIG_DECK_USD_PREALLOCATE
+#define USD_SECTOR_SIZE         (512)
+#define USD_WRITE_BLOCK_SIZE    (CONFIG_DECK_USD_WRITE_BLOCK_SECTORS * USD_SECTOR_SIZE)
+#define USD_PREALLOCATE_SIZE    ((FSIZE_t)CONFIG_DECK_USD_PREALLOCATE_SIZE_MB * 1024 * 1024)
+// Distance from the end of the logged data to the end marker, which is moved
+// ahead each time the data reaches it
+#define USD_END_MARKER_DISTANCE (32 * USD_WRITE_BLOCK_SIZE)
+// A contiguous file is one fragment: table size, cluster count, start cluster and terminator
+#define USD_LINK_MAP_SIZE       (4)
+#endif
 
 /* set to true when graceful shutdown is triggered */
 static volatile bool in_shutdown = false;
@@ -104,6 +126,10 @@ typedef struct usdLogEventConfig_s {
   uint8_t numVars;
   uint16_t numBytes;
   logVarId_t varIds[MAX_USD_LOG_VARIABLES_PER_EVENT];
+#ifdef CONFIG_DECK_USD_COMPRESSED_LOG
+  uint8_t fieldSizes[MAX_USD_LOG_FIELDS_PER_EVENT];
+  deltaEncoder_t encoder;
+#endif
 } usdLogEventConfig_t;
 
 typedef struct usdLogConfig_s {
@@ -244,6 +270,24 @@ static crc32Context_t crcContext;
 static xTimerHandle timer;
 static void usdTimer(xTimerHandle timer);
 
+#ifdef CONFIG_DECK_USD_PREALLOCATE
+// Sector aligned block that all data of a preallocated log file goes through,
+// filled from the ring buffer while the previous block is written to the card
+static uint8_t* writeBlock;
+static uint16_t writeBlockFill;
+// Empty sector written ahead of the data, allocated after the write block
+static uint8_t* endMarker;
+static FSIZE_t endMarkerPosition;
+static DWORD linkMap[USD_LINK_MAP_SIZE];
+static bool isPreallocated;
+#endif
+
+#ifdef CONFIG_DECK_USD_COMPRESSED_LOG
+// Only used with the log buffer mutex taken
+static uint8_t eventValues[MAX_USD_LOG_EVENT_BYTES];
+static uint8_t eventRecord[MAX_USD_LOG_RECORD_SIZE];
+#endif
+
 static SemaphoreHandle_t shutdownMutex;
 
 // Handling from the memory module
@@ -475,7 +519,106 @@ static void usdInit(DeckInfo *info)
   isInit = true;
 }
 
-static void usddeckWriteEventData(const usdLogEventConfig_t* cfg, const uint8_t* payload, uint8_t payloadSize)
+#ifdef CONFIG_DECK_USD_COMPRESSED_LOG
+static uint8_t usdEventtriggerTypeSize(enum eventtriggerType_e type)
+{
+  switch (type) {
+  case eventtriggerType_uint8:
+  case eventtriggerType_int8:
+    return sizeof(uint8_t);
+  case eventtriggerType_uint16:
+  case eventtriggerType_int16:
+  case eventtrigerType_fp16:
+    return sizeof(uint16_t);
+  case eventtriggerType_uint32:
+  case eventtriggerType_int32:
+  case eventtriggerType_float:
+    return sizeof(uint32_t);
+  default:
+    ASSERT(false);
+    return 0;
+  }
+}
+
+static bool usdInitEncoders(void)
+{
+  uint16_t totalBytes = 0;
+
+  for (int i = 0; i < usdLogConfig.numEventConfigs; ++i) {
+    usdLogEventConfig_t* cfg = &usdLogConfig.eventConfigs[i];
+    const eventtrigger *et = eventtriggerGetById(cfg->eventId);
+    uint8_t numFields = 0;
+
+    if (et) {
+      if (et->numPayloadVariables > MAX_USD_LOG_PAYLOAD_VARIABLES) {
+        return false;
+      }
+      for (int j = 0; j < et->numPayloadVariables; ++j) {
+        cfg->fieldSizes[numFields++] = usdEventtriggerTypeSize(et->payloadDesc[j].type);
+      }
+    }
+    for (int j = 0; j < cfg->numVars; ++j) {
+      cfg->fieldSizes[numFields++] = logVarSize(logGetType(cfg->varIds[j]));
+    }
+
+    // The storage for the previous values is assigned below
+    deltaEncoderInit(&cfg->encoder, cfg->fieldSizes, numFields, 0, CONFIG_DECK_USD_KEYFRAME_INTERVAL);
+    totalBytes += cfg->encoder.numBytes;
+  }
+
+  uint8_t* previousValues = pvPortMalloc(totalBytes);
+  if (!previousValues) {
+    return false;
+  }
+
+  for (int i = 0; i < usdLogConfig.numEventConfigs; ++i) {
+    usdLogEventConfig_t* cfg = &usdLogConfig.eventConfigs[i];
+    cfg->encoder.previous = previousValues;
+    previousValues += cfg->encoder.numBytes;
+  }
+
+  return true;
+}
+
+static void usdResetEncoders(void)
+{
+  for (int i = 0; i < usdLogConfig.numEventConfigs; ++i) {
+    deltaEncoderReset(&usdLogConfig.eventConfigs[i].encoder);
+  }
+}
+
+// Must be called with the log buffer mutex taken
+static bool usdPushCompressedEvent(usdLogEventConfig_t* cfg, const uint8_t* payload, uint8_t payloadSize, uint64_t ticks)
+{
+  uint16_t numBytes = 0;
+
+  if (payloadSize) {
+    memcpy(eventValues, payload, payloadSize);
+    numBytes += payloadSize;
+  }
+  for (int i = 0; i < cfg->numVars; ++i) {
+    logVarId_t varid = cfg->varIds[i];
+    uint8_t size = logVarSize(logGetType(varid));
+    memcpy(&eventValues[numBytes], logGetAddress(varid), size);
+    numBytes += size;
+  }
+  ASSERT(numBytes == cfg->encoder.numBytes);
+
+  // The record tag is the index of the event in the file header
+  uint8_t tag = cfg - usdLogConfig.eventConfigs;
+  uint16_t recordSize = deltaEncoderEncode(&cfg->encoder, tag, ticks, eventValues, eventRecord);
+
+  if (!ringBuffer_push(&logBuffer, eventRecord, recordSize)) {
+    // The decoder will not see this event, the next one must not depend on it
+    deltaEncoderReset(&cfg->encoder);
+    return false;
+  }
+
+  return true;
+}
+#endif
+
+static void usddeckWriteEventData(usdLogEventConfig_t* cfg, const uint8_t* payload, uint8_t payloadSize)
 {
   uint64_t ticks = usecTimestamp();
 
@@ -492,6 +635,11 @@ static void usddeckWriteEventData(const usdLogEventConfig_t* cfg, const uint8_t*
     vTaskResume(xHandleWriteTask);
   }
 
+#ifdef CONFIG_DECK_USD_COMPRESSED_LOG
+  if (usdPushCompressedEvent(cfg, payload, payloadSize, ticks)) {
+    ++usdLogStats.eventsWritten;
+  }
+#else
   int dataSize = sizeof(cfg->eventId) + sizeof(ticks) + payloadSize + cfg->numBytes;
 
   // only write if we have enough space
@@ -527,6 +675,7 @@ static void usddeckWriteEventData(const usdLogEventConfig_t* cfg, const uint8_t*
     }
     ++usdLogStats.eventsWritten;
   }
+#endif
   xSemaphoreGive(logBufferMutex);
 }
 
@@ -709,6 +858,23 @@ static void usdLogTask(void* prm)
     }
     ringBuffer_init(&logBuffer, logBufferData, usdLogConfig.bufferSize);
 
+#ifdef CONFIG_DECK_USD_COMPRESSED_LOG
+    if (!usdInitEncoders()) {
+      DEBUG_PRINT("Init compressed log [FAIL].\n");
+      break;
+    }
+#endif
+
+#ifdef CONFIG_DECK_USD_PREALLOCATE
+    writeBlock = pvPortMalloc(USD_WRITE_BLOCK_SIZE + USD_SECTOR_SIZE);
+    if (!writeBlock) {
+      DEBUG_PRINT("malloc write block [FAIL], not preallocating.\n");
+    } else {
+      endMarker = &writeBlock[USD_WRITE_BLOCK_SIZE];
+      memset(endMarker, 0, USD_SECTOR_SIZE);
+    }
+#endif
+
     /* create queue to hand over pointer to usdLogData */
     // usdLogQueue = xQueueCreate(usdLogConfig.queueSize, sizeof(uint8_t*));
 
@@ -805,16 +971,158 @@ static bool handleMemRead(const uint32_t memAddr, const uint8_t readLen, uint8_t
   return result;
 }
 
-static void usdWriteData(const void *data, size_t size)
+static bool usdWriteFile(const void *data, size_t size)
 {
   UINT bytesWritten;
   FRESULT status = f_write(&logFile, data, size, &bytesWritten);
   if (status != FR_OK) {
     DEBUG_PRINT("usd deck write failure %d\n", status);
     enableLogging = false;
-  } else {
+    return false;
+  } else if (bytesWritten != size) {
+    DEBUG_PRINT("usd deck file full\n");
+    enableLogging = false;
+    return false;
+  }
+
+  STATS_CNT_RATE_MULTI_EVENT(&fatWriteRate, bytesWritten);
+  return true;
+}
+
+#ifdef CONFIG_DECK_USD_PREALLOCATE
+/* The preallocated file keeps its full size if the Crazyflie is reset while
+ * logging, and the clusters after the logged data hold whatever was on the
+ * card before. Write an empty sector at the given position and go back, so
+ * that a decoder stops there. */
+static bool usdWriteEndMarker(FSIZE_t position)
+{
+  if (position + USD_SECTOR_SIZE > f_size(&logFile)) {
+    // The file is full, the end is the end of the file
+    return true;
+  }
+
+  FSIZE_t end = f_tell(&logFile);
+  UINT bytesWritten;
+  if (f_lseek(&logFile, position) != FR_OK ||
+      f_write(&logFile, endMarker, USD_SECTOR_SIZE, &bytesWritten) != FR_OK ||
+      f_lseek(&logFile, end) != FR_OK) {
+    DEBUG_PRINT("usd deck end marker failure\n");
+    enableLogging = false;
+    return false;
+  }
+
+  return true;
+}
+
+/* Allocate a contiguous file and map its clusters in RAM (fast seek), so that
+ * FatFs neither allocates clusters nor reads the FAT while logging */
+static bool usdPreallocateFile(void)
+{
+  if (!writeBlock || f_expand(&logFile, USD_PREALLOCATE_SIZE, 1) != FR_OK) {
+    return false;
+  }
+
+  linkMap[0] = USD_LINK_MAP_SIZE;
+  logFile.cltbl = linkMap;
+  if (f_lseek(&logFile, CREATE_LINKMAP) != FR_OK) {
+    logFile.cltbl = 0;
+    return false;
+  }
+
+  // Make the allocation visible in the directory in case of a power loss
+  f_sync(&logFile);
+
+  // Clear the start of the file, in case the header is not written, and
+  // put the first end marker ahead of it
+  writeBlockFill = 0;
+  endMarkerPosition = USD_END_MARKER_DISTANCE;
+  return usdWriteEndMarker(0) && usdWriteEndMarker(endMarkerPosition);
+}
+
+/* Moving the marker for each block would add one non-sequential sector write
+ * per block, so it is only moved when the data reaches it. A reset leaves up
+ * to USD_END_MARKER_DISTANCE bytes of old card content between the data and
+ * the marker, which the decoders stop at when it is not a valid event. */
+static bool usdMoveEndMarker(void)
+{
+  FSIZE_t end = f_tell(&logFile);
+  if (end < endMarkerPosition) {
+    return true;
+  }
+
+  endMarkerPosition = end + USD_END_MARKER_DISTANCE;
+  return usdWriteEndMarker(endMarkerPosition);
+}
+
+/* Only write whole blocks, at sector aligned offsets of the file. Writing a
+ * partial sector inside the allocated file makes FatFs read the sector first. */
+static bool usdWriteBlocks(const uint8_t *data, size_t size)
+{
+  bool success = true;
+  bool wroteBlocks = false;
+
+  while (size > 0 && success) {
+    if (writeBlockFill == 0 && size >= USD_WRITE_BLOCK_SIZE) {
+      // Whole blocks are written straight from the ring buffer
+      size_t blocksSize = size - (size % USD_WRITE_BLOCK_SIZE);
+      success = usdWriteFile(data, blocksSize);
+      wroteBlocks = true;
+      data += blocksSize;
+      size -= blocksSize;
+    } else {
+      size_t chunk = USD_WRITE_BLOCK_SIZE - writeBlockFill;
+      if (chunk > size) {
+        chunk = size;
+      }
+      memcpy(&writeBlock[writeBlockFill], data, chunk);
+      writeBlockFill += chunk;
+      data += chunk;
+      size -= chunk;
+
+      if (writeBlockFill == USD_WRITE_BLOCK_SIZE) {
+        success = usdWriteFile(writeBlock, USD_WRITE_BLOCK_SIZE);
+        wroteBlocks = true;
+        writeBlockFill = 0;
+      }
+    }
+  }
+
+  if (success && wroteBlocks) {
+    success = usdMoveEndMarker();
+  }
+
+  return success;
+}
+
+/* Write the last partial block and cut the file to the logged size */
+static void usdFinalizePreallocatedFile(void)
+{
+  if (writeBlockFill > 0) {
+    usdWriteFile(writeBlock, writeBlockFill);
+    writeBlockFill = 0;
+  }
+
+  // The file can not be truncated in fast seek mode
+  logFile.cltbl = 0;
+  f_truncate(&logFile);
+}
+#endif
+
+static void usdWriteData(const void *data, size_t size)
+{
+  bool success;
+
+#ifdef CONFIG_DECK_USD_PREALLOCATE
+  if (isPreallocated) {
+    success = usdWriteBlocks(data, size);
+  } else
+#endif
+  {
+    success = usdWriteFile(data, size);
+  }
+
+  if (success) {
     crc32Update(&crcContext, data, size);
-    STATS_CNT_RATE_MULTI_EVENT(&fatWriteRate, bytesWritten);
   }
 }
 
@@ -837,6 +1145,9 @@ static void usdWriteTask(void* prm)
       // reset the buffer
       xSemaphoreTake(logBufferMutex, portMAX_DELAY);
       ringBuffer_reset(&logBuffer);
+#ifdef CONFIG_DECK_USD_COMPRESSED_LOG
+      usdResetEncoders();
+#endif
       xSemaphoreGive(logBufferMutex);
 
       xSemaphoreTake(logFileMutex, portMAX_DELAY);
@@ -869,6 +1180,13 @@ static void usdWriteTask(void* prm)
 
         DEBUG_PRINT("Logging to: %s\n", usdLogConfig.filename);
 
+#ifdef CONFIG_DECK_USD_PREALLOCATE
+        isPreallocated = usdPreallocateFile();
+        if (!isPreallocated) {
+          DEBUG_PRINT("Could not preallocate %d MB, logging without preallocation\n", CONFIG_DECK_USD_PREALLOCATE_SIZE_MB);
+        }
+#endif
+
         // iniatialize crc
         crc32ContextInit(&crcContext);
 
@@ -876,7 +1194,7 @@ static void usdWriteTask(void* prm)
         uint8_t magic = 0xBC;
         usdWriteData(&magic, sizeof(magic));
 
-        uint16_t version = 2;
+        uint16_t version = USD_LOG_VERSION;
         usdWriteData(&version, sizeof(version));
 
         uint16_t numEventTypes = usdLogConfig.numEventConfigs;
@@ -1013,6 +1331,13 @@ static void usdWriteTask(void* prm)
         uint32_t crcValue = crc32Out(&crcContext);
         usdWriteData(&crcValue, sizeof(crcValue));
 
+#ifdef CONFIG_DECK_USD_PREALLOCATE
+        if (isPreallocated) {
+          usdFinalizePreallocatedFile();
+          isPreallocated = false;
+        }
+#endif
+
         // close file
         f_close(&logFile);
 
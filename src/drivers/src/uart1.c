@@ -42,14 +42,22 @@
 #include "config.h"
 #include "nvicconf.h"
 #include "static_mem.h"
+#include "autoconf.h"
 
 /** This uart is conflicting with SPI2 DMA used in sensors_bmi088_spi_bmp388.c
  *  which is used in CF-Bolt. So for other products this can be enabled.
  */
 //#define ENABLE_UART1_DMA
 
+#ifdef CONFIG_DECK_LIGHTHOUSE_UART_RX_QUEUE_LENGTH
+  // The lighthouse deck streams frames continuously, buffer enough data to survive a busy period
+  #define UART1_RX_QUEUE_LENGTH CONFIG_DECK_LIGHTHOUSE_UART_RX_QUEUE_LENGTH
+#else
+  #define UART1_RX_QUEUE_LENGTH 64
+#endif
+
 static xQueueHandle uart1queue;
-STATIC_MEM_QUEUE_ALLOC(uart1queue, 64, sizeof(uint8_t));
+STATIC_MEM_QUEUE_ALLOC(uart1queue, UART1_RX_QUEUE_LENGTH, sizeof(uint8_t));
 
 static bool isInit = false;
 static bool hasOverrun = false;
@@ -293,7 +301,10 @@ void __attribute__((used)) USART3_IRQHandler(void)
   {
     portBASE_TYPE xHigherPriorityTaskWoken = pdFALSE;
     uint8_t rxData = USART_ReceiveData(UART1_TYPE) & 0x00FF;
-    xQueueSendFromISR(uart1queue, &rxData, &xHigherPriorityTaskWoken);
+    if (xQueueSendFromISR(uart1queue, &rxData, &xHigherPriorityTaskWoken) != pdTRUE) {
+      // The queue is full, the byte is lost
+      hasOverrun = true;
+    }
     portYIELD_FROM_ISR(xHigherPriorityTaskWoken);
   } else {
     /** if we get here, the error is most likely caused by an overrun!
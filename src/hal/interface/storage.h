@@ -31,6 +31,7 @@
 
 #include <stdbool.h>
 #include <stddef.h>
+#include <stdint.h>
 
 /**
  * Initialize the storage subsystem.
@@ -51,7 +52,9 @@ bool storageTest();
  * it will be replaced.
  *
  * This function can take a lot of time to complete: if there is no space for the new buffer,
- * the memory is going to be defragmented before the new buffer is written.
+ * the memory is going to be defragmented before the new buffer is written. With
+ * CONFIG_STORAGE_BACKGROUND_DEFRAG the holes are compacted in small steps by the worker
+ * task after stores and deletes, which makes this unlikely.
  *
  * This function can fail either if there is no place left in memory or if the memory
  * is corrupted.
@@ -98,6 +101,22 @@ typedef bool (*storageFunc_t)(const char *key, void *buffer, size_t length);
  */
 bool storageForeach(const char* prefix, storageFunc_t func);
 
+typedef struct {
+  size_t fragmentation;          // Percentage of the free space that is in holes
+  size_t holeCount;
+  size_t holeSize;
+  uint32_t worstLockTime;        // Longest store or delete, in us
+  uint32_t worstDefragStepTime;  // Longest background defrag step, in us
+} storageStats_t;
+
+/**
+ * Get fragmentation and timing statistics of the storage
+ *
+ * The worst times are the longest times the storage has been locked since
+ * startup, that is how long a caller could have been blocked.
+ */
+void storageGetStats(storageStats_t *stats);
+
 /**
  * Print storage information on the debug console
  *
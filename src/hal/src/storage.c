@@ -30,6 +30,9 @@
 #include "param.h"
 
 #include "kve/kve.h"
+#include "autoconf.h"
+#include "usec_time.h"
+#include "worker.h"
 
 #include "FreeRTOS.h"
 #include "semphr.h"
@@ -111,13 +114,68 @@ static void flushEeprom(void)
   // NOP for now, lets fix the EEPROM write first!
 }
 
+#ifdef CONFIG_STORAGE_KVE_INDEX
+static kveIndexEntry_t kveIndexEntries[CONFIG_STORAGE_KVE_INDEX_SIZE];
+
+static kveIndex_t kveIndex = {
+  .entries = kveIndexEntries,
+  .size = CONFIG_STORAGE_KVE_INDEX_SIZE,
+};
+#endif
+
 static kveMemory_t kve = {
   .memorySize = KVE_PARTITION_LENGTH,
   .read = readEeprom,
   .write = writeEeprom,
   .flush = flushEeprom,
+#ifdef CONFIG_STORAGE_KVE_INDEX
+  .index = &kveIndex,
+#endif
 };
 
+// Longest time the storage has been locked by a store or delete, and by a
+// background defrag step, in us
+static uint32_t worstLockTime;
+static uint32_t worstDefragStepTime;
+
+static void updateWorstTime(uint32_t *worstTime, uint64_t startTime)
+{
+  uint32_t time = usecTimestamp() - startTime;
+  if (time > *worstTime) {
+    *worstTime = time;
+  }
+}
+
+#ifdef CONFIG_STORAGE_BACKGROUND_DEFRAG
+// Only accessed with the storage mutex taken
+static bool defragScheduled = false;
+
+static void defragWorker(void *arg)
+{
+  xSemaphoreTake(storageMutex, portMAX_DELAY);
+
+  uint64_t startTime = usecTimestamp();
+  bool done = kveDefragStep(&kve, CONFIG_STORAGE_DEFRAG_STEP_SIZE);
+  updateWorstTime(&worstDefragStepTime, startTime);
+
+  // Let other work and storage users run between the steps
+  if (done || workerSchedule(defragWorker, NULL) != 0) {
+    defragScheduled = false;
+  }
+
+  xSemaphoreGive(storageMutex);
+}
+
+static void scheduleDefrag(void)
+{
+  if (!defragScheduled) {
+    defragScheduled = (workerSchedule(defragWorker, NULL) == 0);
+  }
+}
+#else
+static void scheduleDefrag(void) {}
+#endif
+
 // Public API
 
 static bool isInit = false;
@@ -133,11 +191,19 @@ bool storageTest()
 {
   xSemaphoreTake(storageMutex, portMAX_DELAY);
 
+  uint64_t checkStart = usecTimestamp();
   bool pass = kveCheck(&kve);
+  uint32_t checkTime = usecTimestamp() - checkStart;
 
   xSemaphoreGive(storageMutex);
 
-  DEBUG_PRINT("Storage check %s.\n", pass?"[OK]":"[FAIL]");
+  DEBUG_PRINT("Storage check %s (%d ms).\n", pass?"[OK]":"[FAIL]", (int)(checkTime / 1000));
+
+#ifdef CONFIG_STORAGE_KVE_INDEX
+  if (pass) {
+    DEBUG_PRINT("Storage index %s, %d items indexed.\n", kveIndex.valid?"[OK]":"[TOO SMALL]", kveIndex.used);
+  }
+#endif
 
   if (!pass) {
     pass = storageReformat();
@@ -154,7 +220,16 @@ bool storageStore(const char* key, const void* buffer, size_t length)
 
   xSemaphoreTake(storageMutex, portMAX_DELAY);
 
-  bool result = kveStore(&kve, key, buffer, length);
+  uint64_t startTime = usecTimestamp();
+  bool leftHole = false;
+  bool result = kveStoreReportHole(&kve, key, buffer, length, &leftHole);
+  updateWorstTime(&worstLockTime, startTime);
+
+  // Only replacing an item with one of a different size leaves a hole,
+  // overwriting in place does not need a defrag pass
+  if (leftHole) {
+    scheduleDefrag();
+  }
 
   xSemaphoreGive(storageMutex);
 
@@ -200,7 +275,13 @@ bool storageDelete(const char* key)
 
   xSemaphoreTake(storageMutex, portMAX_DELAY);
 
+  uint64_t startTime = usecTimestamp();
   bool result = kveDelete(&kve, key);
+  updateWorstTime(&worstLockTime, startTime);
+
+  if (result) {
+    scheduleDefrag();
+  }
 
   xSemaphoreGive(storageMutex);
 
@@ -238,13 +319,31 @@ void storagePrintStats()
 
 
   DEBUG_PRINT("Used storage: %d item stored, %d Bytes/%d Bytes (%d%%)\n", stats.totalItems, stats.itemSize, stats.totalSize, (stats.itemSize*100)/stats.totalSize);
-  DEBUG_PRINT("Fragmentation: %d%%\n", stats.fragmentation);
+  DEBUG_PRINT("Fragmentation: %d%% (%d holes, %d Bytes)\n", stats.fragmentation, stats.holeCount, stats.holeSize);
+  DEBUG_PRINT("Worst lock time: store/delete %d us, defrag step %d us\n", (int)worstLockTime, (int)worstDefragStepTime);
   DEBUG_PRINT("Efficiency: Data: %d Bytes (%d%%), Keys: %d Bytes (%d%%), Metadata: %d Bytes (%d%%)\n",
     stats.dataSize, (stats.dataSize*100)/stats.totalSize,
     stats.keySize, (stats.keySize*100)/stats.totalSize,
     stats.metadataSize, (stats.metadataSize*100)/stats.totalSize);
 }
 
+void storageGetStats(storageStats_t *stats)
+{
+  kveStats_t kveStats;
+
+  xSemaphoreTake(storageMutex, portMAX_DELAY);
+
+  kveGetStats(&kve, &kveStats);
+
+  stats->fragmentation = kveStats.fragmentation;
+  stats->holeCount = kveStats.holeCount;
+  stats->holeSize = kveStats.holeSize;
+  stats->worstLockTime = worstLockTime;
+  stats->worstDefragStepTime = worstDefragStepTime;
+
+  xSemaphoreGive(storageMutex);
+}
+
 static bool storageStats;
 
 static void printStats(void)
@@ -36,6 +36,12 @@
 
 #include "math3d.h"
 #include "stabilizer_types.h"
+#include "peer_localization.h"
+
+
+// Each face of the Voronoi cell is defined by a linear inequality a^T x <= b.
+// The six extra faces come from the overall flight area bounding box.
+#define COLLISION_AVOIDANCE_MAX_CELL_ROWS (PEER_LOCALIZATION_MAX_NEIGHBORS + 6)
 
 
 // Algorithm parameters. They can be changed online by the user, but the
@@ -105,12 +111,35 @@ typedef struct collision_avoidance_state_s
   // state as a setpoint.
   struct vec lastFeasibleSetPosition;
 
+  // Lagrange multipliers of the latest projection into our cell, the first
+  // six for the bounding box faces followed by one per neighbor face. The
+  // cell and the goal change little between two updates, so the next
+  // projection starts from these values instead of from scratch. Any
+  // nonnegative values are a valid start, zero initialization is fine.
+  float projectionMultipliers[COLLISION_AVOIDANCE_MAX_CELL_ROWS];
+
+  // The peer of each neighbor face in projectionMultipliers. The neighbors
+  // that constrain the cell, and their order, change between updates, so the
+  // multiplier of a face is looked up by peer.
+  uint8_t projectionMultiplierPeers[PEER_LOCALIZATION_MAX_NEIGHBORS];
+
+  // Number of neighbors that constrained our cell in the latest update.
+  // Neighbors too far away to be reached within the horizon are left out.
+  int nCellNeighbors;
+
+  // Number of iterations of the latest projection into our cell.
+  int nProjectionIters;
+
 } collision_avoidance_state_t;
 
 
 // Main computational routine. Mutates the setpoint such that the new setpoint
 // respects the buffered Voronoi cell constraint.
 //
+// Neighbors that can not be reached within the horizon do not constrain the
+// cell and are left out, and the projection into the cell is warm started from
+// the previous update, so the typical cost is much lower than the worst case.
+//
 // To facilitate compiling and testing on a PC, we take neighbour positions via
 // array instead of having the implementation call peer_localization.h functions
 // directly. On the other hand, we wish to use the minimum possible amount of
@@ -123,7 +152,10 @@ typedef struct collision_avoidance_state_s
 //   collisionState: Algorithm mutable state.
 //   nOthers: Number of other Crazyflies in array arguments.
 //   otherPositions: [nOthers * 3] array of positions (meters).
-//   workspace: Space of no less than 7 * (nOthers + 6) floats. Used for
+//   otherIds: [nOthers] array of peer ids, used to warm start the projection.
+//     If NULL, the index in otherPositions is used instead, which is only
+//     a good warm start if the order of the neighbors does not change.
+//   workspace: Space of no less than 5 * (nOthers + 6) floats. Used for
 //     temporary storage during computation. This can be the same address as
 //     otherPositions - otherPositions is copied into workspace immediately.
 //   setpoint: Setpoint from commander that will be mutated.
@@ -135,6 +167,7 @@ void collisionAvoidanceUpdateSetpointCore(
   collision_avoidance_state_t *collisionState,
   int nOthers,
   float const *otherPositions,
+  uint8_t const *otherIds,
   float *workspace,
   setpoint_t *setpoint, sensorData_t const *sensorData, state_t const *state);
 
@@ -228,6 +228,28 @@ int crtpCommanderHighLevelStartTrajectory(const uint8_t trajectoryId, const floa
  */
 int crtpCommanderHighLevelDefineTrajectory(const uint8_t trajectoryId, const crtpCommanderTrajectoryType_t type, const uint32_t offset, const uint8_t nPieces);
 
+/**
+ * @brief Define a streamed trajectory. Pieces are appended with crtpCommanderHighLevelAppendTrajectory(), before
+ *        and while the trajectory is flown. Pieces are freed when they have been flown, which makes it possible to fly
+ *        trajectories that do not fit in the trajectory memory. Any previously appended pieces are removed.
+ *
+ * @param trajectoryId The id of the trajectory
+ * @return zero if the command succeeded, an error code otherwise
+ */
+int crtpCommanderHighLevelDefineStreamTrajectory(const uint8_t trajectoryId);
+
+/**
+ * @brief Append poly4d pieces, previously uploaded to memory, to a streamed trajectory. All pieces are appended
+ *        or none. The number of pieces that can be appended is available in the hlStream.free log variable.
+ *
+ * @param trajectoryId The id of the trajectory (previously defined by crtpCommanderHighLevelDefineStreamTrajectory())
+ * @param offset       offset of the pieces in uploaded memory (bytes)
+ * @param nPieces      Nr of pieces to append
+ * @param isLast       set to true, if no more pieces will be appended
+ * @return zero if the pieces were appended, EAGAIN if there is not enough space, an error code otherwise
+ */
+int crtpCommanderHighLevelAppendTrajectory(const uint8_t trajectoryId, const uint32_t offset, const uint8_t nPieces, const bool isLast);
+
 /**
  * @brief Get the size of the allocated trajectory memory
  *
@@ -56,6 +56,7 @@ typedef enum {
   MeasurementTypeGyroscope,
   MeasurementTypeAcceleration,
   MeasurementTypeBarometer,
+  MeasurementTypeSweepAngleBatch,
 } MeasurementType;
 
 typedef struct
@@ -75,6 +76,7 @@ typedef struct
     gyroscopeMeasurement_t gyroscope;
     accelerationMeasurement_t acceleration;
     barometerMeasurement_t barometer;
+    sweepAngleBatchMeasurement_t sweepAngleBatch;
   } data;
 } measurement_t;
 
@@ -161,9 +163,30 @@ static inline void estimatorEnqueueSweepAngles(const sweepAngleMeasurement_t *sw
   estimatorEnqueue(&m);
 }
 
+static inline void estimatorEnqueueSweepAngleBatch(const sweepAngleBatchMeasurement_t *sweepAngleBatch)
+{
+  measurement_t m;
+  m.type = MeasurementTypeSweepAngleBatch;
+  m.data.sweepAngleBatch = *sweepAngleBatch;
+  estimatorEnqueue(&m);
+}
+
 // Helper function for state estimators
 bool estimatorDequeue(measurement_t *measurement);
 
+// Load of the estimator, used by measurement sources to adapt the rate of measurements they produce
+typedef struct {
+  uint16_t queueLength;       // Measurements currently waiting in the queue
+  uint16_t queueSize;         // Max number of measurements in the queue
+  uint32_t notAppendedCount;  // Total number of measurements that were dropped due to a full queue
+  uint32_t updateDurationUs;  // Duration of the latest measurement update in the estimator, 0 if not reported
+} estimatorLoad_t;
+
+void estimatorGetLoad(estimatorLoad_t* load);
+
+// Called by state estimators to report the time spent on processing queued measurements
+void estimatorReportUpdateDuration(const uint32_t durationUs);
+
 #ifdef CONFIG_ESTIMATOR_OOT
 void estimatorOutOfTreeInit(void);
 bool estimatorOutOfTreeTest(void);
@@ -167,4 +167,22 @@ void kalmanCoreDecoupleXY(kalmanCoreData_t* this);
 
 void kalmanCoreScalarUpdate(kalmanCoreData_t* this, arm_matrix_instance_f32 *Hm, float error, float stdMeasNoise);
 
+/**
+ * @brief Gate used to decide if a measurement should be used, based on the innovation and the innovation variance
+ *
+ * @param context The context passed to kalmanCoreScalarUpdateGated()
+ * @param error The innovation, measured - predicted
+ * @param innovationVariance The innovation variance, HPH' + R
+ * @return true If the measurement should be used
+ */
+typedef bool (*kalmanCoreInnovationGate_t)(void* context, const float error, const float innovationVariance);
+
+/**
+ * @brief Same as kalmanCoreScalarUpdate() but the update is only done if the gate accepts the measurement. The gate
+ * is called with the innovation variance that is computed for the update anyway.
+ *
+ * @return true If the update was done
+ */
+bool kalmanCoreScalarUpdateGated(kalmanCoreData_t* this, arm_matrix_instance_f32 *Hm, float error, float stdMeasNoise, kalmanCoreInnovationGate_t gate, void* gateContext);
+
 void kalmanCoreUpdateWithPKE(kalmanCoreData_t* this, arm_matrix_instance_f32 *Hm, arm_matrix_instance_f32 *Km, arm_matrix_instance_f32 *P_w_m, float error);
@@ -30,3 +30,7 @@
 
 // Measurement of sweep angles from a Lighthouse base station
 void kalmanCoreUpdateWithSweepAngles(kalmanCoreData_t *this, sweepAngleMeasurement_t *angles, const uint32_t nowMs, OutlierFilterLhState_t* sweepOutlierFilterState);
+
+// Measurement of sweep angles from all sensors for one sweep of a Lighthouse base station.
+// The geometry is computed once for all sensors and the sensors are applied as one block update.
+void kalmanCoreUpdateWithSweepAngleBatch(kalmanCoreData_t *this, sweepAngleBatchMeasurement_t *angles, const uint32_t nowMs, OutlierFilterLhState_t* sweepOutlierFilterState);
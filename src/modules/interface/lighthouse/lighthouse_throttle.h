@@ -28,15 +28,23 @@
 #include <inttypes.h>
 #include <stdbool.h>
 
+/**
+ * @brief Initialize the throttling state
+ */
+void throttleLh2Init();
+
 /**
  * @brief Throttles how much of the data from lighthouse base stations that is used. When multiple base stations
  * are received, pushing all the data to the estimator is nor necessary and it increases the risk of overloading
  * the system.
  *
- * This function tries to limit the rate of the samples used by randomly discarding samples when needed.
+ * This function tries to limit the rate of the samples used by randomly discarding samples when needed. The rate
+ * is adapted to the load of the estimator, and samples from base stations that have not been used recently are
+ * always used.
  *
  * @param now_ms The current time in ms
+ * @param baseStation The base station the sample is from
  * @return true   If the sample is to be used
  * @return false  If the sample should be discarded
  */
-bool throttleLh2Samples(const uint32_t now_ms);
+bool throttleLh2Samples(const uint32_t now_ms, const int baseStation);
@@ -1009,5 +1009,66 @@ static inline struct vec vprojectpolytope(struct vec v, float const A[], float c
 	return x;
 }
 
+// Same as vprojectpolytope, but warm started from the Lagrange multipliers of
+// an earlier projection, typically into the same polytope at the previous
+// time step. For half spaces, Dykstra's algorithm is coordinate ascent on the
+// dual problem, so it converges to the projection from any nonnegative
+// multipliers. Good multipliers only make it converge in fewer iterations.
+//
+// Args:
+//   v, A, b, tolerance, maxiters: see vprojectpolytope.
+//   multipliers: n vector. Input: multipliers to start from, negative or NaN
+//     values are treated as 0. Output: the multipliers of the result.
+//   iters: if not NULL, the number of iterations is written here.
+//
+// Returns:
+//   The projection of v into the polytope.
+//
+static inline struct vec vprojectpolytopewarm(struct vec v, float const A[], float const b[], float multipliers[], int n, float tolerance, int maxiters, int *iters)
+{
+	if (iters != NULL) {
+		*iters = 0;
+	}
+
+	// early bailout, no constraint is active.
+	if (vinpolytope(v, A, b, n, tolerance)) {
+		for (int i = 0; i < n; ++i) {
+			multipliers[i] = 0.0f;
+		}
+		return v;
+	}
+
+	// the increment of Dykstra's algorithm for row i is -multipliers[i] * a_i.
+	struct vec x = v;
+	for (int i = 0; i < n; ++i) {
+		if (!(multipliers[i] > 0.0f)) {
+			multipliers[i] = 0.0f;
+		}
+		x = vsub(x, vscl(multipliers[i], vloadf(A + 3 * i)));
+	}
+
+	// see vprojectpolytope for the stopping criteria.
+	float const tolerance2 = n * fsqr(tolerance) / 10.0f;
+
+	for (int iter = 0; iter < maxiters; ++iter) {
+		if (iters != NULL) {
+			*iters = iter + 1;
+		}
+		float c = 0.0f;
+		for (int i = 0; i < n; ++i) {
+			struct vec ai = vloadf(A + 3 * i);
+			struct vec y = vadd(x, vscl(multipliers[i], ai));
+			float const multiplier = fmaxf(0.0f, vdot(ai, y) - b[i]);
+			x = vsub(y, vscl(multiplier, ai));
+			c += fsqr(multiplier - multipliers[i]);
+			multipliers[i] = multiplier;
+		}
+		if (c < tolerance2) {
+			return x;
+		}
+	}
+	return x;
+}
+
 
 // Overall TODO: lines? segments? planes? axis-aligned boxes? spheres?
@@ -0,0 +1,78 @@
+/**
+ *    ||          ____  _ __
+ * +------+      / __ )(_) /_______________ _____  ___
+ * | 0xBC |     / __  / / __/ ___/ ___/ __ `/_  / / _ \
+ * +------+    / /_/ / / /_/ /__/ /  / /_/ / / /_/  __/
+ *  ||  ||    /_____/_/\__/\___/_/   \__,_/ /___/\___/
+ *
+ * Copyright (C) 2023 Bitcraze AB
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, in version 3.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ *
+ * Generic outlier gating with statistics per measurement source
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+
+// The max number of sources tracked by a bank, must be a power of 2
+#define OUTLIER_FILTER_BANK_SIZE 32
+
+#define OUTLIER_FILTER_BANK_NO_SOURCE 0xffff
+
+typedef struct {
+    uint16_t sourceId;
+    float acceptanceRate;  // Exponential average of the ratio of samples that are within the gate
+    float gate;            // Max normalized innovation squared that is accepted
+    uint32_t latestUpdateMs;
+} outlierFilterBankSource_t;
+
+typedef struct {
+    outlierFilterBankSource_t sources[OUTLIER_FILTER_BANK_SIZE];
+
+    // All sources together, used to detect a diverged estimator
+    float acceptanceRate;
+    bool isOpen;
+
+    // One source can be monitored, for instance through the log system
+    uint16_t monitoredSourceId;
+    float monitoredAcceptanceRate;
+} outlierFilterBank_t;
+
+void outlierFilterBankReset(outlierFilterBank_t* this);
+
+/**
+ * @brief Chi-square gating of a scalar measurement. The normalized innovation squared (error^2 / innovation variance)
+ * is compared to the gate of the source. The gate is tightened for sources that often are outside of the gate, and
+ * samples from sources that are mostly outside are rejected. If most samples from all sources are outside the gate,
+ * the estimator has probably diverged and all samples are accepted until it has recovered.
+ *
+ * Sources are found in constant time, if the bank is full the least recently used source is replaced.
+ *
+ * @param this The bank
+ * @param sourceId Id of the source of the measurement, for instance a pair of anchors
+ * @param error The innovation, measured - predicted
+ * @param innovationVariance The innovation variance, HPH' + R
+ * @param nowMs The current time
+ * @return true If the sample should be used
+ */
+bool outlierFilterBankValidate(outlierFilterBank_t* this, const uint16_t sourceId, const float error, const float innovationVariance, const uint32_t nowMs);
+
+/**
+ * @brief Get the statistics for a source
+ *
+ * @return The source, or 0 if the source is not in the bank
+ */
+const outlierFilterBankSource_t* outlierFilterBankGetSource(const outlierFilterBank_t* this, const uint16_t sourceId);
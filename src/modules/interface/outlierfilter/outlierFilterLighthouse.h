@@ -25,11 +25,24 @@
 #pragma once
 
 #include "stabilizer_types.h"
+#include "autoconf.h"
+
+#ifdef CONFIG_ESTIMATOR_KALMAN_OUTLIER_FILTER_BANK
+#include "outlierFilterBank.h"
+#endif
 
 typedef struct {
     uint32_t openingTimeMs;
     int32_t openingWindowMs;
+#ifdef CONFIG_ESTIMATOR_KALMAN_OUTLIER_FILTER_BANK
+    outlierFilterBank_t bank;
+#endif
 } OutlierFilterLhState_t;
 
 bool outlierFilterLighthouseValidateSweep(OutlierFilterLhState_t* this, const float distanceToBs, const float angleError, const uint32_t nowMs);
 void outlierFilterLighthouseReset(OutlierFilterLhState_t* this, const uint32_t nowMs);
+
+#ifdef CONFIG_ESTIMATOR_KALMAN_OUTLIER_FILTER_BANK
+// Chi-square gating with statistics per base station and sensor
+bool outlierFilterLighthouseValidateChiSquare(OutlierFilterLhState_t* this, const uint8_t baseStation, const uint8_t sensor, const float error, const float innovationVariance, const uint32_t nowMs);
+#endif
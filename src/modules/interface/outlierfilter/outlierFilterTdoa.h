@@ -25,12 +25,25 @@
 #pragma once
 
 #include "stabilizer_types.h"
+#include "autoconf.h"
+
+#ifdef CONFIG_ESTIMATOR_KALMAN_OUTLIER_FILTER_BANK
+#include "outlierFilterBank.h"
+#endif
 
 typedef struct {
     float integrator;
     uint32_t latestUpdateMs;
     bool isFilterOpen;
+#ifdef CONFIG_ESTIMATOR_KALMAN_OUTLIER_FILTER_BANK
+    outlierFilterBank_t bank;
+#endif
 } OutlierFilterTdoaState_t;
 
 void outlierFilterTdoaReset(OutlierFilterTdoaState_t* this);
 bool outlierFilterTdoaValidateIntegrator(OutlierFilterTdoaState_t* this, const tdoaMeasurement_t* tdoa, const float error, const uint32_t nowMs);
+
+#ifdef CONFIG_ESTIMATOR_KALMAN_OUTLIER_FILTER_BANK
+// Chi-square gating with statistics per anchor pair
+bool outlierFilterTdoaValidateChiSquare(OutlierFilterTdoaState_t* this, const tdoaMeasurement_t* tdoa, const float error, const float innovationVariance, const uint32_t nowMs);
+#endif
@@ -0,0 +1,107 @@
+/**
+ *    ||          ____  _ __
+ * +------+      / __ )(_) /_______________ _____  ___
+ * | 0xBC |     / __  / / __/ ___/ ___/ __ `/_  / / _ \
+ * +------+    / /_/ / / /_/ /__/ /  / /_/ / / /_/  __/
+ *  ||  ||    /_____/_/\__/\___/_/   \__,_/ /___/\___/
+ *
+ * Crazyflie Firmware
+ *
+ * Copyright (C) 2024 Bitcraze AB
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, in version 3.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ *
+ * peer_gossip.h - Packet format and rate control for sharing the states of
+ * Crazyflies over the P2P radio
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "stabilizer_types.h"
+
+// Each packet holds the state of the sender, if it has a valid position,
+// followed by the states of other Crazyflies that the sender relays. The
+// number of entries is given by the packet size.
+#define PEER_GOSSIP_MAX_ENTRIES 4
+
+// Only states that are at most this old are relayed, so that states do not
+// circulate in the swarm after a Crazyflie has gone away.
+#define PEER_GOSSIP_MAX_RELAY_AGE_MS 500
+
+// Our own state is only sent when the Kalman estimator is used and the
+// standard deviation of its position is below this value [m], so that a
+// Crazyflie without positioning, or whose estimate has not converged, is not
+// taken for a Crazyflie at the position it happens to estimate.
+#define PEER_GOSSIP_MAX_POSITION_STD_DEV 0.5f
+
+// The number of packets per second that all Crazyflies within radio range
+// together may send, and the limits for the period of one Crazyflie.
+#define PEER_GOSSIP_CHANNEL_BUDGET 200
+#define PEER_GOSSIP_MIN_PERIOD_MS 20
+#define PEER_GOSSIP_MAX_PERIOD_MS 500
+
+typedef struct {
+  uint8_t id;
+  uint8_t age;    // age of the state, 10 ms
+  int16_t x;      // mm
+  int16_t y;
+  int16_t z;
+  int16_t vx;     // cm/s
+  int16_t vy;
+  int16_t vz;
+} __attribute__((packed)) peerGossipEntry_t;
+
+typedef struct {
+  peerGossipEntry_t entries[PEER_GOSSIP_MAX_ENTRIES];
+} __attribute__((packed)) peerGossipPacket_t;
+
+/**
+ * @brief Fill a packet with our own state followed by the freshest states to
+ * relay from the peer localization table. Peers are relayed round robin, the
+ * cursor holds the position in the table between calls.
+ *
+ * @param packet The packet to fill
+ * @param ownId Our radio id
+ * @param pos Our position, or NULL to only relay other Crazyflies
+ * @param vel Our velocity, or NULL to only relay other Crazyflies
+ * @param nowMs The current time
+ * @param cursor Position in the peer localization table, initialize to 0
+ * @return The size of the packet in bytes
+ */
+int peerGossipFillPacket(peerGossipPacket_t* packet, uint8_t ownId, const point_t* pos, const velocity_t* vel, uint32_t nowMs, int* cursor);
+
+/**
+ * @brief Feed the states in a received packet to the peer localization table.
+ * Our own state, and states that are older than what is in the table, are
+ * ignored.
+ *
+ * @param packet The received packet
+ * @param size The size of the packet in bytes
+ * @param ownId Our radio id
+ * @param nowMs The current time
+ * @return The number of states that were used, or -1 if the size is invalid
+ */
+int peerGossipHandlePacket(const peerGossipPacket_t* packet, int size, uint8_t ownId, uint32_t nowMs);
+
+/**
+ * @brief Compute the period between our packets. The number of Crazyflies
+ * within radio range is estimated from the rate of received P2P packets, of
+ * all kinds, and our current period. The channel budget is then shared equally.
+ *
+ * @param rxPacketsPerSecond The rate of received P2P packets
+ * @param periodMs Our current period
+ * @return The new period
+ */
+uint32_t peerGossipComputePeriodMs(float rxPacketsPerSecond, uint32_t periodMs);
@@ -0,0 +1,46 @@
+/**
+ *    ||          ____  _ __
+ * +------+      / __ )(_) /_______________ _____  ___
+ * | 0xBC |     / __  / / __/ ___/ ___/ __ `/_  / / _ \
+ * +------+    / /_/ / / /_/ /__/ /  / /_/ / / /_/  __/
+ *  ||  ||    /_____/_/\__/\___/_/   \__,_/ /___/\___/
+ *
+ * Crazyflie Firmware
+ *
+ * Copyright (C) 2024 Bitcraze AB
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, in version 3.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ *
+ * peer_gossip_service.h - Broadcasts the state of this Crazyflie, and relays
+ * the states of other Crazyflies, over the P2P radio
+ */
+
+#pragma once
+
+#include <stdbool.h>
+#include "radiolink.h"
+
+// The P2P port used for the state packets
+#define PEER_GOSSIP_P2P_PORT 14
+
+void peerGossipServiceInit();
+bool peerGossipServiceTest();
+
+/**
+ * @brief Handle a received P2P packet. The service registers this handler as
+ * the P2P callback. Apps that register their own P2P callback should forward
+ * all packets to it to keep the service running.
+ *
+ * @return true if the packet was a state packet
+ */
+bool peerGossipP2PIncomingHandler(P2PPacket *p);
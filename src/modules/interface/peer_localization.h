@@ -5,15 +5,38 @@
 #include "math3d.h"
 #include "stabilizer_types.h"
 
-// This module tracks the positions of other Crazyflies. Currently, only motion
-// capture localization is supported. Mocap setups transmit position
-// measurements on the radio in broadcast mode, so we can obtain the positions
-// of other Crazyflies on the same radio "for free". In the future, other
-// methods of peer localization such as peer-to-peer sharing could be added.
+// This module tracks the positions of other Crazyflies. Mocap setups transmit
+// position measurements on the radio in broadcast mode, so we can obtain the
+// positions of other Crazyflies on the same radio "for free". Crazyflies can
+// also share their states peer-to-peer, see peer_gossip_service.h.
 
 // The maximum number of other Crazyflie ID's to track. This constant may be
 // needed for static allocations in other modules, e.g. collision avoidance.
-#define PEER_LOCALIZATION_MAX_NEIGHBORS 10
+#ifdef CONFIG_PEER_LOCALIZATION_MAX_NEIGHBORS
+#define PEER_LOCALIZATION_MAX_NEIGHBORS CONFIG_PEER_LOCALIZATION_MAX_NEIGHBORS
+#else
+#define PEER_LOCALIZATION_MAX_NEIGHBORS 64
+#endif
+
+// When the table is full, the least recently updated peer is replaced by a new
+// peer if it has not been updated for this long.
+#define PEER_LOCALIZATION_EVICTION_AGE_MS 1000
+
+// Peers that have not been updated for this long are removed from the table,
+// so that iterating over the peers does not visit Crazyflies that have gone
+// away. The table is checked when a peer is updated, at most every
+// PEER_LOCALIZATION_STALE_CHECK_INTERVAL_MS. 0 keeps peers until the table is
+// full.
+#ifdef CONFIG_PEER_LOCALIZATION_STALE_AGE_MS
+#define PEER_LOCALIZATION_STALE_AGE_MS CONFIG_PEER_LOCALIZATION_STALE_AGE_MS
+#else
+#define PEER_LOCALIZATION_STALE_AGE_MS 5000
+#endif
+#define PEER_LOCALIZATION_STALE_CHECK_INTERVAL_MS 100
+
+// Velocities are estimated from consecutive positions that are no further
+// apart in time than this, otherwise the velocity is reset to zero.
+#define PEER_LOCALIZATION_VELOCITY_MAX_DT_MS 500
 
 // Initialize and test the module.
 void peerLocalizationInit();
@@ -22,22 +45,52 @@ bool peerLocalizationTest();
 typedef struct peerLocalizationOtherPosition_s {
   uint8_t id;  // CF id
   point_t pos; // position and timestamp (millisecs)
+  velocity_t vel; // estimated velocity, from consecutive positions
 } peerLocalizationOtherPosition_t;
 
 // Tell the peer localization system the position of another Crazyflie.
 // Should be called when the position is already known with high accuracy,
 // e.g. when a motion capture measurement packet is received.
+// Returns false if the table is full of recently updated peers, or the id is
+// not in 1 to 255.
 bool peerLocalizationTellPosition(int id, positionMeasurement_t const *pos);
 
+// Tell the peer localization system the position and velocity of another
+// Crazyflie as it was at pos->timestamp, e.g. when relayed by other Crazyflies.
+// Returns false if the state is not newer than the one in the table, the table
+// is full of recently updated peers, or the id is not in 1 to 255.
+bool peerLocalizationTellState(int id, point_t const *pos, velocity_t const *vel);
+
 // Returns true if we have a position value for the given radio ID.
 bool peerLocalizationIsIDActive(uint8_t id);
 
 // Returns the position value for the given radio ID, or NULL if none exists.
-// Performs a linear search.
+// Constant time lookup. The table is updated by other tasks, which may move
+// or remove the peer, use the copy functions below to read a consistent state.
 peerLocalizationOtherPosition_t *peerLocalizationGetPositionByID(uint8_t id);
 
+// Returns the number of peers in the table. The active peers are at index 0 to
+// count - 1, in no particular order.
+int peerLocalizationGetCount();
+
 // Returns the position value based on index, uncorrelated with radio ID. More
-// efficient if iterating over all peers is needed.
+// efficient if iterating over all peers is needed. Returns NULL if idx is not
+// less than peerLocalizationGetCount(). Note that the index of a peer may
+// change when another peer is removed.
 peerLocalizationOtherPosition_t *peerLocalizationGetPositionByIdx(uint8_t idx);
 
+// Copies the peer at index idx to dest, in a critical section so that the copy
+// is consistent while other tasks update the table. Returns false if idx is
+// not less than the number of peers, which may change between calls.
+bool peerLocalizationCopyPositionByIdx(int idx, peerLocalizationOtherPosition_t *dest);
+
+// Copies the positions, as x, y, z, and the ids of at most maxCount peers that
+// have been updated within maxAgeMs, or of all peers if maxAgeMs is negative.
+// All peers are copied in one critical section. Returns the number of peers.
+int peerLocalizationCopyPositions(float *positions, uint8_t *ids, int maxCount, int32_t maxAgeMs);
+
+// Removes peers that have not been updated for more than maxAgeMs. Called
+// periodically with PEER_LOCALIZATION_STALE_AGE_MS when peers are updated.
+void peerLocalizationRemoveStale(uint32_t maxAgeMs);
+
 #endif // __PEER_LOCALIZATION_H__
@@ -43,6 +43,7 @@ Header file for planning state machine
 #include "math3d.h"
 #include "pptraj.h"
 #include "pptraj_compressed.h"
+#include "pptraj_stream.h"
 
 enum trajectory_state
 {
@@ -59,7 +60,8 @@ enum trajectory_state
 enum trajectory_type
 {
 	TRAJECTORY_TYPE_PIECEWISE            = 0,
-	TRAJECTORY_TYPE_PIECEWISE_COMPRESSED = 1
+	TRAJECTORY_TYPE_PIECEWISE_COMPRESSED = 1,
+	TRAJECTORY_TYPE_PIECEWISE_STREAM     = 2
 };
 
 struct planner
@@ -71,8 +73,10 @@ struct planner
 	union {
 		const struct piecewise_traj* trajectory; // pointer to trajectory
 		struct piecewise_traj_compressed* compressed_trajectory; // pointer to compressed trajectory
+		struct piecewise_traj_stream* stream_trajectory; // pointer to streamed trajectory
 	};
 
+	struct piecewise_cursor cursor; // playhead of the piecewise trajectory
 	struct piecewise_traj planned_trajectory; // trajectory for on-board planning
 	struct poly4d pieces[1]; // the on-board planner requires a single piece, only
 };
@@ -118,7 +122,15 @@ int plan_go_to_from(struct planner *p, const struct traj_eval *curr_eval, bool r
 int plan_start_trajectory(struct planner *p, struct piecewise_traj* trajectory, bool reversed, bool relative, struct vec start_from);
 
 // start compressed trajectory. start_from param is ignored if relative == false.
-int plan_start_compressed_trajectory(struct planner *p, struct piecewise_traj_compressed* trajectory, bool relative, struct vec start_from);
+int plan_start_compressed_trajectory(struct planner *p, struct piecewise_traj_compressed* trajectory, bool reversed, bool relative, struct vec start_from);
+
+// start streamed trajectory, at least one piece must have been appended.
+// start_from param is ignored if relative == false.
+int plan_start_stream_trajectory(struct planner *p, struct piecewise_traj_stream* trajectory, bool relative, struct vec start_from);
 
 // Query if the trjectory is finished
 bool plan_is_finished(struct planner *p, float t);
+
+// must be called when the pieces of the trajectory may have changed while it
+// is flown, for instance by a write to the trajectory memory.
+void plan_trajectory_changed(struct planner *p);
@@ -52,6 +52,10 @@ Header file for piecewise polynomial trajectories
 // evaluate a polynomial using horner's rule.
 float polyval(float const p[PP_SIZE], float t);
 
+// evaluate a polynomial and its first three derivatives in a single pass of horner's rule.
+// out[0] = p(t), out[1] = p'(t), out[2] = p''(t), out[3] = p'''(t).
+void polyval_derivs(float const p[PP_SIZE], float t, float out[4]);
+
 // construct a linear polynomial from p(0) = x0 to p(duration) = x1.
 void polylinear(float p[PP_SIZE], float duration, float x0, float x1);
 
@@ -136,6 +140,11 @@ bool is_traj_eval_valid(struct traj_eval const *ev);
 // evaluate a single polynomial piece
 struct traj_eval poly4d_eval(struct poly4d const *p, float t);
 
+// evaluate a single polynomial piece with the time derivatives scaled by dt,
+// e.g. dt == 0.5 evaluates a piece that has been stretched to take 2x longer at t * 2.
+// dt < 0 evaluates the piece in reverse.
+struct traj_eval poly4d_eval_scaled(struct poly4d const *p, float t, float dt);
+
 
 
 // ----------------------------------//
@@ -175,7 +184,40 @@ struct traj_eval piecewise_eval_reversed(
 	struct piecewise_traj const *traj, float t);
 
 
+// playhead for repeated evaluation of the same trajectory.
+// remembers the current piece, so that evaluating at a time close to the
+// previous one does not require a search from the first piece.
+// times are unscaled, i.e. independent of t_begin and timescale.
+struct piecewise_cursor
+{
+	unsigned char piece; // index of the current piece
+	float piece_begin;   // start time of the current piece
+	float duration;      // duration of all pieces
+};
+
+// must be called when the playhead is used for a new trajectory,
+// or when the pieces of the trajectory have changed.
+void piecewise_cursor_reset(struct piecewise_cursor *cursor,
+	struct piecewise_traj const *traj);
+
+// same as piecewise_eval, amortized O(1) when t changes by less than a piece
+// between calls.
+struct traj_eval piecewise_eval_cursor(
+	struct piecewise_traj const *traj, struct piecewise_cursor *cursor, float t);
+
+// same as piecewise_eval_reversed, amortized O(1) when t changes by less than
+// a piece between calls.
+struct traj_eval piecewise_eval_reversed_cursor(
+	struct piecewise_traj const *traj, struct piecewise_cursor *cursor, float t);
+
+
 static inline bool piecewise_is_finished(struct piecewise_traj const *traj, float t)
 {
 	return (t - traj->t_begin) >= piecewise_duration(traj);
 }
+
+static inline bool piecewise_is_finished_cursor(struct piecewise_traj const *traj,
+	struct piecewise_cursor const *cursor, float t)
+{
+	return (t - traj->t_begin) >= cursor->duration * traj->timescale;
+}
@@ -27,6 +27,7 @@
 #pragma once
 
 #include "pptraj.h"
+#include <stdint.h>
 #include <stdio.h>
 
 enum piecewise_traj_storage_type {
@@ -40,6 +41,24 @@ enum piecewise_traj_storage_type {
 // compressed piecewise polynomial trajectories //
 // ---------------------------------------------//
 
+// Max number of entries in the seek index of a compressed trajectory. Long
+// trajectories are indexed at every n-th piece to stay within this limit.
+#define PPTRAJ_COMPRESSED_INDEX_SIZE 16
+
+// An entry in the seek index, describing where a piece starts both in the
+// data and in time
+struct piecewise_traj_compressed_index_entry
+{
+	// offset of the piece from the start of the data, in bytes
+	uint16_t offset;
+
+	// start time of the piece relative to the start of the trajectory, in msec
+	uint32_t t_begin_msec;
+
+	// start point (x, y, z, yaw) of the piece, in the stored units
+	int16_t start[4];
+};
+
 struct piecewise_traj_compressed
 {
 	float t_begin;
@@ -48,6 +67,12 @@ struct piecewise_traj_compressed
 	struct vec shift;
 	const void* data;
 
+	// seek index, built when the trajectory is loaded. Entry i describes
+	// piece i * index_stride.
+	struct piecewise_traj_compressed_index_entry index[PPTRAJ_COMPRESSED_INDEX_SIZE];
+	uint8_t index_count;
+	uint16_t index_stride;
+
 	// mutable part of the data structure. We plan to mess around with this part
 	// but keep the rest untouched (i.e. supplied by the user)
 	struct {
@@ -57,6 +82,10 @@ struct piecewise_traj_compressed
 		// start time of the current piece, relative to the "global" start time of
 		// the entire trajectory
 		float t_begin_relative;
+		uint32_t t_begin_msec;
+
+		// start point (x, y, z, yaw) of the current piece, in the stored units
+		int16_t start[4];
 
 		// poly4d representation of the current piece
 		struct poly4d poly4d;
@@ -73,13 +102,20 @@ static float piecewise_compressed_duration(struct piecewise_traj_compressed cons
 static inline bool piecewise_compressed_is_finished(
 	struct piecewise_traj_compressed const *traj, float t)
 {
-	return (t - traj->t_begin) >= piecewise_compressed_duration(traj);
+	return (t - traj->t_begin) >= piecewise_compressed_duration(traj) * traj->timescale;
 }
 
-// Evaluates the trajectory at the given time instant.
+// Evaluates the trajectory at the given time instant. Any point in time can
+// be evaluated, jumping forward or backward looks up the piece in the seek
+// index instead of walking through the data from the start.
 struct traj_eval piecewise_compressed_eval(
 	struct piecewise_traj_compressed *traj, float t);
 
+// Evaluates the trajectory at the given time instant, flying it backwards
+// from its end point to its start point.
+struct traj_eval piecewise_compressed_eval_reversed(
+	struct piecewise_traj_compressed *traj, float t);
+
 // Loads the compressed trajectory at the given pointer
 void piecewise_compressed_load(
 	struct piecewise_traj_compressed *traj, const void* data);
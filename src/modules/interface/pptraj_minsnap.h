@@ -0,0 +1,57 @@
+/**
+ *    ||          ____  _ __
+ * +------+      / __ )(_) /_______________ _____  ___
+ * | 0xBC |     / __  / / __/ ___/ ___/ __ `/_  / / _ \
+ * +------+    / /_/ / / /_/ /__/ /  / /_/ / / /_/  __/
+ *  ||  ||    /_____/_/\__/\___/_/   \__,_/ /___/\___/
+ *
+ * Crazyflie control firmware
+ *
+ * Copyright (C) 2023 Bitcraze AB
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, in version 3.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ *
+ * pptraj_minsnap.h - On-board planning of minimum snap trajectories
+ */
+
+#pragma once
+
+#include "pptraj.h"
+
+// ---------------------------------------------//
+// minimum snap piecewise polynomial planning   //
+// ---------------------------------------------//
+
+// max number of pieces of a trajectory planned on board. the solver uses
+// static memory sized for this number of pieces.
+#define PPTRAJ_MINSNAP_MAX_PIECES 16
+
+// plan a trajectory through n_pieces + 1 waypoints that minimizes the
+// integral of the squared snap, i.e. the 4th derivative of the position.
+// piece k goes from waypoints[k] to waypoints[k + 1] in durations[k] seconds.
+//
+// yaws may be 0 to keep the yaw at 0, otherwise the yaw is planned the same
+// way as the position.
+//
+// velocities may be 0, the trajectory then starts and ends at rest and the
+// velocity at the other waypoints is free. otherwise velocities has one entry
+// per waypoint, and a NaN component leaves that component free. the start and
+// end acceleration and jerk are always 0.
+//
+// the pieces are written to traj->pieces, which must have room for n_pieces.
+// returns 0 on success, or -1 if the input is invalid.
+//
+// not reentrant, the solver uses static memory.
+int piecewise_plan_min_snap(struct piecewise_traj *traj,
+	struct vec const *waypoints, float const *yaws, struct vec const *velocities,
+	float const *durations, int n_pieces);
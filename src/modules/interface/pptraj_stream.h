@@ -0,0 +1,95 @@
+/**
+ *    ||          ____  _ __
+ * +------+      / __ )(_) /_______________ _____  ___
+ * | 0xBC |     / __  / / __/ ___/ ___/ __ `/_  / / _ \
+ * +------+    / /_/ / / /_/ /__/ /  / /_/ / / /_/  __/
+ *  ||  ||    /_____/_/\__/\___/_/   \__,_/ /___/\___/
+ *
+ * Crazyflie control firmware
+ *
+ * Copyright (C) 2023 Bitcraze AB
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, in version 3.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ *
+ * pptraj_stream.h - Piecewise polynomial trajectories of unlimited length
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "pptraj.h"
+
+// ---------------------------------------------//
+// streamed piecewise polynomial trajectories   //
+// ---------------------------------------------//
+
+// pieces are appended to a ring buffer while the trajectory is flown, and
+// freed when the playhead has passed them. if the playhead catches up with
+// the appended pieces before the last piece has been appended, the trajectory
+// is paused at the end of the latest piece until more pieces are available.
+struct piecewise_traj_stream
+{
+	float t_begin;
+	float timescale;
+	struct vec shift;
+
+	// ring buffer, supplied by the user
+	struct poly4d* pieces;
+	uint8_t capacity;
+
+	// piece counters, the index in the ring buffer is the counter modulo capacity
+	uint32_t head; // the current piece, all pieces before it are freed
+	uint32_t tail; // one past the latest appended piece
+
+	// unscaled times, relative to t_begin
+	float head_begin; // start of the current piece
+	float tail_end;   // end of the latest appended piece
+
+	bool is_closed; // true when the last piece has been appended
+
+	// the number of times the playhead caught up with the appended pieces
+	uint32_t underrun_count;
+};
+
+// initialize an empty stream, using the given ring buffer.
+void piecewise_stream_init(struct piecewise_traj_stream *traj,
+	struct poly4d *pieces, uint8_t capacity);
+
+// append a piece. returns false if the ring buffer is full, or the last
+// piece already has been appended.
+bool piecewise_stream_append(struct piecewise_traj_stream *traj,
+	struct poly4d const *piece);
+
+// mark that no more pieces will be appended.
+void piecewise_stream_close(struct piecewise_traj_stream *traj);
+
+// evaluate the trajectory, frees pieces that the playhead has passed.
+// times must be increasing, pieces that have been freed can not be evaluated.
+struct traj_eval piecewise_stream_eval(struct piecewise_traj_stream *traj, float t);
+
+// the number of pieces that can be appended.
+static inline uint8_t piecewise_stream_free_count(struct piecewise_traj_stream const *traj)
+{
+	return traj->capacity - (uint8_t)(traj->tail - traj->head);
+}
+
+static inline bool piecewise_stream_is_empty(struct piecewise_traj_stream const *traj)
+{
+	return traj->tail == traj->head;
+}
+
+static inline bool piecewise_stream_is_finished(struct piecewise_traj_stream const *traj, float t)
+{
+	return traj->is_closed && (t - traj->t_begin) >= traj->tail_end * traj->timescale;
+}
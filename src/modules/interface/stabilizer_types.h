@@ -335,8 +335,29 @@ typedef struct {
   float stdDev;
   const lighthouseCalibrationSweep_t* calib;
   lighthouseCalibrationMeasurementModel_t calibrationMeasurementModel;
+  const lighthouseCalibrationSweepLh2Precalc_t* calibPrecalc;  // Optional, replaces calib and calibrationMeasurementModel when set
 } sweepAngleMeasurement_t;
 
+#define SWEEP_ANGLE_BATCH_MAX_SENSORS 4
+
+/** Sweep angle measurements from all sensors for one sweep of a Lighthouse base station */
+typedef struct {
+  uint32_t timestamp;
+  const vec3d* sensorPos;    // Array of sensor positions in the CF reference frame, one per sensor
+  const vec3d* rotorPos;     // Pos of rotor origin in global reference frame
+  const mat3d* rotorRot;     // Rotor rotation matrix
+  const mat3d* rotorRotInv;  // Inverted rotor rotation matrix
+  uint8_t sensorMask;        // Bit n is set if measuredSweepAngles[n] is valid
+  uint8_t baseStationId;
+  uint8_t sweepId;
+  float t;                   // t is the tilt angle of the light plane on the rotor
+  float measuredSweepAngles[SWEEP_ANGLE_BATCH_MAX_SENSORS];
+  float stdDev;
+  const lighthouseCalibrationSweep_t* calib;
+  lighthouseCalibrationMeasurementModel_t calibrationMeasurementModel;
+  const lighthouseCalibrationSweepLh2Precalc_t* calibPrecalc;  // Optional, replaces calib and calibrationMeasurementModel when set
+} sweepAngleBatchMeasurement_t;
+
 /** gyroscope measurement */
 typedef struct
 {
@@ -65,15 +65,18 @@ static struct vec3_s svec2vec(struct vec v)
 //     so we should go ahead and begin the sidestep.
 //   A: LHS matrix for polytope inequality Ax <= B. Dimension [nRows * 3].
 //   B: RHS vector for polytope inequality Ax <= B. Dimension [nRows].
-//   projectionWorkspace: Additional scratch area. Dimension [nRows * 3].
+//   multipliers: Warm start for the projection, updated with the multipliers
+//     of the projection. Dimension [nRows].
 //   nRows: Number of rows in our cell polytope inequality.
+//   iters: Number of projection iterations, 0 if no projection was needed.
 //
 static struct vec sidestepGoal(
   collision_avoidance_params_t const *params,
   struct vec goal,
   bool modifyIfInside,
-  float const A[], float const B[], float projectionWorkspace[], int nRows)
+  float const A[], float const B[], float multipliers[], int nRows, int *iters)
 {
+  *iters = 0;
   float const rayScale = rayintersectpolytope(vzero(), goal, A, B, nRows, NULL);
   if (rayScale >= 1.0f && !modifyIfInside) {
     return goal;
@@ -86,19 +89,50 @@ static struct vec sidestepGoal(
     goal = vadd(goal, vscl(sidestepAmount, sidestepDir));
   }
   // Otherwise no sidestep, but still project
-  return vprojectpolytope(
+  return vprojectpolytopewarm(
     goal,
-    A, B, projectionWorkspace, nRows,
+    A, B, multipliers, nRows,
     params->voronoiProjectionTolerance,
-    params->voronoiProjectionMaxIters
+    params->voronoiProjectionMaxIters,
+    iters
   );
 }
 
+// The state keeps the multipliers of the box faces first, our rows have the
+// neighbor faces first. Returns the index in the state for a row, or -1 if it
+// does not fit.
+static int multiplierIndex(int row, int nNeighbors)
+{
+  int const index = row < nNeighbors ? row + 6 : row - nNeighbors;
+  return index < COLLISION_AVOIDANCE_MAX_CELL_ROWS ? index : -1;
+}
+
+// The multiplier of the face of a peer in the previous update, or 0 if the
+// peer did not constrain the cell then.
+static float previousNeighborMultiplier(
+  collision_avoidance_state_t const *collisionState, uint8_t peer, int neighbor)
+{
+  int const nPrevious = collisionState->nCellNeighbors < PEER_LOCALIZATION_MAX_NEIGHBORS ?
+    collisionState->nCellNeighbors : PEER_LOCALIZATION_MAX_NEIGHBORS;
+
+  // The order rarely changes, try the same neighbor first
+  if (neighbor < nPrevious && collisionState->projectionMultiplierPeers[neighbor] == peer) {
+    return collisionState->projectionMultipliers[neighbor + 6];
+  }
+  for (int i = 0; i < nPrevious; ++i) {
+    if (collisionState->projectionMultiplierPeers[i] == peer) {
+      return collisionState->projectionMultipliers[i + 6];
+    }
+  }
+  return 0.0f;
+}
+
 void collisionAvoidanceUpdateSetpointCore(
   collision_avoidance_params_t const *params,
   collision_avoidance_state_t *collisionState,
   int nOthers,
   float const *otherPositions,
+  uint8_t const *otherIds,
   float *workspace,
   setpoint_t *setpoint, sensorData_t const *sensorData, state_t const *state)
 {
@@ -106,19 +140,33 @@ void collisionAvoidanceUpdateSetpointCore(
   // Part 1: Construct the polytope inequalities in A, b.
   //
 
-  int const nRows = nOthers + 6;
+  int const maxRows = nOthers + 6;
   float *A = workspace;
-  float *B = workspace + 3 * nRows;
-  float *projectionWorkspace = workspace + 4 * nRows;
+  float *B = workspace + 3 * maxRows;
+  float *multipliers = workspace + 4 * maxRows;
 
   // Compute the cell in a stretched coordinate system for downwash awareness.
   // See header for details.
   struct vec const radiiInv = veltrecip(params->ellipsoidRadii);
   struct vec const ourPos = vec2svec(state->position);
 
-  // We could do some optimizations here to reduce the number of rows, like
-  // leave out very far away neighbors. It would help the average case
-  // complexity, but not the worst case - so we skip it for now.
+  // The bounding box faces, which also enforce max speed in the
+  // infinity-norm, limit how far we can go within the horizon. The cell is
+  // always inside this box.
+  float const maxDist = params->horizonSecs * params->maxSpeed;
+  float boxMax[3];
+  float boxMin[3];
+  for (int dim = 0; dim < 3; ++dim) {
+    boxMax[dim] = fminf(maxDist, vindex(params->bboxMax, dim) - vindex(ourPos, dim));
+    boxMin[dim] = fmaxf(-maxDist, vindex(params->bboxMin, dim) - vindex(ourPos, dim));
+  }
+
+  // Neighbors whose face does not cut the box can not constrain the cell,
+  // typically neighbors that are far away compared to the horizon. They are
+  // left out, which does not change the cell. The rows are compacted in place,
+  // row i is written after peer i has been read.
+  uint8_t neighborPeers[PEER_LOCALIZATION_MAX_NEIGHBORS];
+  int nNeighbors = 0;
   for (int i = 0; i < nOthers; ++i) {
     struct vec peerPos = vloadf(otherPositions + 3 * i);
     struct vec const toPeerStretched = veltmul(vsub(peerPos, ourPos), radiiInv);
@@ -126,24 +174,53 @@ void collisionAvoidanceUpdateSetpointCore(
     struct vec const a = vdiv(veltmul(toPeerStretched, radiiInv), dist);
     float const b = dist / 2.0f - 1.0f;
     float scale = 1.0f / vmag(a);
-    vstoref(vscl(scale, a), A + 3 * i);
-    B[i] = scale * b;
+    struct vec const aUnit = vscl(scale, a);
+
+    // The max of a^T x over the box
+    float support = 0.0f;
+    for (int dim = 0; dim < 3; ++dim) {
+      float const ad = vindex(aUnit, dim);
+      if (ad > 0.0f) {
+        support += ad * boxMax[dim];
+      }
+      else if (ad < 0.0f) {
+        support += ad * boxMin[dim];
+      }
+    }
+    if (support <= scale * b) {
+      continue;
+    }
+
+    vstoref(aUnit, A + 3 * nNeighbors);
+    B[nNeighbors] = scale * b;
+    if (nNeighbors < PEER_LOCALIZATION_MAX_NEIGHBORS) {
+      neighborPeers[nNeighbors] = otherIds ? otherIds[i] : (uint8_t)i;
+    }
+    ++nNeighbors;
   }
 
-  // Add the bounding box polytope faces. We also use the box faces to enforce
-  // max speed in the infinity-norm.
-  float const maxDist = params->horizonSecs * params->maxSpeed;
+  int const nRows = nNeighbors + 6;
 
-  memset(A + 3 * nOthers, 0, 18 * sizeof(float));
+  // Add the bounding box polytope faces.
+  memset(A + 3 * nNeighbors, 0, 18 * sizeof(float));
 
   for (int dim = 0; dim < 3; ++dim) {
-    float boxMax = vindex(params->bboxMax, dim) - vindex(ourPos, dim);
-    A[3 * (nOthers + dim) + dim] = 1.0f;
-    B[nOthers + dim] = fminf(maxDist, boxMax);
+    A[3 * (nNeighbors + dim) + dim] = 1.0f;
+    B[nNeighbors + dim] = boxMax[dim];
+
+    A[3 * (nNeighbors + dim + 3) + dim] = -1.0f;
+    B[nNeighbors + dim + 3] = -boxMin[dim];
+  }
 
-    float boxMin = vindex(params->bboxMin, dim) - vindex(ourPos, dim);
-    A[3 * (nOthers + dim + 3) + dim] = -1.0f;
-    B[nOthers + dim + 3] = -fmaxf(-maxDist, boxMin);
+  // Warm start the projection with the multipliers of the previous update.
+  for (int row = 0; row < nRows; ++row) {
+    if (row < nNeighbors) {
+      multipliers[row] = row < PEER_LOCALIZATION_MAX_NEIGHBORS ?
+        previousNeighborMultiplier(collisionState, neighborPeers[row], row) : 0.0f;
+    }
+    else {
+      multipliers[row] = collisionState->projectionMultipliers[row - nNeighbors];
+    }
   }
 
   //
@@ -154,6 +231,7 @@ void collisionAvoidanceUpdateSetpointCore(
 
   struct vec setPos = vec2svec(setpoint->position);
   struct vec setVel = vec2svec(setpoint->velocity);
+  int iters = 0;
 
   if (setpoint->mode.x == modeVelocity) {
     // Interpret the setpoint to mean "fly with this velocity".
@@ -161,7 +239,7 @@ void collisionAvoidanceUpdateSetpointCore(
     if (vinpolytope(vzero(), A, B, nRows, inPolytopeTolerance)) {
       // Typical case - our current position is within our cell.
       struct vec pseudoGoal = vscl(params->horizonSecs, setVel);
-      pseudoGoal = sidestepGoal(params, pseudoGoal, true, A, B, projectionWorkspace, nRows);
+      pseudoGoal = sidestepGoal(params, pseudoGoal, true, A, B, multipliers, nRows, &iters);
       if (vinpolytope(pseudoGoal, A, B, nRows, inPolytopeTolerance)) {
         setVel = vdiv(pseudoGoal, params->horizonSecs);
       }
@@ -173,11 +251,12 @@ void collisionAvoidanceUpdateSetpointCore(
     else {
       // Atypical case - our current position is not within our cell. Forget
       // about the original goal velocity and try to move towards our cell.
-      struct vec nearestInCell = vprojectpolytope(
+      struct vec nearestInCell = vprojectpolytopewarm(
         vzero(),
-        A, B, projectionWorkspace, nRows,
+        A, B, multipliers, nRows,
         params->voronoiProjectionTolerance,
-        params->voronoiProjectionMaxIters
+        params->voronoiProjectionMaxIters,
+        &iters
       );
       if (vinpolytope(nearestInCell, A, B, nRows, inPolytopeTolerance)) {
         setVel = vclampnorm(nearestInCell, params->maxSpeed);
@@ -193,7 +272,7 @@ void collisionAvoidanceUpdateSetpointCore(
 
     struct vec const setPosRelative = vsub(setPos, ourPos);
     struct vec const setPosRelativeNew = sidestepGoal(
-      params, setPosRelative, false, A, B, projectionWorkspace, nRows);
+      params, setPosRelative, false, A, B, multipliers, nRows, &iters);
 
     if (!vinpolytope(setPosRelativeNew, A, B, nRows, inPolytopeTolerance)) {
       // If the projection algorithm failed to converge, then either
@@ -250,6 +329,18 @@ void collisionAvoidanceUpdateSetpointCore(
 
   setpoint->position = svec2vec(setPos);
   setpoint->velocity = svec2vec(setVel);
+
+  for (int row = 0; row < nRows; ++row) {
+    int const index = multiplierIndex(row, nNeighbors);
+    if (index >= 0) {
+      collisionState->projectionMultipliers[index] = multipliers[row];
+    }
+    if (row < nNeighbors && row < PEER_LOCALIZATION_MAX_NEIGHBORS) {
+      collisionState->projectionMultiplierPeers[row] = neighborPeers[row];
+    }
+  }
+  collisionState->nCellNeighbors = nNeighbors;
+  collisionState->nProjectionIters = iters;
 }
 
 
@@ -294,12 +385,9 @@ bool collisionAvoidanceTest()
   return true;
 }
 
-// Each face of the Voronoi cell is defined by a linear inequality a^T x <= b.
-// The algorithm for projecting a point into a convex polytope requires 3 more
-// floats of working space per face. The six extra faces come from the overall
-// flight area bounding box.
-#define MAX_CELL_ROWS (PEER_LOCALIZATION_MAX_NEIGHBORS + 6)
-static float workspace[7 * MAX_CELL_ROWS];
+// See collisionAvoidanceUpdateSetpointCore for the size of the workspace.
+static float workspace[5 * COLLISION_AVOIDANCE_MAX_CELL_ROWS];
+static uint8_t otherIds[PEER_LOCALIZATION_MAX_NEIGHBORS];
 
 // Latency counter for logging.
 static uint32_t latency = 0;
@@ -312,36 +400,21 @@ void collisionAvoidanceUpdateSetpoint(
   }
 
   TickType_t const time = xTaskGetTickCount();
-  bool doAgeFilter = params.maxPeerLocAgeMillis >= 0;
 
-  // Counts the actual number of neighbors after we filter stale measurements.
-  int nOthers = 0;
-
-  for (int i = 0; i < PEER_LOCALIZATION_MAX_NEIGHBORS; ++i) {
-
-    peerLocalizationOtherPosition_t const *otherPos = peerLocalizationGetPositionByIdx(i);
-
-    if (otherPos == NULL || otherPos->id == 0) {
-      continue;
-    }
-
-    if (doAgeFilter && (time - otherPos->pos.timestamp > params.maxPeerLocAgeMillis)) {
-      continue;
-    }
-
-    workspace[3 * nOthers + 0] = otherPos->pos.x;
-    workspace[3 * nOthers + 1] = otherPos->pos.y;
-    workspace[3 * nOthers + 2] = otherPos->pos.z;
-    ++nOthers;
-  }
+  // Copy the peers that are not stale, a negative max age disables the filter.
+  // The peer table is updated by other tasks.
+  int const nOthers = peerLocalizationCopyPositions(
+    workspace, otherIds, PEER_LOCALIZATION_MAX_NEIGHBORS, params.maxPeerLocAgeMillis);
 
-  collisionAvoidanceUpdateSetpointCore(&params, &collisionState, nOthers, workspace, workspace, setpoint, sensorData, state);
+  collisionAvoidanceUpdateSetpointCore(&params, &collisionState, nOthers, workspace, otherIds, workspace, setpoint, sensorData, state);
 
   latency = xTaskGetTickCount() - time;
 }
 
 LOG_GROUP_START(colAv)
   LOG_ADD(LOG_UINT32, latency, &latency)
+  LOG_ADD(LOG_INT32, nNeighbors, &collisionState.nCellNeighbors)
+  LOG_ADD(LOG_INT32, projIters, &collisionState.nProjectionIters)
 LOG_GROUP_STOP(colAv)
 
 
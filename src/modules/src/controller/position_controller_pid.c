@@ -32,6 +32,7 @@
 #include "pid.h"
 #include "num.h"
 #include "position_controller.h"
+#include "math3d.h"
 #include "platform_defaults.h"
 
 
@@ -199,8 +200,8 @@ void positionController(float* thrust, attitude_t *attitude, const setpoint_t *s
   // this value is below 0.5
   this.pidZ.pid.outputLimit = fmaxf(zVelMax, 0.5f)  * velMaxOverhead;
 
-  float cosyaw = cosf(state->attitude.yaw * (float)M_PI / 180.0f);
-  float sinyaw = sinf(state->attitude.yaw * (float)M_PI / 180.0f);
+  float cosyaw = cosf(state->attitude.yaw * M_PI_F / 180.0f);
+  float sinyaw = sinf(state->attitude.yaw * M_PI_F / 180.0f);
 
   float setp_body_x = setpoint->position.x * cosyaw + setpoint->position.y * sinyaw;
   float setp_body_y = -setpoint->position.x * sinyaw + setpoint->position.y * cosyaw;
@@ -242,8 +243,8 @@ void velocityController(float* thrust, attitude_t *attitude, const Axis3f* setpo
   this.pidVZ.pid.outputLimit = (UINT16_MAX / 2 / thrustScale);
   //this.pidVZ.pid.outputLimit = (this.thrustBase - this.thrustMin) / thrustScale;
 
-  float cosyaw = cosf(state->attitude.yaw * (float)M_PI / 180.0f);
-  float sinyaw = sinf(state->attitude.yaw * (float)M_PI / 180.0f);
+  float cosyaw = cosf(state->attitude.yaw * M_PI_F / 180.0f);
+  float sinyaw = sinf(state->attitude.yaw * M_PI_F / 180.0f);
   state_body_vx = state->velocity.x * cosyaw + state->velocity.y * sinyaw;
   state_body_vy = -state->velocity.x * sinyaw + state->velocity.y * cosyaw;
 
@@ -62,6 +62,7 @@ such as: take-off, landing, polynomial trajectories.
 enum TrajectoryLocation_e {
   TRAJECTORY_LOCATION_INVALID = 0,
   TRAJECTORY_LOCATION_MEM     = 1, // for trajectories that are uploaded dynamically
+  TRAJECTORY_LOCATION_STREAM  = 2, // for trajectories that are appended while flying
   // Future features might include trajectories on flash or uSD card
 };
 
@@ -83,6 +84,10 @@ struct trajectoryDescription
 // other (compressed) formats might be added in the future
 #define TRAJECTORY_MEMORY_SIZE 4096
 
+// ring buffer for streamed trajectories, pieces are uploaded to the trajectory
+// memory and then appended to the ring buffer while flying
+#define TRAJECTORY_STREAM_PIECES 8
+
 #define ALL_GROUPS 0
 
 // Global variables
@@ -103,6 +108,8 @@ static struct vec vel; // last known setpoint (velocity [m/s])
 static float yaw; // last known setpoint yaw (yaw [rad])
 static struct piecewise_traj trajectory;
 static struct piecewise_traj_compressed  compressed_trajectory;
+static struct poly4d stream_pieces[TRAJECTORY_STREAM_PIECES];
+static struct piecewise_traj_stream stream_trajectory;
 
 // makes sure that we don't evaluate the trajectory while it is being changed
 static xSemaphoreHandle lockTraj;
@@ -140,6 +147,7 @@ enum TrajectoryCommand_e {
   COMMAND_LAND_2                  = 8,
   COMMAND_TAKEOFF_WITH_VELOCITY   = 9,
   COMMAND_LAND_WITH_VELOCITY      = 10,
+  COMMAND_APPEND_TRAJECTORY       = 11,
 };
 
 struct data_set_group_mask {
@@ -233,6 +241,14 @@ struct data_define_trajectory {
   struct trajectoryDescription description;
 } __attribute__((packed));
 
+// appends pieces, previously uploaded to memory, to a streamed trajectory
+struct data_append_trajectory {
+  uint8_t trajectoryId; // id of the trajectory (previously defined with TRAJECTORY_LOCATION_STREAM)
+  uint32_t offset;      // offset of the pieces in uploaded memory
+  uint8_t n_pieces;
+  uint8_t is_last;      // set to true, if no more pieces will be appended
+} __attribute__((packed));
+
 // Private functions
 static void crtpCommanderHighLevelTask(void * prm);
 
@@ -247,6 +263,7 @@ static int stop(const struct data_stop* data);
 static int go_to(const struct data_go_to* data);
 static int start_trajectory(const struct data_start_trajectory* data);
 static int define_trajectory(const struct data_define_trajectory* data);
+static int append_trajectory(const struct data_append_trajectory* data);
 
 // Helper functions
 static struct vec state2vec(struct vec3_s v)
@@ -266,6 +283,7 @@ void crtpCommanderHighLevelInit(void)
 
   memoryRegisterHandler(&memDef);
   plan_init(&planner);
+  piecewise_stream_init(&stream_trajectory, stream_pieces, TRAJECTORY_STREAM_PIECES);
 
   //Start the trajectory task
   STATIC_MEM_TASK_CREATE(crtpCommanderHighLevelTask, crtpCommanderHighLevelTask, CMD_HIGH_LEVEL_TASK_NAME, NULL, CMD_HIGH_LEVEL_TASK_PRI);
@@ -405,6 +423,9 @@ static int handleCommand(const enum TrajectoryCommand_e command, const uint8_t*
     case COMMAND_DEFINE_TRAJECTORY:
       ret = define_trajectory((const struct data_define_trajectory*)data);
       break;
+    case COMMAND_APPEND_TRAJECTORY:
+      ret = append_trajectory((const struct data_append_trajectory*)data);
+      break;
     default:
       ret = ENOEXEC;
       break;
@@ -637,18 +658,30 @@ int start_trajectory(const struct data_start_trajectory* data)
         xSemaphoreGive(lockTraj);
       } else if (trajDesc->trajectoryLocation == TRAJECTORY_LOCATION_MEM
           && trajDesc->trajectoryType == CRTP_CHL_TRAJECTORY_TYPE_POLY4D_COMPRESSED) {
+        xSemaphoreTake(lockTraj, portMAX_DELAY);
+        float t = usecTimestamp() / 1e6;
+        piecewise_compressed_load(
+          &compressed_trajectory,
+          &trajectories_memory[trajDesc->trajectoryIdentifier.mem.offset]
+        );
+        compressed_trajectory.t_begin = t;
+        compressed_trajectory.timescale = data->timescale;
+        result = plan_start_compressed_trajectory(&planner, &compressed_trajectory, data->reversed, data->relative, pos);
+        xSemaphoreGive(lockTraj);
+      } else if (trajDesc->trajectoryLocation == TRAJECTORY_LOCATION_STREAM) {
 
-        if (data->timescale != 1 || data->reversed) {
+        if (data->reversed) {
           result = ENOEXEC;
         } else {
           xSemaphoreTake(lockTraj, portMAX_DELAY);
           float t = usecTimestamp() / 1e6;
-          piecewise_compressed_load(
-            &compressed_trajectory,
-            &trajectories_memory[trajDesc->trajectoryIdentifier.mem.offset]
-          );
-          compressed_trajectory.t_begin = t;
-          result = plan_start_compressed_trajectory(&planner, &compressed_trajectory, data->relative, pos);
+          // continue from the oldest piece that has not been freed
+          stream_trajectory.t_begin = t - stream_trajectory.head_begin * data->timescale;
+          stream_trajectory.timescale = data->timescale;
+          if (plan_start_stream_trajectory(&planner, &stream_trajectory, data->relative, pos) != 0) {
+            // no pieces have been appended
+            result = ENOEXEC;
+          }
           xSemaphoreGive(lockTraj);
         }
       }
@@ -662,10 +695,68 @@ int define_trajectory(const struct data_define_trajectory* data)
   if (data->trajectoryId >= NUM_TRAJECTORY_DEFINITIONS) {
     return ENOEXEC;
   }
+
+  if (data->description.trajectoryLocation == TRAJECTORY_LOCATION_STREAM) {
+    xSemaphoreTake(lockTraj, portMAX_DELAY);
+    float t = usecTimestamp() / 1e6;
+    bool isStreamFlying = planner.type == TRAJECTORY_TYPE_PIECEWISE_STREAM && planner.state == TRAJECTORY_STATE_FLYING;
+    // a closed stream that has been flown to the end can be redefined while hovering at the end point
+    bool isStreamInUse = isStreamFlying && !piecewise_stream_is_finished(&stream_trajectory, t);
+    if (!isStreamInUse) {
+      if (isStreamFlying) {
+        // keep hovering at the end point, the stream is about to be emptied
+        plan_go_to(&planner, true, vzero(), 0, 1.0f, t);
+      }
+      // start over with an empty stream
+      piecewise_stream_init(&stream_trajectory, stream_pieces, TRAJECTORY_STREAM_PIECES);
+    }
+    xSemaphoreGive(lockTraj);
+
+    if (isStreamInUse) {
+      return EBUSY;
+    }
+  }
+
+  xSemaphoreTake(lockTraj, portMAX_DELAY);
   trajectory_descriptions[data->trajectoryId] = data->description;
+  plan_trajectory_changed(&planner);
+  xSemaphoreGive(lockTraj);
   return 0;
 }
 
+int append_trajectory(const struct data_append_trajectory* data)
+{
+  if (data->trajectoryId >= NUM_TRAJECTORY_DEFINITIONS ||
+      trajectory_descriptions[data->trajectoryId].trajectoryLocation != TRAJECTORY_LOCATION_STREAM) {
+    return ENOEXEC;
+  }
+
+  const uint32_t length = data->n_pieces * sizeof(struct poly4d);
+  if (data->offset + length > sizeof(trajectories_memory) || (data->offset % 4) != 0) {
+    return ENOEXEC;
+  }
+
+  int result = 0;
+  xSemaphoreTake(lockTraj, portMAX_DELAY);
+  if (stream_trajectory.is_closed) {
+    result = ENOEXEC;
+  } else if (data->n_pieces > piecewise_stream_free_count(&stream_trajectory)) {
+    // back-pressure, the host should try again when the playhead has freed some pieces
+    result = EAGAIN;
+  } else {
+    const struct poly4d* pieces = (const struct poly4d*)&trajectories_memory[data->offset];
+    for (int i = 0; i < data->n_pieces; i++) {
+      piecewise_stream_append(&stream_trajectory, &pieces[i]);
+    }
+    if (data->is_last) {
+      piecewise_stream_close(&stream_trajectory);
+    }
+  }
+  xSemaphoreGive(lockTraj);
+
+  return result;
+}
+
 static bool handleMemRead(const uint32_t memAddr, const uint8_t readLen, uint8_t* buffer) {
   return crtpCommanderHighLevelReadTrajectory(memAddr, readLen, buffer);
 }
@@ -852,6 +943,31 @@ int crtpCommanderHighLevelDefineTrajectory(const uint8_t trajectoryId, const crt
   return handleCommand(COMMAND_DEFINE_TRAJECTORY, (const uint8_t*)&data);
 }
 
+int crtpCommanderHighLevelDefineStreamTrajectory(const uint8_t trajectoryId)
+{
+  struct data_define_trajectory data =
+  {
+    .trajectoryId = trajectoryId,
+    .description.trajectoryLocation = TRAJECTORY_LOCATION_STREAM,
+    .description.trajectoryType = CRTP_CHL_TRAJECTORY_TYPE_POLY4D,
+  };
+
+  return handleCommand(COMMAND_DEFINE_TRAJECTORY, (const uint8_t*)&data);
+}
+
+int crtpCommanderHighLevelAppendTrajectory(const uint8_t trajectoryId, const uint32_t offset, const uint8_t nPieces, const bool isLast)
+{
+  struct data_append_trajectory data =
+  {
+    .trajectoryId = trajectoryId,
+    .offset = offset,
+    .n_pieces = nPieces,
+    .is_last = isLast,
+  };
+
+  return handleCommand(COMMAND_APPEND_TRAJECTORY, (const uint8_t*)&data);
+}
+
 uint32_t crtpCommanderHighLevelTrajectoryMemSize()
 {
   return sizeof(trajectories_memory);
@@ -862,7 +978,15 @@ bool crtpCommanderHighLevelWriteTrajectory(const uint32_t offset, const uint32_t
   bool result = false;
 
   if ((offset + length) <= sizeof(trajectories_memory)) {
+    // the pieces of the trajectory that is flown may be overwritten
+    if (isInit) {
+      xSemaphoreTake(lockTraj, portMAX_DELAY);
+    }
     memcpy(&(trajectories_memory[offset]), data, length);
+    plan_trajectory_changed(&planner);
+    if (isInit) {
+      xSemaphoreGive(lockTraj);
+    }
     result = true;
   }
 
@@ -902,3 +1026,25 @@ PARAM_ADD_CORE(PARAM_FLOAT, vtoff, &defaultTakeoffVelocity)
 PARAM_ADD_CORE(PARAM_FLOAT, vland, &defaultLandingVelocity)
 
 PARAM_GROUP_STOP(hlCommander)
+
+static uint8_t streamFreeLogger(uint32_t timestamp, void* ignored) {
+  return piecewise_stream_free_count(&stream_trajectory);
+}
+static logByFunction_t streamFreeLoggerDef = {.acquireUInt8 = streamFreeLogger, .data = 0};
+
+/**
+ * State of streamed trajectories, used by the host to decide when to append more pieces
+ */
+LOG_GROUP_START(hlStream)
+
+/**
+ * @brief Number of pieces that can be appended to the streamed trajectory
+ */
+LOG_ADD_BY_FUNCTION(LOG_UINT8, free, &streamFreeLoggerDef)
+
+/**
+ * @brief Number of setpoints where the trajectory was paused because no pieces were available
+ */
+LOG_ADD(LOG_UINT32, underrun, &stream_trajectory.underrun_count)
+
+LOG_GROUP_STOP(hlStream)
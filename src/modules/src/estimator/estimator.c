@@ -29,6 +29,10 @@ STATIC_MEM_QUEUE_ALLOC(measurementsQueue, MEASUREMENTS_QUEUE_SIZE, sizeof(measur
 static STATS_CNT_RATE_DEFINE(measurementAppendedCounter, ONE_SECOND);
 static STATS_CNT_RATE_DEFINE(measurementNotAppendedCounter, ONE_SECOND);
 
+// Load
+static uint32_t notAppendedCount = 0;
+static uint32_t updateDurationUs = 0;
+
 // events
 EVENTTRIGGER(estTDOA, uint8, idA, uint8, idB, float, distanceDiff)
 EVENTTRIGGER(estPosition, uint8, source)
@@ -190,6 +194,7 @@ void estimatorEnqueue(const measurement_t *measurement) {
     STATS_CNT_RATE_EVENT(&measurementAppendedCounter);
   } else {
     STATS_CNT_RATE_EVENT(&measurementNotAppendedCounter);
+    notAppendedCount++;
   }
 
   // events
@@ -250,6 +255,19 @@ void estimatorEnqueue(const measurement_t *measurement) {
       // no payload needed, see baro.asl
       eventTrigger(&eventTrigger_estBarometer);
       break;
+    case MeasurementTypeSweepAngleBatch:
+      // One event per sensor, same as for single sweep angles
+      for (int sensor = 0; sensor < SWEEP_ANGLE_BATCH_MAX_SENSORS; sensor++) {
+        if (measurement->data.sweepAngleBatch.sensorMask & (1 << sensor)) {
+          eventTrigger_estSweepAngle_payload.sensorId = sensor;
+          eventTrigger_estSweepAngle_payload.baseStationId = measurement->data.sweepAngleBatch.baseStationId;
+          eventTrigger_estSweepAngle_payload.sweepId = measurement->data.sweepAngleBatch.sweepId;
+          eventTrigger_estSweepAngle_payload.t = measurement->data.sweepAngleBatch.t;
+          eventTrigger_estSweepAngle_payload.sweepAngle = measurement->data.sweepAngleBatch.measuredSweepAngles[sensor];
+          eventTrigger(&eventTrigger_estSweepAngle);
+        }
+      }
+      break;
     default:
       break;
   }
@@ -259,6 +277,17 @@ bool estimatorDequeue(measurement_t *measurement) {
   return pdTRUE == xQueueReceive(measurementsQueue, measurement, 0);
 }
 
+void estimatorGetLoad(estimatorLoad_t* load) {
+  load->queueLength = measurementsQueue ? uxQueueMessagesWaiting(measurementsQueue) : 0;
+  load->queueSize = MEASUREMENTS_QUEUE_SIZE;
+  load->notAppendedCount = notAppendedCount;
+  load->updateDurationUs = updateDurationUs;
+}
+
+void estimatorReportUpdateDuration(const uint32_t durationUs) {
+  updateDurationUs = durationUs;
+}
+
 LOG_GROUP_START(estimator)
   STATS_CNT_RATE_LOG_ADD(rtApnd, &measurementAppendedCounter)
   STATS_CNT_RATE_LOG_ADD(rtRej, &measurementNotAppendedCounter)
@@ -76,6 +76,7 @@
 #include "axis3fSubSampler.h"
 
 #include "statsCnt.h"
+#include "usec_time.h"
 #include "rateSupervisor.h"
 
 // Measurement models
@@ -247,7 +248,9 @@ static void kalmanTask(void* parameters) {
     // Add process noise every loop, rather than every prediction
     kalmanCoreAddProcessNoise(&coreData, &coreParams, nowMs);
 
+    const uint64_t updateStartUs = usecTimestamp();
     updateQueuedMeasurements(nowMs, quadIsFlying);
+    estimatorReportUpdateDuration(usecTimestamp() - updateStartUs);
 
     if (kalmanCoreFinalize(&coreData))
     {
@@ -336,6 +339,9 @@ static void updateQueuedMeasurements(const uint32_t nowMs, const bool quadIsFlyi
       case MeasurementTypeSweepAngle:
         kalmanCoreUpdateWithSweepAngles(&coreData, &m.data.sweepAngle, nowMs, &sweepOutlierFilterState);
         break;
+      case MeasurementTypeSweepAngleBatch:
+        kalmanCoreUpdateWithSweepAngleBatch(&coreData, &m.data.sweepAngleBatch, nowMs, &sweepOutlierFilterState);
+        break;
       case MeasurementTypeGyroscope:
         axis3fSubSamplerAccumulate(&gyroSubSampler, &m.data.gyroscope.gyro);
         gyroLatest = m.data.gyroscope.gyro;
@@ -503,8 +509,40 @@ LOG_GROUP_STOP(kalman)
 
 LOG_GROUP_START(outlierf)
   LOG_ADD(LOG_INT32, lhWin, &sweepOutlierFilterState.openingWindowMs)
+#ifdef CONFIG_ESTIMATOR_KALMAN_OUTLIER_FILTER_BANK
+  /**
+   * @brief Ratio of TDoA samples within the gate, all anchor pairs
+   */
+  LOG_ADD(LOG_FLOAT, tdAcc, &outlierFilterTdoaState.bank.acceptanceRate)
+  /**
+   * @brief Ratio of TDoA samples within the gate, for the anchor pair set by the outlierf.tdMonId parameter
+   */
+  LOG_ADD(LOG_FLOAT, tdMonAcc, &outlierFilterTdoaState.bank.monitoredAcceptanceRate)
+  /**
+   * @brief Ratio of Lighthouse samples within the gate, all base stations and sensors
+   */
+  LOG_ADD(LOG_FLOAT, lhAcc, &sweepOutlierFilterState.bank.acceptanceRate)
+  /**
+   * @brief Ratio of Lighthouse samples within the gate, for the base station and sensor set by the
+   * outlierf.lhMonId parameter
+   */
+  LOG_ADD(LOG_FLOAT, lhMonAcc, &sweepOutlierFilterState.bank.monitoredAcceptanceRate)
+#endif
 LOG_GROUP_STOP(outlierf)
 
+#ifdef CONFIG_ESTIMATOR_KALMAN_OUTLIER_FILTER_BANK
+PARAM_GROUP_START(outlierf)
+/**
+ * @brief TDoA anchor pair to monitor in the outlierf.tdMonAcc log variable, (anchor id A << 8) | anchor id B
+ */
+  PARAM_ADD(PARAM_UINT16, tdMonId, &outlierFilterTdoaState.bank.monitoredSourceId)
+/**
+ * @brief Lighthouse sensor to monitor in the outlierf.lhMonAcc log variable, (base station << 2) | sensor
+ */
+  PARAM_ADD(PARAM_UINT16, lhMonId, &sweepOutlierFilterState.bank.monitoredSourceId)
+PARAM_GROUP_STOP(outlierf)
+#endif
+
 /**
  * Tuning parameters for the Extended Kalman Filter (EKF)
  *     estimator
@@ -210,6 +210,11 @@ void kalmanCoreInit(kalmanCoreData_t *this, const kalmanCoreParams_t *params, co
 }
 
 void kalmanCoreScalarUpdate(kalmanCoreData_t* this, arm_matrix_instance_f32 *Hm, float error, float stdMeasNoise)
+{
+  kalmanCoreScalarUpdateGated(this, Hm, error, stdMeasNoise, 0, 0);
+}
+
+bool kalmanCoreScalarUpdateGated(kalmanCoreData_t* this, arm_matrix_instance_f32 *Hm, float error, float stdMeasNoise, kalmanCoreInnovationGate_t gate, void* gateContext)
 {
   // The Kalman gain as a column vector
   NO_DMA_CCM_SAFE_ZERO_INIT static float K[KC_STATE_DIM];
@@ -245,6 +250,10 @@ void kalmanCoreScalarUpdate(kalmanCoreData_t* this, arm_matrix_instance_f32 *Hm,
   }
   ASSERT(!isnan(HPHR));
 
+  if (gate && !gate(gateContext, error, HPHR)) {
+    return false;
+  }
+
   // ====== MEASUREMENT UPDATE ======
   // Calculate the Kalman gain and perform the state update
   for (int i=0; i<KC_STATE_DIM; i++) {
@@ -279,6 +288,8 @@ void kalmanCoreScalarUpdate(kalmanCoreData_t* this, arm_matrix_instance_f32 *Hm,
   assertStateNotNaN(this);
 
   this->isUpdated = true;
+
+  return true;
 }
 
 void kalmanCoreUpdateWithPKE(kalmanCoreData_t* this, arm_matrix_instance_f32 *Hm, arm_matrix_instance_f32 *Km, arm_matrix_instance_f32 *P_w_m, float error)
@@ -24,8 +24,110 @@
  */
 
 #include "mm_sweep_angles.h"
+#include "lighthouse_calibration.h"
 
 
+// The calibration data and the measurement model, or the precomputed calibration terms if available
+typedef struct {
+  float t;
+  float tan_t;
+  const lighthouseCalibrationSweep_t* calib;
+  lighthouseCalibrationMeasurementModel_t calibrationMeasurementModel;
+  const lighthouseCalibrationSweepLh2Precalc_t* calibPrecalc;
+} sweepModel_t;
+
+#ifdef CONFIG_ESTIMATOR_KALMAN_OUTLIER_FILTER_BANK
+typedef struct {
+  OutlierFilterLhState_t* outlierFilterState;
+  uint8_t baseStation;
+  uint8_t sensor;
+  uint32_t nowMs;
+} sweepGateContext_t;
+
+static bool sweepGate(void* context, const float error, const float innovationVariance) {
+  sweepGateContext_t* gateContext = context;
+  return outlierFilterLighthouseValidateChiSquare(gateContext->outlierFilterState, gateContext->baseStation, gateContext->sensor,
+    error, innovationVariance, gateContext->nowMs);
+}
+#endif
+
+static void scalarUpdate(kalmanCoreData_t *this, arm_matrix_instance_f32 *H, const float error, const float stdDev,
+    OutlierFilterLhState_t* sweepOutlierFilterState, const uint8_t baseStation, const uint8_t sensor, const uint32_t nowMs) {
+#ifdef CONFIG_ESTIMATOR_KALMAN_OUTLIER_FILTER_BANK
+  // The outlier gating is done in the update, using the innovation variance
+  sweepGateContext_t gateContext = {.outlierFilterState = sweepOutlierFilterState, .baseStation = baseStation, .sensor = sensor, .nowMs = nowMs};
+  kalmanCoreScalarUpdateGated(this, H, error, stdDev, sweepGate, &gateContext);
+#else
+  kalmanCoreScalarUpdate(this, H, error, stdDev);
+#endif
+}
+
+static void initSweepModel(sweepModel_t* model, const float t, const lighthouseCalibrationSweep_t* calib,
+    const lighthouseCalibrationMeasurementModel_t calibrationMeasurementModel, const lighthouseCalibrationSweepLh2Precalc_t* calibPrecalc) {
+  model->t = t;
+  model->calib = calib;
+  model->calibrationMeasurementModel = calibrationMeasurementModel;
+  model->calibPrecalc = calibPrecalc;
+
+  if (calibPrecalc) {
+    model->tan_t = calibPrecalc->tanT;
+  } else {
+    model->tan_t = tanf(t);
+  }
+}
+
+// Calculates the error and the gradient (global reference frame) of the sweep angle for a sensor.
+// sr is the sensor position relative to the rotor, in the rotor reference frame.
+// Returns false if the sample is an outlier or too close to a singularity.
+static bool calculateSweepAngleErrorAndGradient(const vec3d sr, const sweepModel_t* model, const float measuredSweepAngle, const mat3d* rotorRot,
+    const uint32_t nowMs, OutlierFilterLhState_t* sweepOutlierFilterState, float* error, vec3d g) {
+  // The following computations are in the rotor refernece frame
+  const float x = sr[0];
+  const float y = sr[1];
+  const float z = sr[2];
+
+  const float r2 = x * x + y * y;
+
+  float predictedSweepAngle;
+  if (model->calibPrecalc) {
+    predictedSweepAngle = lighthouseCalibrationMeasurementModelLh2Precalc(x, y, z, model->calibPrecalc);
+  } else {
+    predictedSweepAngle = model->calibrationMeasurementModel(x, y, z, model->t, model->calib);
+  }
+  *error = measuredSweepAngle - predictedSweepAngle;
+
+#ifdef CONFIG_ESTIMATOR_KALMAN_OUTLIER_FILTER_BANK
+  // Outliers are gated in the update
+  const bool isSampleAccepted = true;
+#else
+  const float r = arm_sqrt(r2);
+  const bool isSampleAccepted = outlierFilterLighthouseValidateSweep(sweepOutlierFilterState, r, *error, nowMs);
+#endif
+
+  if (isSampleAccepted) {
+    // Calculate H vector (in the rotor reference frame)
+    const float tan_t = model->tan_t;
+    const float z_tan_t = z * tan_t;
+    const float qNum = r2 - z_tan_t * z_tan_t;
+    // Avoid singularity
+    if (qNum > 0.0001f) {
+      const float q = tan_t / arm_sqrt(qNum);
+      vec3d gr = {(-y - x * z * q) / r2, (x - y * z * q) / r2 , q};
+
+      // gr is in the rotor reference frame, rotate back to the global
+      // reference frame using the rotor rotation matrix
+      arm_matrix_instance_f32 gr_ = {3, 1, gr};
+      arm_matrix_instance_f32 Rr_ = {3, 3, (float32_t *)(*rotorRot)};
+      arm_matrix_instance_f32 g_ = {3, 1, g};
+      mat_mult(&Rr_, &gr_, &g_);
+
+      return true;
+    }
+  }
+
+  return false;
+}
+
 void kalmanCoreUpdateWithSweepAngles(kalmanCoreData_t *this, sweepAngleMeasurement_t *sweepInfo, const uint32_t nowMs, OutlierFilterLhState_t* sweepOutlierFilterState) {
   // Rotate the sensor position from CF reference frame to global reference frame,
   // using the CF roatation matrix
@@ -50,44 +152,77 @@ void kalmanCoreUpdateWithSweepAngles(kalmanCoreData_t *this, sweepAngleMeasureme
   arm_matrix_instance_f32 sr_ = {3, 1, sr};
   mat_mult(&Rr_inv_, &stmp_, &sr_);
 
-  // The following computations are in the rotor refernece frame
-  const float x = sr[0];
-  const float y = sr[1];
-  const float z = sr[2];
-  const float t = sweepInfo->t;
-  const float tan_t = tanf(t);
+  sweepModel_t model;
+  initSweepModel(&model, sweepInfo->t, sweepInfo->calib, sweepInfo->calibrationMeasurementModel, sweepInfo->calibPrecalc);
 
-  const float r2 = x * x + y * y;
-  const float r = arm_sqrt(r2);
+  float error;
+  vec3d g;
+  if (calculateSweepAngleErrorAndGradient(sr, &model, sweepInfo->measuredSweepAngle, sweepInfo->rotorRot, nowMs, sweepOutlierFilterState, &error, g)) {
+    float h[KC_STATE_DIM] = {0};
+    h[KC_STATE_X] = g[0];
+    h[KC_STATE_Y] = g[1];
+    h[KC_STATE_Z] = g[2];
 
-  const float predictedSweepAngle = sweepInfo->calibrationMeasurementModel(x, y, z, t, sweepInfo->calib);
-  const float measuredSweepAngle = sweepInfo->measuredSweepAngle;
-  const float error = measuredSweepAngle - predictedSweepAngle;
+    arm_matrix_instance_f32 H = {1, KC_STATE_DIM, h};
+    scalarUpdate(this, &H, error, sweepInfo->stdDev, sweepOutlierFilterState, sweepInfo->baseStationId, sweepInfo->sensorId, nowMs);
+  }
+}
 
-  if (outlierFilterLighthouseValidateSweep(sweepOutlierFilterState, r, error, nowMs)) {
-    // Calculate H vector (in the rotor reference frame)
-    const float z_tan_t = z * tan_t;
-    const float qNum = r2 - z_tan_t * z_tan_t;
-    // Avoid singularity
-    if (qNum > 0.0001f) {
-      const float q = tan_t / arm_sqrt(qNum);
-      vec3d gr = {(-y - x * z * q) / r2, (x - y * z * q) / r2 , q};
+void kalmanCoreUpdateWithSweepAngleBatch(kalmanCoreData_t *this, sweepAngleBatchMeasurement_t *sweepInfo, const uint32_t nowMs, OutlierFilterLhState_t* sweepOutlierFilterState) {
+  // The sensor position in the rotor reference frame is
+  // sr = Rr_inv * (pcf + Rcf * scf - pr) = Rr_inv * (pcf - pr) + (Rr_inv * Rcf) * scf
+  // where the first term and the matrix product are the same for all sensors
+  mat3d RrRcf;
+  arm_matrix_instance_f32 Rr_inv_ = {3, 3, (float32_t *)(*sweepInfo->rotorRotInv)};
+  arm_matrix_instance_f32 Rcf_ = {3, 3, (float32_t *)this->R};
+  arm_matrix_instance_f32 RrRcf_ = {3, 3, (float32_t *)RrRcf};
+  mat_mult(&Rr_inv_, &Rcf_, &RrRcf_);
 
-      // gr is in the rotor reference frame, rotate back to the global
-      // reference frame using the rotor rotation matrix
-      vec3d g;
-      arm_matrix_instance_f32 gr_ = {3, 1, gr};
-      arm_matrix_instance_f32 Rr_ = {3, 3, (float32_t *)(*sweepInfo->rotorRot)};
-      arm_matrix_instance_f32 g_ = {3, 1, g};
-      mat_mult(&Rr_, &gr_, &g_);
+  const vec3d* pr = sweepInfo->rotorPos;
+  vec3d stmp = {this->S[KC_STATE_X] - (*pr)[0], this->S[KC_STATE_Y] - (*pr)[1], this->S[KC_STATE_Z] - (*pr)[2]};
+  arm_matrix_instance_f32 stmp_ = {3, 1, stmp};
+  vec3d sr0;
+  arm_matrix_instance_f32 sr0_ = {3, 1, sr0};
+  mat_mult(&Rr_inv_, &stmp_, &sr0_);
+
+  sweepModel_t model;
+  initSweepModel(&model, sweepInfo->t, sweepInfo->calib, sweepInfo->calibrationMeasurementModel, sweepInfo->calibPrecalc);
+
+  // Assemble the H rows and errors for all sensors, using the same linearization point
+  vec3d g[SWEEP_ANGLE_BATCH_MAX_SENSORS];
+  float errors[SWEEP_ANGLE_BATCH_MAX_SENSORS];
+  uint8_t sensors[SWEEP_ANGLE_BATCH_MAX_SENSORS];
+  int rowCount = 0;
 
-      float h[KC_STATE_DIM] = {0};
-      h[KC_STATE_X] = g[0];
-      h[KC_STATE_Y] = g[1];
-      h[KC_STATE_Z] = g[2];
+  for (int sensor = 0; sensor < SWEEP_ANGLE_BATCH_MAX_SENSORS; sensor++) {
+    if (sweepInfo->sensorMask & (1 << sensor)) {
+      const float* scf = sweepInfo->sensorPos[sensor];
+      vec3d sr;
+      for (int i = 0; i < 3; i++) {
+        sr[i] = sr0[i] + RrRcf[i][0] * scf[0] + RrRcf[i][1] * scf[1] + RrRcf[i][2] * scf[2];
+      }
 
-      arm_matrix_instance_f32 H = {1, KC_STATE_DIM, h};
-      kalmanCoreScalarUpdate(this, &H, error, sweepInfo->stdDev);
+      if (calculateSweepAngleErrorAndGradient(sr, &model, sweepInfo->measuredSweepAngles[sensor], sweepInfo->rotorRot, nowMs, sweepOutlierFilterState,
+          &errors[rowCount], g[rowCount])) {
+        sensors[rowCount] = sensor;
+        rowCount++;
+      }
     }
   }
+
+  // The measurement noise is independent between the sensors and the block update is done as a sequence
+  // of scalar updates. The errors were calculated for the state before the update and are adjusted with
+  // the change of the state from the previous rows, this gives the same result as a full block update.
+  const vec3d p0 = {this->S[KC_STATE_X], this->S[KC_STATE_Y], this->S[KC_STATE_Z]};
+  for (int row = 0; row < rowCount; row++) {
+    const float stateChange = g[row][0] * (this->S[KC_STATE_X] - p0[0]) + g[row][1] * (this->S[KC_STATE_Y] - p0[1]) + g[row][2] * (this->S[KC_STATE_Z] - p0[2]);
+
+    float h[KC_STATE_DIM] = {0};
+    h[KC_STATE_X] = g[row][0];
+    h[KC_STATE_Y] = g[row][1];
+    h[KC_STATE_Z] = g[row][2];
+
+    arm_matrix_instance_f32 H = {1, KC_STATE_DIM, h};
+    scalarUpdate(this, &H, errors[row] - stateChange, sweepInfo->stdDev, sweepOutlierFilterState, sweepInfo->baseStationId, sensors[row], nowMs);
+  }
 }
@@ -30,6 +30,19 @@
 #include "outlierFilterTdoaSteps.h"
 #endif
 
+#ifdef CONFIG_ESTIMATOR_KALMAN_OUTLIER_FILTER_BANK
+typedef struct {
+  OutlierFilterTdoaState_t* outlierFilterState;
+  const tdoaMeasurement_t* tdoa;
+  uint32_t nowMs;
+} tdoaGateContext_t;
+
+static bool tdoaGate(void* context, const float error, const float innovationVariance) {
+  tdoaGateContext_t* gateContext = context;
+  return outlierFilterTdoaValidateChiSquare(gateContext->outlierFilterState, gateContext->tdoa, error, innovationVariance, gateContext->nowMs);
+}
+#endif
+
 void kalmanCoreUpdateWithTdoa(kalmanCoreData_t* this, tdoaMeasurement_t *tdoa, const uint32_t nowMs, OutlierFilterTdoaState_t* outlierFilterState)
 {
   /**
@@ -83,12 +96,18 @@ void kalmanCoreUpdateWithTdoa(kalmanCoreData_t* this, tdoaMeasurement_t *tdoa, c
     };
 
     bool sampleIsGood = outlierFilterTdoaValidateSteps(tdoa, error, &jacobian, &estimatedPosition);
+    if (sampleIsGood) {
+      kalmanCoreScalarUpdate(this, &H, error, tdoa->stdDev);
+    }
+    #elif defined(CONFIG_ESTIMATOR_KALMAN_OUTLIER_FILTER_BANK)
+    // The outlier gating is done in the update, using the innovation variance
+    tdoaGateContext_t gateContext = {.outlierFilterState = outlierFilterState, .tdoa = tdoa, .nowMs = nowMs};
+    kalmanCoreScalarUpdateGated(this, &H, error, tdoa->stdDev, tdoaGate, &gateContext);
     #else
     bool sampleIsGood = outlierFilterTdoaValidateIntegrator(outlierFilterState, tdoa, error, nowMs);
-    #endif
-
     if (sampleIsGood) {
       kalmanCoreScalarUpdate(this, &H, error, tdoa->stdDev);
     }
+    #endif
   }
 }
@@ -67,7 +67,6 @@
 static const uint32_t MAX_WAIT_TIME_FOR_HEALTH_MS = 4000;
 
 static pulseProcessorResult_t angles;
-static lighthouseUartFrame_t frame;
 static lighthouseBsIdentificationData_t bsIdentificationData;
 
 // Stats
@@ -135,6 +134,10 @@ static pulseProcessorProcessPulse_t pulseProcessorProcessPulse = pulseProcessorV
 
 #define UART_FRAME_LENGTH 12
 
+// Frames that already are received from the deck are read and processed as a batch
+#define UART_FRAME_BATCH_SIZE 8
+static lighthouseUartFrame_t frames[UART_FRAME_BATCH_SIZE];
+
 
 static bool deckIsFlashed = false;
 
@@ -151,6 +154,7 @@ static void modifyBit(uint16_t *bitmap, const int index, const bool value) {
 void lighthouseCoreInit() {
   lighthouseStorageInitializeSystemTypeFromStorage();
   lighthousePositionEstInit();
+  throttleLh2Init();
 
   for (int i = 0; i < CONFIG_DECK_LIGHTHOUSE_MAX_N_BS; i++) {
     modifyBit(&baseStationAvailabledMap, i, true);
@@ -229,15 +233,20 @@ void lighthouseCoreSetSystemType(const lighthouseBaseStationType_t type)
   lighthouseUpdateSystemType();
 }
 
-TESTABLE_STATIC bool getUartFrameRaw(lighthouseUartFrame_t *frame) {
-  static char data[UART_FRAME_LENGTH];
+static void readUartFrameData(uint8_t data[], const int start) {
+  for(int i = start; i < UART_FRAME_LENGTH; i++) {
+    while(!uart1GetDataWithTimeout(&data[i], 2)) {
+      lighthouseTransmitProcessTimeout();
+    }
+  }
+}
+
+// Decodes a frame from the raw UART data
+TESTABLE_STATIC bool decodeUartFrame(const uint8_t data[], lighthouseUartFrame_t *frame) {
   int syncCounter = 0;
 
   for(int i = 0; i < UART_FRAME_LENGTH; i++) {
-    while(!uart1GetDataWithTimeout((uint8_t*)&data[i], 2)) {
-      lighthouseTransmitProcessTimeout();
-    }
-    if ((unsigned char)data[i] == 0xff) {
+    if (data[i] == 0xff) {
       syncCounter += 1;
     }
   }
@@ -266,6 +275,41 @@ TESTABLE_STATIC bool getUartFrameRaw(lighthouseUartFrame_t *frame) {
   return isFrameValid;
 }
 
+TESTABLE_STATIC bool getUartFrameRaw(lighthouseUartFrame_t *frame) {
+  static uint8_t data[UART_FRAME_LENGTH];
+
+  readUartFrameData(data, 0);
+  return decodeUartFrame(data, frame);
+}
+
+/**
+ * @brief Read the next frame, followed by the frames that already have started to arrive, up to maxCount frames.
+ * Reading stops after an invalid frame.
+ *
+ * @param frames (output) The frames that were read
+ * @param maxCount The max number of frames to read
+ * @param isLastFrameValid (output) false if the last frame is invalid
+ * @return int The number of frames read, including the invalid frame
+ */
+TESTABLE_STATIC int getUartFrameBatch(lighthouseUartFrame_t frames[], const int maxCount, bool* isLastFrameValid) {
+  static uint8_t data[UART_FRAME_LENGTH];
+
+  *isLastFrameValid = getUartFrameRaw(&frames[0]);
+  int count = 1;
+
+  while (*isLastFrameValid && count < maxCount) {
+    if (!uart1GetDataWithTimeout(&data[0], 0)) {
+      break;
+    }
+
+    readUartFrameData(data, 1);
+    *isLastFrameValid = decodeUartFrame(data, &frames[count]);
+    count++;
+  }
+
+  return count;
+}
+
 TESTABLE_STATIC void waitForUartSynchFrame() {
   char c;
   int syncCounter = 0;
@@ -401,7 +445,7 @@ static void usePulseResult(pulseProcessor_t *appState, pulseProcessorResult_t* a
         STATS_CNT_RATE_EVENT_DEBUG(&preThrottleRate);
         bool useSample = true;
         if (lighthouseBsTypeV2 == angles->measurementType) {
-          useSample = throttleLh2Samples(now_ms);
+          useSample = throttleLh2Samples(now_ms, baseStation);
         }
 
         if (useSample) {
@@ -519,6 +563,7 @@ static void updateSystemStatus(const uint32_t now_ms) {
 
 void lighthouseCoreTask(void *param) {
   bool isUartFrameValid = false;
+  int frameCount = 0;
 
   uart1Init(230400);
   systemWaitStart();
@@ -547,29 +592,35 @@ void lighthouseCoreTask(void *param) {
 
     bool previousWasSyncFrame = false;
 
-    while((isUartFrameValid = getUartFrameRaw(&frame))) {
+    do {
+      frameCount = getUartFrameBatch(frames, UART_FRAME_BATCH_SIZE, &isUartFrameValid);
+      const int validFrameCount = isUartFrameValid ? frameCount : frameCount - 1;
       const uint32_t now_ms = T2M(xTaskGetTickCount());
 
-      // If a sync frame is getting through, we are only receiving sync frames. So nothing else. Reset state
-      if(frame.isSyncFrame && previousWasSyncFrame) {
-          pulseProcessorAllClear(&angles);
-      }
-      // Now we are receiving items
-      else if(!frame.isSyncFrame) {
-        STATS_CNT_RATE_EVENT_DEBUG(&frameRate);
-	lighthouseTransmitProcessFrame(&frame);
-
-        deckHealthCheck(&lighthouseCoreState, &frame, now_ms);
-        lighthouseUpdateSystemType();
-        if (pulseProcessorProcessPulse) {
-          processFrame(&lighthouseCoreState, &angles, &frame, now_ms);
+      for (int i = 0; i < validFrameCount; i++) {
+        const lighthouseUartFrame_t* frame = &frames[i];
+
+        // If a sync frame is getting through, we are only receiving sync frames. So nothing else. Reset state
+        if(frame->isSyncFrame && previousWasSyncFrame) {
+            pulseProcessorAllClear(&angles);
+        }
+        // Now we are receiving items
+        else if(!frame->isSyncFrame) {
+          STATS_CNT_RATE_EVENT_DEBUG(&frameRate);
+          lighthouseTransmitProcessFrame(frame);
+
+          deckHealthCheck(&lighthouseCoreState, frame, now_ms);
+          lighthouseUpdateSystemType();
+          if (pulseProcessorProcessPulse) {
+            processFrame(&lighthouseCoreState, &angles, frame, now_ms);
+          }
         }
-      }
 
-      previousWasSyncFrame = frame.isSyncFrame;
+        previousWasSyncFrame = frame->isSyncFrame;
+      }
 
       updateSystemStatus(now_ms);
-    }
+    } while (isUartFrameValid);
 
     uartSynchronized = false;
   }
@@ -46,6 +46,7 @@
 static STATS_CNT_RATE_DEFINE(positionRate, ONE_SECOND);
 static STATS_CNT_RATE_DEFINE(estBs0Rate, HALF_SECOND);
 static STATS_CNT_RATE_DEFINE(estBs1Rate, HALF_SECOND);
+// Rate loggers are only available for the first two base stations
 static statsCntRateLogger_t* bsEstRates[CONFIG_DECK_LIGHTHOUSE_MAX_N_BS] = {&estBs0Rate, &estBs1Rate};
 
 // The light planes in LH2 are tilted +- 30 degrees
@@ -80,6 +81,7 @@ static void modifyBit(uint16_t *bitmap, const int index, const bool value) {
 void lighthousePositionEstInit() {
   for (int i = 0; i < CONFIG_DECK_LIGHTHOUSE_MAX_N_BS; i++) {
     lighthousePositionGeometryDataUpdated(i);
+    lighthousePositionCalibrationDataWritten(i);
   }
   memoryRegisterHandler(&memDef);
 }
@@ -162,6 +164,11 @@ static bool handleMemWrite(const uint32_t memAddr, const uint8_t writeLen, const
 
 void lighthousePositionCalibrationDataWritten(const uint8_t baseStation) {
   if (baseStation < CONFIG_DECK_LIGHTHOUSE_MAX_N_BS) {
+    const lighthouseCalibration_t* calib = &lighthouseCoreState.bsCalibration[baseStation];
+    baseStationGeometryCache_t* cache = &lighthouseCoreState.bsGeoCache[baseStation];
+    lighthouseCalibrationPrecalcLh2(&calib->sweep[0], -t30, &cache->lh2SweepCalib[0]);
+    lighthouseCalibrationPrecalcLh2(&calib->sweep[1], t30, &cache->lh2SweepCalib[1]);
+
     modifyBit(&lighthouseCoreState.baseStationCalibValidMap, baseStation, lighthouseCoreState.bsCalibration[baseStation].valid);
   }
 }
@@ -170,6 +177,7 @@ static void lighthousePositionGeometryDataUpdated(const int baseStation) {
   if (lighthouseCoreState.bsGeometry[baseStation].valid) {
     baseStationGeometryCache_t* cache = &lighthouseCoreState.bsGeoCache[baseStation];
     preProcessGeometryData(lighthouseCoreState.bsGeometry[baseStation].mat, cache->baseStationInvertedRotationMatrixes, cache->lh1Rotor2RotationMatrixes, cache->lh1Rotor2InvertedRotationMatrixes);
+    lighthouseGeometryGetBaseStationPosition(&lighthouseCoreState.bsGeometry[baseStation], cache->origin);
   }
 
   modifyBit(&lighthouseCoreState.baseStationGeoValidMap, baseStation, lighthouseCoreState.bsGeometry[baseStation].valid);
@@ -214,9 +222,17 @@ static vec3d sensorDeckPositions[4] = {
 };
 
 
+static void countSweepEstimate(const int baseStation) {
+  if (bsEstRates[baseStation]) {
+    STATS_CNT_RATE_EVENT(bsEstRates[baseStation]);
+  }
+  STATS_CNT_RATE_EVENT(&positionRate);
+}
+
 static positionMeasurement_t ext_pos;
 static float sweepStd = 0.0004;
 static float sweepStdLh2 = 0.001;
+static uint8_t sweepBatchEnabled = 1;
 
 static vec3d position;
 static vec3d positionLog;
@@ -286,6 +302,7 @@ static void estimatePositionSweepsLh1(const pulseProcessor_t* appState, pulsePro
   sweepInfo.rotorPos = &appState->bsGeometry[baseStation].origin;
   sweepInfo.t = 0;
   sweepInfo.calibrationMeasurementModel = lighthouseCalibrationMeasurementModelLh1;
+  sweepInfo.calibPrecalc = 0;
   sweepInfo.baseStationId = baseStation;
 
   for (size_t sensor = 0; sensor < PULSE_PROCESSOR_N_SENSORS; sensor++) {
@@ -302,8 +319,7 @@ static void estimatePositionSweepsLh1(const pulseProcessor_t* appState, pulsePro
         sweepInfo.sweepId = 0;
 
         estimatorEnqueueSweepAngles(&sweepInfo);
-        STATS_CNT_RATE_EVENT(bsEstRates[baseStation]);
-        STATS_CNT_RATE_EVENT(&positionRate);
+        countSweepEstimate(baseStation);
       }
 
       sweepInfo.measuredSweepAngle = measurement->angles[1];
@@ -317,20 +333,72 @@ static void estimatePositionSweepsLh1(const pulseProcessor_t* appState, pulsePro
           estimatorEnqueueSweepAngles(&sweepInfo);
         #endif
 
-        STATS_CNT_RATE_EVENT(bsEstRates[baseStation]);
-        STATS_CNT_RATE_EVENT(&positionRate);
+        countSweepEstimate(baseStation);
+      }
+    }
+  }
+}
+
+// Sends the angles from all sensors for one sweep as one measurement, the estimator
+// can share the geometry calculations between the sensors
+static void estimatePositionSweepsLh2Batch(const pulseProcessor_t* appState, pulseProcessorResult_t* angles, int baseStation) {
+  const lighthouseCalibration_t* bsCalib = &appState->bsCalibration[baseStation];
+  const baseStationGeometryCache_t* bsGeoCache = &appState->bsGeoCache[baseStation];
+  sweepAngleBatchMeasurement_t sweepInfo[PULSE_PROCESSOR_N_SWEEPS];
+
+  for (int sweep = 0; sweep < PULSE_PROCESSOR_N_SWEEPS; sweep++) {
+    sweepInfo[sweep].stdDev = sweepStdLh2;
+    sweepInfo[sweep].sensorPos = sensorDeckPositions;
+    sweepInfo[sweep].rotorPos = &appState->bsGeometry[baseStation].origin;
+    sweepInfo[sweep].rotorRot = &appState->bsGeometry[baseStation].mat;
+    sweepInfo[sweep].rotorRotInv = &bsGeoCache->baseStationInvertedRotationMatrixes;
+    sweepInfo[sweep].calibrationMeasurementModel = lighthouseCalibrationMeasurementModelLh2;
+    sweepInfo[sweep].baseStationId = baseStation;
+    sweepInfo[sweep].sweepId = sweep;
+    sweepInfo[sweep].t = (sweep == 0) ? -t30 : t30;
+    sweepInfo[sweep].calib = &bsCalib->sweep[sweep];
+    sweepInfo[sweep].calibPrecalc = &bsGeoCache->lh2SweepCalib[sweep];
+    sweepInfo[sweep].sensorMask = 0;
+  }
+
+  for (size_t sensor = 0; sensor < PULSE_PROCESSOR_N_SENSORS; sensor++) {
+    pulseProcessorSensorMeasurement_t* measurement = &angles->baseStationMeasurementsLh2[baseStation].sensorMeasurements[sensor];
+    if (measurement->validCount == PULSE_PROCESSOR_N_SWEEPS) {
+      for (int sweep = 0; sweep < PULSE_PROCESSOR_N_SWEEPS; sweep++) {
+        sweepInfo[sweep].measuredSweepAngles[sensor] = measurement->angles[sweep];
+        if (measurement->angles[sweep] != 0) {
+          sweepInfo[sweep].sensorMask |= (1 << sensor);
+          countSweepEstimate(baseStation);
+        }
       }
     }
   }
+
+  for (int sweep = 0; sweep < PULSE_PROCESSOR_N_SWEEPS; sweep++) {
+    if (sweepInfo[sweep].sensorMask) {
+      #ifndef CONFIG_DECK_LIGHTHOUSE_AS_GROUNDTRUTH
+        estimatorEnqueueSweepAngleBatch(&sweepInfo[sweep]);
+      #endif
+    }
+  }
 }
 
 static void estimatePositionSweepsLh2(const pulseProcessor_t* appState, pulseProcessorResult_t* angles, int baseStation) {
+  // Only the kalman estimator handles batched sweeps
+  #ifdef CONFIG_ESTIMATOR_KALMAN_ENABLE
+  if (sweepBatchEnabled && stateEstimatorGetType() == StateEstimatorTypeKalman) {
+    estimatePositionSweepsLh2Batch(appState, angles, baseStation);
+    return;
+  }
+  #endif
+
   const lighthouseCalibration_t* bsCalib = &appState->bsCalibration[baseStation];
+  const baseStationGeometryCache_t* bsGeoCache = &appState->bsGeoCache[baseStation];
   sweepAngleMeasurement_t sweepInfo;
   sweepInfo.stdDev = sweepStdLh2;
   sweepInfo.rotorPos = &appState->bsGeometry[baseStation].origin;
   sweepInfo.rotorRot = &appState->bsGeometry[baseStation].mat;
-  sweepInfo.rotorRotInv = &appState->bsGeoCache[baseStation].baseStationInvertedRotationMatrixes;
+  sweepInfo.rotorRotInv = &bsGeoCache->baseStationInvertedRotationMatrixes;
   sweepInfo.calibrationMeasurementModel = lighthouseCalibrationMeasurementModelLh2;
   sweepInfo.baseStationId = baseStation;
 
@@ -344,24 +412,24 @@ static void estimatePositionSweepsLh2(const pulseProcessor_t* appState, pulsePro
       if (sweepInfo.measuredSweepAngle != 0) {
         sweepInfo.t = -t30;
         sweepInfo.calib = &bsCalib->sweep[0];
+        sweepInfo.calibPrecalc = &bsGeoCache->lh2SweepCalib[0];
         sweepInfo.sweepId = 0;
         #ifndef CONFIG_DECK_LIGHTHOUSE_AS_GROUNDTRUTH
           estimatorEnqueueSweepAngles(&sweepInfo);
         #endif
-        STATS_CNT_RATE_EVENT(bsEstRates[baseStation]);
-        STATS_CNT_RATE_EVENT(&positionRate);
+        countSweepEstimate(baseStation);
       }
 
       sweepInfo.measuredSweepAngle = measurement->angles[1];
       if (sweepInfo.measuredSweepAngle != 0) {
         sweepInfo.t = t30;
         sweepInfo.calib = &bsCalib->sweep[1];
+        sweepInfo.calibPrecalc = &bsGeoCache->lh2SweepCalib[1];
         sweepInfo.sweepId = 1;
         #ifndef CONFIG_DECK_LIGHTHOUSE_AS_GROUNDTRUTH
           estimatorEnqueueSweepAngles(&sweepInfo);
         #endif
-        STATS_CNT_RATE_EVENT(bsEstRates[baseStation]);
-        STATS_CNT_RATE_EVENT(&positionRate);
+        countSweepEstimate(baseStation);
       }
     }
   }
@@ -381,11 +449,9 @@ static void estimatePositionSweeps(const pulseProcessor_t* appState, pulseProces
   }
 }
 
-static bool estimateYawDeltaOneBaseStation(const int bs, const pulseProcessorResult_t* angles, const baseStationGeometry_t baseStationGeometries[], const float cfPos[3], const float n[3], const arm_matrix_instance_f32 *RR, float *yawDelta) {
-  const baseStationGeometry_t* baseStationGeometry = &baseStationGeometries[bs];
-
-  vec3d baseStationPos;
-  lighthouseGeometryGetBaseStationPosition(baseStationGeometry, baseStationPos);
+static bool estimateYawDeltaOneBaseStation(const int bs, const pulseProcessorResult_t* angles, const pulseProcessor_t* state, const float cfPos[3], const float n[3], const arm_matrix_instance_f32 *RR, float *yawDelta) {
+  const baseStationGeometry_t* baseStationGeometry = &state->bsGeometry[bs];
+  const float* baseStationPos = state->bsGeoCache[bs].origin;
 
   vec3d rays[PULSE_PROCESSOR_N_SENSORS];
   for (int sensor = 0; sensor < PULSE_PROCESSOR_N_SENSORS; sensor++) {
@@ -445,7 +511,7 @@ static void estimateYaw(const pulseProcessor_t *state, pulseProcessorResult_t* a
 
   // Calculate yaw delta using only one base station for now
   float yawDelta;
-  if (estimateYawDeltaOneBaseStation(baseStation, angles, state->bsGeometry, cfPos, n, &RR, &yawDelta)) {
+  if (estimateYawDeltaOneBaseStation(baseStation, angles, state, cfPos, n, &RR, &yawDelta)) {
     #ifndef CONFIG_DECK_LIGHTHOUSE_AS_GROUNDTRUTH
       yawErrorMeasurement_t yawDeltaMeasurement = {.yawError = yawDelta, .stdDev = 0.01};
       estimatorEnqueueYawError(&yawDeltaMeasurement);
@@ -495,4 +561,8 @@ PARAM_ADD_CORE(PARAM_FLOAT, sweepStd, &sweepStd)
  * @brief Standard deviation Sweep angles Lighthouse V2
  */
 PARAM_ADD_CORE(PARAM_FLOAT, sweepStd2, &sweepStdLh2)
+/**
+ * @brief Send the sweep angles from all sensors as one measurement to the kalman estimator (Lighthouse V2). 0 = one measurement per sensor, 1 = batched (default)
+ */
+PARAM_ADD(PARAM_UINT8, sweepBatch, &sweepBatchEnabled)
 PARAM_GROUP_STOP(lighthouse)
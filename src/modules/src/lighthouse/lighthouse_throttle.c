@@ -25,7 +25,10 @@
  */
 
 #include <stdlib.h>
+#include <string.h>
 #include "lighthouse_throttle.h"
+#include "estimator.h"
+#include "autoconf.h"
 #include "param.h"
 
 // Uncomment next line to add extra debug log variables
@@ -33,32 +36,134 @@
 #include "log.h"
 
 static const uint32_t evaluationIntervalMs = 100;
+
+// The estimator is considered loaded when the latest measurement update took longer than this,
+// and to have spare capacity when it is below the low limit. The Kalman estimator runs at 1 kHz.
+#define UPDATE_DURATION_HIGH_US 500
+#define UPDATE_DURATION_LOW_US 250
+
+// Change of the target rate, per evaluation interval
+#define RATE_DECREASE_FACTOR 0.7f
+#define RATE_INCREASE_STEP 5.0f
+
+// Base stations that have not had a sample used for this long are always used
+#define STALE_BASE_STATION_MS 500
+
 static uint16_t maxRate = 50;  // Samples / second
+static uint8_t adaptiveEnable = 1;
+static uint16_t adaptiveMinRate = 30;  // Samples / second
+static uint16_t adaptiveMaxRate = 120;  // Samples / second
+
 static float discardProbability = 0.0f;
+static float targetRate = 50.0f;
+
+static struct {
+    uint32_t previousEvaluationTime;
+    uint32_t nextEvaluationTime;
+    uint32_t eventCounter;
+    uint32_t staleCounter;
+    int discardThreshold;
+
+    uint16_t peakQueueLength;
+    uint32_t previousNotAppendedCount;
+
+    uint32_t latestUsedMs[CONFIG_DECK_LIGHTHOUSE_MAX_N_BS];
+    bool hasBeenUsed[CONFIG_DECK_LIGHTHOUSE_MAX_N_BS];
+} state;
+
+static void updateTargetRate(const estimatorLoad_t* load) {
+    const bool hasDroppedMeasurements = (load->notAppendedCount != state.previousNotAppendedCount);
+    const bool isQueueFilling = (state.peakQueueLength * 2 > load->queueSize);
+    const bool isUpdateSlow = (load->updateDurationUs > UPDATE_DURATION_HIGH_US);
+
+    const bool isQueueEmpty = (state.peakQueueLength * 4 <= load->queueSize);
+    const bool isUpdateFast = (load->updateDurationUs < UPDATE_DURATION_LOW_US);
+
+    if (hasDroppedMeasurements || isQueueFilling || isUpdateSlow) {
+        targetRate *= RATE_DECREASE_FACTOR;
+    } else if (isQueueEmpty && isUpdateFast) {
+        targetRate += RATE_INCREASE_STEP;
+    }
+
+    if (targetRate < adaptiveMinRate) {
+        targetRate = adaptiveMinRate;
+    }
+    if (targetRate > adaptiveMaxRate) {
+        targetRate = adaptiveMaxRate;
+    }
+
+    state.previousNotAppendedCount = load->notAppendedCount;
+    state.peakQueueLength = 0;
+}
 
-bool throttleLh2Samples(const uint32_t nowMs) {
-    static uint32_t previousEvaluationTime = 0;
-    static uint32_t nextEvaluationTime = 0;
-    static uint32_t eventCounter = 0;
-    static int discardThreshold = 0;
+static bool isBaseStationStale(const int baseStation, const uint32_t nowMs) {
+    if (baseStation < 0 || baseStation >= CONFIG_DECK_LIGHTHOUSE_MAX_N_BS) {
+        return false;
+    }
+
+    return !state.hasBeenUsed[baseStation] || (nowMs - state.latestUsedMs[baseStation]) > STALE_BASE_STATION_MS;
+}
+
+void throttleLh2Init() {
+    memset(&state, 0, sizeof(state));
+    targetRate = maxRate;
+    discardProbability = 0.0f;
+}
 
-    eventCounter++;
+bool throttleLh2Samples(const uint32_t nowMs, const int baseStation) {
+    state.eventCounter++;
 
-    if (nowMs > nextEvaluationTime) {
-        const float currentRate = 1000.0f * (float)eventCounter / (float)(nowMs - previousEvaluationTime);
-        if (currentRate < (float)maxRate) {
+    // The parameter may be changed by another task, read it once
+    const bool isAdaptive = adaptiveEnable;
+
+    estimatorLoad_t load;
+    if (isAdaptive) {
+        estimatorGetLoad(&load);
+        if (load.queueLength > state.peakQueueLength) {
+            state.peakQueueLength = load.queueLength;
+        }
+    }
+
+    if (nowMs > state.nextEvaluationTime) {
+        float rate = maxRate;
+        if (isAdaptive) {
+            updateTargetRate(&load);
+            rate = targetRate;
+        }
+
+        // Samples from stale base stations are always used, the remaining rate is shared by the other samples
+        const float intervalMs = (float)(nowMs - state.previousEvaluationTime);
+        const float currentRate = 1000.0f * (float)(state.eventCounter - state.staleCounter) / intervalMs;
+        const float availableRate = rate - 1000.0f * (float)state.staleCounter / intervalMs;
+        if (currentRate < availableRate) {
             discardProbability = 0.0;
+        } else if (availableRate <= 0.0f) {
+            discardProbability = 1.0f;
         } else {
-            discardProbability = 1.0f - (float)maxRate / currentRate;
+            discardProbability = 1.0f - availableRate / currentRate;
         }
-        discardThreshold = RAND_MAX * discardProbability;
+        state.discardThreshold = RAND_MAX * discardProbability;
+
+        state.previousEvaluationTime = nowMs;
+        state.eventCounter = 0;
+        state.staleCounter = 0;
+        state.nextEvaluationTime = nowMs + evaluationIntervalMs;
+    }
+
+    // Samples from base stations that have not been used for a while carry more information, always use them
+    const bool isStale = isBaseStationStale(baseStation, nowMs);
+    if (isStale) {
+        state.staleCounter++;
+    }
+
+    const bool useSample = isStale || (rand() > state.discardThreshold);
 
-        previousEvaluationTime = nowMs;
-        eventCounter = 0;
-        nextEvaluationTime = nowMs + evaluationIntervalMs;
+    if (useSample && baseStation >= 0 && baseStation < CONFIG_DECK_LIGHTHOUSE_MAX_N_BS) {
+        state.latestUsedMs[baseStation] = nowMs;
+        state.hasBeenUsed[baseStation] = true;
     }
 
-    return (rand() > discardThreshold);
+    return useSample;
 }
 
 PARAM_GROUP_START(lighthouse)
@@ -67,12 +172,32 @@ PARAM_GROUP_START(lighthouse)
  * @brief Maximum rate of samples sent to the estimator
  *
  * When many LH V2 base stations are available in a system, the over all rate of samples sent to the estimator might be
- * too high to handle. This parameter sets the (approximate) maximum rate (samples/s). 50 By default.
+ * too high to handle. This parameter sets the (approximate) maximum rate (samples/s) when adaptive throttling is
+ * disabled, and the initial rate when it is enabled. 50 By default.
  */
 PARAM_ADD(PARAM_UINT16, lh2maxRate, &maxRate)
 
+/**
+ * @brief Adapt the rate of samples sent to the estimator to the load of the estimator (1 = enabled, 0 = disabled)
+ *
+ * The rate is lowered when the estimator measurement queue fills up, measurements are dropped or the measurement
+ * update takes too long, and increased when there is spare capacity. 1 By default.
+ */
+PARAM_ADD(PARAM_UINT8, lh2adaptive, &adaptiveEnable)
+
+/**
+ * @brief Minimum rate (samples/s) of samples sent to the estimator when adaptive throttling is enabled. 30 By default.
+ */
+PARAM_ADD(PARAM_UINT16, lh2minAdRate, &adaptiveMinRate)
+
+/**
+ * @brief Maximum rate (samples/s) of samples sent to the estimator when adaptive throttling is enabled. 120 By default.
+ */
+PARAM_ADD(PARAM_UINT16, lh2maxAdRate, &adaptiveMaxRate)
+
 PARAM_GROUP_STOP(lighthouse)
 
 LOG_GROUP_START(lighthouse)
 LOG_ADD_DEBUG(LOG_FLOAT, disProb, &discardProbability)
+LOG_ADD_DEBUG(LOG_FLOAT, thrRate, &targetRate)
 LOG_GROUP_STOP(lighthouse)
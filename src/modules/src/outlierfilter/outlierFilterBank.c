@@ -0,0 +1,177 @@
+/**
+ *    ||          ____  _ __
+ * +------+      / __ )(_) /_______________ _____  ___
+ * | 0xBC |     / __  / / __/ ___/ ___/ __ `/_  / / _ \
+ * +------+    / /_/ / / /_/ /__/ /  / /_/ / / /_/  __/
+ *  ||  ||    /_____/_/\__/\___/_/   \__,_/ /___/\___/
+ *
+ * Copyright (C) 2023 Bitcraze AB
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, in version 3.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ *
+ * outlierFilterBank.c: Generic outlier gating with statistics per measurement source
+ */
+
+#include <string.h>
+#include "outlierFilterBank.h"
+
+// Gates for the normalized innovation squared, chi-square with one degree of freedom.
+// 99.7% (3 sigma) of the samples are within the nominal gate, 95% within the tight gate.
+static const float GATE_NOMINAL = 9.0f;
+static const float GATE_TIGHT = 3.84f;
+
+// Weight of a new sample in the acceptance rate of a source, and for all sources
+static const float SOURCE_RATE_ALPHA = 1.0f / 16.0f;
+static const float BANK_RATE_ALPHA = 1.0f / 64.0f;
+
+// Sources with an acceptance rate below the bad level get the tight gate, and sources above the
+// good level the nominal gate. Samples from sources below the reject level are not used at all.
+static const float SOURCE_GOOD_LEVEL = 0.8f;
+static const float SOURCE_BAD_LEVEL = 0.5f;
+static const float SOURCE_REJECT_LEVEL = 0.2f;
+
+// The bank opens up to let all samples through when the acceptance rate for all sources drops
+// below the open level, and closes again when it is above the close level
+static const float BANK_OPEN_LEVEL = 0.2f;
+static const float BANK_CLOSE_LEVEL = 0.8f;
+
+// The number of slots searched for a source
+#define MAX_PROBE 4
+
+#define SLOT_MASK (OUTLIER_FILTER_BANK_SIZE - 1)
+
+static int homeSlot(const uint16_t sourceId) {
+    // Spread consecutive ids, Fibonacci hashing
+    return ((uint16_t)(sourceId * 40503u) >> 8) & SLOT_MASK;
+}
+
+static outlierFilterBankSource_t* findSource(outlierFilterBank_t* this, const uint16_t sourceId) {
+    if (sourceId == OUTLIER_FILTER_BANK_NO_SOURCE) {
+        return 0;
+    }
+
+    int slot = homeSlot(sourceId);
+    for (int i = 0; i < MAX_PROBE; i++) {
+        outlierFilterBankSource_t* source = &this->sources[slot];
+        if (source->sourceId == sourceId) {
+            return source;
+        }
+        slot = (slot + 1) & SLOT_MASK;
+    }
+
+    return 0;
+}
+
+static outlierFilterBankSource_t* addSource(outlierFilterBank_t* this, const uint16_t sourceId, const uint32_t nowMs) {
+    // Use an empty slot if there is one, otherwise replace the least recently used source
+    outlierFilterBankSource_t* result = 0;
+    int slot = homeSlot(sourceId);
+    for (int i = 0; i < MAX_PROBE; i++) {
+        outlierFilterBankSource_t* source = &this->sources[slot];
+        if (source->sourceId == OUTLIER_FILTER_BANK_NO_SOURCE) {
+            result = source;
+            break;
+        }
+
+        if (!result || (nowMs - source->latestUpdateMs) > (nowMs - result->latestUpdateMs)) {
+            result = source;
+        }
+        slot = (slot + 1) & SLOT_MASK;
+    }
+
+    // New sources are trusted until proven otherwise
+    result->sourceId = sourceId;
+    result->acceptanceRate = 1.0f;
+    result->gate = GATE_NOMINAL;
+
+    return result;
+}
+
+static void updateSource(outlierFilterBankSource_t* source, const bool isInGate) {
+    source->acceptanceRate += ((isInGate ? 1.0f : 0.0f) - source->acceptanceRate) * SOURCE_RATE_ALPHA;
+
+    if (source->acceptanceRate > SOURCE_GOOD_LEVEL) {
+        source->gate = GATE_NOMINAL;
+    } else if (source->acceptanceRate < SOURCE_BAD_LEVEL) {
+        source->gate = GATE_TIGHT;
+    }
+}
+
+static void updateBank(outlierFilterBank_t* this, const bool isInGate) {
+    this->acceptanceRate += ((isInGate ? 1.0f : 0.0f) - this->acceptanceRate) * BANK_RATE_ALPHA;
+
+    if (this->isOpen) {
+        if (this->acceptanceRate > BANK_CLOSE_LEVEL) {
+            // We have recovered and converged, close the filter again
+            this->isOpen = false;
+        }
+    } else {
+        if (this->acceptanceRate < BANK_OPEN_LEVEL) {
+            // Lots of outliers from all sources, the estimator may have diverged. Open up to try to recover
+            this->isOpen = true;
+        }
+    }
+}
+
+void outlierFilterBankReset(outlierFilterBank_t* this) {
+    // The monitored source is configured from the outside, keep it
+    const uint16_t monitoredSourceId = this->monitoredSourceId;
+
+    memset(this, 0, sizeof(*this));
+    for (int i = 0; i < OUTLIER_FILTER_BANK_SIZE; i++) {
+        this->sources[i].sourceId = OUTLIER_FILTER_BANK_NO_SOURCE;
+    }
+
+    // Start open to let the estimator converge
+    this->isOpen = true;
+    this->acceptanceRate = 0.0f;
+    this->monitoredSourceId = monitoredSourceId;
+}
+
+bool outlierFilterBankValidate(outlierFilterBank_t* this, const uint16_t sourceId, const float error, const float innovationVariance, const uint32_t nowMs) {
+    if (!(innovationVariance > 0.0f)) {
+        return false;
+    }
+
+    const float normalizedInnovationSq = error * error / innovationVariance;
+
+    if (sourceId == OUTLIER_FILTER_BANK_NO_SOURCE) {
+        // Reserved for empty slots, no statistics
+        return this->isOpen || (normalizedInnovationSq < GATE_NOMINAL);
+    }
+
+    outlierFilterBankSource_t* source = findSource(this, sourceId);
+    if (!source) {
+        source = addSource(this, sourceId, nowMs);
+    }
+
+    const bool isInGate = (normalizedInnovationSq < source->gate);
+
+    updateSource(source, isInGate);
+    updateBank(this, isInGate);
+    source->latestUpdateMs = nowMs;
+
+    if (sourceId == this->monitoredSourceId) {
+        this->monitoredAcceptanceRate = source->acceptanceRate;
+    }
+
+    if (this->isOpen) {
+        return true;
+    }
+
+    return isInGate && (source->acceptanceRate >= SOURCE_REJECT_LEVEL);
+}
+
+const outlierFilterBankSource_t* outlierFilterBankGetSource(const outlierFilterBank_t* this, const uint16_t sourceId) {
+    return findSource((outlierFilterBank_t*)this, sourceId);
+}
@@ -41,7 +41,18 @@ static const float lhMaxError = 0.05f;
 void outlierFilterLighthouseReset(OutlierFilterLhState_t* this, const uint32_t nowMs) {
   this->openingTimeMs = nowMs;
   this->openingWindowMs = lhMinWindowTimeMs;
+
+  #ifdef CONFIG_ESTIMATOR_KALMAN_OUTLIER_FILTER_BANK
+  outlierFilterBankReset(&this->bank);
+  #endif
+}
+
+#ifdef CONFIG_ESTIMATOR_KALMAN_OUTLIER_FILTER_BANK
+bool outlierFilterLighthouseValidateChiSquare(OutlierFilterLhState_t* this, const uint8_t baseStation, const uint8_t sensor, const float error, const float innovationVariance, const uint32_t nowMs) {
+  const uint16_t sourceId = (baseStation << 2) | (sensor & 0x03);
+  return outlierFilterBankValidate(&this->bank, sourceId, error, innovationVariance, nowMs);
 }
+#endif
 
 
 bool outlierFilterLighthouseValidateSweep(OutlierFilterLhState_t* this, const float distanceToBs, const float angleError, const uint32_t nowMs) {
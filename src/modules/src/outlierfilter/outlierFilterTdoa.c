@@ -54,6 +54,10 @@ void outlierFilterTdoaReset(OutlierFilterTdoaState_t* this) {
   this->integrator = 0.0f;
   this->isFilterOpen = true;
   this->latestUpdateMs = 0;
+
+  #ifdef CONFIG_ESTIMATOR_KALMAN_OUTLIER_FILTER_BANK
+  outlierFilterBankReset(&this->bank);
+  #endif
 }
 
 bool outlierFilterTdoaValidateIntegrator(OutlierFilterTdoaState_t* this, const tdoaMeasurement_t* tdoa, const float error, const uint32_t nowMs) {
@@ -104,6 +108,18 @@ bool outlierFilterTdoaValidateIntegrator(OutlierFilterTdoaState_t* this, const t
   return sampleIsGood;
 }
 
+#ifdef CONFIG_ESTIMATOR_KALMAN_OUTLIER_FILTER_BANK
+bool outlierFilterTdoaValidateChiSquare(OutlierFilterTdoaState_t* this, const tdoaMeasurement_t* tdoa, const float error, const float innovationVariance, const uint32_t nowMs) {
+  // Discard samples that are physically impossible, most likely measurement error
+  if (!isDistanceDiffSmallerThanDistanceBetweenAnchors(tdoa)) {
+    return false;
+  }
+
+  const uint16_t sourceId = (tdoa->anchorIds[0] << 8) | tdoa->anchorIds[1];
+  return outlierFilterBankValidate(&this->bank, sourceId, error, innovationVariance, nowMs);
+}
+#endif
+
 static float sq(float a) {return a * a;}
 
 static float distanceSq(const point_t* a, const point_t* b) {
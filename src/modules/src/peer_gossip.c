@@ -0,0 +1,139 @@
+/**
+ *    ||          ____  _ __
+ * +------+      / __ )(_) /_______________ _____  ___
+ * | 0xBC |     / __  / / __/ ___/ ___/ __ `/_  / / _ \
+ * +------+    / /_/ / / /_/ /__/ /  / /_/ / / /_/  __/
+ *  ||  ||    /_____/_/\__/\___/_/   \__,_/ /___/\___/
+ *
+ * Crazyflie Firmware
+ *
+ * Copyright (C) 2024 Bitcraze AB
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, in version 3.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ *
+ * peer_gossip.c - Packet format and rate control for sharing the states of
+ * Crazyflies over the P2P radio
+ */
+
+#include <math.h>
+#include "peer_gossip.h"
+#include "peer_localization.h"
+
+// Unit of the age field
+#define AGE_UNIT_MS 10
+
+static int16_t quantize(float value, float scale) {
+  float const scaled = roundf(value * scale);
+  if (scaled > INT16_MAX) {
+    return INT16_MAX;
+  }
+  if (scaled < INT16_MIN) {
+    return INT16_MIN;
+  }
+  return (int16_t)scaled;
+}
+
+static void encodeEntry(peerGossipEntry_t* entry, uint8_t id, const point_t* pos, const velocity_t* vel, uint32_t ageMs) {
+  uint32_t const age = (ageMs + AGE_UNIT_MS / 2) / AGE_UNIT_MS;
+
+  entry->id = id;
+  entry->age = age > UINT8_MAX ? UINT8_MAX : age;
+  entry->x = quantize(pos->x, 1000.0f);
+  entry->y = quantize(pos->y, 1000.0f);
+  entry->z = quantize(pos->z, 1000.0f);
+  entry->vx = quantize(vel->x, 100.0f);
+  entry->vy = quantize(vel->y, 100.0f);
+  entry->vz = quantize(vel->z, 100.0f);
+}
+
+static void decodeEntry(const peerGossipEntry_t* entry, uint32_t nowMs, point_t* pos, velocity_t* vel) {
+  pos->timestamp = nowMs - entry->age * AGE_UNIT_MS;
+  pos->x = entry->x / 1000.0f;
+  pos->y = entry->y / 1000.0f;
+  pos->z = entry->z / 1000.0f;
+
+  vel->timestamp = pos->timestamp;
+  vel->x = entry->vx / 100.0f;
+  vel->y = entry->vy / 100.0f;
+  vel->z = entry->vz / 100.0f;
+}
+
+int peerGossipFillPacket(peerGossipPacket_t* packet, uint8_t ownId, const point_t* pos, const velocity_t* vel, uint32_t nowMs, int* cursor) {
+  int count = 0;
+  if (pos && vel) {
+    encodeEntry(&packet->entries[count], ownId, pos, vel, 0);
+    count++;
+  }
+
+  // Visit each peer at most once, starting where the previous packet stopped
+  int const peerCount = peerLocalizationGetCount();
+  for (int i = 0; i < peerCount && count < PEER_GOSSIP_MAX_ENTRIES; i++) {
+    if (*cursor >= peerCount) {
+      *cursor = 0;
+    }
+    peerLocalizationOtherPosition_t other;
+    bool const isValid = peerLocalizationCopyPositionByIdx(*cursor, &other);
+    (*cursor)++;
+
+    // Peers may have been removed by another task since the count was read
+    if (!isValid) {
+      continue;
+    }
+
+    uint32_t const ageMs = nowMs - other.pos.timestamp;
+    if (other.id != ownId && ageMs <= PEER_GOSSIP_MAX_RELAY_AGE_MS) {
+      encodeEntry(&packet->entries[count], other.id, &other.pos, &other.vel, ageMs);
+      count++;
+    }
+  }
+
+  return count * sizeof(peerGossipEntry_t);
+}
+
+int peerGossipHandlePacket(const peerGossipPacket_t* packet, int size, uint8_t ownId, uint32_t nowMs) {
+  if (size <= 0 || size > (int)sizeof(peerGossipPacket_t) || size % sizeof(peerGossipEntry_t) != 0) {
+    return -1;
+  }
+
+  int used = 0;
+  int const count = size / sizeof(peerGossipEntry_t);
+  for (int i = 0; i < count; i++) {
+    const peerGossipEntry_t* entry = &packet->entries[i];
+    if (entry->id == ownId) {
+      continue;
+    }
+
+    point_t pos;
+    velocity_t vel;
+    decodeEntry(entry, nowMs, &pos, &vel);
+    if (peerLocalizationTellState(entry->id, &pos, &vel)) {
+      used++;
+    }
+  }
+
+  return used;
+}
+
+uint32_t peerGossipComputePeriodMs(float rxPacketsPerSecond, uint32_t periodMs) {
+  // If all Crazyflies send at our rate, the received rate is (n - 1) / period
+  float const crazyflieCount = 1.0f + rxPacketsPerSecond * periodMs / 1000.0f;
+  float const newPeriodMs = crazyflieCount * 1000.0f / PEER_GOSSIP_CHANNEL_BUDGET;
+
+  if (newPeriodMs < PEER_GOSSIP_MIN_PERIOD_MS) {
+    return PEER_GOSSIP_MIN_PERIOD_MS;
+  }
+  if (newPeriodMs > PEER_GOSSIP_MAX_PERIOD_MS) {
+    return PEER_GOSSIP_MAX_PERIOD_MS;
+  }
+  return (uint32_t)newPeriodMs;
+}
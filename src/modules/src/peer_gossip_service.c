@@ -0,0 +1,246 @@
+/**
+ *    ||          ____  _ __
+ * +------+      / __ )(_) /_______________ _____  ___
+ * | 0xBC |     / __  / / __/ ___/ ___/ __ `/_  / / _ \
+ * +------+    / /_/ / / /_/ /__/ /  / /_/ / / /_/  __/
+ *  ||  ||    /_____/_/\__/\___/_/   \__,_/ /___/\___/
+ *
+ * Crazyflie Firmware
+ *
+ * Copyright (C) 2024 Bitcraze AB
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, in version 3.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ *
+ * peer_gossip_service.c - Broadcasts the state of this Crazyflie, and relays
+ * the states of other Crazyflies, over the P2P radio
+ */
+
+#include <string.h>
+
+#include "FreeRTOS.h"
+#include "task.h"
+#include "queue.h"
+
+#include "config.h"
+#include "configblock.h"
+#include "estimator.h"
+#include "log.h"
+#include "param.h"
+#include "static_mem.h"
+#include "system.h"
+#include "peer_gossip.h"
+#include "peer_gossip_service.h"
+
+#define RX_QUEUE_SIZE 4
+
+// Weight of one period in the received packet rate
+#define RX_RATE_ALPHA 0.25f
+
+static bool isInit = false;
+static uint8_t enable = 1;
+
+static uint8_t ownId;
+static uint32_t periodMs = PEER_GOSSIP_MIN_PERIOD_MS;
+static float rxRate;
+static volatile uint32_t rxCount;
+static uint32_t jitterState;
+
+static xQueueHandle rxQueue;
+STATIC_MEM_QUEUE_ALLOC(rxQueue, RX_QUEUE_SIZE, sizeof(P2PPacket));
+
+static void peerGossipTask(void* param);
+STATIC_MEM_TASK_ALLOC(peerGossipTask, PEER_GOSSIP_TASK_STACKSIZE);
+
+static logVarId_t logIdStateEstimateX;
+static logVarId_t logIdStateEstimateY;
+static logVarId_t logIdStateEstimateZ;
+static logVarId_t logIdStateEstimateVx;
+static logVarId_t logIdStateEstimateVy;
+static logVarId_t logIdStateEstimateVz;
+static logVarId_t logIdKalmanVarX;
+static logVarId_t logIdKalmanVarY;
+static logVarId_t logIdKalmanVarZ;
+
+static void p2pCallback(P2PPacket *p)
+{
+  peerGossipP2PIncomingHandler(p);
+}
+
+void peerGossipServiceInit()
+{
+  if (isInit) {
+    return;
+  }
+
+  rxQueue = STATIC_MEM_QUEUE_CREATE(rxQueue);
+  p2pRegisterCB(p2pCallback);
+  STATIC_MEM_TASK_CREATE(peerGossipTask, peerGossipTask, PEER_GOSSIP_TASK_NAME, NULL, PEER_GOSSIP_TASK_PRI);
+
+  isInit = true;
+}
+
+bool peerGossipServiceTest()
+{
+  return isInit;
+}
+
+bool peerGossipP2PIncomingHandler(P2PPacket *p)
+{
+  // All P2P traffic counts as radio load
+  rxCount++;
+
+  if (p->port != PEER_GOSSIP_P2P_PORT) {
+    return false;
+  }
+
+  // Called from the radio link task, hand the packet over to our task
+  xQueueSend(rxQueue, p, 0);
+  return true;
+}
+
+static uint32_t jitterMs(uint32_t maxMs)
+{
+  // Xorshift, spreads the packets from Crazyflies that happen to start at the same time
+  jitterState ^= jitterState << 13;
+  jitterState ^= jitterState >> 17;
+  jitterState ^= jitterState << 5;
+  return jitterState % (maxMs + 1);
+}
+
+static bool isOwnPositionValid(void)
+{
+  if (stateEstimatorGetType() != StateEstimatorTypeKalman || !logVarIdIsValid(logIdKalmanVarX)) {
+    return false;
+  }
+
+  // The variance grows while there are no position measurements
+  float const maxVariance = PEER_GOSSIP_MAX_POSITION_STD_DEV * PEER_GOSSIP_MAX_POSITION_STD_DEV;
+  return logGetFloat(logIdKalmanVarX) < maxVariance &&
+         logGetFloat(logIdKalmanVarY) < maxVariance &&
+         logGetFloat(logIdKalmanVarZ) < maxVariance;
+}
+
+static int fillOwnPacket(peerGossipPacket_t* packet, uint32_t nowMs, int* cursor)
+{
+  if (!isOwnPositionValid()) {
+    return peerGossipFillPacket(packet, ownId, NULL, NULL, nowMs, cursor);
+  }
+
+  point_t pos = {
+    .timestamp = nowMs,
+    .x = logGetFloat(logIdStateEstimateX),
+    .y = logGetFloat(logIdStateEstimateY),
+    .z = logGetFloat(logIdStateEstimateZ),
+  };
+  velocity_t vel = {
+    .timestamp = nowMs,
+    .x = logGetFloat(logIdStateEstimateVx),
+    .y = logGetFloat(logIdStateEstimateVy),
+    .z = logGetFloat(logIdStateEstimateVz),
+  };
+
+  return peerGossipFillPacket(packet, ownId, &pos, &vel, nowMs, cursor);
+}
+
+static void peerGossipTask(void* param)
+{
+  static P2PPacket txPacket;
+  static P2PPacket rxPacket;
+  int cursor = 0;
+
+  systemWaitStart();
+
+  ownId = configblockGetRadioAddress() & 0xff;
+  jitterState = 0x9e3779b9u ^ ownId;
+
+  logIdStateEstimateX = logGetVarId("stateEstimate", "x");
+  logIdStateEstimateY = logGetVarId("stateEstimate", "y");
+  logIdStateEstimateZ = logGetVarId("stateEstimate", "z");
+  logIdStateEstimateVx = logGetVarId("stateEstimate", "vx");
+  logIdStateEstimateVy = logGetVarId("stateEstimate", "vy");
+  logIdStateEstimateVz = logGetVarId("stateEstimate", "vz");
+  logIdKalmanVarX = logGetVarId("kalman", "varX");
+  logIdKalmanVarY = logGetVarId("kalman", "varY");
+  logIdKalmanVarZ = logGetVarId("kalman", "varZ");
+
+  uint32_t lastRxCount = rxCount;
+  uint32_t lastSendTime = xTaskGetTickCount();
+  uint32_t nextSendTime = lastSendTime;
+
+  while (true) {
+    uint32_t now = xTaskGetTickCount();
+    TickType_t const timeout = (int32_t)(nextSendTime - now) > 0 ? nextSendTime - now : 0;
+    if (xQueueReceive(rxQueue, &rxPacket, timeout) == pdTRUE) {
+      peerGossipHandlePacket((const peerGossipPacket_t*)rxPacket.data, rxPacket.size, ownId, xTaskGetTickCount());
+      continue;
+    }
+
+    now = xTaskGetTickCount();
+
+    // Received P2P packets per second since the previous packet
+    uint32_t const currentRxCount = rxCount;
+    uint32_t const elapsedMs = T2M(now - lastSendTime);
+    if (elapsedMs > 0) {
+      float const periodRxRate = (currentRxCount - lastRxCount) * 1000.0f / elapsedMs;
+      rxRate += (periodRxRate - rxRate) * RX_RATE_ALPHA;
+    }
+    lastRxCount = currentRxCount;
+    lastSendTime = now;
+
+    if (enable) {
+      txPacket.port = PEER_GOSSIP_P2P_PORT;
+      txPacket.size = fillOwnPacket((peerGossipPacket_t*)txPacket.data, now, &cursor);
+      if (txPacket.size > 0) {
+        radiolinkSendP2PPacketBroadcast(&txPacket);
+      }
+    }
+
+    periodMs = peerGossipComputePeriodMs(rxRate, periodMs);
+    nextSendTime = now + M2T(periodMs - periodMs / 8 + jitterMs(periodMs / 4));
+  }
+}
+
+/**
+ * The peer gossip service broadcasts the position and velocity of the
+ * Crazyflie on the P2P radio, together with the states of a few other
+ * Crazyflies that it relays. Received states are fed to the peer localization
+ * module, where for instance collision avoidance picks them up. The rate is
+ * adapted to the number of Crazyflies within radio range.
+ */
+PARAM_GROUP_START(peerGossip)
+
+  /**
+   * @brief Nonzero to broadcast the state of this Crazyflie (default 1)
+   *
+   * States from other Crazyflies are received also when disabled.
+   */
+  PARAM_ADD(PARAM_UINT8, enable, &enable)
+
+PARAM_GROUP_STOP(peerGossip)
+
+/**
+ * Rate control of the peer gossip service
+ */
+LOG_GROUP_START(peerGossip)
+
+  /**
+   * @brief Period between the state packets of this Crazyflie [ms]
+   */
+  LOG_ADD(LOG_UINT32, period, &periodMs)
+
+  /**
+   * @brief Received P2P packets per second, of all kinds
+   */
+  LOG_ADD(LOG_FLOAT, rxRate, &rxRate)
+
+LOG_GROUP_STOP(peerGossip)
@@ -1,14 +1,37 @@
+#include <string.h>
+
 #include "config.h"
 #include "debug.h"
 #include "FreeRTOS.h"
 #include "task.h"
 #include "peer_localization.h"
 
+// Weight of a new sample in the velocity estimate
+#define VELOCITY_ALPHA 0.5f
+
+// The peers are kept at the start of the array, in slots 0 to count - 1, so
+// that iterating over the active peers does not visit empty slots. Radio ids
+// are 8 bits, so the slot of an id is found directly in a table of 256 entries.
+// The table holds slot + 1, 0 means that the id is not in the table.
+//
+// Several tasks update the table, for instance the CRTP localization task and
+// the P2P gossip task, and collision avoidance reads it in the stabilizer
+// loop. All changes and copies are made in short critical sections.
+static peerLocalizationOtherPosition_t other_positions[PEER_LOCALIZATION_MAX_NEIGHBORS];
+static uint8_t slot_by_id[256];
+static int count;
+static uint32_t nextStaleCheck;
+
+#if PEER_LOCALIZATION_MAX_NEIGHBORS > 254
+#error "PEER_LOCALIZATION_MAX_NEIGHBORS must be less than 255"
+#endif
 
 void peerLocalizationInit()
 {
-  // All other_positions[in].id will be set to zero due to static initialization.
-  // If we ever switch to dynamic allocation, we need to set them to zero explicitly.
+  memset(other_positions, 0, sizeof(other_positions));
+  memset(slot_by_id, 0, sizeof(slot_by_id));
+  count = 0;
+  nextStaleCheck = 0;
 }
 
 bool peerLocalizationTest()
@@ -16,49 +39,209 @@ bool peerLocalizationTest()
   return true;
 }
 
-// array of other's position
-static peerLocalizationOtherPosition_t other_positions[PEER_LOCALIZATION_MAX_NEIGHBORS];
+static void removeSlot(int slot)
+{
+  // Move the last peer into the hole
+  slot_by_id[other_positions[slot].id] = 0;
+  count--;
+  if (slot != count) {
+    other_positions[slot] = other_positions[count];
+    slot_by_id[other_positions[slot].id] = slot + 1;
+  }
+  memset(&other_positions[count], 0, sizeof(other_positions[count]));
+}
 
-bool peerLocalizationTellPosition(int cfid, positionMeasurement_t const *pos)
+static int addSlot(uint8_t cfid, uint32_t now)
 {
-  for (uint8_t i = 0; i < PEER_LOCALIZATION_MAX_NEIGHBORS; ++i) {
-    if (other_positions[i].id == 0 || other_positions[i].id == cfid) {
-      other_positions[i].id = cfid;
-      other_positions[i].pos.x = pos->x;
-      other_positions[i].pos.y = pos->y;
-      other_positions[i].pos.z = pos->z;
-      other_positions[i].pos.timestamp = xTaskGetTickCount();
-      return true;
+  if (count == PEER_LOCALIZATION_MAX_NEIGHBORS) {
+    // Full, replace the least recently updated peer if it is stale
+    int oldest = 0;
+    for (int i = 1; i < count; ++i) {
+      if ((now - other_positions[i].pos.timestamp) > (now - other_positions[oldest].pos.timestamp)) {
+        oldest = i;
+      }
+    }
+    if (now - other_positions[oldest].pos.timestamp <= PEER_LOCALIZATION_EVICTION_AGE_MS) {
+      return -1;
     }
+    removeSlot(oldest);
   }
-  return false;
+
+  int slot = count++;
+  memset(&other_positions[slot], 0, sizeof(other_positions[slot]));
+  other_positions[slot].id = cfid;
+  slot_by_id[cfid] = slot + 1;
+  return slot;
 }
 
-bool peerLocalizationIsIDActive(uint8_t cfid)
+// Must be called in a critical section
+static void removeStale(uint32_t now, uint32_t maxAgeMs)
 {
-  for (uint8_t i = 0; i < PEER_LOCALIZATION_MAX_NEIGHBORS; ++i) {
-    if (other_positions[i].id == cfid) {
-      return true;
+  // Iterate backwards, removing a slot moves the last peer into it
+  for (int slot = count - 1; slot >= 0; --slot) {
+    if (now - other_positions[slot].pos.timestamp > maxAgeMs) {
+      removeSlot(slot);
     }
   }
-  return false;
+}
+
+// Must be called in a critical section
+static void removeStalePeriodically(uint32_t now)
+{
+  if (PEER_LOCALIZATION_STALE_AGE_MS == 0 || (int32_t)(now - nextStaleCheck) < 0) {
+    return;
+  }
+  nextStaleCheck = now + PEER_LOCALIZATION_STALE_CHECK_INTERVAL_MS;
+
+  removeStale(now, PEER_LOCALIZATION_STALE_AGE_MS);
+}
+
+static void updateVelocity(peerLocalizationOtherPosition_t *other, positionMeasurement_t const *pos, uint32_t now)
+{
+  uint32_t const dtMs = now - other->pos.timestamp;
+  if (dtMs == 0) {
+    return;
+  }
+
+  if (dtMs > PEER_LOCALIZATION_VELOCITY_MAX_DT_MS) {
+    other->vel.x = other->vel.y = other->vel.z = 0.0f;
+    return;
+  }
+
+  float const dt = dtMs / 1000.0f;
+  other->vel.x += ((pos->x - other->pos.x) / dt - other->vel.x) * VELOCITY_ALPHA;
+  other->vel.y += ((pos->y - other->pos.y) / dt - other->vel.y) * VELOCITY_ALPHA;
+  other->vel.z += ((pos->z - other->pos.z) / dt - other->vel.z) * VELOCITY_ALPHA;
+}
+
+bool peerLocalizationTellPosition(int cfid, positionMeasurement_t const *pos)
+{
+  // Id 0 is not a valid peer, and ids are 8 bits
+  if (cfid <= 0 || cfid > UINT8_MAX) {
+    return false;
+  }
+
+  uint32_t const now = xTaskGetTickCount();
+
+  taskENTER_CRITICAL();
+  removeStalePeriodically(now);
+
+  int slot = slot_by_id[cfid] - 1;
+  if (slot < 0) {
+    slot = addSlot(cfid, now);
+  } else {
+    updateVelocity(&other_positions[slot], pos, now);
+  }
+
+  if (slot >= 0) {
+    peerLocalizationOtherPosition_t *other = &other_positions[slot];
+    other->pos.x = pos->x;
+    other->pos.y = pos->y;
+    other->pos.z = pos->z;
+    other->pos.timestamp = now;
+    other->vel.timestamp = now;
+  }
+  taskEXIT_CRITICAL();
+
+  return slot >= 0;
+}
+
+bool peerLocalizationTellState(int cfid, point_t const *pos, velocity_t const *vel)
+{
+  if (cfid <= 0 || cfid > UINT8_MAX) {
+    return false;
+  }
+
+  uint32_t const now = xTaskGetTickCount();
+
+  taskENTER_CRITICAL();
+  removeStalePeriodically(now);
+
+  int slot = slot_by_id[cfid] - 1;
+  if (slot < 0) {
+    slot = addSlot(cfid, now);
+  } else if ((int32_t)(pos->timestamp - other_positions[slot].pos.timestamp) <= 0) {
+    slot = -1;
+  }
+
+  if (slot >= 0) {
+    peerLocalizationOtherPosition_t *other = &other_positions[slot];
+    other->pos = *pos;
+    other->vel = *vel;
+    other->vel.timestamp = pos->timestamp;
+  }
+  taskEXIT_CRITICAL();
+
+  return slot >= 0;
+}
+
+bool peerLocalizationIsIDActive(uint8_t cfid)
+{
+  return peerLocalizationGetPositionByID(cfid) != NULL;
 }
 
 peerLocalizationOtherPosition_t *peerLocalizationGetPositionByID(uint8_t cfid)
 {
-  for (uint8_t i = 0; i < PEER_LOCALIZATION_MAX_NEIGHBORS; ++i) {
-    if (other_positions[i].id == cfid) {
-      return &other_positions[i];
-    }
+  int const slot = slot_by_id[cfid] - 1;
+  if (cfid == 0 || slot < 0) {
+    return NULL;
   }
-  return NULL;
+  return &other_positions[slot];
+}
+
+int peerLocalizationGetCount()
+{
+  return count;
 }
 
 peerLocalizationOtherPosition_t *peerLocalizationGetPositionByIdx(uint8_t idx)
 {
-  // TODO: should we return NULL if the id == 0?
-  if (idx < PEER_LOCALIZATION_MAX_NEIGHBORS) {
+  if (idx < count) {
     return &other_positions[idx];
   }
   return NULL;
 }
+
+bool peerLocalizationCopyPositionByIdx(int idx, peerLocalizationOtherPosition_t *dest)
+{
+  taskENTER_CRITICAL();
+  bool const isValid = idx >= 0 && idx < count;
+  if (isValid) {
+    *dest = other_positions[idx];
+  }
+  taskEXIT_CRITICAL();
+
+  return isValid;
+}
+
+int peerLocalizationCopyPositions(float *positions, uint8_t *ids, int maxCount, int32_t maxAgeMs)
+{
+  uint32_t const now = xTaskGetTickCount();
+  int copied = 0;
+
+  taskENTER_CRITICAL();
+  for (int slot = 0; slot < count && copied < maxCount; ++slot) {
+    peerLocalizationOtherPosition_t const *other = &other_positions[slot];
+    if (maxAgeMs >= 0 && now - other->pos.timestamp > (uint32_t)maxAgeMs) {
+      continue;
+    }
+
+    positions[3 * copied + 0] = other->pos.x;
+    positions[3 * copied + 1] = other->pos.y;
+    positions[3 * copied + 2] = other->pos.z;
+    ids[copied] = other->id;
+    ++copied;
+  }
+  taskEXIT_CRITICAL();
+
+  return copied;
+}
+
+void peerLocalizationRemoveStale(uint32_t maxAgeMs)
+{
+  uint32_t const now = xTaskGetTickCount();
+
+  taskENTER_CRITICAL();
+  removeStale(now, maxAgeMs);
+  taskEXIT_CRITICAL();
+}
@@ -78,16 +78,27 @@ bool plan_is_finished(struct planner *p, float t)
 {
 	switch (p->type) {
 		case TRAJECTORY_TYPE_PIECEWISE:
-			return piecewise_is_finished(p->trajectory, t);
+			return piecewise_is_finished_cursor(p->trajectory, &p->cursor, t);
 
 		case TRAJECTORY_TYPE_PIECEWISE_COMPRESSED:
 		  return piecewise_compressed_is_finished(p->compressed_trajectory, t);
 
+		case TRAJECTORY_TYPE_PIECEWISE_STREAM:
+		  return piecewise_stream_is_finished(p->stream_trajectory, t);
+
 		default:
 		  return 1;
 	}
 }
 
+void plan_trajectory_changed(struct planner *p)
+{
+	// the cursor caches the piece durations
+	if (p->type == TRAJECTORY_TYPE_PIECEWISE && p->trajectory != NULL) {
+		piecewise_cursor_reset(&p->cursor, p->trajectory);
+	}
+}
+
 bool plan_is_stopped(struct planner *p)
 {
 	return p->state == TRAJECTORY_STATE_IDLE;
@@ -124,20 +135,29 @@ struct traj_eval plan_eval(struct planner *p, float t)
 	switch (p->type) {
 		case TRAJECTORY_TYPE_PIECEWISE:
 			if (p->reversed) {
-				return piecewise_eval_reversed(p->trajectory, t);
+				return piecewise_eval_reversed_cursor(p->trajectory, &p->cursor, t);
 			}
 			else {
-				return piecewise_eval(p->trajectory, t);
+				return piecewise_eval_cursor(p->trajectory, &p->cursor, t);
 			}
 			break;
 
 		case TRAJECTORY_TYPE_PIECEWISE_COMPRESSED:
+			if (p->reversed) {
+				return piecewise_compressed_eval_reversed(p->compressed_trajectory, t);
+			}
+			else {
+				return piecewise_compressed_eval(p->compressed_trajectory, t);
+			}
+			break;
+
+		case TRAJECTORY_TYPE_PIECEWISE_STREAM:
 			if (p->reversed) {
 				/* not supported */
 				return traj_eval_invalid();
 			}
 			else {
-				return piecewise_compressed_eval(p->compressed_trajectory, t);
+				return piecewise_stream_eval(p->stream_trajectory, t);
 			}
 			break;
 
@@ -158,6 +178,7 @@ int plan_takeoff(struct planner *p, struct vec curr_pos, float curr_yaw, float h
 	p->type = TRAJECTORY_TYPE_PIECEWISE;
 	p->planned_trajectory.t_begin = t;
 	p->trajectory = &p->planned_trajectory;
+	piecewise_cursor_reset(&p->cursor, p->trajectory);
 	return 0;
 }
 
@@ -173,6 +194,7 @@ int plan_land(struct planner *p, struct vec curr_pos, float curr_yaw, float hove
 	p->type = TRAJECTORY_TYPE_PIECEWISE;
 	p->planned_trajectory.t_begin = t;
 	p->trajectory = &p->planned_trajectory;
+	piecewise_cursor_reset(&p->cursor, p->trajectory);
 	return 0;
 }
 
@@ -197,6 +219,7 @@ int plan_go_to_from(struct planner *p, const struct traj_eval *curr_eval, bool r
 	p->type = TRAJECTORY_TYPE_PIECEWISE;
 	p->planned_trajectory.t_begin = t;
 	p->trajectory = &p->planned_trajectory;
+	piecewise_cursor_reset(&p->cursor, p->trajectory);
 	return 0;
 }
 
@@ -228,21 +251,52 @@ int plan_start_trajectory(struct planner *p, struct piecewise_traj* trajectory,
 	else {
 		trajectory->shift = vzero();
 	}
+	piecewise_cursor_reset(&p->cursor, trajectory);
 
 	return 0;
 }
 
-int plan_start_compressed_trajectory( struct planner *p, struct piecewise_traj_compressed* trajectory, bool relative, struct vec start_from)
+int plan_start_compressed_trajectory( struct planner *p, struct piecewise_traj_compressed* trajectory, bool reversed, bool relative, struct vec start_from)
 {
-	p->reversed = 0;
+	p->reversed = reversed;
 	p->state = TRAJECTORY_STATE_FLYING;
 	p->type = TRAJECTORY_TYPE_PIECEWISE_COMPRESSED;
 	p->compressed_trajectory = trajectory;
 
+	if (relative) {
+		struct traj_eval traj_init;
+		trajectory->shift = vzero();
+		if (reversed) {
+			traj_init = piecewise_compressed_eval_reversed(trajectory, trajectory->t_begin);
+		}
+		else {
+			traj_init = piecewise_compressed_eval(trajectory, trajectory->t_begin);
+		}
+		struct vec shift_pos = vsub(start_from, traj_init.pos);
+		trajectory->shift = shift_pos;
+	} else {
+		trajectory->shift = vzero();
+	}
+
+	return 0;
+}
+
+int plan_start_stream_trajectory(struct planner *p, struct piecewise_traj_stream* trajectory, bool relative, struct vec start_from)
+{
+	if (piecewise_stream_is_empty(trajectory)) {
+		return 1;
+	}
+
+	p->reversed = 0;
+	p->state = TRAJECTORY_STATE_FLYING;
+	p->type = TRAJECTORY_TYPE_PIECEWISE_STREAM;
+	p->stream_trajectory = trajectory;
+
 	if (relative) {
 		trajectory->shift = vzero();
-		struct traj_eval traj_init = piecewise_compressed_eval(
-			trajectory, trajectory->t_begin
+		// the start of the oldest piece that has not been freed
+		struct traj_eval traj_init = piecewise_stream_eval(
+			trajectory, trajectory->t_begin + trajectory->head_begin * trajectory->timescale
 		);
 		struct vec shift_pos = vsub(start_from, traj_init.pos);
 		trajectory->shift = shift_pos;
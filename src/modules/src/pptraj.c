@@ -41,8 +41,6 @@ See Daniel Mellinger, Vijay Kumar: "Minimum snap trajectory generation and contr
 
 #define GRAV (9.81f)
 
-static struct poly4d poly4d_tmp;
-
 // polynomials are stored with ascending degree
 
 void polylinear(float p[PP_SIZE], float duration, float x0, float x1)
@@ -117,6 +115,27 @@ float polyval(float const p[PP_SIZE], float t)
 	return x;
 }
 
+// evaluate a polynomial and its first three derivatives using horner's rule.
+// d[k] accumulates the k-th derivative divided by k!, see e.g.
+// Knuth, "The Art of Computer Programming", Vol. 2, 4.6.4.
+void polyval_derivs(float const p[PP_SIZE], float t, float out[4])
+{
+	float d0 = 0.0f;
+	float d1 = 0.0f;
+	float d2 = 0.0f;
+	float d3 = 0.0f;
+	for (int i = PP_DEGREE; i >= 0; --i) {
+		d3 = d3 * t + d2;
+		d2 = d2 * t + d1;
+		d1 = d1 * t + d0;
+		d0 = d0 * t + p[i];
+	}
+	out[0] = d0;
+	out[1] = d1;
+	out[2] = 2.0f * d2;
+	out[3] = 6.0f * d3;
+}
+
 // compute derivative of a polynomial in place
 void polyder(float p[PP_SIZE])
 {
@@ -234,30 +253,20 @@ void polyder4d(struct poly4d *p)
 	}
 }
 
-static struct vec polyval_xyz(struct poly4d const *p, float t)
-{
-	return mkvec(polyval(p->p[0], t), polyval(p->p[1], t), polyval(p->p[2], t));
-}
-
-static float polyval_yaw(struct poly4d const *p, float t)
-{
-	return polyval(p->p[3], t);
-}
-
 // compute loose maximum of acceleration -
 // uses L1 norm instead of Euclidean, evaluates polynomial instead of root-finding
 float poly4d_max_accel_approx(struct poly4d const *p)
 {
-	struct poly4d* acc = &poly4d_tmp;
-	*acc = *p;
-	polyder4d(acc);
-	polyder4d(acc);
 	int steps = 10 * p->duration;
 	float step = p->duration / (steps - 1);
 	float t = 0;
 	float amax = 0;
 	for (int i = 0; i < steps; ++i) {
-		struct vec ddx = polyval_xyz(acc, t);
+		float x[4], y[4], z[4];
+		polyval_derivs(p->p[0], t, x);
+		polyval_derivs(p->p[1], t, y);
+		polyval_derivs(p->p[2], t, z);
+		struct vec ddx = mkvec(x[2], y[2], z[2]);
 		float ddx_minkowski = vnorm1(ddx);
 		if (ddx_minkowski > amax) amax = ddx_minkowski;
 		t += step;
@@ -289,27 +298,27 @@ bool is_traj_eval_valid(struct traj_eval const *ev)
 	return !visnan(ev->pos);
 }
 
-struct traj_eval poly4d_eval(struct poly4d const *p, float t)
+// the timescale of a trajectory is applied by scaling the time derivatives,
+// the coefficients of the pieces are not modified.
+struct traj_eval poly4d_eval_scaled(struct poly4d const *p, float t, float dt)
 {
-	// flat variables
-	struct traj_eval out;
-	out.pos = polyval_xyz(p, t);
-	out.yaw = polyval_yaw(p, t);
-
-	// 1st derivative
-	struct poly4d* deriv = &poly4d_tmp;
-	*deriv = *p;
-	polyder4d(deriv);
-	out.vel = polyval_xyz(deriv, t);
-	float dyaw = polyval_yaw(deriv, t);
+	// flat variables and their 1st to 3rd derivatives in one pass,
+	// no scratch memory so this is safe to call from several tasks
+	float x[4], y[4], z[4], yaw[4];
+	polyval_derivs(p->p[0], t, x);
+	polyval_derivs(p->p[1], t, y);
+	polyval_derivs(p->p[2], t, z);
+	polyval_derivs(p->p[3], t, yaw);
 
-	// 2nd derivative
-	polyder4d(deriv);
-	out.acc = polyval_xyz(deriv, t);
+	struct traj_eval out;
+	out.pos = mkvec(x[0], y[0], z[0]);
+	out.yaw = yaw[0];
 
-	// 3rd derivative
-	polyder4d(deriv);
-	struct vec jerk = polyval_xyz(deriv, t);
+	float dt2 = dt * dt;
+	out.vel = vscl(dt, mkvec(x[1], y[1], z[1]));
+	float dyaw = dt * yaw[1];
+	out.acc = vscl(dt2, mkvec(x[2], y[2], z[2]));
+	struct vec jerk = vscl(dt2 * dt, mkvec(x[3], y[3], z[3]));
 
 	struct vec thrust = vadd(out.acc, mkvec(0, 0, GRAV));
 	// float thrust_mag = mass * vmag(thrust);
@@ -329,26 +338,86 @@ struct traj_eval poly4d_eval(struct poly4d const *p, float t)
 	return out;
 }
 
+struct traj_eval poly4d_eval(struct poly4d const *p, float t)
+{
+	return poly4d_eval_scaled(p, t, 1.0f);
+}
+
 //
 // piecewise 4d polynomials
 //
 
+void piecewise_cursor_reset(struct piecewise_cursor *cursor,
+	struct piecewise_traj const *traj)
+{
+	cursor->piece = 0;
+	cursor->piece_begin = 0;
+	cursor->duration = 0;
+	for (int i = 0; i < traj->n_pieces; ++i) {
+		cursor->duration += traj->pieces[i].duration;
+	}
+}
+
+// move the cursor to the piece that contains the unscaled time t.
+// at the boundary between two pieces, the earlier piece is used when going
+// forward and the later piece when reversed, to match the reversed evaluation.
+static struct poly4d const *piecewise_seek(struct piecewise_traj const *traj,
+	struct piecewise_cursor *cursor, float t, bool reversed)
+{
+	if (cursor->piece >= traj->n_pieces) {
+		piecewise_cursor_reset(cursor, traj);
+	}
+
+	while (cursor->piece > 0 &&
+		(reversed ? t < cursor->piece_begin : t <= cursor->piece_begin)) {
+		--cursor->piece;
+		cursor->piece_begin -= traj->pieces[cursor->piece].duration;
+		if (cursor->piece == 0) {
+			// avoid accumulating rounding errors
+			cursor->piece_begin = 0;
+		}
+	}
+
+	while (cursor->piece < traj->n_pieces - 1) {
+		float piece_end = cursor->piece_begin + traj->pieces[cursor->piece].duration;
+		if (reversed ? t < piece_end : t <= piece_end) {
+			break;
+		}
+		cursor->piece_begin = piece_end;
+		++cursor->piece;
+	}
+
+	return &traj->pieces[cursor->piece];
+}
+
 // piecewise eval
 struct traj_eval piecewise_eval(
   struct piecewise_traj const *traj, float t)
 {
-	int cursor = 0;
-	t = t - traj->t_begin;
-	while (cursor < traj->n_pieces) {
-		struct poly4d const *piece = &(traj->pieces[cursor]);
-		if (t <= piece->duration * traj->timescale) {
-			poly4d_tmp = *piece;
-			poly4d_shift(&poly4d_tmp, traj->shift.x, traj->shift.y, traj->shift.z, 0);
-			poly4d_stretchtime(&poly4d_tmp, traj->timescale);
-			return poly4d_eval(&poly4d_tmp, t);
-		}
-		t -= piece->duration * traj->timescale;
-		++cursor;
+	struct piecewise_cursor cursor;
+	piecewise_cursor_reset(&cursor, traj);
+	return piecewise_eval_cursor(traj, &cursor, t);
+}
+
+struct traj_eval piecewise_eval_reversed(
+  struct piecewise_traj const *traj, float t)
+{
+	struct piecewise_cursor cursor;
+	piecewise_cursor_reset(&cursor, traj);
+	return piecewise_eval_reversed_cursor(traj, &cursor, t);
+}
+
+struct traj_eval piecewise_eval_cursor(
+  struct piecewise_traj const *traj, struct piecewise_cursor *cursor, float t)
+{
+	// the timescale is applied to the time instead of to the coefficients,
+	// piece(t / timescale) is the stretched piece
+	float t_piece = (t - traj->t_begin) / traj->timescale;
+	if (t_piece <= cursor->duration) {
+		struct poly4d const *piece = piecewise_seek(traj, cursor, t_piece, false);
+		struct traj_eval ev = poly4d_eval_scaled(piece, t_piece - cursor->piece_begin, 1.0f / traj->timescale);
+		ev.pos = vadd(ev.pos, traj->shift);
+		return ev;
 	}
 	// if we get here, the trajectory has ended
 	struct poly4d const *end_piece = &(traj->pieces[traj->n_pieces - 1]);
@@ -360,25 +429,16 @@ struct traj_eval piecewise_eval(
 	return ev;
 }
 
-struct traj_eval piecewise_eval_reversed(
-  struct piecewise_traj const *traj, float t)
+struct traj_eval piecewise_eval_reversed_cursor(
+  struct piecewise_traj const *traj, struct piecewise_cursor *cursor, float t)
 {
-	int cursor = traj->n_pieces - 1;
-	t = t - traj->t_begin;
-	while (cursor >= 0) {
-		struct poly4d const *piece = &(traj->pieces[cursor]);
-		if (t <= piece->duration * traj->timescale) {
-			poly4d_tmp = *piece;
-			poly4d_shift(&poly4d_tmp, traj->shift.x, traj->shift.y, traj->shift.z, 0);
-			poly4d_stretchtime(&poly4d_tmp, traj->timescale);
-			for (int i = 0; i < 4; ++i) {
-				polyreflect(poly4d_tmp.p[i]);
-			}
-			t = t - piece->duration * traj->timescale;
-			return poly4d_eval(&poly4d_tmp, t);
-		}
-		t -= piece->duration * traj->timescale;
-		--cursor;
+	// time from the start of the trajectory, running backwards
+	float t_piece = cursor->duration - (t - traj->t_begin) / traj->timescale;
+	if (t_piece >= 0) {
+		struct poly4d const *piece = piecewise_seek(traj, cursor, t_piece, true);
+		struct traj_eval ev = poly4d_eval_scaled(piece, t_piece - cursor->piece_begin, -1.0f / traj->timescale);
+		ev.pos = vadd(ev.pos, traj->shift);
+		return ev;
 	}
 	// if we get here, the trajectory has ended
 	struct poly4d const *end_piece = &(traj->pieces[0]);
@@ -58,21 +58,22 @@ struct compressed_piece_parsed_header
   compressed_piece_ptr body;
 };
 
-static float calculate_total_duration(compressed_piece_ptr ptr);
 static compressed_piece_ptr next_coordinate(compressed_piece_ptr ptr, compressed_piece_coordinate* coord);
 static compressed_piece_ptr next_duration(compressed_piece_ptr ptr, uint16_t* coord);
-static compressed_piece_ptr next_piece(compressed_piece_ptr ptr);
 static compressed_piece_ptr parse_header_of_current_piece(
   struct compressed_piece_parsed_header* result, compressed_piece_ptr ptr);
+static void calculate_end_point(
+  int16_t end[4], const struct compressed_piece_parsed_header* header, const int16_t start[4]);
 
 static inline float end_time_of_current_piece(const struct piecewise_traj_compressed *traj);
 static inline float start_time_of_current_piece(const struct piecewise_traj_compressed *traj);
-static inline float time_relative_to_start_of_current_piece(const struct piecewise_traj_compressed *traj, float t);
 
 static void piecewise_compressed_advance_playhead(struct piecewise_traj_compressed *traj);
-static void piecewise_compressed_rewind(struct piecewise_traj_compressed *traj);
-static void piecewise_compressed_update_current_poly4d(
-  struct piecewise_traj_compressed *traj, const struct traj_eval *end_of_previous_piece);
+static void piecewise_compressed_build_index(struct piecewise_traj_compressed *traj);
+static void piecewise_compressed_seek(struct piecewise_traj_compressed *traj, float t);
+static struct traj_eval piecewise_compressed_eval_relative(
+  struct piecewise_traj_compressed *traj, float t, float dt);
+static void piecewise_compressed_update_current_poly4d(struct piecewise_traj_compressed *traj);
 
 // Calculates the coefficients of a 7D polynomial from the compressed
 // representation starting at the given pointer. Returns a pointer that
@@ -99,24 +100,31 @@ static compressed_piece_ptr calculate_polynomial_coefficients(
   return ptr;
 }
 
-// Calculates the total duration of a compressed trajectory, starting at the
-// given piece
-static float calculate_total_duration(compressed_piece_ptr ptr)
+// Calculates the end point of a piece from its header and its start point.
+// The end point of a Bezier curve is its last control point, so the result
+// is exact, in the stored units, and no polynomial needs to be evaluated.
+static void calculate_end_point(
+  int16_t end[4], const struct compressed_piece_parsed_header* header, const int16_t start[4])
 {
-  uint32_t duration_in_msec = 0;
-  struct compressed_piece_parsed_header header;
+  const enum piecewise_traj_storage_type types[4] = {
+    header->x_type, header->y_type, header->z_type, header->yaw_type
+  };
+  compressed_piece_ptr ptr = header->body;
+  uint8_t i, n;
 
-  while (1) {
-    ptr = parse_header_of_current_piece(&header, ptr);
-    if (ptr) {
-      duration_in_msec += header.duration_in_msec;
+  for (i = 0; i < 4; i++) {
+    n = control_points_by_type[types[i]];
+    if (n > 0) {
+      next_coordinate(ptr + (n - 1) * sizeof(compressed_piece_coordinate), &end[i]);
     } else {
-      return duration_in_msec / STORED_DURATION_SCALE;
+      end[i] = start[i];
     }
+    ptr += n * sizeof(compressed_piece_coordinate);
   }
 }
 
-// Returns the end time of the current piece being executed
+// Returns the end time of the current piece being executed, relative to the
+// start of the trajectory
 static inline float end_time_of_current_piece(const struct piecewise_traj_compressed *traj) {
   return start_time_of_current_piece(traj) + traj->current_piece.poly4d.duration;
 }
@@ -137,15 +145,6 @@ static compressed_piece_ptr next_duration(compressed_piece_ptr ptr, uint16_t* co
   return ptr + 2;
 }
 
-// Given a pointer that points to the start of a piece inside the data section
-// of a compressed trajectory, returns the pointer that points to the next
-// piece or zero if this is the last piece
-static compressed_piece_ptr next_piece(compressed_piece_ptr ptr)
-{
-  struct compressed_piece_parsed_header header;
-  return parse_header_of_current_piece(&header, ptr);
-}
-
 // Given a pointer that points to the start of a piece inside the data section
 // of a compressed trajeectory, parses the header of the piece, which includes
 // the duration of the piece as well as the storage types of the XY, Z and
@@ -187,15 +186,10 @@ static compressed_piece_ptr parse_header_of_current_piece(
   }
 }
 
-// Returns the start time of the current piece being executed
+// Returns the start time of the current piece being executed, relative to
+// the start of the trajectory
 static inline float start_time_of_current_piece(const struct piecewise_traj_compressed *traj) {
-  return traj->t_begin + traj->current_piece.t_begin_relative;
-}
-
-// Returns the number of seconds elapsed since the start time of the current
-// piece being executed
-static inline float time_relative_to_start_of_current_piece(const struct piecewise_traj_compressed *traj, float t) {
-  return t - start_time_of_current_piece(traj);
+  return traj->current_piece.t_begin_relative;
 }
 
 /* ************************************************************************ */
@@ -203,28 +197,25 @@ static inline float time_relative_to_start_of_current_piece(const struct piecewi
 struct traj_eval piecewise_compressed_eval(
   struct piecewise_traj_compressed *traj, float t)
 {
-  struct traj_eval eval;
-
-  /* TODO(ntamas): timescale is currently limited to 1.
-   * We could support other timescales, but then we would need to update
-   * piecewise_compressed_update_current_poly4d() to stretch the time of
-   * the poly4d. The problem is that the user may set the timescale to
-   * a different value while the poly4d is already pre-calculated, and we
-   * have no way of detecting it */
+  /* The pieces are evaluated in their own time and the timescale is applied
+   * when evaluating the poly4d, so the timescale may be changed at any time */
+  t = (t - traj->t_begin) / traj->timescale;
+  return piecewise_compressed_eval_relative(traj, t, 1.0f / traj->timescale);
+}
 
-  if (t < start_time_of_current_piece(traj)) {
-    piecewise_compressed_rewind(traj);
-  }
+struct traj_eval piecewise_compressed_eval_reversed(
+  struct piecewise_traj_compressed *traj, float t)
+{
+  struct traj_eval eval;
 
-  while (traj->current_piece.data && t >= end_time_of_current_piece(traj)) {
-    piecewise_compressed_advance_playhead(traj);
+  t = traj->duration - (t - traj->t_begin) / traj->timescale;
+  if (t >= 0) {
+    return piecewise_compressed_eval_relative(traj, t, -1.0f / traj->timescale);
   }
 
-  t = time_relative_to_start_of_current_piece(traj, t);
-
-  eval = poly4d_eval(&traj->current_piece.poly4d, t);
-  eval.pos = vadd(eval.pos, traj->shift);
-
+  /* Finished, stay at the start point of the trajectory */
+  eval = piecewise_compressed_eval_relative(traj, 0, 0);
+  eval.vel = eval.acc = eval.omega = vzero();
   return eval;
 }
 
@@ -235,34 +226,117 @@ void piecewise_compressed_load(struct piecewise_traj_compressed *traj, const voi
 
   traj->data = data;
   traj->shift = vzero();
-  piecewise_compressed_rewind(traj);
 
-  traj->duration = calculate_total_duration(traj->current_piece.data);
+  piecewise_compressed_build_index(traj);
+  piecewise_compressed_seek(traj, 0);
 }
 
-static void piecewise_compressed_rewind(struct piecewise_traj_compressed *traj)
+// Evaluates the trajectory at the given time, relative to the start of the
+// trajectory and not scaled by the timescale. The derivatives are scaled by
+// dt, see poly4d_eval_scaled().
+static struct traj_eval piecewise_compressed_eval_relative(
+  struct piecewise_traj_compressed *traj, float t, float dt)
 {
-  struct traj_eval stopped;
-  compressed_piece_coordinate value;
+  struct traj_eval eval;
+
+  if (t < start_time_of_current_piece(traj)) {
+    piecewise_compressed_seek(traj, t);
+  } else if (traj->current_piece.data && t >= end_time_of_current_piece(traj)) {
+    /* Playing forward, the next piece is the most likely one */
+    piecewise_compressed_advance_playhead(traj);
+    if (traj->current_piece.data && t >= end_time_of_current_piece(traj)) {
+      piecewise_compressed_seek(traj, t);
+    }
+  }
+
+  eval = poly4d_eval_scaled(&traj->current_piece.poly4d, t - start_time_of_current_piece(traj), dt);
+  eval.pos = vadd(eval.pos, traj->shift);
+
+  return eval;
+}
+
+// Walks through all pieces of the trajectory once, calculates the total
+// duration and records the position of every index_stride-th piece in the
+// seek index
+static void piecewise_compressed_build_index(struct piecewise_traj_compressed *traj)
+{
+  struct piecewise_traj_compressed_index_entry *entry;
+  struct compressed_piece_parsed_header header;
+  compressed_piece_ptr start_of_pieces;
   compressed_piece_ptr ptr;
+  int16_t start[4];
+  uint32_t t_begin_msec = 0;
+  uint16_t n_pieces = 0;
+  uint16_t i;
 
   /* Parse header that stores the start coordinates */
-  bzero(&stopped, sizeof(stopped));
   ptr = traj->data;
-  ptr = next_coordinate(ptr, &value); stopped.pos.x = value / STORED_DISTANCE_SCALE;
-  ptr = next_coordinate(ptr, &value); stopped.pos.y = value / STORED_DISTANCE_SCALE;
-  ptr = next_coordinate(ptr, &value); stopped.pos.z = value / STORED_DISTANCE_SCALE;
-  ptr = next_coordinate(ptr, &value); stopped.yaw = value / STORED_ANGLE_SCALE;
-  traj->current_piece.t_begin_relative = 0;
-  traj->current_piece.data = ptr;
+  for (i = 0; i < 4; i++) {
+    ptr = next_coordinate(ptr, &start[i]);
+  }
+  start_of_pieces = ptr;
 
-  piecewise_compressed_update_current_poly4d(traj, &stopped);
+  /* Count the pieces first to spread the index entries evenly */
+  while (ptr) {
+    ptr = parse_header_of_current_piece(&header, ptr);
+    n_pieces++;
+  }
+
+  traj->index_stride = (n_pieces + PPTRAJ_COMPRESSED_INDEX_SIZE - 1) / PPTRAJ_COMPRESSED_INDEX_SIZE;
+  traj->index_count = 0;
+
+  ptr = start_of_pieces;
+  for (i = 0; ptr; i++) {
+    if (i % traj->index_stride == 0) {
+      entry = &traj->index[traj->index_count++];
+      entry->offset = ptr - (compressed_piece_ptr)traj->data;
+      entry->t_begin_msec = t_begin_msec;
+      memcpy(entry->start, start, sizeof(start));
+    }
+
+    ptr = parse_header_of_current_piece(&header, ptr);
+    calculate_end_point(start, &header, start);
+    t_begin_msec += header.duration_in_msec;
+  }
+
+  traj->duration = t_begin_msec / STORED_DURATION_SCALE;
 }
 
-static void piecewise_compressed_update_current_poly4d(
-  struct piecewise_traj_compressed *traj, const struct traj_eval *prev_end)
+// Moves the playhead to the piece that contains the given time, relative to
+// the start of the trajectory. The index entry before the piece is found with
+// a binary search, then at most index_stride pieces are parsed.
+static void piecewise_compressed_seek(struct piecewise_traj_compressed *traj, float t)
+{
+  const struct piecewise_traj_compressed_index_entry *entry;
+  int low = 0;
+  int high = traj->index_count - 1;
+  int mid;
+
+  while (low < high) {
+    mid = (low + high + 1) / 2;
+    if (traj->index[mid].t_begin_msec / STORED_DURATION_SCALE <= t) {
+      low = mid;
+    } else {
+      high = mid - 1;
+    }
+  }
+
+  entry = &traj->index[low];
+  traj->current_piece.data = (compressed_piece_ptr)traj->data + entry->offset;
+  traj->current_piece.t_begin_msec = entry->t_begin_msec;
+  traj->current_piece.t_begin_relative = entry->t_begin_msec / STORED_DURATION_SCALE;
+  memcpy(traj->current_piece.start, entry->start, sizeof(entry->start));
+  piecewise_compressed_update_current_poly4d(traj);
+
+  while (traj->current_piece.data && t >= end_time_of_current_piece(traj)) {
+    piecewise_compressed_advance_playhead(traj);
+  }
+}
+
+static void piecewise_compressed_update_current_poly4d(struct piecewise_traj_compressed *traj)
 {
   struct poly4d* poly4d = &traj->current_piece.poly4d;
+  const int16_t* start = traj->current_piece.start;
   compressed_piece_ptr ptr;
   struct compressed_piece_parsed_header header;
 
@@ -277,22 +351,27 @@ static void piecewise_compressed_update_current_poly4d(
   /* Process the body */
   ptr = header.body;
   ptr = calculate_polynomial_coefficients(
-    poly4d->p[0], ptr, header.x_type, prev_end->pos.x, poly4d->duration, STORED_DISTANCE_SCALE);
+    poly4d->p[0], ptr, header.x_type, start[0] / STORED_DISTANCE_SCALE, poly4d->duration, STORED_DISTANCE_SCALE);
   ptr = calculate_polynomial_coefficients(
-    poly4d->p[1], ptr, header.y_type, prev_end->pos.y, poly4d->duration, STORED_DISTANCE_SCALE);
+    poly4d->p[1], ptr, header.y_type, start[1] / STORED_DISTANCE_SCALE, poly4d->duration, STORED_DISTANCE_SCALE);
   ptr = calculate_polynomial_coefficients(
-    poly4d->p[2], ptr, header.z_type, prev_end->pos.z, poly4d->duration, STORED_DISTANCE_SCALE);
+    poly4d->p[2], ptr, header.z_type, start[2] / STORED_DISTANCE_SCALE, poly4d->duration, STORED_DISTANCE_SCALE);
   calculate_polynomial_coefficients(
-    poly4d->p[3], ptr, header.yaw_type, prev_end->yaw, poly4d->duration, STORED_ANGLE_SCALE);
+    poly4d->p[3], ptr, header.yaw_type, start[3] / STORED_ANGLE_SCALE, poly4d->duration, STORED_ANGLE_SCALE);
 }
 
 static void piecewise_compressed_advance_playhead(struct piecewise_traj_compressed *traj)
 {
-  float duration = traj->current_piece.poly4d.duration;
-  struct traj_eval end_of_previous_piece = poly4d_eval(&traj->current_piece.poly4d, duration);
+  struct compressed_piece_parsed_header header;
+  compressed_piece_ptr ptr = traj->current_piece.data;
+
+  /* The end point of the current piece is the start point of the next one */
+  ptr = parse_header_of_current_piece(&header, ptr);
+  calculate_end_point(traj->current_piece.start, &header, traj->current_piece.start);
 
-  traj->current_piece.t_begin_relative += duration;
-  traj->current_piece.data = next_piece(traj->current_piece.data);
+  traj->current_piece.t_begin_msec += header.duration_in_msec;
+  traj->current_piece.t_begin_relative = traj->current_piece.t_begin_msec / STORED_DURATION_SCALE;
+  traj->current_piece.data = ptr;
 
-  piecewise_compressed_update_current_poly4d(traj, &end_of_previous_piece);
+  piecewise_compressed_update_current_poly4d(traj);
 }
@@ -0,0 +1,312 @@
+/**
+ *    ||          ____  _ __
+ * +------+      / __ )(_) /_______________ _____  ___
+ * | 0xBC |     / __  / / __/ ___/ ___/ __ `/_  / / _ \
+ * +------+    / /_/ / / /_/ /__/ /  / /_/ / / /_/  __/
+ *  ||  ||    /_____/_/\__/\___/_/   \__,_/ /___/\___/
+ *
+ * Crazyflie control firmware
+ *
+ * Copyright (C) 2023 Bitcraze AB
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, in version 3.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ *
+ * pptraj_minsnap.c - On-board planning of minimum snap trajectories
+ *
+ * The trajectory is planned in the Hermite form: each degree 7 piece is
+ * defined by the position, velocity, acceleration and jerk at its two ends.
+ * The snap cost of a piece is a quadratic form of these values, so the
+ * minimum snap trajectory is found by solving a linear system for the free
+ * derivatives at the waypoints. Each waypoint is only coupled to its
+ * neighbours, which makes the system banded, symmetric and positive definite.
+ * It is solved with a banded Cholesky factorization in O(n) time and memory.
+ */
+
+#include <math.h>
+
+#include "pptraj_minsnap.h"
+
+// free derivatives (velocity, acceleration, jerk) per waypoint
+#define DERIVATIVES 3
+
+// the derivatives of a waypoint are coupled to the derivatives of the
+// previous and next waypoints only
+#define HALF_BANDWIDTH (2 * DERIVATIVES - 1)
+
+#define MAX_UNKNOWNS (DERIVATIVES * (PPTRAJ_MINSNAP_MAX_PIECES + 1))
+
+// snap cost of a piece with duration 1, as a quadratic form of
+// [x0, dx0, ddx0, dddx0, x1, dx1, ddx1, dddx1]
+static const float snap_cost[8][8] = {
+	{  100800,  50400,  10080,  840, -100800,  50400, -10080,  840 },
+	{   50400,  25920,   5400,  480,  -50400,  24480,  -4680,  360 },
+	{   10080,   5400,   1200,  120,  -10080,   4680,   -840,   60 },
+	{     840,    480,    120,   16,    -840,    360,    -60,    4 },
+	{ -100800, -50400, -10080, -840,  100800, -50400,  10080, -840 },
+	{   50400,  24480,   4680,  360,  -50400,  25920,  -5400,  480 },
+	{  -10080,  -4680,   -840,  -60,   10080,  -5400,   1200, -120 },
+	{     840,    360,     60,    4,    -840,    480,   -120,   16 },
+};
+
+// coefficients 4..7 of a piece with duration 1, from
+// [x0, dx0, ddx0, dddx0, x1, dx1, ddx1, dddx1]. coefficients 0..3 follow
+// directly from the values at the start.
+static const float hermite_coefficients[4][8] = {
+	{ -35, -20, -5.0f,  -2.0f/3,  35, -15,  5.0f/2, -1.0f/6 },
+	{  84,  45,   10,         1, -84,  39,      -7,  1.0f/2 },
+	{ -70, -36, -15.0f/2, -2.0f/3,  70, -34, 13.0f/2, -1.0f/2 },
+	{  20,  10,    2,   1.0f/6, -20,  10,      -2,  1.0f/6 },
+};
+
+// the linear system, the lower half of the symmetric band matrix is stored.
+// band[i][d] is the element at row i, column i - d.
+static float band[MAX_UNKNOWNS][HALF_BANDWIDTH + 1];
+static float rhs[MAX_UNKNOWNS];
+static float scale[MAX_UNKNOWNS];
+
+// waypoints and derivatives of the axis being planned
+static float positions[PPTRAJ_MINSNAP_MAX_PIECES + 1];
+static float pinned[MAX_UNKNOWNS];
+
+static inline int unknown_index(int waypoint, int derivative)
+{
+	return DERIVATIVES * waypoint + derivative - 1;
+}
+
+static void assemble(float const *durations, int n_pieces)
+{
+	int n = DERIVATIVES * (n_pieces + 1);
+	for (int i = 0; i < n; ++i) {
+		for (int d = 0; d <= HALF_BANDWIDTH; ++d) {
+			band[i][d] = 0;
+		}
+		rhs[i] = 0;
+	}
+
+	for (int k = 0; k < n_pieces; ++k) {
+		// the cost of a piece with duration T is T^-7 * b' * S * snap_cost * S * b,
+		// where S scales the derivatives to the time of the piece
+		float T = durations[k];
+		float s[8];
+		s[0] = 1;
+		for (int i = 1; i < 4; ++i) {
+			s[i] = s[i - 1] * T;
+		}
+		for (int i = 0; i < 4; ++i) {
+			s[4 + i] = s[i];
+		}
+		float w = 1.0f / (s[3] * s[3] * s[1]);
+
+		for (int i = 0; i < 8; ++i) {
+			if (i % 4 == 0) {
+				// positions are given, not part of the system
+				continue;
+			}
+			int row = unknown_index(k + i / 4, i % 4);
+			for (int j = 0; j < 8; ++j) {
+				float h = snap_cost[i][j] * s[i] * s[j] * w;
+				if (j % 4 == 0) {
+					rhs[row] -= h * positions[k + j / 4];
+				}
+				else {
+					int col = unknown_index(k + j / 4, j % 4);
+					if (col <= row) {
+						band[row][row - col] += h;
+					}
+				}
+			}
+		}
+	}
+}
+
+// replace the equation of a derivative that has a given value with
+// unknown == value, keeping the matrix symmetric
+static void pin(int n, int unknown, float value)
+{
+	for (int d = 1; d <= HALF_BANDWIDTH; ++d) {
+		int above = unknown - d;
+		if (above >= 0) {
+			rhs[above] -= band[unknown][d] * value;
+			band[unknown][d] = 0;
+		}
+		int below = unknown + d;
+		if (below < n) {
+			rhs[below] -= band[below][d] * value;
+			band[below][d] = 0;
+		}
+	}
+	band[unknown][0] = 1;
+	rhs[unknown] = value;
+}
+
+// solve the system in place, the solution is written to rhs.
+// returns -1 if the matrix is not positive definite.
+static int solve(int n)
+{
+	// the derivatives of different orders differ in magnitude by orders of
+	// magnitude, scale the system to a unit diagonal to keep the precision
+	for (int i = 0; i < n; ++i) {
+		if (!(band[i][0] > 0)) {
+			return -1;
+		}
+		scale[i] = 1.0f / sqrtf(band[i][0]);
+	}
+	for (int i = 0; i < n; ++i) {
+		for (int d = 0; d <= HALF_BANDWIDTH && d <= i; ++d) {
+			band[i][d] *= scale[i] * scale[i - d];
+		}
+		rhs[i] *= scale[i];
+	}
+
+	// cholesky factorization, L is written over the lower half
+	for (int i = 0; i < n; ++i) {
+		for (int d = (i < HALF_BANDWIDTH ? i : HALF_BANDWIDTH); d >= 0; --d) {
+			int j = i - d;
+			float sum = band[i][d];
+			int first = i - HALF_BANDWIDTH > 0 ? i - HALF_BANDWIDTH : 0;
+			for (int k = first; k < j; ++k) {
+				sum -= band[i][i - k] * band[j][j - k];
+			}
+			if (d == 0) {
+				if (!(sum > 0)) {
+					return -1;
+				}
+				band[i][0] = sqrtf(sum);
+			}
+			else {
+				band[i][d] = sum / band[j][0];
+			}
+		}
+	}
+
+	// forward substitution, L * y = rhs
+	for (int i = 0; i < n; ++i) {
+		float sum = rhs[i];
+		int first = i - HALF_BANDWIDTH > 0 ? i - HALF_BANDWIDTH : 0;
+		for (int k = first; k < i; ++k) {
+			sum -= band[i][i - k] * rhs[k];
+		}
+		rhs[i] = sum / band[i][0];
+	}
+
+	// backward substitution, L' * x = y
+	for (int i = n - 1; i >= 0; --i) {
+		float sum = rhs[i];
+		int last = i + HALF_BANDWIDTH < n - 1 ? i + HALF_BANDWIDTH : n - 1;
+		for (int k = i + 1; k <= last; ++k) {
+			sum -= band[k][k - i] * rhs[k];
+		}
+		rhs[i] = sum / band[i][0];
+	}
+
+	for (int i = 0; i < n; ++i) {
+		rhs[i] *= scale[i];
+	}
+
+	return 0;
+}
+
+// plan one axis, positions and pinned must be set. pinned is NaN for free
+// derivatives.
+static int plan_axis(struct piecewise_traj *traj, int axis, float const *durations, int n_pieces)
+{
+	int n = DERIVATIVES * (n_pieces + 1);
+
+	assemble(durations, n_pieces);
+	for (int i = 0; i < n; ++i) {
+		if (!isnan(pinned[i])) {
+			pin(n, i, pinned[i]);
+		}
+	}
+	if (solve(n) != 0) {
+		return -1;
+	}
+
+	for (int k = 0; k < n_pieces; ++k) {
+		float T = durations[k];
+		float b[8];
+		b[0] = positions[k];
+		b[4] = positions[k + 1];
+		float Tpow = 1;
+		for (int i = 1; i < 4; ++i) {
+			Tpow *= T;
+			b[i] = rhs[unknown_index(k, i)] * Tpow;
+			b[4 + i] = rhs[unknown_index(k + 1, i)] * Tpow;
+		}
+
+		// coefficients of the piece with duration 1, then stretched to T
+		float *p = traj->pieces[k].p[axis];
+		p[0] = b[0];
+		p[1] = b[1];
+		p[2] = b[2] / 2;
+		p[3] = b[3] / 6;
+		for (int i = 0; i < 4; ++i) {
+			p[4 + i] = 0;
+			for (int j = 0; j < 8; ++j) {
+				p[4 + i] += hermite_coefficients[i][j] * b[j];
+			}
+		}
+		polystretchtime(p, T);
+	}
+
+	return 0;
+}
+
+int piecewise_plan_min_snap(struct piecewise_traj *traj,
+	struct vec const *waypoints, float const *yaws, struct vec const *velocities,
+	float const *durations, int n_pieces)
+{
+	if (n_pieces < 1 || n_pieces > PPTRAJ_MINSNAP_MAX_PIECES) {
+		return -1;
+	}
+	for (int k = 0; k < n_pieces; ++k) {
+		if (!(durations[k] > 0)) {
+			return -1;
+		}
+	}
+
+	traj->timescale = 1.0;
+	traj->shift = vzero();
+	traj->n_pieces = n_pieces;
+	for (int k = 0; k < n_pieces; ++k) {
+		traj->pieces[k].duration = durations[k];
+	}
+
+	for (int axis = 0; axis < 4; ++axis) {
+		for (int k = 0; k <= n_pieces; ++k) {
+			if (axis < 3) {
+				positions[k] = vindex(waypoints[k], axis);
+			}
+			else {
+				positions[k] = yaws ? yaws[k] : 0;
+			}
+
+			// start and end with no acceleration and jerk, and at rest unless
+			// a velocity is given. the other derivatives are free.
+			bool is_end = (k == 0 || k == n_pieces);
+			float velocity = is_end ? 0 : NAN;
+			if (velocities && axis < 3) {
+				velocity = vindex(velocities[k], axis);
+			}
+			pinned[unknown_index(k, 1)] = velocity;
+			pinned[unknown_index(k, 2)] = is_end ? 0 : NAN;
+			pinned[unknown_index(k, 3)] = is_end ? 0 : NAN;
+		}
+
+		if (plan_axis(traj, axis, durations, n_pieces) != 0) {
+			return -1;
+		}
+	}
+
+	return 0;
+}
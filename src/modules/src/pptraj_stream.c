@@ -0,0 +1,115 @@
+/**
+ *    ||          ____  _ __
+ * +------+      / __ )(_) /_______________ _____  ___
+ * | 0xBC |     / __  / / __/ ___/ ___/ __ `/_  / / _ \
+ * +------+    / /_/ / / /_/ /__/ /  / /_/ / / /_/  __/
+ *  ||  ||    /_____/_/\__/\___/_/   \__,_/ /___/\___/
+ *
+ * Crazyflie control firmware
+ *
+ * Copyright (C) 2023 Bitcraze AB
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, in version 3.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ *
+ * pptraj_stream.c - Piecewise polynomial trajectories of unlimited length
+ */
+
+#include "pptraj_stream.h"
+
+static struct poly4d const *piece_at(struct piecewise_traj_stream const *traj, uint32_t counter)
+{
+	return &traj->pieces[counter % traj->capacity];
+}
+
+void piecewise_stream_init(struct piecewise_traj_stream *traj,
+	struct poly4d *pieces, uint8_t capacity)
+{
+	traj->t_begin = 0;
+	traj->timescale = 1;
+	traj->shift = vzero();
+	traj->pieces = pieces;
+	traj->capacity = capacity;
+	traj->head = 0;
+	traj->tail = 0;
+	traj->head_begin = 0;
+	traj->tail_end = 0;
+	traj->is_closed = false;
+	traj->underrun_count = 0;
+}
+
+bool piecewise_stream_append(struct piecewise_traj_stream *traj,
+	struct poly4d const *piece)
+{
+	if (traj->is_closed || piecewise_stream_free_count(traj) == 0) {
+		return false;
+	}
+
+	traj->pieces[traj->tail % traj->capacity] = *piece;
+	traj->tail_end += piece->duration;
+	++traj->tail;
+	return true;
+}
+
+void piecewise_stream_close(struct piecewise_traj_stream *traj)
+{
+	traj->is_closed = true;
+}
+
+struct traj_eval piecewise_stream_eval(struct piecewise_traj_stream *traj, float t)
+{
+	if (piecewise_stream_is_empty(traj)) {
+		return traj_eval_invalid();
+	}
+
+	float t_piece = (t - traj->t_begin) / traj->timescale;
+	bool is_paused = false;
+
+	if (t_piece > traj->tail_end) {
+		if (traj->is_closed) {
+			// the trajectory has ended, hover at the end point
+			struct poly4d const *end_piece = piece_at(traj, traj->tail - 1);
+			struct traj_eval ev = poly4d_eval(end_piece, end_piece->duration);
+			ev.pos = vadd(ev.pos, traj->shift);
+			ev.vel = vzero();
+			ev.acc = vzero();
+			ev.omega = vzero();
+			return ev;
+		}
+
+		// underrun, pause the trajectory by moving the start time forward
+		traj->t_begin += (t_piece - traj->tail_end) * traj->timescale;
+		t_piece = traj->tail_end;
+		++traj->underrun_count;
+		is_paused = true;
+	}
+
+	// free the pieces that the playhead has passed
+	while (traj->head + 1 < traj->tail) {
+		float piece_end = traj->head_begin + piece_at(traj, traj->head)->duration;
+		if (t_piece <= piece_end) {
+			break;
+		}
+		traj->head_begin = piece_end;
+		++traj->head;
+	}
+
+	struct poly4d const *piece = piece_at(traj, traj->head);
+	struct traj_eval ev = poly4d_eval_scaled(piece, t_piece - traj->head_begin, 1.0f / traj->timescale);
+	ev.pos = vadd(ev.pos, traj->shift);
+	if (is_paused) {
+		ev.vel = vzero();
+		ev.acc = vzero();
+		ev.omega = vzero();
+	}
+	return ev;
+}
@@ -69,6 +69,7 @@
 #include "app.h"
 #include "static_mem.h"
 #include "peer_localization.h"
+#include "peer_gossip_service.h"
 #include "cfassert.h"
 #include "i2cdev.h"
 #include "autoconf.h"
@@ -212,6 +213,9 @@ void systemTask(void *arg)
   }
   soundInit();
   crtpMemInit();
+#ifdef CONFIG_PEER_GOSSIP
+  peerGossipServiceInit();
+#endif
 
 #ifdef PROXIMITY_ENABLED
   proximityInit();
@@ -268,6 +272,12 @@ void systemTask(void *arg)
     pass = false;
     DEBUG_PRINT("sound [FAIL]\n");
   }
+#ifdef CONFIG_PEER_GOSSIP
+  if (peerGossipServiceTest() == false) {
+    pass = false;
+    DEBUG_PRINT("peerGossip [FAIL]\n");
+  }
+#endif
   if (memTest() == false) {
     pass = false;
     DEBUG_PRINT("mem [FAIL]\n");
@@ -32,8 +32,12 @@
 #include <stdbool.h>
 #include <stdint.h>
 
+// Fixed point clock corrections are unsigned Q1.31 numbers, 1.0 is 2^31
+#define CLOCK_CORRECTION_FIXED_ONE (1u << 31)
+
 typedef struct {
   double clockCorrection;
+  uint32_t clockCorrectionFixed; // Only used by the fixed point functions
   unsigned int clockCorrectionBucket;
 } clockCorrectionStorage_t;
 
@@ -41,4 +45,14 @@ double clockCorrectionEngineGet(const clockCorrectionStorage_t* storage);
 double clockCorrectionEngineCalculate(const uint64_t new_t_in_cl_reference, const uint64_t old_t_in_cl_reference, const uint64_t new_t_in_cl_x, const uint64_t old_t_in_cl_x, const uint64_t mask);
 bool clockCorrectionEngineUpdate(clockCorrectionStorage_t* storage, const double clockCorrectionCandidate);
 
+// Fixed point versions of the functions above, they do not use double precision
+// floating point math which is emulated in software on the Cortex-M4.
+uint32_t clockCorrectionEngineGetFixed(const clockCorrectionStorage_t* storage);
+uint32_t clockCorrectionEngineCalculateFixed(const uint64_t new_t_in_cl_reference, const uint64_t old_t_in_cl_reference, const uint64_t new_t_in_cl_x, const uint64_t old_t_in_cl_x, const uint64_t mask);
+bool clockCorrectionEngineUpdateFixed(clockCorrectionStorage_t* storage, const uint32_t clockCorrectionCandidate);
+int64_t clockCorrectionEngineApplyFixed(const int64_t t_in_cl_x, const uint32_t clockCorrection);
+
+// Set an initial clock correction in Q1.31 for both the floating and fixed point functions
+void clockCorrectionEngineSeed(clockCorrectionStorage_t* storage, const uint32_t clockCorrection);
+
 #endif /* clockCorrectionEngine_h */
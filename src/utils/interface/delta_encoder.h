@@ -0,0 +1,123 @@
+/**
+ * ,---------,       ____  _ __
+ * |  ,-^-,  |      / __ )(_) /_______________ _____  ___
+ * | (  O  ) |     / __  / / __/ ___/ ___/ __ `/_  / / _ \
+ * | / ,--´  |    / /_/ / / /_/ /__/ /  / /_/ / / /_/  __/
+ *    +------`   /_____/_/\__/\___/_/   \__,_/ /___/\___/
+ *
+ * Crazyflie control firmware
+ *
+ * Copyright (C) 2023 Bitcraze AB
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, in version 3.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ *
+ *
+ * delta_encoder.h - Delta and zigzag varint encoding of fixed layout records,
+ * used for the compressed uSD log format.
+ *
+ * A record consists of a tag byte, a timestamp and a number of fields of
+ * 1, 2 or 4 bytes each. Keyframes are written as raw data, other records as
+ * the difference to the previous record of the same type:
+ *
+ *   keyframe: tag | 0x80, uint64 timestamp, raw field values (little endian)
+ *   delta:    tag, zigzag varint timestamp delta, zigzag varint delta per field
+ *
+ * Field deltas are computed modulo the field size, the decoder adds them to
+ * the previous value modulo the same size. Floats are handled as their raw
+ * 32 bit pattern, which makes small changes in a value small deltas as long
+ * as the exponent does not change.
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#define DELTA_ENCODER_KEYFRAME_FLAG (0x80)
+
+// Maximum size of an unsigned varint, 32 and 64 bit values
+#define DELTA_ENCODER_MAX_VARINT32_SIZE (5)
+#define DELTA_ENCODER_MAX_VARINT64_SIZE (10)
+
+typedef struct {
+    const uint8_t* fieldSizes;
+    uint8_t numFields;
+    uint16_t numBytes;
+
+    // Raw field values and timestamp of the previous record
+    uint8_t* previous;
+    uint64_t previousTimestamp;
+
+    uint16_t keyframeInterval;
+    uint16_t sinceKeyframe;
+    bool keyframeRequired;
+} deltaEncoder_t;
+
+/**
+ * @brief Initialize an encoder
+ *
+ * @param encoder The encoder
+ * @param fieldSizes Size of each field in bytes, 1, 2 or 4. Must be valid as long as the encoder is used
+ * @param numFields The number of fields
+ * @param previous Storage for the previous record, the sum of the field sizes
+ * @param keyframeInterval Write a keyframe every keyframeInterval records, 1 writes keyframes only
+ */
+void deltaEncoderInit(deltaEncoder_t* encoder, const uint8_t* fieldSizes, const uint8_t numFields, uint8_t* previous, const uint16_t keyframeInterval);
+
+/**
+ * @brief Make the next record a keyframe
+ *
+ * Must be called when the decoder will not see the previous record, for instance when a new file is started or
+ * when an encoded record could not be stored.
+ *
+ * @param encoder The encoder
+ */
+void deltaEncoderReset(deltaEncoder_t* encoder);
+
+/**
+ * @brief The worst case size of an encoded record
+ *
+ * @param encoder The encoder
+ * @return uint16_t Size in bytes
+ */
+uint16_t deltaEncoderMaxRecordSize(const deltaEncoder_t* encoder);
+
+/**
+ * @brief Encode a record
+ *
+ * @param encoder The encoder
+ * @param tag Record tag, 0 - 127
+ * @param timestamp Timestamp of the record
+ * @param values Raw field values, packed in field order
+ * @param out Output buffer, must hold at least deltaEncoderMaxRecordSize() bytes
+ * @return uint16_t The number of bytes written to out
+ */
+uint16_t deltaEncoderEncode(deltaEncoder_t* encoder, const uint8_t tag, const uint64_t timestamp, const uint8_t* values, uint8_t* out);
+
+/**
+ * @brief Write an unsigned varint, 7 bits per byte, least significant group first
+ *
+ * @param value The value
+ * @param out Output buffer, at least DELTA_ENCODER_MAX_VARINT64_SIZE bytes
+ * @return uint8_t The number of bytes written
+ */
+uint8_t deltaEncoderWriteVarint(uint64_t value, uint8_t* out);
+
+/**
+ * @brief Map a signed value to an unsigned, small magnitudes give small values
+ *
+ * 0 -> 0, -1 -> 1, 1 -> 2, -2 -> 3 ...
+ */
+static inline uint64_t deltaEncoderZigzag(const int64_t value) {
+    return ((uint64_t)value << 1) ^ (uint64_t)(value >> 63);
+}
@@ -37,8 +37,29 @@ typedef bool (*kveFunc_t)(const char *key, void *buffer, size_t length);
 
 void kveDefrag(kveMemory_t *kve);
 
+/** Incremental defragmentation
+ *
+ * Move items into the holes of the table, one item at a time, until at most
+ * maxBytes have been moved. At least one item is moved per call, unless an
+ * item does not fit in the hole before it and there is no room to move it to
+ * the end of the table. The table is kept consistent if a reset happens
+ * during the step.
+ *
+ * Return true when there are no holes left in the table, or when no item can
+ * be moved.
+ */
+bool kveDefragStep(kveMemory_t *kve, size_t maxBytes);
+
 bool kveStore(kveMemory_t *kve, const char* key, const void* buffer, size_t length);
 
+/** Store an item and tell if the table got a new hole
+ *
+ * Same as kveStore(). If leftHole is not NULL, it is set to true when an
+ * existing item was replaced by one of a different size, which leaves a hole
+ * where the old item was. Overwriting an item of the same size does not.
+ */
+bool kveStoreReportHole(kveMemory_t *kve, const char* key, const void* buffer, size_t length, bool *leftHole);
+
 size_t kveFetch(kveMemory_t *kve, const char* key, void* buffer, size_t bufferLength);
 
 bool kveDelete(kveMemory_t *kve, const char* key);
@@ -56,6 +77,7 @@ typedef struct kveStats {
     size_t keySize;
     size_t dataSize;
     size_t metadataSize;
+    size_t holeCount;
     size_t holeSize;
     size_t freeSpace;
     size_t fragmentation;
@@ -29,10 +29,30 @@
 #pragma once
 
 #include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+typedef struct {
+    uint16_t hash;
+    uint16_t address;
+} kveIndexEntry_t;
+
+/**
+ * Optional RAM index of the items in a kve memory.
+ *
+ * The entries are provided by the owner of the kve memory, see kve_index.h.
+ */
+typedef struct {
+    kveIndexEntry_t *entries;
+    uint16_t size;
+    uint16_t used;
+    bool valid;
+} kveIndex_t;
 
 typedef struct {
     size_t memorySize;
     size_t (*read)(size_t address, void* data, size_t length);
     size_t (*write)(size_t address, const void* data, size_t length);
     void (*flush)(void);
+    kveIndex_t *index;
 } kveMemory_t;
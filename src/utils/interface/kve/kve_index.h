@@ -0,0 +1,82 @@
+/**
+ * ,---------,       ____  _ __
+ * |  ,-^-,  |      / __ )(_) /_______________ _____  ___
+ * | (  O  ) |     / __  / / __/ ___/ ___/ __ `/_  / / _ \
+ * | / ,--´  |    / /_/ / / /_/ /__/ /  / /_/ / / /_/  __/
+ *    +------`   /_____/_/\__/\___/_/   \__,_/ /___/\___/
+ *
+ * Crazyflie control firmware
+ *
+ * Copyright (C) 2023 Bitcraze AB
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, in version 3.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ *
+ *
+ * kve_index.h - RAM index of key hash to item address
+ *
+ */
+
+/**
+ * The index maps a hash of the key to the address of the item in memory, so
+ * that a lookup does not have to walk the table from the start. It is an open
+ * addressing hash table with linear probing, the entries array is supplied by
+ * the owner of the kve memory:
+ *
+ *   static kveIndexEntry_t entries[64];
+ *   static kveIndex_t index = { .entries = entries, .size = 64 };
+ *   static kveMemory_t kve = { ..., .index = &index };
+ *
+ * The index is built by kveCheck() and kept up to date by the kve functions.
+ * If it is not built, or if it overflows, the kve falls back to scanning the
+ * memory. These functions are intended to be used internally by the kve
+ * module.
+ */
+
+#pragma once
+
+#include "kve/kve_common.h"
+
+#include <stddef.h>
+#include <stdbool.h>
+
+/** Return true if the kve memory has an index that can be used for lookups */
+bool kveIndexIsValid(const kveMemory_t *kve);
+
+/** Mark the index as unusable, lookups will fall back to scanning the memory */
+void kveIndexInvalidate(kveMemory_t *kve);
+
+/** Empty the index, used when the memory is formatted */
+void kveIndexClear(kveMemory_t *kve);
+
+/** Build the index by walking the table from firstItemAddress
+ *
+ * Return true if all items could be indexed
+ */
+bool kveIndexBuild(kveMemory_t *kve, size_t firstItemAddress);
+
+/** Find the address of the item with key "key"
+ *
+ * The candidate item is verified against the memory, so hash collisions are
+ * handled. Return KVE_STORAGE_INVALID_ADDRESS if the key is not in the index.
+ * Only meaningful when kveIndexIsValid() is true.
+ */
+size_t kveIndexFind(kveMemory_t *kve, const char *key);
+
+/** Add an item that has been written at "address" */
+void kveIndexAdd(kveMemory_t *kve, const char *key, size_t address);
+
+/** Remove the item at "address" that has been replaced by a hole */
+void kveIndexRemove(kveMemory_t *kve, const char *key, size_t address);
+
+/** Update the index after a block of items has been moved in memory */
+void kveIndexMove(kveMemory_t *kve, size_t sourceAddress, size_t destinationAddress, size_t length);
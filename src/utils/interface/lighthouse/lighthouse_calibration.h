@@ -1,5 +1,7 @@
 #pragma once
 
+#include <math.h>
+#include "cf_math.h"
 #include "ootx_decoder.h"
 #include "lighthouse_types.h"
 
@@ -58,3 +60,32 @@ float lighthouseCalibrationMeasurementModelLh1(const float x, const float y, con
  * @return float The predicted uncompensated sweep angle of the rotor
  */
 float lighthouseCalibrationMeasurementModelLh2(const float x, const float y, const float z, const float t, const lighthouseCalibrationSweep_t* calib);
+
+/**
+ * @brief Compute the calibration terms of the lighthouse 2 measurement model for one sweep
+ * @param calib Calibration data for the rotor
+ * @param t Tilt of the light plane in radians
+ * @param precalc (output) The precomputed terms
+ */
+void lighthouseCalibrationPrecalcLh2(const lighthouseCalibrationSweep_t* calib, const float t, lighthouseCalibrationSweepLh2Precalc_t* precalc);
+
+/**
+ * @brief Predict the measured sweep angle based on a position for a lighthouse 2 rotor, using precomputed calibration terms.
+ *        Gives the same result as lighthouseCalibrationMeasurementModelLh2(). The position is relative to the rotor reference frame.
+ * @param x meters
+ * @param y meters
+ * @param z meters
+ * @param precalc Precomputed calibration terms for the sweep, see lighthouseCalibrationPrecalcLh2()
+ * @return float The predicted uncompensated sweep angle of the rotor
+ *
+ * Inline since it is used by the estimator, also when the lighthouse deck driver is not built.
+ */
+static inline float lighthouseCalibrationMeasurementModelLh2Precalc(const float x, const float y, const float z, const lighthouseCalibrationSweepLh2Precalc_t* precalc) {
+  const float ax = atan2f(y, x);
+  const float r = arm_sqrt(x * x + y * y);
+
+  const float base = ax + asinf(clip1(z * precalc->tanTiltedPlane / r));
+  const float compGib = -precalc->gibmag * arm_cos_f32(ax + precalc->gibphase);
+
+  return base - (precalc->phase + compGib);
+}
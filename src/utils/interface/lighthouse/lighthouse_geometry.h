@@ -14,6 +14,10 @@ typedef struct {
   __attribute__((aligned(4))) mat3d baseStationInvertedRotationMatrixes;
   __attribute__((aligned(4))) mat3d lh1Rotor2RotationMatrixes;
   __attribute__((aligned(4))) mat3d lh1Rotor2InvertedRotationMatrixes;
+  // Base station position, the origin of the rays (world reference frame)
+  __attribute__((aligned(4))) vec3d origin;
+  // Calibration terms for the two LH2 sweeps, updated when the calibration data is written
+  lighthouseCalibrationSweepLh2Precalc_t lh2SweepCalib[2];
 } baseStationGeometryCache_t;
 
 /**
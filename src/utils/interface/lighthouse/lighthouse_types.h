@@ -29,3 +29,15 @@ typedef struct {
  *
  */
 typedef float (*lighthouseCalibrationMeasurementModel_t)(const float x, const float y, const float z, const float t, const lighthouseCalibrationSweep_t* calib);
+
+/**
+ * @brief Terms of the lighthouse 2 measurement model for one sweep that only depend on the calibration data and the
+ *        tilt of the light plane. Computed when the calibration data is updated to avoid trigonometric functions per sample.
+ */
+typedef struct {
+  float tanT;             // tan(t)
+  float tanTiltedPlane;   // tan(t - tilt)
+  float phase;
+  float gibmag;
+  float gibphase;
+} lighthouseCalibrationSweepLh2Precalc_t;
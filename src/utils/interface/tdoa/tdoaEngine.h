@@ -11,6 +11,12 @@
 #define TDOA_ENGINE_MEASUREMENT_NOISE_STD 0.15f
 #endif
 
+#ifdef CONFIG_DECK_LOCO_TDOA_PAIRS_PER_PACKET
+#define TDOA_ENGINE_MAX_PAIRS_PER_PACKET CONFIG_DECK_LOCO_TDOA_PAIRS_PER_PACKET
+#else
+#define TDOA_ENGINE_MAX_PAIRS_PER_PACKET 1
+#endif
+
 typedef void (*tdoaEngineSendTdoaToEstimator)(tdoaMeasurement_t* tdoaMeasurement);
 
 typedef enum {
@@ -21,18 +27,18 @@ typedef enum {
 
 typedef struct {
   // State
-  tdaoAnchorInfoArray_t anchorInfoArray;
+  tdoaAnchorStorage_t anchorStorage;
   tdoaStats_t stats;
 
   // Configuration
   tdoaEngineSendTdoaToEstimator sendTdoaToEstimator;
   double locodeckTsFreq;
+  float metersPerTick;
   tdoaEngineMatchingAlgorithm_t matchingAlgorithm;
+  uint8_t pairsPerPacket; // Max number of TDoA measurements created per received packet, 1 to TDOA_ENGINE_MAX_PAIRS_PER_PACKET
 
   // Matching algorithm data
   struct {
-    uint8_t seqNr[REMOTE_ANCHOR_DATA_COUNT];
-    uint8_t id[REMOTE_ANCHOR_DATA_COUNT];
     uint8_t offset;
   } matching;
 } tdoaEngineState_t;
@@ -48,4 +54,19 @@ static inline uint64_t tdoaEngineTruncateToAnchorTimeStamp(uint64_t fullTimeStam
   return fullTimeStamp & TDOA_ENGINE_TRUNCATE_TO_ANCHOR_TS_BITMAP;
 }
 
+/**
+ * Calculates the time difference of arrival in the clock of the tag, from the time between the receptions
+ * of the two packets in the tag and the time between the transmissions of the packets, in the clock of anchor An.
+ */
+static inline int64_t tdoaEngineCalcTdoa(const int64_t delta_rxAr_to_rxAn_in_cl_T, const int64_t delta_txAr_to_txAn_in_cl_An, const double clockCorrection) {
+  return delta_rxAr_to_rxAn_in_cl_T - delta_txAr_to_txAn_in_cl_An * clockCorrection;
+}
+
+/**
+ * Same as tdoaEngineCalcTdoa() but using a Q1.31 fixed point clock correction, see clockCorrectionEngine.h
+ */
+static inline int64_t tdoaEngineCalcTdoaFixed(const int64_t delta_rxAr_to_rxAn_in_cl_T, const int64_t delta_txAr_to_txAn_in_cl_An, const uint32_t clockCorrection) {
+  return delta_rxAr_to_rxAn_in_cl_T - clockCorrectionEngineApplyFixed(delta_txAr_to_txAn_in_cl_An, clockCorrection);
+}
+
 #endif // __TDOA_ENGINE_H__
@@ -3,23 +3,39 @@
 
 #include "stabilizer_types.h"
 #include "clockCorrectionEngine.h"
+#include "autoconf.h"
 
+#ifdef CONFIG_DECK_LOCO_TDOA_ANCHOR_STORAGE_COUNT
+#define ANCHOR_STORAGE_COUNT CONFIG_DECK_LOCO_TDOA_ANCHOR_STORAGE_COUNT
+#else
 #define ANCHOR_STORAGE_COUNT 16
+#endif
 #define REMOTE_ANCHOR_DATA_COUNT 16
 #define TOF_PER_ANCHOR_COUNT 16
 
+#if ANCHOR_STORAGE_COUNT > 254
+#error "Anchor storage count does not fit the id index"
+#endif
 
+
+// The remote anchor and tof tables are stored as one array per member, the ids
+// can be searched without touching the rest of the data and no space is lost
+// to padding.
 typedef struct {
-  uint8_t id; // Id of remote remote anchor
-  uint8_t seqNr; // Sequence number of the packet received in the remote anchor (7 bits)
-  int64_t rxTime; // Receive time of packet from anchor id in the remote anchor, in remote DWM clock
-  uint32_t endOfLife;
+  uint8_t id[REMOTE_ANCHOR_DATA_COUNT]; // Id of remote remote anchor
+  uint8_t seqNr[REMOTE_ANCHOR_DATA_COUNT]; // Sequence number of the packet received in the remote anchor (7 bits)
+  uint32_t endOfLife[REMOTE_ANCHOR_DATA_COUNT];
+  int64_t rxTime[REMOTE_ANCHOR_DATA_COUNT]; // Receive time of packet from anchor id in the remote anchor, in remote DWM clock
+
+  // Indexes into the arrays above, ordered by rxTime with the latest first.
+  // Updated when remote data is set, so that the latest partner is found without a search.
+  uint8_t byRecency[REMOTE_ANCHOR_DATA_COUNT];
 } tdoaRemoteAnchorData_t;
 
 typedef struct {
-  uint8_t id;
-  int64_t tof;
-  uint32_t endOfLife; // Time stamp when the tof data is outdated, local system time in ms
+  uint8_t id[TOF_PER_ANCHOR_COUNT];
+  uint32_t endOfLife[TOF_PER_ANCHOR_COUNT]; // Time stamp when the tof data is outdated, local system time in ms
+  int64_t tof[TOF_PER_ANCHOR_COUNT];
 } tdoaTimeOfFlight_t;
 
 typedef struct {
@@ -34,12 +50,36 @@ typedef struct {
   clockCorrectionStorage_t clockCorrectionStorage;
 
   point_t position; // The coordinates of the anchor
+  bool isPositionRestored; // The position is from a previous power cycle and has not been confirmed yet
 
-  tdoaTimeOfFlight_t tof[TOF_PER_ANCHOR_COUNT];
-  tdoaRemoteAnchorData_t remoteAnchorData[REMOTE_ANCHOR_DATA_COUNT];
+  tdoaTimeOfFlight_t tof;
+  tdoaRemoteAnchorData_t remoteAnchorData;
 } tdoaAnchorInfo_t;
 
-typedef tdoaAnchorInfo_t tdaoAnchorInfoArray_t[ANCHOR_STORAGE_COUNT];
+typedef struct {
+  tdoaAnchorInfo_t anchorInfo[ANCHOR_STORAGE_COUNT];
+  uint8_t anchorCount; // Slots are used in order and never released
+
+  // Slot + 1 of each anchor id, 0 if the anchor is not in storage
+  uint8_t slotById[256];
+} tdoaAnchorStorage_t;
+
+
+// Anchor data that is kept between power cycles, to get a position quickly after start up
+typedef struct {
+  uint8_t id;
+  uint16_t tof;
+} __attribute__((packed)) tdoaPersistedTof_t;
+
+typedef struct {
+  uint8_t id;
+  float x;
+  float y;
+  float z;
+  uint32_t clockCorrection; // Q1.31
+  uint8_t tofCount;
+  tdoaPersistedTof_t tof[TOF_PER_ANCHOR_COUNT];
+} __attribute__((packed)) tdoaPersistedAnchor_t;
 
 
 // The anchor context is used to pass information about an anchor as well as
@@ -51,12 +91,12 @@ typedef struct {
 } tdoaAnchorContext_t;
 
 
-void tdoaStorageInitialize(tdoaAnchorInfo_t anchorStorage[]);
+void tdoaStorageInitialize(tdoaAnchorStorage_t* anchorStorage);
 
-bool tdoaStorageGetCreateAnchorCtx(tdoaAnchorInfo_t anchorStorage[], const uint8_t anchor, const uint32_t currentTime_ms, tdoaAnchorContext_t* anchorCtx);
-bool tdoaStorageGetAnchorCtx(tdoaAnchorInfo_t anchorStorage[], const uint8_t anchor, const uint32_t currentTime_ms, tdoaAnchorContext_t* anchorCtx);
-uint8_t tdoaStorageGetListOfAnchorIds(tdoaAnchorInfo_t anchorStorage[], uint8_t unorderedAnchorList[], const int maxListSize);
-uint8_t tdoaStorageGetListOfActiveAnchorIds(tdoaAnchorInfo_t anchorStorage[], uint8_t unorderedAnchorList[], const int maxListSize, const uint32_t currentTime_ms);
+bool tdoaStorageGetCreateAnchorCtx(tdoaAnchorStorage_t* anchorStorage, const uint8_t anchor, const uint32_t currentTime_ms, tdoaAnchorContext_t* anchorCtx);
+bool tdoaStorageGetAnchorCtx(tdoaAnchorStorage_t* anchorStorage, const uint8_t anchor, const uint32_t currentTime_ms, tdoaAnchorContext_t* anchorCtx);
+uint8_t tdoaStorageGetListOfAnchorIds(tdoaAnchorStorage_t* anchorStorage, uint8_t unorderedAnchorList[], const int maxListSize);
+uint8_t tdoaStorageGetListOfActiveAnchorIds(tdoaAnchorStorage_t* anchorStorage, uint8_t unorderedAnchorList[], const int maxListSize, const uint32_t currentTime_ms);
 
 uint8_t tdoaStorageGetId(const tdoaAnchorContext_t* anchorCtx);
 int64_t tdoaStorageGetRxTime(const tdoaAnchorContext_t* anchorCtx);
@@ -71,11 +111,14 @@ double tdoaStorageGetClockCorrection(const tdoaAnchorContext_t* anchorCtx);
 int64_t tdoaStorageGetRemoteRxTime(const tdoaAnchorContext_t* anchorCtx, const uint8_t remoteAnchor);
 bool tdoaStorageGetRemoteRxTimeSeqNr(const tdoaAnchorContext_t* anchorCtx, const uint8_t remoteAnchor, int64_t* rxTime, uint8_t* seqNr);
 void tdoaStorageSetRemoteRxTime(tdoaAnchorContext_t* anchorCtx, const uint8_t remoteAnchor, const int64_t remoteRxTime, const uint8_t remoteSeqNr);
-void tdoaStorageGetRemoteSeqNrList(const tdoaAnchorContext_t* anchorCtx, int* remoteCount, uint8_t seqNr[], uint8_t id[]);
+bool tdoaStorageGetRemoteByRecency(const tdoaAnchorContext_t* anchorCtx, const int recency, uint8_t* remoteAnchor, uint8_t* seqNr);
 int64_t tdoaStorageGetTimeOfFlight(const tdoaAnchorContext_t* anchorCtx, const uint8_t otherAnchor);
 void tdoaStorageSetTimeOfFlight(tdoaAnchorContext_t* anchorCtx, const uint8_t remoteAnchor, const int64_t tof);
 
+bool tdoaStorageGetPersistedAnchor(const tdoaAnchorContext_t* anchorCtx, tdoaPersistedAnchor_t* persisted);
+void tdoaStorageRestoreAnchor(tdoaAnchorStorage_t* anchorStorage, const tdoaPersistedAnchor_t* persisted, const uint32_t currentTime_ms);
+
 // Mainly for test
-bool tdoaStorageIsAnchorInStorage(tdoaAnchorInfo_t anchorStorage[], const uint8_t anchor);
+bool tdoaStorageIsAnchorInStorage(tdoaAnchorStorage_t* anchorStorage, const uint8_t anchor);
 
 #endif // __TDOA_STORAGE_H__
@@ -8,6 +8,14 @@
 #define CLOCK_CORRECTION_FILTER 0.1
 #define CLOCK_CORRECTION_BUCKET_MAX 4
 
+// Limits in Q1.31, evaluated at compile time
+#define CLOCK_CORRECTION_FIXED_SPEC_MIN ((int64_t)(CLOCK_CORRECTION_SPEC_MIN * CLOCK_CORRECTION_FIXED_ONE))
+#define CLOCK_CORRECTION_FIXED_SPEC_MAX ((int64_t)(CLOCK_CORRECTION_SPEC_MAX * CLOCK_CORRECTION_FIXED_ONE))
+#define CLOCK_CORRECTION_FIXED_ACCEPTED_NOISE ((int64_t)(CLOCK_CORRECTION_ACCEPTED_NOISE * CLOCK_CORRECTION_FIXED_ONE))
+// CLOCK_CORRECTION_FILTER as a fraction
+#define CLOCK_CORRECTION_FIXED_FILTER_NUMERATOR 1
+#define CLOCK_CORRECTION_FIXED_FILTER_DENOMINATOR 10
+
 /**
  Logging all the clock correction information requires scaling the values repeatedly, which is computer intense. Thus, the logging functionality is enabled at compile time with the CLOCK_CORRECTION_ENABLE_LOGGING flag.
  */
@@ -121,6 +129,94 @@ bool clockCorrectionEngineUpdate(clockCorrectionStorage_t* storage, const double
   return sampleIsReliable;
 }
 
+/**
+ Obtains the fixed point clock correction, in Q1.31, from a clockCorrectionStorage_t object.
+ */
+uint32_t clockCorrectionEngineGetFixed(const clockCorrectionStorage_t* storage) {
+  return storage->clockCorrectionFixed;
+}
+
+/**
+ Fixed point version of clockCorrectionEngineCalculate().
+
+ @return The clock correction in Q1.31. Values that do not fit, 2.0 or larger, are saturated to the largest representable value. 0 if it was not possible to perform the computation.
+ */
+uint32_t clockCorrectionEngineCalculateFixed(const uint64_t new_t_in_cl_reference, const uint64_t old_t_in_cl_reference, const uint64_t new_t_in_cl_x, const uint64_t old_t_in_cl_x, const uint64_t mask) {
+  const uint64_t tickCount_in_cl_reference = truncateTimeStamp(new_t_in_cl_reference - old_t_in_cl_reference, mask);
+  const uint64_t tickCount_in_cl_x = truncateTimeStamp(new_t_in_cl_x - old_t_in_cl_x, mask);
+
+  if (tickCount_in_cl_x == 0) {
+    return 0;
+  }
+
+  if (tickCount_in_cl_reference >= 2 * tickCount_in_cl_x) {
+    return UINT32_MAX;
+  }
+
+  // (reference << 31) / x does not fit in 64 bits for 40 bit time stamps, the
+  // division is done in two steps of 16 and 15 bits instead. The result is
+  // rounded to nearest.
+  const uint64_t high = (tickCount_in_cl_reference << 16) / tickCount_in_cl_x;
+  const uint64_t remainder = (tickCount_in_cl_reference << 16) % tickCount_in_cl_x;
+  const uint64_t low = ((remainder << 15) + tickCount_in_cl_x / 2) / tickCount_in_cl_x;
+
+  const uint64_t result = (high << 15) + low;
+  return result > UINT32_MAX ? UINT32_MAX : result;
+}
+
+/**
+ Fixed point version of clockCorrectionEngineUpdate(), with the clock correction candidate in Q1.31.
+ */
+bool clockCorrectionEngineUpdateFixed(clockCorrectionStorage_t* storage, const uint32_t clockCorrectionCandidate) {
+  bool sampleIsReliable = false;
+
+  const int64_t currentClockCorrection = storage->clockCorrectionFixed;
+  const int64_t difference = (int64_t)clockCorrectionCandidate - currentClockCorrection;
+
+  if (-CLOCK_CORRECTION_FIXED_ACCEPTED_NOISE < difference && difference < CLOCK_CORRECTION_FIXED_ACCEPTED_NOISE) {
+    // Simple low pass filter
+    const int64_t newClockCorrection = clockCorrectionCandidate - (difference * CLOCK_CORRECTION_FIXED_FILTER_NUMERATOR) / CLOCK_CORRECTION_FIXED_FILTER_DENOMINATOR;
+
+    sampleIsReliable = true;
+    fillClockCorrectionBucket(storage);
+    storage->clockCorrectionFixed = newClockCorrection;
+  } else {
+    const bool shouldAcceptANewClockReference = emptyClockCorrectionBucket(storage);
+    if (shouldAcceptANewClockReference) {
+      if (CLOCK_CORRECTION_FIXED_SPEC_MIN < clockCorrectionCandidate && clockCorrectionCandidate < CLOCK_CORRECTION_FIXED_SPEC_MAX) {
+        storage->clockCorrectionFixed = clockCorrectionCandidate;
+      }
+    }
+  }
+
+  return sampleIsReliable;
+}
+
+/**
+ Applies a Q1.31 clock correction to a time (difference) measured by clock x.
+
+ @return The time in the reference clock, rounded towards zero
+ */
+int64_t clockCorrectionEngineApplyFixed(const int64_t t_in_cl_x, const uint32_t clockCorrection) {
+  const uint64_t magnitude = t_in_cl_x < 0 ? -(uint64_t)t_in_cl_x : (uint64_t)t_in_cl_x;
+
+  // Split in 32 bit halves to keep the products within 64 bits
+  const uint64_t high = (magnitude >> 32) * clockCorrection;
+  const uint64_t low = (magnitude & 0xffffffff) * clockCorrection;
+  const uint64_t result = (high << 1) + (low >> 31);
+
+  return t_in_cl_x < 0 ? -(int64_t)result : (int64_t)result;
+}
+
+/**
+ Sets an initial clock correction in Q1.31, for instance from a previous power cycle. The bucket is empty, a new sample that does not match the initial value replaces it directly.
+ */
+void clockCorrectionEngineSeed(clockCorrectionStorage_t* storage, const uint32_t clockCorrection) {
+  storage->clockCorrection = (double)clockCorrection / CLOCK_CORRECTION_FIXED_ONE;
+  storage->clockCorrectionFixed = clockCorrection;
+  storage->clockCorrectionBucket = 0;
+}
+
 #ifdef CLOCK_CORRECTION_ENABLE_LOGGING
 LOG_GROUP_START(CkCorrection)
 LOG_ADD(LOG_FLOAT, minNoise, &logMinAcceptedNoiseLimit)
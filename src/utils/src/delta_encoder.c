@@ -0,0 +1,129 @@
+/**
+ * ,---------,       ____  _ __
+ * |  ,-^-,  |      / __ )(_) /_______________ _____  ___
+ * | (  O  ) |     / __  / / __/ ___/ ___/ __ `/_  / / _ \
+ * | / ,--´  |    / /_/ / / /_/ /__/ /  / /_/ / / /_/  __/
+ *    +------`   /_____/_/\__/\___/_/   \__,_/ /___/\___/
+ *
+ * Crazyflie control firmware
+ *
+ * Copyright (C) 2023 Bitcraze AB
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, in version 3.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ *
+ *
+ *
+ * delta_encoder.c - Delta and zigzag varint encoding of fixed layout records
+ *
+ */
+
+#include <string.h>
+#include "delta_encoder.h"
+
+static uint32_t readField(const uint8_t* data, const uint8_t size) {
+    uint32_t value = 0;
+    memcpy(&value, data, size);
+    return value;
+}
+
+// Difference modulo the field size, sign extended from the field size
+static int32_t fieldDelta(const uint32_t current, const uint32_t previous, const uint8_t size) {
+    const uint8_t unusedBits = 32 - 8 * size;
+    return (int32_t)((current - previous) << unusedBits) >> unusedBits;
+}
+
+static uint16_t encodeKeyframe(deltaEncoder_t* encoder, const uint8_t tag, const uint64_t timestamp, const uint8_t* values, uint8_t* out) {
+    uint16_t size = 0;
+
+    out[size++] = tag | DELTA_ENCODER_KEYFRAME_FLAG;
+    memcpy(&out[size], &timestamp, sizeof(timestamp));
+    size += sizeof(timestamp);
+    memcpy(&out[size], values, encoder->numBytes);
+    size += encoder->numBytes;
+
+    return size;
+}
+
+static uint16_t encodeDelta(deltaEncoder_t* encoder, const uint8_t tag, const uint64_t timestamp, const uint8_t* values, uint8_t* out) {
+    uint16_t size = 0;
+
+    out[size++] = tag;
+    size += deltaEncoderWriteVarint(deltaEncoderZigzag((int64_t)(timestamp - encoder->previousTimestamp)), &out[size]);
+
+    uint16_t offset = 0;
+    for (int i = 0; i < encoder->numFields; i++) {
+        const uint8_t fieldSize = encoder->fieldSizes[i];
+        const uint32_t current = readField(&values[offset], fieldSize);
+        const uint32_t previous = readField(&encoder->previous[offset], fieldSize);
+
+        size += deltaEncoderWriteVarint(deltaEncoderZigzag(fieldDelta(current, previous, fieldSize)), &out[size]);
+        offset += fieldSize;
+    }
+
+    return size;
+}
+
+void deltaEncoderInit(deltaEncoder_t* encoder, const uint8_t* fieldSizes, const uint8_t numFields, uint8_t* previous, const uint16_t keyframeInterval) {
+    memset(encoder, 0, sizeof(deltaEncoder_t));
+
+    encoder->fieldSizes = fieldSizes;
+    encoder->numFields = numFields;
+    for (int i = 0; i < numFields; i++) {
+        encoder->numBytes += fieldSizes[i];
+    }
+
+    encoder->previous = previous;
+    encoder->keyframeInterval = keyframeInterval;
+    deltaEncoderReset(encoder);
+}
+
+void deltaEncoderReset(deltaEncoder_t* encoder) {
+    encoder->keyframeRequired = true;
+}
+
+uint16_t deltaEncoderMaxRecordSize(const deltaEncoder_t* encoder) {
+    const uint16_t keyframeSize = 1 + sizeof(uint64_t) + encoder->numBytes;
+    const uint16_t deltaSize = 1 + DELTA_ENCODER_MAX_VARINT64_SIZE + DELTA_ENCODER_MAX_VARINT32_SIZE * encoder->numFields;
+
+    return keyframeSize > deltaSize ? keyframeSize : deltaSize;
+}
+
+uint16_t deltaEncoderEncode(deltaEncoder_t* encoder, const uint8_t tag, const uint64_t timestamp, const uint8_t* values, uint8_t* out) {
+    uint16_t size;
+
+    if (encoder->keyframeRequired || encoder->sinceKeyframe >= encoder->keyframeInterval) {
+        size = encodeKeyframe(encoder, tag, timestamp, values, out);
+        encoder->keyframeRequired = false;
+        encoder->sinceKeyframe = 0;
+    } else {
+        size = encodeDelta(encoder, tag, timestamp, values, out);
+    }
+
+    encoder->sinceKeyframe++;
+    encoder->previousTimestamp = timestamp;
+    memcpy(encoder->previous, values, encoder->numBytes);
+
+    return size;
+}
+
+uint8_t deltaEncoderWriteVarint(uint64_t value, uint8_t* out) {
+    uint8_t size = 0;
+
+    while (value >= 0x80) {
+        out[size++] = (value & 0x7f) | 0x80;
+        value >>= 7;
+    }
+    out[size++] = value;
+
+    return size;
+}
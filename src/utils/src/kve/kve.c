@@ -1,6 +1,7 @@
 
 #include "kve/kve.h"
 #include "kve/kve_storage.h"
+#include "kve/kve_index.h"
 
 #include "debug.h"
 
@@ -15,6 +16,9 @@
 // Current version of the KVE table is 1
 #define KVE_VERSION (1)
 
+// Version byte while an incremental defrag step has an item at two places
+#define KVE_VERSION_MOVE_PENDING (KVE_VERSION | 0x80)
+
 static size_t min(size_t a, size_t b)
 {
     if (a < b) {
@@ -24,7 +28,15 @@ static size_t min(size_t a, size_t b)
     }
 }
 
-// Utility function
+// Utility functions
+static size_t findItemByKey(kveMemory_t *kve, const char* key) {
+    if (kveIndexIsValid(kve)) {
+        return kveIndexFind(kve, key);
+    }
+
+    return kveStorageFindItemByKey(kve, FIRST_ITEM_ADDRESS, key);
+}
+
 static bool appendItemToEnd(kveMemory_t *kve, size_t address, const char* key, const void* buffer, size_t length) {
     size_t itemAddress = kveStorageFindEnd(kve, address);
 
@@ -37,6 +49,7 @@ static bool appendItemToEnd(kveMemory_t *kve, size_t address, const char* key, c
 
     // Test that there is enough space to write the item
     if ((itemAddress + sizeof(kveItemHeader_t) + strlen(key) + length + KVE_END_TAG_LENDTH) < kve->memorySize) {
+        kveIndexAdd(kve, key, itemAddress);
         itemAddress += kveStorageWriteItem(kve, itemAddress, key, buffer, length);
         kveStorageWriteEnd(kve, itemAddress);
     } else {
@@ -46,6 +59,7 @@ static bool appendItemToEnd(kveMemory_t *kve, size_t address, const char* key, c
         itemAddress = kveStorageFindEnd(kve, FIRST_ITEM_ADDRESS);
 
         if ((itemAddress + sizeof(kveItemHeader_t) + strlen(key) + length + KVE_END_TAG_LENDTH) < kve->memorySize) {
+            kveIndexAdd(kve, key, itemAddress);
             itemAddress += kveStorageWriteItem(kve, itemAddress, key, buffer, length);
             kveStorageWriteEnd(kve, itemAddress);
         } else {
@@ -58,6 +72,66 @@ static bool appendItemToEnd(kveMemory_t *kve, size_t address, const char* key, c
     return true;
 }
 
+static void setMovePending(kveMemory_t *kve, bool pending) {
+    uint8_t version = pending ? KVE_VERSION_MOVE_PENDING : KVE_VERSION;
+    kve->write(VERSION_ADDRESS, &version, 1);
+    kve->flush();
+}
+
+// Copy the key and data of an item. The header is written by commitItem()
+// once the rest is in place, so that a reset never exposes a partial item.
+static void copyItem(kveMemory_t *kve, size_t source, size_t destination, kveItemHeader_t header) {
+    kveStorageMoveMemory(kve, source + sizeof(header), destination + sizeof(header), header.full_length - sizeof(header));
+}
+
+static void commitItem(kveMemory_t *kve, size_t destination, kveItemHeader_t header) {
+    kve->write(destination, &header, sizeof(header));
+    kve->flush();
+}
+
+// A reset while an item was moved by kveDefragStep() can leave the item
+// twice in the table: either right after its copy or as the last item of the
+// table. Both copies hold the same data, remove one of them.
+static void completeInterruptedMove(kveMemory_t *kve) {
+    static char key[256];
+    static char previousKey[256];
+    size_t address = FIRST_ITEM_ADDRESS;
+    size_t previousEnd = KVE_STORAGE_INVALID_ADDRESS;
+    size_t lastItemAddress = KVE_STORAGE_INVALID_ADDRESS;
+
+    while (address < (kve->memorySize - 2)) {
+        kveItemHeader_t header = kveStorageGetItemInfo(kve, address);
+
+        if (header.full_length == KVE_END_TAG) {
+            break;
+        }
+
+        if (header.key_length != 0) {
+            size_t keyLength = kveStorageGetKey(kve, address, header, key, sizeof(key) - 1);
+            key[keyLength] = 0;
+
+            if (address == previousEnd && strcmp(key, previousKey) == 0) {
+                kveStorageWriteHole(kve, address, header.full_length);
+                return;
+            }
+
+            memcpy(previousKey, key, keyLength + 1);
+            previousEnd = address + header.full_length;
+            lastItemAddress = address;
+        }
+
+        address += header.full_length;
+    }
+
+    if (KVE_STORAGE_IS_VALID(lastItemAddress)) {
+        size_t firstAddress = kveStorageFindItemByKey(kve, FIRST_ITEM_ADDRESS, previousKey);
+        if (firstAddress != lastItemAddress) {
+            kveItemHeader_t header = kveStorageGetItemInfo(kve, firstAddress);
+            kveStorageWriteHole(kve, firstAddress, header.full_length);
+        }
+    }
+}
+
 // Public API
 
 void kveDefrag(kveMemory_t *kve) {
@@ -84,6 +158,7 @@ void kveDefrag(kveMemory_t *kve) {
         size_t lenghtToMove = nextHoleAddress - itemAddress;
 
         kveStorageMoveMemory(kve, itemAddress, holeAddress, lenghtToMove);
+        kveIndexMove(kve, itemAddress, holeAddress, lenghtToMove);
 
         kveStorageWriteHole(kve, holeAddress + lenghtToMove, itemAddress - holeAddress);
 
@@ -91,11 +166,113 @@ void kveDefrag(kveMemory_t *kve) {
     }
 }
 
+//
+// The incremental defrag moves one item at a time into the first hole of the
+// table. The table is valid between every write, so that the defrag can be
+// interrupted by a reset at any time:
+//
+//  - If the hole is at least 3 bytes larger than the item, the item is copied
+//    into the hole, followed by a new hole header that covers the old item.
+//    The header of the item is written last and makes the move visible.
+//  - If the hole has exactly the size of the item, the item is copied into
+//    the hole and the old item is then replaced by a hole.
+//  - Otherwise the item is moved to the end of the table, which makes the
+//    hole grow so that the next items fit. If there is no room at the end,
+//    the step stops. A store that does not fit defragments the table.
+//
+// In the two last cases the item is present twice in the table between the
+// writes. This is flagged in the version byte and cleaned up by kveCheck().
+//
+bool kveDefragStep(kveMemory_t *kve, size_t maxBytes) {
+    size_t movedBytes = 0;
+    size_t holeAddress = kveStorageFindHole(kve, FIRST_ITEM_ADDRESS);
+
+    while (KVE_STORAGE_IS_VALID(holeAddress)) {
+        kveItemHeader_t hole = kveStorageGetItemInfo(kve, holeAddress);
+        if (hole.full_length == KVE_END_TAG) {
+            break;
+        }
+
+        // Merge the following holes
+        size_t itemAddress = holeAddress;
+        kveItemHeader_t item = hole;
+        while (item.full_length != KVE_END_TAG && item.key_length == 0) {
+            if (item.full_length < sizeof(kveItemHeader_t) || (itemAddress + item.full_length) >= (kve->memorySize - 2)) {
+                // This is a corrupted table!
+                return true;
+            }
+            itemAddress += item.full_length;
+            item = kveStorageGetItemInfo(kve, itemAddress);
+        }
+
+        size_t holeLength = itemAddress - holeAddress;
+        if (holeLength != hole.full_length) {
+            kveStorageWriteHole(kve, holeAddress, holeLength);
+        }
+
+        if (item.full_length == KVE_END_TAG) {
+            // This hole is at the end, lets crop it
+            kveStorageWriteEnd(kve, holeAddress);
+            break;
+        }
+
+        if (movedBytes > 0 && (movedBytes + item.full_length) > maxBytes) {
+            return false;
+        }
+
+        if (holeLength >= (size_t)item.full_length + sizeof(kveItemHeader_t)) {
+            copyItem(kve, itemAddress, holeAddress, item);
+            kveStorageWriteHole(kve, holeAddress + item.full_length, holeLength);
+            commitItem(kve, holeAddress, item);
+
+            kveIndexMove(kve, itemAddress, holeAddress, item.full_length);
+            holeAddress += item.full_length;
+        } else if (holeLength == item.full_length) {
+            setMovePending(kve, true);
+            copyItem(kve, itemAddress, holeAddress, item);
+            commitItem(kve, holeAddress, item);
+            kveStorageWriteHole(kve, itemAddress, item.full_length);
+            setMovePending(kve, false);
+
+            kveIndexMove(kve, itemAddress, holeAddress, item.full_length);
+            holeAddress = itemAddress;
+        } else {
+            size_t endAddress = kveStorageFindEnd(kve, itemAddress);
+            if (!KVE_STORAGE_IS_VALID(endAddress) ||
+                (endAddress + item.full_length + KVE_END_TAG_LENDTH) >= kve->memorySize) {
+                // No room to move the item, nothing more can be done now
+                break;
+            }
+
+            setMovePending(kve, true);
+            copyItem(kve, itemAddress, endAddress, item);
+            kveStorageWriteEnd(kve, endAddress + item.full_length);
+            commitItem(kve, endAddress, item);
+            kveStorageWriteHole(kve, itemAddress, item.full_length);
+            setMovePending(kve, false);
+
+            kveIndexMove(kve, itemAddress, endAddress, item.full_length);
+        }
+
+        movedBytes += item.full_length;
+    }
+
+    return true;
+}
+
 bool kveStore(kveMemory_t *kve, const char* key, const void* buffer, size_t length) {
+    return kveStoreReportHole(kve, key, buffer, length, NULL);
+}
+
+bool kveStoreReportHole(kveMemory_t *kve, const char* key, const void* buffer, size_t length, bool *leftHole) {
     size_t itemAddress;
 
+    if (leftHole) {
+        *leftHole = false;
+    }
+
     // Search if the key is already present in the table
-    itemAddress = kveStorageFindItemByKey(kve, FIRST_ITEM_ADDRESS, key);
+    itemAddress = findItemByKey(kve, key);
     if (KVE_STORAGE_IS_VALID(itemAddress) == false) {
         // Item does not exit, find the end of the table to insert it
         return appendItemToEnd(kve, FIRST_ITEM_ADDRESS, key, buffer, length);
@@ -106,6 +283,10 @@ bool kveStore(kveMemory_t *kve, const char* key, const void* buffer, size_t leng
         if (currentItem.full_length != newLength) {
             // If not, delete the item and find the end of the table
             kveStorageWriteHole(kve, itemAddress, currentItem.full_length);
+            kveIndexRemove(kve, key, itemAddress);
+            if (leftHole) {
+                *leftHole = true;
+            }
             return appendItemToEnd(kve, FIRST_ITEM_ADDRESS, key, buffer, length);
         } else {
             kveStorageWriteItem(kve, itemAddress, key, buffer, length);
@@ -157,7 +338,7 @@ bool kveForeach(kveMemory_t *kve, const char *prefix, kveFunc_t func)
 
 size_t kveFetch(kveMemory_t *kve, const char* key, void* buffer, size_t bufferLength)
 {
-    size_t itemAddress = kveStorageFindItemByKey(kve, FIRST_ITEM_ADDRESS, key);
+    size_t itemAddress = findItemByKey(kve, key);
 
     if (KVE_STORAGE_IS_VALID(itemAddress)) {
         kveItemHeader_t header = kveStorageGetItemInfo(kve, itemAddress);
@@ -169,11 +350,12 @@ size_t kveFetch(kveMemory_t *kve, const char* key, void* buffer, size_t bufferLe
 }
 
 bool kveDelete(kveMemory_t *kve, const char* key) {
-    size_t itemAddress = kveStorageFindItemByKey(kve, FIRST_ITEM_ADDRESS, key);
+    size_t itemAddress = findItemByKey(kve, key);
 
     if (KVE_STORAGE_IS_VALID(itemAddress)) {
         kveItemHeader_t itemInfo = kveStorageGetItemInfo(kve, itemAddress);
         kveStorageWriteHole(kve, itemAddress, itemInfo.full_length);
+        kveIndexRemove(kve, key, itemAddress);
         return true;
     }
 
@@ -184,6 +366,7 @@ void kveFormat(kveMemory_t *kve) {
     uint8_t version = KVE_VERSION;
     kve->write(VERSION_ADDRESS, &version, 1);
     kveStorageWriteEnd(kve, FIRST_ITEM_ADDRESS);
+    kveIndexClear(kve);
 }
 
 bool kveCheck(kveMemory_t *kve) {
@@ -191,7 +374,8 @@ bool kveCheck(kveMemory_t *kve) {
     // Check version
     uint8_t version;
     kve->read(VERSION_ADDRESS, &version, 1);
-    if (version != KVE_VERSION) {
+    if (version != KVE_VERSION && version != KVE_VERSION_MOVE_PENDING) {
+        kveIndexInvalidate(kve);
         return false;
     }
 
@@ -200,9 +384,21 @@ bool kveCheck(kveMemory_t *kve) {
 
     // If it is not possible to get to the end tag, the table is corupted
     if (!KVE_STORAGE_IS_VALID(endAddress)) {
+        kveIndexInvalidate(kve);
         return false;
     }
 
+    if (version == KVE_VERSION_MOVE_PENDING) {
+        completeInterruptedMove(kve);
+        setMovePending(kve, false);
+    }
+
+    // The table is sane, index it to speed up the lookups. If the index is
+    // too small the lookups fall back to scanning the memory.
+    if (kve->index) {
+        kveIndexBuild(kve, FIRST_ITEM_ADDRESS);
+    }
+
     return true;
 }
 
@@ -213,6 +409,7 @@ void kveGetStats(kveMemory_t *kve, kveStats_t *stats) {
 
     size_t total_size = 0;
     size_t total_items = 0;
+    size_t hole_count = 0;
     size_t hole_size = 0;
     size_t item_size = 0;
     size_t data_size = 0;
@@ -229,6 +426,7 @@ void kveGetStats(kveMemory_t *kve, kveStats_t *stats) {
         total_size += itemInfo.full_length;
 
         if (itemInfo.key_length == 0) {
+            hole_count++;
             hole_size += itemInfo.full_length;
         } else {
             item_size += itemInfo.full_length;
@@ -248,6 +446,7 @@ void kveGetStats(kveMemory_t *kve, kveStats_t *stats) {
     stats->keySize = key_size;
     stats->dataSize = data_size;
     stats->metadataSize = metadata_size;
+    stats->holeCount = hole_count;
     stats->holeSize = hole_size;
     stats->freeSpace = kve->memorySize - item_size;
     stats->fragmentation = (hole_size * 100) / (kve->memorySize - item_size);
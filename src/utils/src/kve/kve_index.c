@@ -0,0 +1,263 @@
+/**
+ * ,---------,       ____  _ __
+ * |  ,-^-,  |      / __ )(_) /_______________ _____  ___
+ * | (  O  ) |     / __  / / __/ ___/ ___/ __ `/_  / / _ \
+ * | / ,--´  |    / /_/ / / /_/ /__/ /  / /_/ / / /_/  __/
+ *    +------`   /_____/_/\__/\___/_/   \__,_/ /___/\___/
+ *
+ * Crazyflie control firmware
+ *
+ * Copyright (C) 2023 Bitcraze AB
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, in version 3.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ *
+ *
+ * kve_index.c - RAM index of key hash to item address
+ *
+ */
+
+#include "kve/kve_index.h"
+#include "kve/kve_storage.h"
+
+#include <stdint.h>
+#include <string.h>
+
+// Address 0 holds the table version, no item can ever start there
+#define EMPTY_ADDRESS (0)
+
+// Keep some free slots so that probing stays short and always terminates
+#define MAX_USED(size) ((size) - ((size) / 8) - 1)
+
+static uint16_t hashKey(const char *key)
+{
+    // FNV-1a, folded to 16 bits
+    uint32_t hash = 2166136261u;
+    while (*key) {
+        hash ^= (uint8_t)*key++;
+        hash *= 16777619u;
+    }
+
+    return (hash >> 16) ^ (hash & 0xffff);
+}
+
+static uint16_t homeSlot(const kveIndex_t *index, uint16_t hash)
+{
+    return hash % index->size;
+}
+
+static uint16_t nextSlot(const kveIndex_t *index, uint16_t slot)
+{
+    slot++;
+    if (slot == index->size) {
+        slot = 0;
+    }
+    return slot;
+}
+
+#define MAX_KEY_LENGTH UINT8_MAX
+
+static bool keyMatches(kveMemory_t *kve, size_t address, const char *key)
+{
+    uint8_t headerAndKey[sizeof(kveItemHeader_t) + MAX_KEY_LENGTH];
+    size_t keyLength = strlen(key);
+
+    // The key length is stored in 8 bits, no stored key can be longer
+    if (keyLength > MAX_KEY_LENGTH) {
+        return false;
+    }
+
+    if ((address + sizeof(kveItemHeader_t) + keyLength) > kve->memorySize) {
+        return false;
+    }
+
+    // Header and key are fetched in a single memory access
+    kve->read(address, headerAndKey, sizeof(kveItemHeader_t) + keyLength);
+
+    kveItemHeader_t header;
+    memcpy(&header, headerAndKey, sizeof(header));
+
+    return (header.key_length == keyLength) &&
+           (memcmp(&headerAndKey[sizeof(header)], key, keyLength) == 0);
+}
+
+static bool insert(kveIndex_t *index, uint16_t hash, size_t address)
+{
+    if (index->used >= MAX_USED(index->size) || address > UINT16_MAX) {
+        return false;
+    }
+
+    uint16_t slot = homeSlot(index, hash);
+    while (index->entries[slot].address != EMPTY_ADDRESS) {
+        slot = nextSlot(index, slot);
+    }
+
+    index->entries[slot].hash = hash;
+    index->entries[slot].address = address;
+    index->used++;
+
+    return true;
+}
+
+// Backward shift deletion, keeps the probe sequences intact without tombstones
+static void removeSlot(kveIndex_t *index, uint16_t slot)
+{
+    uint16_t hole = slot;
+    uint16_t current = nextSlot(index, slot);
+
+    while (index->entries[current].address != EMPTY_ADDRESS) {
+        uint16_t home = homeSlot(index, index->entries[current].hash);
+
+        // Distance from the home slot of the entry to where it is now, and to
+        // the hole. If the hole is on the probe path, the entry can move up.
+        uint16_t distanceToCurrent = (current + index->size - home) % index->size;
+        uint16_t distanceToHole = (hole + index->size - home) % index->size;
+        if (distanceToHole < distanceToCurrent) {
+            index->entries[hole] = index->entries[current];
+            hole = current;
+        }
+
+        current = nextSlot(index, current);
+    }
+
+    index->entries[hole].address = EMPTY_ADDRESS;
+    index->used--;
+}
+
+// Public API
+
+bool kveIndexIsValid(const kveMemory_t *kve)
+{
+    return (kve->index != NULL) && kve->index->valid;
+}
+
+void kveIndexInvalidate(kveMemory_t *kve)
+{
+    if (kve->index) {
+        kve->index->valid = false;
+    }
+}
+
+void kveIndexClear(kveMemory_t *kve)
+{
+    kveIndex_t *index = kve->index;
+
+    if (index == NULL || index->size == 0) {
+        return;
+    }
+
+    memset(index->entries, 0, index->size * sizeof(kveIndexEntry_t));
+    index->used = 0;
+    index->valid = true;
+}
+
+bool kveIndexBuild(kveMemory_t *kve, size_t firstItemAddress)
+{
+    static char keyBuffer[256];
+    size_t currentAddress = firstItemAddress;
+
+    if (kve->index == NULL) {
+        return false;
+    }
+
+    kveIndexClear(kve);
+
+    while (currentAddress < (kve->memorySize - 2)) {
+        kveItemHeader_t header = kveStorageGetItemInfo(kve, currentAddress);
+
+        if (header.full_length == KVE_END_TAG) {
+            return kve->index->valid;
+        }
+
+        if (header.full_length < (sizeof(header) + 1)) {
+            break;
+        }
+
+        if (header.key_length != 0) {
+            size_t keyLength = kveStorageGetKey(kve, currentAddress, header, keyBuffer, sizeof(keyBuffer) - 1);
+            keyBuffer[keyLength] = 0;
+
+            if (!insert(kve->index, hashKey(keyBuffer), currentAddress)) {
+                break;
+            }
+        }
+
+        currentAddress += header.full_length;
+    }
+
+    // Corrupted table or too many items
+    kveIndexInvalidate(kve);
+    return false;
+}
+
+size_t kveIndexFind(kveMemory_t *kve, const char *key)
+{
+    kveIndex_t *index = kve->index;
+    uint16_t hash = hashKey(key);
+    uint16_t slot = homeSlot(index, hash);
+
+    while (index->entries[slot].address != EMPTY_ADDRESS) {
+        if (index->entries[slot].hash == hash && keyMatches(kve, index->entries[slot].address, key)) {
+            return index->entries[slot].address;
+        }
+        slot = nextSlot(index, slot);
+    }
+
+    return KVE_STORAGE_INVALID_ADDRESS;
+}
+
+void kveIndexAdd(kveMemory_t *kve, const char *key, size_t address)
+{
+    if (!kveIndexIsValid(kve)) {
+        return;
+    }
+
+    if (!insert(kve->index, hashKey(key), address)) {
+        // An incomplete index would report existing items as missing
+        kveIndexInvalidate(kve);
+    }
+}
+
+void kveIndexRemove(kveMemory_t *kve, const char *key, size_t address)
+{
+    if (!kveIndexIsValid(kve)) {
+        return;
+    }
+
+    kveIndex_t *index = kve->index;
+    uint16_t hash = hashKey(key);
+    uint16_t slot = homeSlot(index, hash);
+
+    while (index->entries[slot].address != EMPTY_ADDRESS) {
+        if (index->entries[slot].address == address) {
+            removeSlot(index, slot);
+            return;
+        }
+        slot = nextSlot(index, slot);
+    }
+}
+
+void kveIndexMove(kveMemory_t *kve, size_t sourceAddress, size_t destinationAddress, size_t length)
+{
+    if (!kveIndexIsValid(kve)) {
+        return;
+    }
+
+    // Moving items does not change their keys, only the addresses are updated
+    kveIndex_t *index = kve->index;
+    for (int i = 0; i < index->size; i++) {
+        size_t address = index->entries[i].address;
+        if (address != EMPTY_ADDRESS && address >= sourceAddress && address < (sourceAddress + length)) {
+            index->entries[i].address = address - sourceAddress + destinationAddress;
+        }
+    }
+}
@@ -148,3 +148,11 @@ float lighthouseCalibrationMeasurementModelLh2(const float x, const float y, con
 
   return base - (calib->phase + compGib);
 }
+
+void lighthouseCalibrationPrecalcLh2(const lighthouseCalibrationSweep_t* calib, const float t, lighthouseCalibrationSweepLh2Precalc_t* precalc) {
+  precalc->tanT = tanf(t);
+  precalc->tanTiltedPlane = tanf(t - calib->tilt);
+  precalc->phase = calib->phase;
+  precalc->gibmag = calib->gibmag;
+  precalc->gibphase = calib->gibphase;
+}
@@ -53,6 +53,15 @@ static const uint32_t CYCLE_PERIODS[V2_N_CHANNELS] = {
     907000 / 2, 901000 / 2, 893000 / 2, 887000 / 2
 };
 
+// Rotor angle per tick, 2 * pi / cycle period
+#define RADIANS_PER_TICK(cyclePeriod) (2.0f * M_PI_F / (cyclePeriod))
+static const float RADIANS_PER_TICK_OF_CHANNEL[V2_N_CHANNELS] = {
+    RADIANS_PER_TICK(959000 / 2), RADIANS_PER_TICK(957000 / 2), RADIANS_PER_TICK(953000 / 2), RADIANS_PER_TICK(949000 / 2),
+    RADIANS_PER_TICK(947000 / 2), RADIANS_PER_TICK(943000 / 2), RADIANS_PER_TICK(941000 / 2), RADIANS_PER_TICK(939000 / 2),
+    RADIANS_PER_TICK(937000 / 2), RADIANS_PER_TICK(929000 / 2), RADIANS_PER_TICK(919000 / 2), RADIANS_PER_TICK(911000 / 2),
+    RADIANS_PER_TICK(907000 / 2), RADIANS_PER_TICK(901000 / 2), RADIANS_PER_TICK(893000 / 2), RADIANS_PER_TICK(887000 / 2)
+};
+
 static inline uint32_t cyclePeriodToMicroseconds(uint32_t cyclePeriod) {
     return cyclePeriod / 24;
 }
@@ -250,10 +259,10 @@ static void calculateAngles(const pulseProcessorV2SweepBlock_t* latestBlock, con
     for (int i = 0; i < PULSE_PROCESSOR_N_SENSORS; i++) {
         uint32_t firstOffset = previousBlock->offset[i];
         uint32_t secondOffset = latestBlock->offset[i];
-        uint32_t period = CYCLE_PERIODS[channel];
+        const float radiansPerTick = RADIANS_PER_TICK_OF_CHANNEL[channel];
 
-        float firstBeam = (firstOffset * 2 * M_PI_F / period) - M_PI_F + M_PI_F / 3.0f;
-        float secondBeam = (secondOffset * 2 * M_PI_F / period) - M_PI_F - M_PI_F / 3.0f;
+        float firstBeam = (firstOffset * radiansPerTick) - M_PI_F + M_PI_F / 3.0f;
+        float secondBeam = (secondOffset * radiansPerTick) - M_PI_F - M_PI_F / 3.0f;
 
         pulseProcessorSensorMeasurement_t* measurement = &angles->baseStationMeasurementsLh2[channel].sensorMeasurements[i];
         measurement->angles[0] = firstBeam;
@@ -298,9 +307,14 @@ TESTABLE_STATIC bool handleCalibrationData(pulseProcessor_t *state, const pulseP
 bool handleAngles(pulseProcessor_t *state, const pulseProcessorFrame_t* frameData, pulseProcessorResult_t* angles, int *baseStation, int *axis) {
     bool anglesMeasured = false;
 
-    clearStaleAnglesAfterTimeout(angles);
-
     int nrOfBlocks = processFrame(frameData, &state->v2.pulseWorkspace, &state->v2.blockWorkspace);
+
+    // The angles are only used when new angles are measured, stale angles only have to be cleared
+    // when a workspace is completed, not for every frame
+    if (nrOfBlocks > 0) {
+        clearStaleAnglesAfterTimeout(angles);
+    }
+
     for (int i = 0; i < nrOfBlocks; i++) {
         const pulseProcessorV2SweepBlock_t* block = &state->v2.blockWorkspace.blocks[i];
         const uint8_t channel = block->channel;
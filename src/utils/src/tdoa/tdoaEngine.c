@@ -54,26 +54,24 @@ The implementation must handle
 #include "physicalConstants.h"
 
 void tdoaEngineInit(tdoaEngineState_t* engineState, const uint32_t now_ms, tdoaEngineSendTdoaToEstimator sendTdoaToEstimator, const double locodeckTsFreq, const tdoaEngineMatchingAlgorithm_t matchingAlgorithm) {
-  tdoaStorageInitialize(engineState->anchorInfoArray);
+  tdoaStorageInitialize(&engineState->anchorStorage);
   tdoaStatsInit(&engineState->stats, now_ms);
   engineState->sendTdoaToEstimator = sendTdoaToEstimator;
   engineState->locodeckTsFreq = locodeckTsFreq;
+  engineState->metersPerTick = SPEED_OF_LIGHT / locodeckTsFreq;
   engineState->matchingAlgorithm = matchingAlgorithm;
+  engineState->pairsPerPacket = TDOA_ENGINE_MAX_PAIRS_PER_PACKET;
 
   engineState->matching.offset = 0;
 }
 
-static void enqueueTDOA(const tdoaAnchorContext_t* anchorACtx, const tdoaAnchorContext_t* anchorBCtx, double distanceDiff, tdoaEngineState_t* engineState) {
+static bool createTDOA(const tdoaAnchorContext_t* anchorACtx, const tdoaAnchorContext_t* anchorBCtx, const float distanceDiff, tdoaEngineState_t* engineState, tdoaMeasurement_t* tdoa) {
   tdoaStats_t* stats = &engineState->stats;
 
-  tdoaMeasurement_t tdoa = {
-    .stdDev = TDOA_ENGINE_MEASUREMENT_NOISE_STD,
-    .distanceDiff = distanceDiff
-  };
-
-  if (tdoaStorageGetAnchorPosition(anchorACtx, &tdoa.anchorPositions[0]) && tdoaStorageGetAnchorPosition(anchorBCtx, &tdoa.anchorPositions[1])) {
-    STATS_CNT_RATE_EVENT(&stats->packetsToEstimator);
+  tdoa->stdDev = TDOA_ENGINE_MEASUREMENT_NOISE_STD;
+  tdoa->distanceDiff = distanceDiff;
 
+  if (tdoaStorageGetAnchorPosition(anchorACtx, &tdoa->anchorPositions[0]) && tdoaStorageGetAnchorPosition(anchorBCtx, &tdoa->anchorPositions[1])) {
     uint8_t idA = tdoaStorageGetId(anchorACtx);
     uint8_t idB = tdoaStorageGetId(anchorBCtx);
     if (idA == stats->anchorId && idB == stats->remoteAnchorId) {
@@ -82,10 +80,21 @@ static void enqueueTDOA(const tdoaAnchorContext_t* anchorACtx, const tdoaAnchorC
     if (idB == stats->anchorId && idA == stats->remoteAnchorId) {
       stats->tdoa = -distanceDiff;
     }
-    tdoa.anchorIds[0] = idA;
-    tdoa.anchorIds[1] = idB;
+    tdoa->anchorIds[0] = idA;
+    tdoa->anchorIds[1] = idB;
 
-    engineState->sendTdoaToEstimator(&tdoa);
+    return true;
+  }
+
+  return false;
+}
+
+// The measurements from one packet are enqueued one after the other. Each is
+// a separate measurement for the estimator.
+static void enqueueTDOAs(tdoaMeasurement_t tdoas[], const int count, tdoaEngineState_t* engineState) {
+  for (int i = 0; i < count; i++) {
+    STATS_CNT_RATE_EVENT(&engineState->stats.packetsToEstimator);
+    engineState->sendTdoaToEstimator(&tdoas[i]);
   }
 }
 
@@ -96,8 +105,13 @@ static bool updateClockCorrection(tdoaAnchorContext_t* anchorCtx, const int64_t
   const int64_t latest_txAn_in_cl_An = tdoaStorageGetTxTime(anchorCtx);
 
   if (latest_rxAn_by_T_in_cl_T != 0 && latest_txAn_in_cl_An != 0) {
+    #ifdef CONFIG_DECK_LOCO_TDOA_FIXED_POINT
+    uint32_t clockCorrectionCandidate = clockCorrectionEngineCalculateFixed(rxAn_by_T_in_cl_T, latest_rxAn_by_T_in_cl_T, txAn_in_cl_An, latest_txAn_in_cl_An, TDOA_ENGINE_TRUNCATE_TO_ANCHOR_TS_BITMAP);
+    sampleIsReliable = clockCorrectionEngineUpdateFixed(tdoaStorageGetClockCorrectionStorage(anchorCtx), clockCorrectionCandidate);
+    #else
     double clockCorrectionCandidate = clockCorrectionEngineCalculate(rxAn_by_T_in_cl_T, latest_rxAn_by_T_in_cl_T, txAn_in_cl_An, latest_txAn_in_cl_An, TDOA_ENGINE_TRUNCATE_TO_ANCHOR_TS_BITMAP);
     sampleIsReliable = clockCorrectionEngineUpdate(tdoaStorageGetClockCorrectionStorage(anchorCtx), clockCorrectionCandidate);
+    #endif
 
     if (sampleIsReliable){
       if (tdoaStorageGetId(anchorCtx) == stats->anchorId) {
@@ -115,92 +129,92 @@ static int64_t calcTDoA(const tdoaAnchorContext_t* otherAnchorCtx, const tdoaAnc
 
   const int64_t tof_Ar_to_An_in_cl_An = tdoaStorageGetTimeOfFlight(anchorCtx, otherAnchorId);
   const int64_t rxAr_by_An_in_cl_An = tdoaStorageGetRemoteRxTime(anchorCtx, otherAnchorId);
-  const double clockCorrection = tdoaStorageGetClockCorrection(anchorCtx);
 
   const int64_t rxAr_by_T_in_cl_T = tdoaStorageGetRxTime(otherAnchorCtx);
 
   const int64_t delta_txAr_to_txAn_in_cl_An = (tof_Ar_to_An_in_cl_An + tdoaEngineTruncateToAnchorTimeStamp(txAn_in_cl_An - rxAr_by_An_in_cl_An));
-  const int64_t timeDiffOfArrival_in_cl_T =  tdoaEngineTruncateToAnchorTimeStamp(rxAn_by_T_in_cl_T - rxAr_by_T_in_cl_T) - delta_txAr_to_txAn_in_cl_An  * clockCorrection;
+  const int64_t delta_rxAr_to_rxAn_in_cl_T = tdoaEngineTruncateToAnchorTimeStamp(rxAn_by_T_in_cl_T - rxAr_by_T_in_cl_T);
 
-  return timeDiffOfArrival_in_cl_T;
+  #ifdef CONFIG_DECK_LOCO_TDOA_FIXED_POINT
+  const uint32_t clockCorrection = clockCorrectionEngineGetFixed(tdoaStorageGetClockCorrectionStorage(anchorCtx));
+  return tdoaEngineCalcTdoaFixed(delta_rxAr_to_rxAn_in_cl_T, delta_txAr_to_txAn_in_cl_An, clockCorrection);
+  #else
+  const double clockCorrection = tdoaStorageGetClockCorrection(anchorCtx);
+  return tdoaEngineCalcTdoa(delta_rxAr_to_rxAn_in_cl_T, delta_txAr_to_txAn_in_cl_An, clockCorrection);
+  #endif
 }
 
-static double calcDistanceDiff(const tdoaAnchorContext_t* otherAnchorCtx, const tdoaAnchorContext_t* anchorCtx, const int64_t txAn_in_cl_An, const int64_t rxAn_by_T_in_cl_T, const double locodeckTsFreq) {
+static float calcDistanceDiff(const tdoaAnchorContext_t* otherAnchorCtx, const tdoaAnchorContext_t* anchorCtx, const int64_t txAn_in_cl_An, const int64_t rxAn_by_T_in_cl_T, const tdoaEngineState_t* engineState) {
   const int64_t tdoa = calcTDoA(otherAnchorCtx, anchorCtx, txAn_in_cl_An, rxAn_by_T_in_cl_T);
-  return SPEED_OF_LIGHT * tdoa / locodeckTsFreq;
+
+  #ifdef CONFIG_DECK_LOCO_TDOA_FIXED_POINT
+  // The time difference is a few thousand ticks at most and is exact as a float
+  return tdoa * engineState->metersPerTick;
+  #else
+  return SPEED_OF_LIGHT * tdoa / engineState->locodeckTsFreq;
+  #endif
 }
 
-static bool matchRandomAnchor(tdoaEngineState_t* engineState, tdoaAnchorContext_t* otherAnchorCtx, const tdoaAnchorContext_t* anchorCtx, const bool doExcludeId, const uint8_t excludedId) {
-  engineState->matching.offset++;
-  int remoteCount = 0;
-  tdoaStorageGetRemoteSeqNrList(anchorCtx, &remoteCount, engineState->matching.seqNr, engineState->matching.id);
-
-  uint32_t now_ms = anchorCtx->currentTime_ms;
-
-  // Loop over the candidates and pick the first one that is useful
-  // An offset (updated for each call) is added to make sure we start at
-  // different positions in the list and vary which candidate to choose
-  for (int i = engineState->matching.offset; i < (remoteCount + engineState->matching.offset); i++) {
-    uint8_t index = i % remoteCount;
-    const uint8_t candidateAnchorId = engineState->matching.id[index];
-    if (!doExcludeId || (excludedId != candidateAnchorId)) {
-      if (tdoaStorageGetCreateAnchorCtx(engineState->anchorInfoArray, candidateAnchorId, now_ms, otherAnchorCtx)) {
-        if (engineState->matching.seqNr[index] == tdoaStorageGetSeqNr(otherAnchorCtx) && tdoaStorageGetTimeOfFlight(anchorCtx, candidateAnchorId)) {
-          return true;
-        }
-      }
-    }
+static bool isSuitableAnchor(tdoaEngineState_t* engineState, tdoaAnchorContext_t* otherAnchorCtx, const tdoaAnchorContext_t* anchorCtx, const uint8_t candidateAnchorId, const uint8_t candidateSeqNr, const bool doExcludeId, const uint8_t excludedId) {
+  if (doExcludeId && (excludedId == candidateAnchorId)) {
+    return false;
   }
 
-  otherAnchorCtx->anchorInfo = 0;
-  return false;
+  if (!tdoaStorageGetTimeOfFlight(anchorCtx, candidateAnchorId)) {
+    return false;
+  }
+
+  // Both the tag and the anchor must have received the same packet from the candidate
+  if (!tdoaStorageGetAnchorCtx(&engineState->anchorStorage, candidateAnchorId, anchorCtx->currentTime_ms, otherAnchorCtx)) {
+    return false;
+  }
+
+  return candidateSeqNr == tdoaStorageGetSeqNr(otherAnchorCtx);
 }
 
-static bool matchYoungestAnchor(tdoaEngineState_t* engineState, tdoaAnchorContext_t* otherAnchorCtx, const tdoaAnchorContext_t* anchorCtx, const bool doExcludeId, const uint8_t excludedId) {
-    int remoteCount = 0;
-    tdoaStorageGetRemoteSeqNrList(anchorCtx, &remoteCount, engineState->matching.seqNr, engineState->matching.id);
-
-    uint32_t now_ms = anchorCtx->currentTime_ms;
-    uint32_t youmgestUpdateTime = 0;
-    int bestId = -1;
-
-    for (int index = 0; index < remoteCount; index++) {
-      const uint8_t candidateAnchorId = engineState->matching.id[index];
-      if (!doExcludeId || (excludedId != candidateAnchorId)) {
-        if (tdoaStorageGetTimeOfFlight(anchorCtx, candidateAnchorId)) {
-          if (tdoaStorageGetCreateAnchorCtx(engineState->anchorInfoArray, candidateAnchorId, now_ms, otherAnchorCtx)) {
-            uint32_t updateTime = otherAnchorCtx->anchorInfo->lastUpdateTime;
-            if (updateTime > youmgestUpdateTime) {
-              if (engineState->matching.seqNr[index] == tdoaStorageGetSeqNr(otherAnchorCtx)) {
-                youmgestUpdateTime = updateTime;
-                bestId = candidateAnchorId;
-              }
-            }
-          }
-        }
-      }
-    }
+// Walk the remote data of the anchor in recency order, starting at startIndex and wrapping around.
+// The remote data is kept sorted by the storage, the first suitable candidates are usually found
+// without looking at the rest.
+static int matchAnchors(tdoaEngineState_t* engineState, tdoaAnchorContext_t otherAnchorCtx[], const tdoaAnchorContext_t* anchorCtx, const int startIndex, const bool doExcludeId, const uint8_t excludedId) {
+  int count = 0;
+
+  const int maxCount = engineState->pairsPerPacket < TDOA_ENGINE_MAX_PAIRS_PER_PACKET ? engineState->pairsPerPacket : TDOA_ENGINE_MAX_PAIRS_PER_PACKET;
+
+  for (int i = 0; i < REMOTE_ANCHOR_DATA_COUNT && count < maxCount; i++) {
+    const int recency = (startIndex + i) % REMOTE_ANCHOR_DATA_COUNT;
 
-    if (bestId >= 0) {
-      tdoaStorageGetCreateAnchorCtx(engineState->anchorInfoArray, bestId, now_ms, otherAnchorCtx);
-      return true;
+    uint8_t candidateAnchorId;
+    uint8_t candidateSeqNr;
+    if (tdoaStorageGetRemoteByRecency(anchorCtx, recency, &candidateAnchorId, &candidateSeqNr)) {
+      if (isSuitableAnchor(engineState, &otherAnchorCtx[count], anchorCtx, candidateAnchorId, candidateSeqNr, doExcludeId, excludedId)) {
+        count++;
+      }
     }
+  }
 
-    otherAnchorCtx->anchorInfo = 0;
-    return false;
+  return count;
 }
 
-static bool findSuitableAnchor(tdoaEngineState_t* engineState, tdoaAnchorContext_t* otherAnchorCtx, const tdoaAnchorContext_t* anchorCtx, const bool doExcludeId, const uint8_t excludedId) {
-  bool result = false;
+static int findSuitableAnchors(tdoaEngineState_t* engineState, tdoaAnchorContext_t otherAnchorCtx[], const tdoaAnchorContext_t* anchorCtx, const bool doExcludeId, const uint8_t excludedId) {
+  int count = 0;
+
+  #ifdef CONFIG_DECK_LOCO_TDOA_FIXED_POINT
+  const bool hasClockCorrection = clockCorrectionEngineGetFixed(tdoaStorageGetClockCorrectionStorage(anchorCtx)) > 0;
+  #else
+  const bool hasClockCorrection = tdoaStorageGetClockCorrection(anchorCtx) > 0.0;
+  #endif
 
-  if (tdoaStorageGetClockCorrection(anchorCtx) > 0.0) {
+  if (hasClockCorrection) {
     switch(engineState->matchingAlgorithm) {
       case TdoaEngineMatchingAlgorithmRandom:
-        result = matchRandomAnchor(engineState, otherAnchorCtx, anchorCtx, doExcludeId, excludedId);
+        // An offset (updated for each call) is used to start at different positions
+        // in the list and vary which candidates to choose
+        engineState->matching.offset++;
+        count = matchAnchors(engineState, otherAnchorCtx, anchorCtx, engineState->matching.offset, doExcludeId, excludedId);
         break;
 
       case TdoaEngineMatchingAlgorithmYoungest:
-        result = matchYoungestAnchor(engineState, otherAnchorCtx, anchorCtx, doExcludeId, excludedId);
+        count = matchAnchors(engineState, otherAnchorCtx, anchorCtx, 0, doExcludeId, excludedId);
         break;
 
       default:
@@ -209,11 +223,11 @@ static bool findSuitableAnchor(tdoaEngineState_t* engineState, tdoaAnchorContext
     }
   }
 
-  return result;
+  return count;
 }
 
 void tdoaEngineGetAnchorCtxForPacketProcessing(tdoaEngineState_t* engineState, const uint8_t anchorId, const uint32_t currentTime_ms, tdoaAnchorContext_t* anchorCtx) {
-  if (tdoaStorageGetCreateAnchorCtx(engineState->anchorInfoArray, anchorId, currentTime_ms, anchorCtx)) {
+  if (tdoaStorageGetCreateAnchorCtx(&engineState->anchorStorage, anchorId, currentTime_ms, anchorCtx)) {
     STATS_CNT_RATE_EVENT(&engineState->stats.contextHitCount);
   } else {
     STATS_CNT_RATE_EVENT(&engineState->stats.contextMissCount);
@@ -229,11 +243,21 @@ void tdoaEngineProcessPacketFiltered(tdoaEngineState_t* engineState, tdoaAnchorC
   if (timeIsGood) {
     STATS_CNT_RATE_EVENT(&engineState->stats.timeIsGood);
 
-    tdoaAnchorContext_t otherAnchorCtx;
-    if (findSuitableAnchor(engineState, &otherAnchorCtx, anchorCtx, doExcludeId, excludedId)) {
+    tdoaAnchorContext_t otherAnchorCtx[TDOA_ENGINE_MAX_PAIRS_PER_PACKET];
+    const int anchorCount = findSuitableAnchors(engineState, otherAnchorCtx, anchorCtx, doExcludeId, excludedId);
+    if (anchorCount > 0) {
       STATS_CNT_RATE_EVENT(&engineState->stats.suitableDataFound);
-      double tdoaDistDiff = calcDistanceDiff(&otherAnchorCtx, anchorCtx, txAn_in_cl_An, rxAn_by_T_in_cl_T, engineState->locodeckTsFreq);
-      enqueueTDOA(&otherAnchorCtx, anchorCtx, tdoaDistDiff, engineState);
+
+      tdoaMeasurement_t tdoas[TDOA_ENGINE_MAX_PAIRS_PER_PACKET];
+      int tdoaCount = 0;
+      for (int i = 0; i < anchorCount; i++) {
+        float tdoaDistDiff = calcDistanceDiff(&otherAnchorCtx[i], anchorCtx, txAn_in_cl_An, rxAn_by_T_in_cl_T, engineState);
+        if (createTDOA(&otherAnchorCtx[i], anchorCtx, tdoaDistDiff, engineState, &tdoas[tdoaCount])) {
+          tdoaCount++;
+        }
+      }
+
+      enqueueTDOAs(tdoas, tdoaCount, engineState);
     }
   }
 }
@@ -40,86 +40,77 @@ Data storage encapsulation for the TDoA engine
 #define REMOTE_DATA_VALIDITY_PERIOD 30
 #define ANCHOR_POSITION_VALIDITY_PERIOD (2 * 1000)
 #define ANCHOR_ACTIVE_VALIDITY_PERIOD (2 * 1000)
+// Data from a previous power cycle is used until it is replaced by live data, or expires
+#define RESTORED_DATA_VALIDITY_PERIOD (10 * 1000)
 
+// Max difference between a restored and a live anchor position, in meters
+#define RESTORED_POSITION_MAX_ERROR 0.1f
 
-static tdoaAnchorInfo_t* initializeSlot(tdoaAnchorInfo_t anchorStorage[], const uint8_t slot, const uint8_t anchor);
 
-void tdoaStorageInitialize(tdoaAnchorInfo_t anchorStorage[]) {
-  memset(anchorStorage, 0, sizeof(tdoaAnchorInfo_t) * ANCHOR_STORAGE_COUNT);
+static tdoaAnchorInfo_t* initializeSlot(tdoaAnchorStorage_t* anchorStorage, const uint8_t slot, const uint8_t anchor);
+static int findSlot(const tdoaAnchorStorage_t* anchorStorage, const uint8_t anchor);
+static int findOldestSlot(const tdoaAnchorStorage_t* anchorStorage, const uint32_t currentTime_ms);
+static int findId(const uint8_t ids[], const int count, const uint8_t id);
+static void updateRecency(tdoaRemoteAnchorData_t* remoteAnchorData, const int index, const uint32_t now);
+static bool isSamePosition(const point_t* position, const float x, const float y, const float z);
+
+void tdoaStorageInitialize(tdoaAnchorStorage_t* anchorStorage) {
+  memset(anchorStorage, 0, sizeof(tdoaAnchorStorage_t));
 }
 
-bool tdoaStorageGetCreateAnchorCtx(tdoaAnchorInfo_t anchorStorage[], const uint8_t anchor, const uint32_t currentTime_ms, tdoaAnchorContext_t* anchorCtx) {
+bool tdoaStorageGetCreateAnchorCtx(tdoaAnchorStorage_t* anchorStorage, const uint8_t anchor, const uint32_t currentTime_ms, tdoaAnchorContext_t* anchorCtx) {
   anchorCtx->currentTime_ms = currentTime_ms;
-  uint32_t oldestUpdateTime = currentTime_ms;
-  int firstUninitializedSlot = -1;
-  int oldestSlot = 0;
 
-  for (int i = 0; i < ANCHOR_STORAGE_COUNT; i++) {
-    if (anchorStorage[i].isInitialized) {
-      if (anchor == anchorStorage[i].id) {
-        anchorCtx->anchorInfo = &anchorStorage[i];
-        return true;
-      }
-
-      if (anchorStorage[i].lastUpdateTime < oldestUpdateTime) {
-        oldestUpdateTime = anchorStorage[i].lastUpdateTime;
-        oldestSlot = i;
-      }
-    } else {
-      if (firstUninitializedSlot == -1) {
-        firstUninitializedSlot = i;
-      }
-    }
+  const int slot = findSlot(anchorStorage, anchor);
+  if (slot >= 0) {
+    anchorCtx->anchorInfo = &anchorStorage->anchorInfo[slot];
+    return true;
   }
 
   // The anchor was not found in storage
   tdoaAnchorInfo_t* newAnchorInfo = 0;
-  if (firstUninitializedSlot != -1) {
-    newAnchorInfo = initializeSlot(anchorStorage, firstUninitializedSlot, anchor);
+  if (anchorStorage->anchorCount < ANCHOR_STORAGE_COUNT) {
+    newAnchorInfo = initializeSlot(anchorStorage, anchorStorage->anchorCount, anchor);
+    anchorStorage->anchorCount++;
   } else {
-    newAnchorInfo = initializeSlot(anchorStorage, oldestSlot, anchor);
+    newAnchorInfo = initializeSlot(anchorStorage, findOldestSlot(anchorStorage, currentTime_ms), anchor);
   }
 
   anchorCtx->anchorInfo = newAnchorInfo;
   return false;
 }
 
-bool tdoaStorageGetAnchorCtx(tdoaAnchorInfo_t anchorStorage[], const uint8_t anchor, const uint32_t currentTime_ms, tdoaAnchorContext_t* anchorCtx) {
+bool tdoaStorageGetAnchorCtx(tdoaAnchorStorage_t* anchorStorage, const uint8_t anchor, const uint32_t currentTime_ms, tdoaAnchorContext_t* anchorCtx) {
   anchorCtx->currentTime_ms = currentTime_ms;
 
-  for (int i = 0; i < ANCHOR_STORAGE_COUNT; i++) {
-    if (anchorStorage[i].isInitialized) {
-      if (anchor == anchorStorage[i].id) {
-        anchorCtx->anchorInfo = &anchorStorage[i];
-        return true;
-      }
-    }
+  const int slot = findSlot(anchorStorage, anchor);
+  if (slot >= 0) {
+    anchorCtx->anchorInfo = &anchorStorage->anchorInfo[slot];
+    return true;
   }
 
   anchorCtx->anchorInfo = 0;
   return false;
 }
 
-uint8_t tdoaStorageGetListOfAnchorIds(tdoaAnchorInfo_t anchorStorage[], uint8_t unorderedAnchorList[], const int maxListSize) {
+uint8_t tdoaStorageGetListOfAnchorIds(tdoaAnchorStorage_t* anchorStorage, uint8_t unorderedAnchorList[], const int maxListSize) {
   int count = 0;
 
-  for (int i = 0; i < ANCHOR_STORAGE_COUNT && count < maxListSize; i++) {
-    if (anchorStorage[i].isInitialized) {
-      unorderedAnchorList[count] = anchorStorage[i].id;
-      count++;
-    }
+  for (int i = 0; i < anchorStorage->anchorCount && count < maxListSize; i++) {
+    unorderedAnchorList[count] = anchorStorage->anchorInfo[i].id;
+    count++;
   }
 
   return count;
 }
 
-uint8_t tdoaStorageGetListOfActiveAnchorIds(tdoaAnchorInfo_t anchorStorage[], uint8_t unorderedAnchorList[], const int maxListSize, const uint32_t currentTime_ms) {
+uint8_t tdoaStorageGetListOfActiveAnchorIds(tdoaAnchorStorage_t* anchorStorage, uint8_t unorderedAnchorList[], const int maxListSize, const uint32_t currentTime_ms) {
   int count = 0;
 
   const uint32_t expiryTime = currentTime_ms - ANCHOR_ACTIVE_VALIDITY_PERIOD;
-  for (int i = 0; i < ANCHOR_STORAGE_COUNT && count < maxListSize; i++) {
-    if (anchorStorage[i].isInitialized && anchorStorage[i].lastUpdateTime > expiryTime) {
-      unorderedAnchorList[count] = anchorStorage[i].id;
+  for (int i = 0; i < anchorStorage->anchorCount && count < maxListSize; i++) {
+    if (anchorStorage->anchorInfo[i].lastUpdateTime > expiryTime) {
+      unorderedAnchorList[count] = anchorStorage->anchorInfo[i].id;
       count++;
     }
   }
@@ -154,8 +145,9 @@ clockCorrectionStorage_t* tdoaStorageGetClockCorrectionStorage(const tdoaAnchorC
 bool tdoaStorageGetAnchorPosition(const tdoaAnchorContext_t* anchorCtx, point_t* position) {
   uint32_t now = anchorCtx->currentTime_ms;
 
-  int32_t validCreationTime = now - ANCHOR_POSITION_VALIDITY_PERIOD;
   const tdoaAnchorInfo_t* anchorInfo = anchorCtx->anchorInfo;
+  const uint32_t validityPeriod = anchorInfo->isPositionRestored ? RESTORED_DATA_VALIDITY_PERIOD : ANCHOR_POSITION_VALIDITY_PERIOD;
+  int32_t validCreationTime = now - validityPeriod;
   if ((int32_t)anchorInfo->position.timestamp > validCreationTime) {
     position->timestamp = anchorInfo->position.timestamp;
     position->x = anchorInfo->position.x;
@@ -171,6 +163,15 @@ void tdoaStorageSetAnchorPosition(tdoaAnchorContext_t* anchorCtx, const float x,
   uint32_t now = anchorCtx->currentTime_ms;
   tdoaAnchorInfo_t* anchorInfo = anchorCtx->anchorInfo;
 
+  if (anchorInfo->isPositionRestored) {
+    // If the anchor has been moved since the data was stored, the restored
+    // time of flight data is probably wrong as well
+    if (!isSamePosition(&anchorInfo->position, x, y, z)) {
+      memset(&anchorInfo->tof, 0, sizeof(anchorInfo->tof));
+    }
+    anchorInfo->isPositionRestored = false;
+  }
+
   anchorInfo->position.timestamp = now;
   anchorInfo->position.x = x;
   anchorInfo->position.y = y;
@@ -188,7 +189,11 @@ void tdoaStorageSetRxTxData(tdoaAnchorContext_t* anchorCtx, int64_t rxTime, int6
 }
 
 double tdoaStorageGetClockCorrection(const tdoaAnchorContext_t* anchorCtx) {
+  #ifdef CONFIG_DECK_LOCO_TDOA_FIXED_POINT
+  return (double)clockCorrectionEngineGetFixed(&anchorCtx->anchorInfo->clockCorrectionStorage) / CLOCK_CORRECTION_FIXED_ONE;
+  #else
   return clockCorrectionEngineGet(&anchorCtx->anchorInfo->clockCorrectionStorage);
+  #endif
 }
 
 int64_t tdoaStorageGetRemoteRxTime(const tdoaAnchorContext_t* anchorCtx, const uint8_t remoteAnchor) {
@@ -204,18 +209,16 @@ int64_t tdoaStorageGetRemoteRxTime(const tdoaAnchorContext_t* anchorCtx, const u
 }
 
 bool tdoaStorageGetRemoteRxTimeSeqNr(const tdoaAnchorContext_t* anchorCtx, const uint8_t remoteAnchor, int64_t* rxTime, uint8_t* seqNr) {
-  const tdoaAnchorInfo_t* anchorInfo = anchorCtx->anchorInfo;
+  const tdoaRemoteAnchorData_t* remoteAnchorData = &anchorCtx->anchorInfo->remoteAnchorData;
   bool result = false;
 
-  for (int i = 0; i < REMOTE_ANCHOR_DATA_COUNT; i++) {
-    if (remoteAnchor == anchorInfo->remoteAnchorData[i].id) {
-      uint32_t now = anchorCtx->currentTime_ms;
-      if (anchorInfo->remoteAnchorData[i].endOfLife > now) {
-        *rxTime = anchorInfo->remoteAnchorData[i].rxTime;
-        *seqNr = anchorInfo->remoteAnchorData[i].seqNr;
-        result = true;
-      }
-      break;
+  const int i = findId(remoteAnchorData->id, REMOTE_ANCHOR_DATA_COUNT, remoteAnchor);
+  if (i >= 0) {
+    uint32_t now = anchorCtx->currentTime_ms;
+    if (remoteAnchorData->endOfLife[i] > now) {
+      *rxTime = remoteAnchorData->rxTime[i];
+      *seqNr = remoteAnchorData->seqNr[i];
+      result = true;
     }
   }
 
@@ -223,103 +226,240 @@ bool tdoaStorageGetRemoteRxTimeSeqNr(const tdoaAnchorContext_t* anchorCtx, const
 }
 
 void tdoaStorageSetRemoteRxTime(tdoaAnchorContext_t* anchorCtx, const uint8_t remoteAnchor, const int64_t remoteRxTime, const uint8_t remoteSeqNr) {
-  tdoaAnchorInfo_t* anchorInfo = anchorCtx->anchorInfo;
-
-  int indexToUpdate = 0;
+  tdoaRemoteAnchorData_t* remoteAnchorData = &anchorCtx->anchorInfo->remoteAnchorData;
   uint32_t now = anchorCtx->currentTime_ms;
-  uint32_t oldestTime = 0xFFFFFFFF;
 
-  for (int i = 0; i < REMOTE_ANCHOR_DATA_COUNT; i++) {
-    if (remoteAnchor == anchorInfo->remoteAnchorData[i].id) {
-      indexToUpdate = i;
-      break;
+  int indexToUpdate = findId(remoteAnchorData->id, REMOTE_ANCHOR_DATA_COUNT, remoteAnchor);
+  if (indexToUpdate < 0) {
+    indexToUpdate = 0;
+    uint32_t oldestTime = 0xFFFFFFFF;
+    for (int i = 0; i < REMOTE_ANCHOR_DATA_COUNT; i++) {
+      if (remoteAnchorData->endOfLife[i] < oldestTime) {
+        oldestTime = remoteAnchorData->endOfLife[i];
+        indexToUpdate = i;
+      }
     }
+  }
+
+  remoteAnchorData->id[indexToUpdate] = remoteAnchor;
+  remoteAnchorData->rxTime[indexToUpdate] = remoteRxTime;
+  remoteAnchorData->seqNr[indexToUpdate] = remoteSeqNr;
+  remoteAnchorData->endOfLife[indexToUpdate] = now + REMOTE_DATA_VALIDITY_PERIOD;
 
-    if (anchorInfo->remoteAnchorData[i].endOfLife < oldestTime) {
-      oldestTime = anchorInfo->remoteAnchorData[i].endOfLife;
-      indexToUpdate = i;
+  updateRecency(remoteAnchorData, indexToUpdate, now);
+}
+
+/**
+ * Get the remote data with a given recency, 0 is the packet that was received last by the anchor.
+ * Returns false if the data has expired.
+ */
+bool tdoaStorageGetRemoteByRecency(const tdoaAnchorContext_t* anchorCtx, const int recency, uint8_t* remoteAnchor, uint8_t* seqNr) {
+  const tdoaRemoteAnchorData_t* remoteAnchorData = &anchorCtx->anchorInfo->remoteAnchorData;
+  const int i = remoteAnchorData->byRecency[recency];
+
+  if (remoteAnchorData->endOfLife[i] > anchorCtx->currentTime_ms) {
+    *remoteAnchor = remoteAnchorData->id[i];
+    *seqNr = remoteAnchorData->seqNr[i];
+    return true;
+  }
+
+  return false;
+}
+
+int64_t tdoaStorageGetTimeOfFlight(const tdoaAnchorContext_t* anchorCtx, const uint8_t otherAnchor) {
+  const tdoaTimeOfFlight_t* tof = &anchorCtx->anchorInfo->tof;
+
+  const int i = findId(tof->id, TOF_PER_ANCHOR_COUNT, otherAnchor);
+  if (i >= 0) {
+    uint32_t now = anchorCtx->currentTime_ms;
+    if (tof->endOfLife[i] > now) {
+      return tof->tof[i];
     }
   }
 
-  anchorInfo->remoteAnchorData[indexToUpdate].id = remoteAnchor;
-  anchorInfo->remoteAnchorData[indexToUpdate].rxTime = remoteRxTime;
-  anchorInfo->remoteAnchorData[indexToUpdate].seqNr = remoteSeqNr;
-  anchorInfo->remoteAnchorData[indexToUpdate].endOfLife = now + REMOTE_DATA_VALIDITY_PERIOD;
+  return 0;
 }
 
-void tdoaStorageGetRemoteSeqNrList(const tdoaAnchorContext_t* anchorCtx, int* remoteCount, uint8_t seqNr[], uint8_t id[]) {
-  const tdoaAnchorInfo_t* anchorInfo = anchorCtx->anchorInfo;
+void tdoaStorageSetTimeOfFlight(tdoaAnchorContext_t* anchorCtx, const uint8_t remoteAnchor, const int64_t tofValue) {
+  tdoaTimeOfFlight_t* tof = &anchorCtx->anchorInfo->tof;
   uint32_t now = anchorCtx->currentTime_ms;
 
-  int count = 0;
-
-  for (int i = 0; i < REMOTE_ANCHOR_DATA_COUNT; i++) {
-    if (anchorInfo->remoteAnchorData[i].endOfLife > now) {
-      id[count] = anchorInfo->remoteAnchorData[i].id;
-      seqNr[count] = anchorInfo->remoteAnchorData[i].seqNr;
-      count++;
+  int indexToUpdate = findId(tof->id, TOF_PER_ANCHOR_COUNT, remoteAnchor);
+  if (indexToUpdate < 0) {
+    indexToUpdate = 0;
+    uint32_t oldestTime = 0xFFFFFFFF;
+    for (int i = 0; i < TOF_PER_ANCHOR_COUNT; i++) {
+      if (tof->endOfLife[i] < oldestTime) {
+        oldestTime = tof->endOfLife[i];
+        indexToUpdate = i;
+      }
     }
   }
 
-  *remoteCount = count;
+  tof->id[indexToUpdate] = remoteAnchor;
+  tof->tof[indexToUpdate] = tofValue;
+  tof->endOfLife[indexToUpdate] = now + TOF_VALIDITY_PERIOD;
 }
 
-int64_t tdoaStorageGetTimeOfFlight(const tdoaAnchorContext_t* anchorCtx, const uint8_t otherAnchor) {
+/**
+ * Get the data of an anchor that should be kept between power cycles, only valid live data is included.
+ * Returns false if the anchor does not have a live position.
+ */
+bool tdoaStorageGetPersistedAnchor(const tdoaAnchorContext_t* anchorCtx, tdoaPersistedAnchor_t* persisted) {
   const tdoaAnchorInfo_t* anchorInfo = anchorCtx->anchorInfo;
+  uint32_t now = anchorCtx->currentTime_ms;
+
+  point_t position;
+  if (anchorInfo->isPositionRestored || !tdoaStorageGetAnchorPosition(anchorCtx, &position)) {
+    return false;
+  }
 
+  memset(persisted, 0, sizeof(tdoaPersistedAnchor_t));
+  persisted->id = anchorInfo->id;
+  persisted->x = position.x;
+  persisted->y = position.y;
+  persisted->z = position.z;
+  #ifdef CONFIG_DECK_LOCO_TDOA_FIXED_POINT
+  persisted->clockCorrection = clockCorrectionEngineGetFixed(&anchorInfo->clockCorrectionStorage);
+  #else
+  persisted->clockCorrection = clockCorrectionEngineGet(&anchorInfo->clockCorrectionStorage) * CLOCK_CORRECTION_FIXED_ONE;
+  #endif
+
+  const tdoaTimeOfFlight_t* tof = &anchorInfo->tof;
   for (int i = 0; i < TOF_PER_ANCHOR_COUNT; i++) {
-    if (otherAnchor == anchorInfo->tof[i].id) {
-      uint32_t now = anchorCtx->currentTime_ms;
-      if (anchorInfo->tof[i].endOfLife > now) {
-        return anchorInfo->tof[i].tof;
-      }
-      break;
+    if (tof->endOfLife[i] > now && tof->tof[i] > 0 && tof->tof[i] <= UINT16_MAX) {
+      persisted->tof[persisted->tofCount].id = tof->id[i];
+      persisted->tof[persisted->tofCount].tof = tof->tof[i];
+      persisted->tofCount++;
     }
   }
 
-  return 0;
+  return true;
 }
 
-void tdoaStorageSetTimeOfFlight(tdoaAnchorContext_t* anchorCtx, const uint8_t remoteAnchor, const int64_t tof) {
-  tdoaAnchorInfo_t* anchorInfo = anchorCtx->anchorInfo;
+/**
+ * Restore anchor data from a previous power cycle. The data is used until it is replaced by live data, and
+ * the time of flight data is dropped if the live anchor position does not match the restored position.
+ * Anchors that already are in the storage are not changed.
+ */
+void tdoaStorageRestoreAnchor(tdoaAnchorStorage_t* anchorStorage, const tdoaPersistedAnchor_t* persisted, const uint32_t currentTime_ms) {
+  tdoaAnchorContext_t anchorCtx;
+  if (tdoaStorageGetCreateAnchorCtx(anchorStorage, persisted->id, currentTime_ms, &anchorCtx)) {
+    return;
+  }
 
-  int indexToUpdate = 0;
-  uint32_t now = anchorCtx->currentTime_ms;
-  uint32_t oldestTime = 0xFFFFFFFF;
+  tdoaAnchorInfo_t* anchorInfo = anchorCtx.anchorInfo;
 
-  for (int i = 0; i < TOF_PER_ANCHOR_COUNT; i++) {
-    if (remoteAnchor == anchorInfo->tof[i].id) {
-      indexToUpdate = i;
-      break;
-    }
+  anchorInfo->position.timestamp = currentTime_ms;
+  anchorInfo->position.x = persisted->x;
+  anchorInfo->position.y = persisted->y;
+  anchorInfo->position.z = persisted->z;
+  anchorInfo->isPositionRestored = true;
 
-    if (anchorInfo->tof[i].endOfLife < oldestTime) {
-      oldestTime = anchorInfo->tof[i].endOfLife;
-      indexToUpdate = i;
-    }
+  clockCorrectionEngineSeed(&anchorInfo->clockCorrectionStorage, persisted->clockCorrection);
+
+  tdoaTimeOfFlight_t* tof = &anchorInfo->tof;
+  const int tofCount = persisted->tofCount < TOF_PER_ANCHOR_COUNT ? persisted->tofCount : TOF_PER_ANCHOR_COUNT;
+  for (int i = 0; i < tofCount; i++) {
+    tof->id[i] = persisted->tof[i].id;
+    tof->tof[i] = persisted->tof[i].tof;
+    tof->endOfLife[i] = currentTime_ms + RESTORED_DATA_VALIDITY_PERIOD;
+  }
+}
+
+bool tdoaStorageIsAnchorInStorage(tdoaAnchorStorage_t* anchorStorage, const uint8_t anchor) {
+  return findSlot(anchorStorage, anchor) >= 0;
+}
+
+static tdoaAnchorInfo_t* initializeSlot(tdoaAnchorStorage_t* anchorStorage, const uint8_t slot, const uint8_t anchor) {
+  tdoaAnchorInfo_t* anchorInfo = &anchorStorage->anchorInfo[slot];
+
+  if (anchorInfo->isInitialized) {
+    anchorStorage->slotById[anchorInfo->id] = 0;
+  }
+
+  memset(anchorInfo, 0, sizeof(tdoaAnchorInfo_t));
+  for (int i = 0; i < REMOTE_ANCHOR_DATA_COUNT; i++) {
+    anchorInfo->remoteAnchorData.byRecency[i] = i;
   }
+  anchorInfo->id = anchor;
+  anchorInfo->isInitialized = true;
+  anchorStorage->slotById[anchor] = slot + 1;
+
+  return anchorInfo;
+}
 
-  anchorInfo->tof[indexToUpdate].id = remoteAnchor;
-  anchorInfo->tof[indexToUpdate].tof = tof;
-  anchorInfo->tof[indexToUpdate].endOfLife = now + TOF_VALIDITY_PERIOD;
+static int findSlot(const tdoaAnchorStorage_t* anchorStorage, const uint8_t anchor) {
+  return anchorStorage->slotById[anchor] - 1;
 }
 
-bool tdoaStorageIsAnchorInStorage(tdoaAnchorInfo_t anchorStorage[], const uint8_t anchor) {
+// Only used when a new anchor is added to a full storage
+static int findOldestSlot(const tdoaAnchorStorage_t* anchorStorage, const uint32_t currentTime_ms) {
+  uint32_t oldestUpdateTime = currentTime_ms;
+  int oldestSlot = 0;
+
   for (int i = 0; i < ANCHOR_STORAGE_COUNT; i++) {
-    if (anchorStorage[i].isInitialized) {
-      if (anchor == anchorStorage[i].id) {
-        return true;
-      }
+    if (anchorStorage->anchorInfo[i].lastUpdateTime < oldestUpdateTime) {
+      oldestUpdateTime = anchorStorage->anchorInfo[i].lastUpdateTime;
+      oldestSlot = i;
     }
   }
 
-  return false;
+  return oldestSlot;
+}
+
+static int findId(const uint8_t ids[], const int count, const uint8_t id) {
+  const uint8_t* found = memchr(ids, id, count);
+  if (found) {
+    return found - ids;
+  }
+
+  return -1;
+}
+
+// Anchors transmit a few ms apart, the lower 32 bits of the time stamps are
+// enough to order them, also when the time stamps wrap around
+static bool isLater(const int64_t rxTime, const int64_t otherRxTime) {
+  return (int32_t)((uint32_t)rxTime - (uint32_t)otherRxTime) > 0;
+}
+
+// Move the updated data to its place in the recency list, expired data is
+// treated as older than all valid data
+static void updateRecency(tdoaRemoteAnchorData_t* remoteAnchorData, const int index, const uint32_t now) {
+  uint8_t* byRecency = remoteAnchorData->byRecency;
+
+  int position = 0;
+  while (byRecency[position] != index) {
+    position++;
+  }
+
+  // Move data that is later than the updated data one step up, towards the
+  // front, then move older data one step down
+  while (position < REMOTE_ANCHOR_DATA_COUNT - 1) {
+    const int next = byRecency[position + 1];
+    if (remoteAnchorData->endOfLife[next] <= now || !isLater(remoteAnchorData->rxTime[next], remoteAnchorData->rxTime[index])) {
+      break;
+    }
+    byRecency[position] = next;
+    position++;
+  }
+
+  while (position > 0) {
+    const int previous = byRecency[position - 1];
+    if (remoteAnchorData->endOfLife[previous] > now && !isLater(remoteAnchorData->rxTime[index], remoteAnchorData->rxTime[previous])) {
+      break;
+    }
+    byRecency[position] = previous;
+    position--;
+  }
+
+  byRecency[position] = index;
 }
 
-static tdoaAnchorInfo_t* initializeSlot(tdoaAnchorInfo_t anchorStorage[], const uint8_t slot, const uint8_t anchor) {
-  memset(&anchorStorage[slot], 0, sizeof(tdoaAnchorInfo_t));
-  anchorStorage[slot].id = anchor;
-  anchorStorage[slot].isInitialized = true;
+static bool isSamePosition(const point_t* position, const float x, const float y, const float z) {
+  const float dx = position->x - x;
+  const float dy = position->y - y;
+  const float dz = position->z - z;
 
-  return &anchorStorage[slot];
+  return (dx * dx + dy * dy + dz * dz) < (RESTORED_POSITION_MAX_ERROR * RESTORED_POSITION_MAX_ERROR);
 }
@@ -0,0 +1,193 @@
+// @IGNORE_IF_NOT CONFIG_DECK_LOCO_TDOA_PERSIST_ANCHORS
+
+// File under test lpsTdoaPersist.c
+#include "lpsTdoaPersist.h"
+
+#include "unity.h"
+#include "tdoaStorage.h"
+#include "mock_clockCorrectionEngine.h"
+#include "mock_storage.h"
+#include "mock_worker.h"
+
+#include <string.h>
+
+// kveForeach() only hands the first bytes of a value to the callback
+#define FOREACH_VALUE_LENGTH 8
+
+#define ANCHOR_ID 0x2a
+#define REMOTE_ANCHOR_ID 3
+#define UPDATE_INTERVAL_MS (10 * 1000)
+
+static tdoaAnchorStorage_t anchorStorage;
+
+static tdoaPersistedAnchor_t storedAnchor;
+static bool isStoredAnchorInStorage;
+static int storeCount;
+static char storedKey[20];
+
+static bool mockStorageForeach(const char* prefix, storageFunc_t func, int cmock_num_calls);
+static size_t mockStorageFetch(const char* key, void* buffer, size_t length, int cmock_num_calls);
+static bool mockStorageStore(const char* key, const void* buffer, size_t length, int cmock_num_calls);
+static int mockWorkerSchedule(void (*function)(void*), void* arg, int cmock_num_calls);
+static void fixtureSetLiveAnchor(const uint8_t id, const uint32_t now_ms, const float x, const uint16_t tof);
+
+void setUp(void) {
+  tdoaStorageInitialize(&anchorStorage);
+
+  memset(&storedAnchor, 0, sizeof(storedAnchor));
+  isStoredAnchorInStorage = false;
+  storeCount = 0;
+  storedKey[0] = '\0';
+
+  storageForeach_StubWithCallback(mockStorageForeach);
+  storageFetch_StubWithCallback(mockStorageFetch);
+  storageStore_StubWithCallback(mockStorageStore);
+  workerSchedule_StubWithCallback(mockWorkerSchedule);
+  clockCorrectionEngineSeed_Ignore();
+  clockCorrectionEngineGet_IgnoreAndReturn(1.0);
+}
+
+void tearDown(void) {
+  // Empty
+}
+
+void testThatStoredAnchorIsRestored() {
+  // Fixture
+  const uint32_t now_ms = 1000;
+  storedAnchor = (tdoaPersistedAnchor_t){.id = ANCHOR_ID, .x = 1.0f, .y = 2.0f, .z = 3.0f, .tofCount = 1, .tof = {{.id = REMOTE_ANCHOR_ID, .tof = 4711}}};
+  isStoredAnchorInStorage = true;
+
+  // Test
+  lpsTdoaPersistRestore(&anchorStorage, now_ms);
+
+  // Assert
+  tdoaAnchorContext_t anchorCtx;
+  TEST_ASSERT_TRUE(tdoaStorageGetAnchorCtx(&anchorStorage, ANCHOR_ID, now_ms, &anchorCtx));
+
+  point_t position;
+  TEST_ASSERT_TRUE(tdoaStorageGetAnchorPosition(&anchorCtx, &position));
+  TEST_ASSERT_EQUAL_FLOAT(1.0f, position.x);
+  TEST_ASSERT_EQUAL_INT64(4711, tdoaStorageGetTimeOfFlight(&anchorCtx, REMOTE_ANCHOR_ID));
+}
+
+void testThatLiveAnchorIsWrittenToStorage() {
+  // Fixture
+  lpsTdoaPersistRestore(&anchorStorage, 0);
+  fixtureSetLiveAnchor(ANCHOR_ID, UPDATE_INTERVAL_MS, 1.0f, 4711);
+
+  // Test
+  lpsTdoaPersistUpdate(&anchorStorage, UPDATE_INTERVAL_MS);
+
+  // Assert
+  TEST_ASSERT_EQUAL_INT(1, storeCount);
+  TEST_ASSERT_EQUAL_STRING("lps/anc/2a", storedKey);
+  TEST_ASSERT_EQUAL_UINT8(ANCHOR_ID, storedAnchor.id);
+  TEST_ASSERT_EQUAL_FLOAT(1.0f, storedAnchor.x);
+  TEST_ASSERT_EQUAL_UINT16(4711, storedAnchor.tof[0].tof);
+}
+
+void testThatAnchorIsNotWrittenBeforeUpdateInterval() {
+  // Fixture
+  lpsTdoaPersistRestore(&anchorStorage, 0);
+  fixtureSetLiveAnchor(ANCHOR_ID, UPDATE_INTERVAL_MS - 1, 1.0f, 4711);
+
+  // Test
+  lpsTdoaPersistUpdate(&anchorStorage, UPDATE_INTERVAL_MS - 1);
+
+  // Assert
+  TEST_ASSERT_EQUAL_INT(0, storeCount);
+}
+
+void testThatUnchangedAnchorIsNotWrittenAgain() {
+  // Fixture
+  lpsTdoaPersistRestore(&anchorStorage, 0);
+  fixtureSetLiveAnchor(ANCHOR_ID, UPDATE_INTERVAL_MS, 1.0f, 4711);
+  lpsTdoaPersistUpdate(&anchorStorage, UPDATE_INTERVAL_MS);
+
+  // Small changes are not worth a write
+  fixtureSetLiveAnchor(ANCHOR_ID, 2 * UPDATE_INTERVAL_MS, 1.01f, 4715);
+
+  // Test
+  lpsTdoaPersistUpdate(&anchorStorage, 2 * UPDATE_INTERVAL_MS);
+
+  // Assert
+  TEST_ASSERT_EQUAL_INT(1, storeCount);
+}
+
+void testThatMovedAnchorIsWrittenAgain() {
+  // Fixture
+  lpsTdoaPersistRestore(&anchorStorage, 0);
+  fixtureSetLiveAnchor(ANCHOR_ID, UPDATE_INTERVAL_MS, 1.0f, 4711);
+  lpsTdoaPersistUpdate(&anchorStorage, UPDATE_INTERVAL_MS);
+
+  fixtureSetLiveAnchor(ANCHOR_ID, 2 * UPDATE_INTERVAL_MS, 1.5f, 4711);
+
+  // Test
+  lpsTdoaPersistUpdate(&anchorStorage, 2 * UPDATE_INTERVAL_MS);
+
+  // Assert
+  TEST_ASSERT_EQUAL_INT(2, storeCount);
+  TEST_ASSERT_EQUAL_FLOAT(1.5f, storedAnchor.x);
+}
+
+void testThatRestoredAnchorIsNotWrittenUntilConfirmed() {
+  // Fixture
+  storedAnchor = (tdoaPersistedAnchor_t){.id = ANCHOR_ID, .x = 1.0f};
+  isStoredAnchorInStorage = true;
+  lpsTdoaPersistRestore(&anchorStorage, 0);
+
+  // Test
+  lpsTdoaPersistUpdate(&anchorStorage, UPDATE_INTERVAL_MS);
+
+  // Assert
+  TEST_ASSERT_EQUAL_INT(0, storeCount);
+}
+
+// Helpers
+
+static bool mockStorageForeach(const char* prefix, storageFunc_t func, int cmock_num_calls) {
+  TEST_ASSERT_EQUAL_STRING("lps/anc/", prefix);
+
+  if (isStoredAnchorInStorage) {
+    uint8_t value[FOREACH_VALUE_LENGTH];
+    const size_t length = sizeof(storedAnchor) < FOREACH_VALUE_LENGTH ? sizeof(storedAnchor) : FOREACH_VALUE_LENGTH;
+    memcpy(value, &storedAnchor, length);
+    func("lps/anc/2a", value, length);
+  }
+
+  return true;
+}
+
+static size_t mockStorageFetch(const char* key, void* buffer, size_t length, int cmock_num_calls) {
+  if (!isStoredAnchorInStorage || strcmp(key, "lps/anc/2a") != 0) {
+    return 0;
+  }
+
+  const size_t readLength = sizeof(storedAnchor) < length ? sizeof(storedAnchor) : length;
+  memcpy(buffer, &storedAnchor, readLength);
+  return readLength;
+}
+
+static bool mockStorageStore(const char* key, const void* buffer, size_t length, int cmock_num_calls) {
+  TEST_ASSERT_EQUAL_UINT(sizeof(tdoaPersistedAnchor_t), length);
+
+  strcpy(storedKey, key);
+  memcpy(&storedAnchor, buffer, length);
+  storeCount++;
+
+  return true;
+}
+
+static int mockWorkerSchedule(void (*function)(void*), void* arg, int cmock_num_calls) {
+  // Run the work directly
+  function(arg);
+  return 0;
+}
+
+static void fixtureSetLiveAnchor(const uint8_t id, const uint32_t now_ms, const float x, const uint16_t tof) {
+  tdoaAnchorContext_t anchorCtx;
+  tdoaStorageGetCreateAnchorCtx(&anchorStorage, id, now_ms, &anchorCtx);
+  tdoaStorageSetAnchorPosition(&anchorCtx, x, 2.0f, 3.0f);
+  tdoaStorageSetTimeOfFlight(&anchorCtx, REMOTE_ANCHOR_ID, tof);
+  tdoaStorageSetRxTxData(&anchorCtx, 0, 0, 0);
+}
@@ -35,6 +35,12 @@ static void mockEventPacketSendHandling(dwTime_t* departureTime);
 static void mockEventPacketReceivedAnswerHandling(int dataLength, const packet_t* rxPacket, const dwTime_t* answerArrivalTagTime, const packet_t* expectedTxPacket);
 static void mockEventPacketReceivedReportHandling(int dataLength, const packet_t* rxPacket);
 static void mockSendLppShortHandling(const packet_t* expectedTxPacket, int datalength);
+static void mockReceiveRestartHandling();
+static void mockConcurrentEventTimeoutHandling(const packet_t* expectedTxPacket);
+static void mockConcurrentEventPacketReceivedAnswerHandling(int dataLength, const packet_t* rxPacket, const dwTime_t* answerArrivalTagTime);
+static void mockConcurrentEventReceiveTimeoutHandling(const packet_t* expectedTxPacket);
+static void mockConcurrentEventPacketReceivedReportHandling(int dataLength, const packet_t* rxPacket, bool isMoreReportsExpected);
+static void populateConcurrentReportPacket(packet_t* packet, uint8_t seqNr, locoAddress_t sourceAddress, const dwTime_t* pollRx, const dwTime_t* answerTx, const dwTime_t* finalRx);
 
 static bool lpsGetLppShortCallbackForLppShortPacketSent(lpsLppShortPacket_t* shortPacket, int cmock_num_calls);
 
@@ -53,6 +59,8 @@ static lpsTwrAlgoOptions_t defaultOptions = {
   .combinedAnchorPositionOk = false
 };
 
+#define ANSWERING_ANCHOR_COUNT 3
+
 static char * lppShortPacketData = "hello";
 static int lppShortPacketLength = 5;
 static int lppShortPacketDest = 3;
@@ -320,6 +328,167 @@ void testThatWhenARangingHasHappenRangingIsReportedToBeOk() {
   TEST_ASSERT_TRUE(uwbTwrTagAlgorithm.isRangingOk());
 }
 
+void testConcurrentRangingShouldGenerateDistancesToAllAnsweringAnchors() {
+  // Fixture
+  options.useConcurrentRanging = true;
+
+  const int dataLength = sizeof(packet_t);
+  const uint8_t expectedSeqNr = 1;
+
+  const uint8_t answeringAnchors[ANSWERING_ANCHOR_COUNT] = {0, 2, 5};
+  const float expectedDistances[ANSWERING_ANCHOR_COUNT] = {2.0, 5.0, 7.5};
+  const uint64_t replySlotTicks = 20000;
+
+  dwTime_t pollDepartureTagTime = {.full = 123456};
+  dwTime_t finalDepartureTagTime = {.full = pollDepartureTagTime.full + 1000000};
+  dwTime_t pollArrivalAnchorTime[ANSWERING_ANCHOR_COUNT];
+  dwTime_t answerDepartureAnchorTime[ANSWERING_ANCHOR_COUNT];
+  dwTime_t answerArrivalTagTime[ANSWERING_ANCHOR_COUNT];
+  dwTime_t finalArrivalAnchorTime[ANSWERING_ANCHOR_COUNT];
+  for (int i = 0; i < ANSWERING_ANCHOR_COUNT; i++) {
+    const uint32_t distInTicks = expectedDistances[i] * LOCODECK_TS_FREQ / SPEED_OF_LIGHT;
+    pollArrivalAnchorTime[i].full = pollDepartureTagTime.full + distInTicks + defaultOptions.antennaDelay / 2;
+    answerDepartureAnchorTime[i].full = pollArrivalAnchorTime[i].full + (answeringAnchors[i] + 1) * replySlotTicks;
+    answerArrivalTagTime[i].full = answerDepartureAnchorTime[i].full + distInTicks + defaultOptions.antennaDelay / 2;
+    finalArrivalAnchorTime[i].full = finalDepartureTagTime.full + distInTicks + defaultOptions.antennaDelay / 2;
+  }
+
+  // eventTimeout
+  packet_t expectedPollPacket;
+  populatePacket(&expectedPollPacket, expectedSeqNr, LPS_TWR_POLL_CONCURRENT, defaultOptions.tagAddress, LPS_TWR_BROADCAST_ADDRESS);
+  expectedPollPacket.payload[LPS_TWR_CONCURRENT_ANCHOR_COUNT] = LOCODECK_NR_OF_TWR_ANCHORS;
+  mockConcurrentEventTimeoutHandling(&expectedPollPacket);
+  lpsGetLppShort_IgnoreAndReturn(false);
+
+  // eventPacketSent (POLL)
+  mockEventPacketSendHandling(&pollDepartureTagTime);
+
+  // eventPacketReceived (ANSWER) from all answering anchors
+  packet_t answerPackets[ANSWERING_ANCHOR_COUNT];
+  for (int i = 0; i < ANSWERING_ANCHOR_COUNT; i++) {
+    populatePacket(&answerPackets[i], expectedSeqNr, LPS_TWR_ANSWER, defaultOptions.anchorAddress[answeringAnchors[i]], defaultOptions.tagAddress);
+    mockConcurrentEventPacketReceivedAnswerHandling(dataLength, &answerPackets[i], &answerArrivalTagTime[i]);
+  }
+
+  // eventReceiveTimeout, no more answers
+  packet_t expectedFinalPacket;
+  populatePacket(&expectedFinalPacket, expectedSeqNr, LPS_TWR_FINAL, defaultOptions.tagAddress, LPS_TWR_BROADCAST_ADDRESS);
+  expectedFinalPacket.payload[LPS_TWR_CONCURRENT_ANSWER_MASK] = (1 << 0) | (1 << 2) | (1 << 5);
+  mockConcurrentEventReceiveTimeoutHandling(&expectedFinalPacket);
+
+  // eventPacketSent (FINAL)
+  mockEventPacketSendHandling(&finalDepartureTagTime);
+
+  // eventPacketReceived (REPORT) from all answering anchors
+  packet_t reportPackets[ANSWERING_ANCHOR_COUNT];
+  for (int i = 0; i < ANSWERING_ANCHOR_COUNT; i++) {
+    populateConcurrentReportPacket(&reportPackets[i], expectedSeqNr, defaultOptions.anchorAddress[answeringAnchors[i]], &pollArrivalAnchorTime[i], &answerDepartureAnchorTime[i], &finalArrivalAnchorTime[i]);
+    const bool isMoreReportsExpected = (i < ANSWERING_ANCHOR_COUNT - 1);
+    mockConcurrentEventPacketReceivedReportHandling(dataLength, &reportPackets[i], isMoreReportsExpected);
+  }
+
+  // Test
+  uint32_t actualPoll = uwbTwrTagAlgorithm.onEvent(&dev, eventTimeout);
+  uwbTwrTagAlgorithm.onEvent(&dev, eventPacketSent);
+  for (int i = 0; i < ANSWERING_ANCHOR_COUNT; i++) {
+    uwbTwrTagAlgorithm.onEvent(&dev, eventPacketReceived);
+  }
+  uint32_t actualFinal = uwbTwrTagAlgorithm.onEvent(&dev, eventReceiveTimeout);
+  uwbTwrTagAlgorithm.onEvent(&dev, eventPacketSent);
+  uint32_t actualReports[ANSWERING_ANCHOR_COUNT];
+  for (int i = 0; i < ANSWERING_ANCHOR_COUNT; i++) {
+    actualReports[i] = uwbTwrTagAlgorithm.onEvent(&dev, eventPacketReceived);
+  }
+
+  // Assert
+  TEST_ASSERT_EQUAL_UINT32(MAX_TIMEOUT, actualPoll);
+  TEST_ASSERT_EQUAL_UINT32(MAX_TIMEOUT, actualFinal);
+  TEST_ASSERT_EQUAL_UINT32(MAX_TIMEOUT, actualReports[0]);
+  TEST_ASSERT_EQUAL_UINT32(MAX_TIMEOUT, actualReports[1]);
+  TEST_ASSERT_EQUAL_UINT32(0, actualReports[2]);
+
+  for (int i = 0; i < ANSWERING_ANCHOR_COUNT; i++) {
+    TEST_ASSERT_FLOAT_WITHIN(0.01, expectedDistances[i], lpsTwrTagGetDistance(answeringAnchors[i]));
+  }
+  TEST_ASSERT_EQUAL_FLOAT(0.0, lpsTwrTagGetDistance(1));
+  TEST_ASSERT_TRUE(uwbTwrTagAlgorithm.isRangingOk());
+}
+
+void testConcurrentRangingShouldIgnoreReportFromAnchorThatDidNotAnswer() {
+  // Fixture
+  options.useConcurrentRanging = true;
+
+  const int dataLength = sizeof(packet_t);
+  const uint8_t expectedSeqNr = 1;
+  const uint8_t answeringAnchor = 1;
+  const uint8_t silentAnchor = 3;
+
+  dwTime_t pollDepartureTagTime = {.full = 123456};
+  dwTime_t answerArrivalTagTime = {.full = 223456};
+  dwTime_t finalDepartureTagTime = {.full = 323456};
+  dwTime_t anchorTime = {.full = 0};
+
+  packet_t expectedPollPacket;
+  populatePacket(&expectedPollPacket, expectedSeqNr, LPS_TWR_POLL_CONCURRENT, defaultOptions.tagAddress, LPS_TWR_BROADCAST_ADDRESS);
+  expectedPollPacket.payload[LPS_TWR_CONCURRENT_ANCHOR_COUNT] = LOCODECK_NR_OF_TWR_ANCHORS;
+  mockConcurrentEventTimeoutHandling(&expectedPollPacket);
+  lpsGetLppShort_IgnoreAndReturn(false);
+  mockEventPacketSendHandling(&pollDepartureTagTime);
+
+  packet_t answerPacket;
+  populatePacket(&answerPacket, expectedSeqNr, LPS_TWR_ANSWER, defaultOptions.anchorAddress[answeringAnchor], defaultOptions.tagAddress);
+  mockConcurrentEventPacketReceivedAnswerHandling(dataLength, &answerPacket, &answerArrivalTagTime);
+
+  packet_t expectedFinalPacket;
+  populatePacket(&expectedFinalPacket, expectedSeqNr, LPS_TWR_FINAL, defaultOptions.tagAddress, LPS_TWR_BROADCAST_ADDRESS);
+  expectedFinalPacket.payload[LPS_TWR_CONCURRENT_ANSWER_MASK] = (1 << answeringAnchor);
+  mockConcurrentEventReceiveTimeoutHandling(&expectedFinalPacket);
+  mockEventPacketSendHandling(&finalDepartureTagTime);
+
+  packet_t reportPacket;
+  populateConcurrentReportPacket(&reportPacket, expectedSeqNr, defaultOptions.anchorAddress[silentAnchor], &anchorTime, &anchorTime, &anchorTime);
+  mockConcurrentEventPacketReceivedReportHandling(dataLength, &reportPacket, true);
+
+  uwbTwrTagAlgorithm.onEvent(&dev, eventTimeout);
+  uwbTwrTagAlgorithm.onEvent(&dev, eventPacketSent);
+  uwbTwrTagAlgorithm.onEvent(&dev, eventPacketReceived);
+  uwbTwrTagAlgorithm.onEvent(&dev, eventReceiveTimeout);
+  uwbTwrTagAlgorithm.onEvent(&dev, eventPacketSent);
+
+  // Test
+  uint32_t actual = uwbTwrTagAlgorithm.onEvent(&dev, eventPacketReceived);
+
+  // Assert
+  TEST_ASSERT_EQUAL_UINT32(MAX_TIMEOUT, actual);
+  TEST_ASSERT_EQUAL_FLOAT(0.0, lpsTwrTagGetDistance(silentAnchor));
+  TEST_ASSERT_FALSE(uwbTwrTagAlgorithm.isRangingOk());
+}
+
+void testConcurrentRangingWithoutAnswersShouldEndRangingOnReceiveTimeout() {
+  // Fixture
+  options.useConcurrentRanging = true;
+
+  const uint8_t expectedSeqNr = 1;
+  dwTime_t pollDepartureTagTime = {.full = 123456};
+
+  packet_t expectedPollPacket;
+  populatePacket(&expectedPollPacket, expectedSeqNr, LPS_TWR_POLL_CONCURRENT, defaultOptions.tagAddress, LPS_TWR_BROADCAST_ADDRESS);
+  expectedPollPacket.payload[LPS_TWR_CONCURRENT_ANCHOR_COUNT] = LOCODECK_NR_OF_TWR_ANCHORS;
+  mockConcurrentEventTimeoutHandling(&expectedPollPacket);
+  lpsGetLppShort_IgnoreAndReturn(false);
+  mockEventPacketSendHandling(&pollDepartureTagTime);
+
+  uwbTwrTagAlgorithm.onEvent(&dev, eventTimeout);
+  uwbTwrTagAlgorithm.onEvent(&dev, eventPacketSent);
+
+  // Test
+  uint32_t actual = uwbTwrTagAlgorithm.onEvent(&dev, eventReceiveTimeout);
+
+  // Assert
+  const uint32_t expected = 0;
+  TEST_ASSERT_EQUAL_UINT32(expected, actual);
+}
+
 
 ///////////////////////////////////////////////////////////////////////////////
 
@@ -393,3 +562,49 @@ static bool lpsGetLppShortCallbackForLppShortPacketSent(lpsLppShortPacket_t* sho
 
   return true;
 }
+
+static void populateConcurrentReportPacket(packet_t* packet, uint8_t seqNr, locoAddress_t sourceAddress, const dwTime_t* pollRx, const dwTime_t* answerTx, const dwTime_t* finalRx) {
+  populatePacket(packet, seqNr, LPS_TWR_REPORT, sourceAddress, defaultOptions.tagAddress);
+  lpsTwrTagReportPayload_t *report = (lpsTwrTagReportPayload_t *)(packet->payload + 2);
+  setTime(report->pollRx, pollRx);
+  setTime(report->answerTx, answerTx);
+  setTime(report->finalRx, finalRx);
+}
+
+static void mockReceiveRestartHandling() {
+  dwNewReceive_Expect(&dev);
+  dwSetDefaults_Expect(&dev);
+  dwStartReceive_Expect(&dev);
+}
+
+static void mockConcurrentEventTimeoutHandling(const packet_t* expectedTxPacket) {
+  dwIdle_Expect(&dev);
+  dwNewTransmit_Expect(&dev);
+  dwSetDefaults_Expect(&dev);
+  dwSetData_ExpectWithArray(&dev, 1, (uint8_t*)expectedTxPacket, sizeof(packet_t), MAC802154_HEADER_LENGTH + 3);
+  dwWaitForResponse_Expect(&dev, true);
+  dwStartTransmit_Expect(&dev);
+}
+
+static void mockConcurrentEventPacketReceivedAnswerHandling(int dataLength, const packet_t* rxPacket, const dwTime_t* answerArrivalTagTime) {
+  dwGetDataLength_ExpectAndReturn(&dev, dataLength);
+  dwGetData_ExpectAndCopyData(&dev, rxPacket, dataLength);
+  dwGetReceiveTimestamp_ExpectAndCopyData(&dev, answerArrivalTagTime);
+  mockReceiveRestartHandling();
+}
+
+static void mockConcurrentEventReceiveTimeoutHandling(const packet_t* expectedTxPacket) {
+  dwNewTransmit_Expect(&dev);
+  dwSetDefaults_Expect(&dev);
+  dwSetData_ExpectWithArray(&dev, 1, (uint8_t*)expectedTxPacket, sizeof(packet_t), MAC802154_HEADER_LENGTH + 4);
+  dwWaitForResponse_Expect(&dev, true);
+  dwStartTransmit_Expect(&dev);
+}
+
+static void mockConcurrentEventPacketReceivedReportHandling(int dataLength, const packet_t* rxPacket, bool isMoreReportsExpected) {
+  dwGetDataLength_ExpectAndReturn(&dev, dataLength);
+  dwGetData_ExpectAndCopyData(&dev, rxPacket, dataLength);
+  if (isMoreReportsExpected) {
+    mockReceiveRestartHandling();
+  }
+}
@@ -0,0 +1,184 @@
+#pragma once
+
+// Golden traces for test_controller_benchmark.c
+//
+// The thrust of motor 1 to 4, before capping, every GOLDEN_SAMPLE_INTERVAL
+// steps of the trace. The test prints a new trace when the output of a
+// controller differs.
+
+#include <stdint.h>
+
+#define GOLDEN_SAMPLE_COUNT (40)
+#define GOLDEN_SAMPLE_INTERVAL (100)
+
+static const int32_t goldenPid[GOLDEN_SAMPLE_COUNT][4] = {
+  {38994, 7040, 31546, 65124},
+  {41522, 9680, 28390, 62080},
+  {44473, 11405, 18445, 50909},
+  {57765, 28175, 27111, 63053},
+  {58728, 27762, 14300, 48866},
+  {63086, 34970, 7678, 38438},
+  {67985, 49045, 13191, 38307},
+  {55727, 35549, 3123, 22621},
+  {55596, 43744, 10670, 23138},
+  {54427, 50651, 16785, 22761},
+  {45098, 44156, 12592, 11130},
+  {50467, 63225, 28581, 19579},
+  {39667, 58735, 36691, 21299},
+  {28065, 51433, 41035, 18927},
+  {22014, 56406, 63356, 35404},
+  {6505, 39773, 59991, 27727},
+  {201, 32739, 64549, 31555},
+  {4357, 38255, 69889, 38255},
+  {-4682, 26217, 60849, 26217},
+  {3040, 35852, 68572, 35852},
+  {6082, 40032, 71614, 40032},
+  {509, 32675, 66041, 32675},
+  {10153, 45251, 75685, 45251},
+  {10017, 43799, 65079, 33329},
+  {12687, 44693, 52883, 19357},
+  {22870, 56696, 55492, 23786},
+  {22523, 51913, 36721, 3371},
+  {31596, 60110, 33368, 1482},
+  {40394, 69026, 37144, 9012},
+  {37298, 57360, 26508, 2618},
+  {47371, 68047, 34583, 15303},
+  {47473, 62793, 34413, 21265},
+  {42065, 46651, 25341, 18303},
+  {44018, 46162, 37956, 37592},
+  {37227, 26773, 29007, 36601},
+  {35306, 14394, 25698, 41090},
+  {37857, 14351, 38955, 61501},
+  {32718, -2799, 29428, 59442},
+  {37321, 3421, 37321, 68953},
+  {42480, 10512, 42480, 76044},
+};
+
+static const int32_t goldenMellinger[GOLDEN_SAMPLE_COUNT][4] = {
+  {30149, 41991, 29005, 33859},
+  {28039, 38305, 31891, 37573},
+  {22547, 18903, 26099, 35215},
+  {47886, 60132, 49692, 54474},
+  {34012, 37950, 42562, 48520},
+  {33667, 30607, 39769, 46729},
+  {44266, 51720, 49948, 55426},
+  {23723, -4512, 29181, 43429},
+  {35865, 22471, 22109, 39211},
+  {38111, 37245, 27003, 40797},
+  {40762, 27358, -17099, 25084},
+  {41688, 56566, 36924, 45046},
+  {36939, 54403, 37161, 44333},
+  {35063, 51767, 22477, 30441},
+  {38696, 62540, 57738, 59106},
+  {31673, 47985, 24209, 26013},
+  {36501, 48055, 15379, 16713},
+  {38673, 48437, 36009, 35997},
+  {35326, 30426, -3363, 5116},
+  {44409, 39291, 24491, 28821},
+  {47173, 41213, 37367, 43935},
+  {36701, 19513, 23727, 36311},
+  {56199, 49457, 47225, 59487},
+  {40914, 31208, 39382, 56460},
+  {24783, 10331, 33411, 51619},
+  {44564, 36002, 41492, 58130},
+  {9028, 2658, 30364, 45322},
+  {22638, 12938, 31426, 38630},
+  {42371, 35375, 42801, 45785},
+  {20684, 21916, 34790, 21866},
+  {46603, 41951, 53869, 44617},
+  {43008, 42414, 59602, 47696},
+  {30599, 35131, 45927, 12475},
+  {43977, 43577, 63249, 43285},
+  {34943, 38277, 44045, 4215},
+  {41037, 36913, 32011, -18060},
+  {46806, 42472, 49340, 26086},
+  {41857, 36269, 23913, -9786},
+  {46124, 39384, 40112, 22180},
+  {49759, 48751, 58223, 44319},
+};
+
+static const int32_t goldenIndi[GOLDEN_SAMPLE_COUNT][4] = {
+  {10227, 5055, 8095, 16799},
+  {14686, 6532, 9548, 22638},
+  {14821, 1753, 5515, 20179},
+  {21550, 17778, 9368, 35932},
+  {25739, 18949, 5961, 35471},
+  {25573, 19649, -2760, 31519},
+  {29623, 30415, -7200, 35863},
+  {25861, 20411, -19682, 18311},
+  {20406, 21240, -27137, 10468},
+  {18695, 26199, -27108, 8003},
+  {0, 0, 0, 0},
+  {-2360, 13229, 7129, 3431},
+  {-3475, 20460, 13234, 3678},
+  {-11426, 18887, 13877, -2908},
+  {-18440, 28433, 22769, 7375},
+  {-28632, 14939, 20063, -364},
+  {0, 0, 0, 0},
+  {0, 0, 0, 0},
+  {0, 0, 0, 0},
+  {0, 0, 0, 0},
+  {-2114, 9105, 11471, 6883},
+  {-3431, 6640, 13606, 1558},
+  {1249, 23469, 23743, 15299},
+  {5266, 27330, 28344, 15976},
+  {2819, 23241, 25755, 8257},
+  {6035, 32909, 26743, 10789},
+  {4771, 23037, 18925, -6448},
+  {2791, 21039, 11373, -17802},
+  {6980, 28734, 12528, -17077},
+  {7964, 21082, 7552, -28825},
+  {13305, 30369, 10743, -19996},
+  {21915, 35523, 15051, -11712},
+  {23874, 25544, 10332, -15737},
+  {28830, 28672, 11324, -3785},
+  {29178, 14010, 5760, -8743},
+  {185, 185, 185, 185},
+  {1008, -7897, 2260, 9190},
+  {0, 0, 0, 0},
+  {0, 0, 0, 0},
+  {5152, 1286, 7188, 16506},
+};
+
+static const int32_t goldenBrescianini[GOLDEN_SAMPLE_COUNT][4] = {
+  {11088, 54427, 12158, 53550},
+  {10223, 54025, 12900, 53815},
+  {16844, 47530, 17621, 48017},
+  {8414, 62684, 14175, 62492},
+  {9738, 55477, 15793, 56225},
+  {14393, 52368, 18815, 53348},
+  {9418, 59434, 16311, 59886},
+  {19235, 41657, 21611, 44015},
+  {23413, 44854, 23052, 46152},
+  {21312, 48976, 21219, 49771},
+  {29854, 36537, 23776, 37885},
+  {21609, 53975, 20951, 54259},
+  {20455, 53284, 20173, 53569},
+  {25810, 47242, 22209, 47395},
+  {19211, 58118, 22391, 58527},
+  {28978, 43077, 25846, 43101},
+  {33677, 38361, 28834, 38531},
+  {32081, 43630, 30774, 44190},
+  {41131, 23300, 35020, 24055},
+  {39362, 34946, 36878, 36052},
+  {37407, 39416, 37722, 40533},
+  {41356, 27674, 41059, 29253},
+  {37286, 44382, 39547, 45464},
+  {38297, 35969, 41443, 37247},
+  {41935, 25077, 44398, 26674},
+  {40858, 36286, 43435, 37344},
+  {45093, 14217, 47318, 15336},
+  {47817, 17707, 47903, 18019},
+  {46667, 29406, 47357, 29502},
+  {51074, 11203, 50178, 8955},
+  {49665, 28821, 50105, 28398},
+  {50990, 26288, 52400, 25771},
+  {56172, 5723, 55037, 95},
+  {54338, 22587, 55258, 21581},
+  {58668, 0, 57152, 0},
+  {60366, 0, 56610, 0},
+  {56400, 15561, 55626, 12714},
+  {59178, 0, 56108, 0},
+  {56083, 12894, 54950, 9953},
+  {51893, 25991, 53530, 25656},
+};
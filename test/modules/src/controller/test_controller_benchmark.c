@@ -0,0 +1,380 @@
+/**
+ *    ||          ____  _ __
+ * +------+      / __ )(_) /_______________ _____  ___
+ * | 0xBC |     / __  / / __/ ___/ ___/ __ `/_  / / _ \
+ * +------+    / /_/ / / /_/ /__/ /  / /_/ / / /_/  __/
+ *  ||  ||    /_____/_/\__/\___/_/   \__,_/ /___/\___/
+ *
+ * Crazyflie control firmware
+ *
+ * Copyright (C) 2024 Bitcraze AB
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, in version 3.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ *
+ * test_controller_benchmark.c - Regression and cost of the controllers
+ *
+ * Each controller, followed by the power distribution, is run on a setpoint
+ * and state trace of a figure eight flight, called at the 1 kHz rate of the
+ * stabilizer loop. The motor thrusts are compared to the golden traces in
+ * controller_golden_traces.h. When a change to a controller is meant to change
+ * its output, the test prints the new golden trace to replace the old one.
+ *
+ * The time per call is printed, together with the share of a core that it
+ * would use at 500 Hz and 1 kHz. Host timing depends on the machine, so the
+ * cost is also measured relative to a reference workload of typical controller
+ * math, and the tests fail if it is over the budget of the controller.
+ */
+
+// File under test controller_pid.c
+#include "controller_pid.h"
+#include "controller_mellinger.h"
+#include "controller_indi.h"
+#include "controller_brescianini.h"
+#include "position_controller_indi.h"
+#include "power_distribution.h"
+#include "pid.h"
+#include "filter.h"
+#include "num.h"
+#include "physicalConstants.h"
+// @MODULE "position_controller_pid.c"
+// @MODULE "attitude_pid_controller.c"
+// @MODULE "power_distribution_quadrotor.c"
+
+#include "controller_golden_traces.h"
+
+#include "unity.h"
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#define TRACE_DURATION_MS (GOLDEN_SAMPLE_COUNT * GOLDEN_SAMPLE_INTERVAL)
+#define TIMING_ITERATIONS (5)
+#define REFERENCE_ITERATIONS (200000)
+
+// Max difference in motor thrust from the golden trace
+#define MOTOR_TOLERANCE (64)
+
+// Max cost per call, relative to one iteration of the reference workload.
+// Roughly four times the current cost, to only catch real regressions.
+#define BUDGET_PID (10.0)
+#define BUDGET_MELLINGER (10.0)
+#define BUDGET_INDI (12.0)
+#define BUDGET_BRESCIANINI (5.0)
+
+typedef enum {
+  controllerTypePid,
+  controllerTypeMellinger,
+  controllerTypeIndi,
+  controllerTypeBrescianini,
+} controllerType_t;
+
+static setpoint_t setpoints[TRACE_DURATION_MS];
+static state_t states[TRACE_DURATION_MS];
+static sensorData_t sensors[TRACE_DURATION_MS];
+
+static controllerMellinger_t mellinger;
+
+static void fixtureTrace();
+static void runTrace(const controllerType_t type, int32_t motors[GOLDEN_SAMPLE_COUNT][4]);
+static double timeTrace(const controllerType_t type);
+static double timeReferenceWorkload();
+static void assertGoldenTrace(const char* name, const int32_t expected[GOLDEN_SAMPLE_COUNT][4], const int32_t actual[GOLDEN_SAMPLE_COUNT][4]);
+static void assertCost(const char* name, const double nsPerCall, const double referenceNs, const double budget);
+
+void setUp(void) {
+  fixtureTrace();
+}
+
+void tearDown(void) {
+  // Empty
+}
+
+void testPidMatchesGoldenTrace() {
+  // Fixture
+  int32_t actual[GOLDEN_SAMPLE_COUNT][4];
+
+  // Test
+  runTrace(controllerTypePid, actual);
+
+  // Assert
+  assertGoldenTrace("goldenPid", goldenPid, actual);
+}
+
+void testMellingerMatchesGoldenTrace() {
+  // Fixture
+  int32_t actual[GOLDEN_SAMPLE_COUNT][4];
+
+  // Test
+  runTrace(controllerTypeMellinger, actual);
+
+  // Assert
+  assertGoldenTrace("goldenMellinger", goldenMellinger, actual);
+}
+
+void testIndiMatchesGoldenTrace() {
+  // Fixture
+  int32_t actual[GOLDEN_SAMPLE_COUNT][4];
+
+  // Test
+  runTrace(controllerTypeIndi, actual);
+
+  // Assert
+  assertGoldenTrace("goldenIndi", goldenIndi, actual);
+}
+
+void testBrescianiniMatchesGoldenTrace() {
+  // Fixture
+  int32_t actual[GOLDEN_SAMPLE_COUNT][4];
+
+  // Test
+  runTrace(controllerTypeBrescianini, actual);
+
+  // Assert
+  assertGoldenTrace("goldenBrescianini", goldenBrescianini, actual);
+}
+
+void testBenchmarkPid() {
+  // Fixture
+  const double referenceNs = timeReferenceWorkload();
+
+  // Test
+  const double nsPerCall = timeTrace(controllerTypePid);
+
+  // Assert
+  assertCost("pid", nsPerCall, referenceNs, BUDGET_PID);
+}
+
+void testBenchmarkMellinger() {
+  // Fixture
+  const double referenceNs = timeReferenceWorkload();
+
+  // Test
+  const double nsPerCall = timeTrace(controllerTypeMellinger);
+
+  // Assert
+  assertCost("mellinger", nsPerCall, referenceNs, BUDGET_MELLINGER);
+}
+
+void testBenchmarkIndi() {
+  // Fixture
+  const double referenceNs = timeReferenceWorkload();
+
+  // Test
+  const double nsPerCall = timeTrace(controllerTypeIndi);
+
+  // Assert
+  assertCost("indi", nsPerCall, referenceNs, BUDGET_INDI);
+}
+
+void testBenchmarkBrescianini() {
+  // Fixture
+  const double referenceNs = timeReferenceWorkload();
+
+  // Test
+  const double nsPerCall = timeTrace(controllerTypeBrescianini);
+
+  // Assert
+  assertCost("brescianini", nsPerCall, referenceNs, BUDGET_BRESCIANINI);
+}
+
+// Helpers
+
+static void fixtureTrace() {
+  // A figure eight at 1 m height with a slowly turning yaw. The estimated state
+  // lags the setpoint by 50 ms, with a few cm and degrees of disturbances that
+  // are deterministic, to make the trace the same on all machines.
+  const float w = 2.0f * M_PI_F / 4.0f;
+  const float ax = 0.5f;
+  const float ay = 0.25f;
+  const float lag = 0.05f;
+
+  for (int i = 0; i < TRACE_DURATION_MS; i++) {
+    const float t = i / 1000.0f;
+    const float ts = t - lag;
+
+    setpoint_t* setpoint = &setpoints[i];
+    *setpoint = (setpoint_t){0};
+    setpoint->mode.x = modeAbs;
+    setpoint->mode.y = modeAbs;
+    setpoint->mode.z = modeAbs;
+    setpoint->mode.yaw = modeAbs;
+    setpoint->position = (point_t){.x = ax * sinf(w * t), .y = ay * sinf(2 * w * t), .z = 1.0f};
+    setpoint->velocity = (velocity_t){.x = ax * w * cosf(w * t), .y = 2 * ay * w * cosf(2 * w * t), .z = 0.0f};
+    setpoint->acceleration = (acc_t){.x = -ax * w * w * sinf(w * t), .y = -4 * ay * w * w * sinf(2 * w * t), .z = 0.0f};
+    setpoint->attitude.yaw = 20.0f * sinf(0.5f * w * t);
+    setpoint->attitudeRate.yaw = 20.0f * 0.5f * w * cosf(0.5f * w * t);
+
+    const float disturbance = 0.02f * sinf(7.0f * t) + 0.01f * sinf(23.0f * t);
+    const float disturbanceRate = 0.14f * cosf(7.0f * t) + 0.23f * cosf(23.0f * t);
+    const float accX = -ax * w * w * sinf(w * ts);
+    const float accY = -4 * ay * w * w * sinf(2 * w * ts);
+
+    state_t* state = &states[i];
+    *state = (state_t){0};
+    state->position = (point_t){.x = ax * sinf(w * ts) + disturbance, .y = ay * sinf(2 * w * ts) - disturbance, .z = 1.0f + disturbance};
+    state->velocity = (velocity_t){.x = ax * w * cosf(w * ts), .y = 2 * ay * w * cosf(2 * w * ts), .z = disturbanceRate};
+    state->acc = (acc_t){.x = accX / GRAVITY_MAGNITUDE, .y = accY / GRAVITY_MAGNITUDE, .z = 0.0f};
+
+    // Legacy coordinate system, the pitch is inverted
+    const float roll = degrees(atanf(-accY / GRAVITY_MAGNITUDE)) + 30.0f * disturbance;
+    const float pitch = degrees(atanf(accX / GRAVITY_MAGNITUDE)) - 20.0f * disturbance;
+    const float yaw = 20.0f * sinf(0.5f * w * ts) + 20.0f * disturbance;
+    state->attitude = (attitude_t){.roll = roll, .pitch = -pitch, .yaw = yaw};
+    struct quat q = rpy2quat(mkvec(radians(roll), radians(pitch), radians(yaw)));
+    state->attitudeQuaternion = (quaternion_t){.x = q.x, .y = q.y, .z = q.z, .w = q.w};
+
+    sensorData_t* sensor = &sensors[i];
+    *sensor = (sensorData_t){0};
+    sensor->gyro = (Axis3f){.x = 30.0f * disturbanceRate, .y = 20.0f * disturbanceRate, .z = 20.0f * disturbanceRate};
+    sensor->acc = (Axis3f){.x = 0.02f * sinf(41.0f * t), .y = 0.02f * cosf(43.0f * t), .z = 1.0f + state->acc.z};
+  }
+}
+
+static void initController(const controllerType_t type) {
+  switch (type) {
+    case controllerTypePid:
+      controllerPidInit();
+      attitudeControllerResetAllPID();
+      positionControllerResetAllPID();
+      positionControllerResetAllfilters();
+      break;
+    case controllerTypeMellinger:
+      controllerMellingerInit(&mellinger);
+      break;
+    case controllerTypeIndi:
+      controllerINDIInit();
+      attitudeControllerResetAllPID();
+      positionControllerResetAllPID();
+      positionControllerResetAllfilters();
+      break;
+    case controllerTypeBrescianini:
+      controllerBrescianiniInit();
+      break;
+  }
+  powerDistributionInit();
+}
+
+static void runController(const controllerType_t type, control_t* control, const int i) {
+  const stabilizerStep_t step = i + 1;
+
+  switch (type) {
+    case controllerTypePid:
+      controllerPid(control, &setpoints[i], &sensors[i], &states[i], step);
+      break;
+    case controllerTypeMellinger:
+      controllerMellinger(&mellinger, control, &setpoints[i], &sensors[i], &states[i], step);
+      break;
+    case controllerTypeIndi:
+      controllerINDI(control, &setpoints[i], &sensors[i], &states[i], step);
+      break;
+    case controllerTypeBrescianini:
+      controllerBrescianini(control, &setpoints[i], &sensors[i], &states[i], step);
+      break;
+  }
+}
+
+static void runTrace(const controllerType_t type, int32_t motors[GOLDEN_SAMPLE_COUNT][4]) {
+  control_t control = {0};
+  motors_thrust_uncapped_t motorThrust;
+
+  initController(type);
+
+  // Not all controllers reset all of their state at init. Run the trace once
+  // first, so that the result does not depend on what was run before.
+  for (int i = 0; i < TRACE_DURATION_MS; i++) {
+    runController(type, &control, i);
+  }
+
+  initController(type);
+  for (int i = 0; i < TRACE_DURATION_MS; i++) {
+    runController(type, &control, i);
+    powerDistribution(&control, &motorThrust);
+
+    if ((i + 1) % GOLDEN_SAMPLE_INTERVAL == 0) {
+      for (int m = 0; m < 4; m++) {
+        motors[i / GOLDEN_SAMPLE_INTERVAL][m] = motorThrust.list[m];
+      }
+    }
+  }
+}
+
+static double timeTrace(const controllerType_t type) {
+  control_t control = {0};
+  motors_thrust_uncapped_t motorThrust;
+  int32_t checksum = 0;
+
+  clock_t start = clock();
+  for (int iteration = 0; iteration < TIMING_ITERATIONS; iteration++) {
+    initController(type);
+    for (int i = 0; i < TRACE_DURATION_MS; i++) {
+      runController(type, &control, i);
+      powerDistribution(&control, &motorThrust);
+      checksum += motorThrust.motors.m1;
+    }
+  }
+  clock_t end = clock();
+
+  // Keep the compiler from optimizing the calls away
+  TEST_ASSERT_TRUE(checksum != 0x7fffffff);
+
+  return (double)(end - start) * 1e9 / CLOCKS_PER_SEC / (TIMING_ITERATIONS * TRACE_DURATION_MS);
+}
+
+static double timeReferenceWorkload() {
+  // A rotation, a normalization and an angle, as done by the controllers
+  volatile float input = 0.1f;
+  float checksum = 0.0f;
+
+  clock_t start = clock();
+  for (int i = 0; i < REFERENCE_ITERATIONS; i++) {
+    struct quat q = rpy2quat(mkvec(input, 0.2f, 0.3f));
+    struct vec v = qvrot(q, mkvec(1.0f, 2.0f, 3.0f));
+    checksum += atan2f(v.y, v.x) + vmag(v);
+  }
+  clock_t end = clock();
+
+  TEST_ASSERT_TRUE(checksum != 0.0f);
+
+  return (double)(end - start) * 1e9 / CLOCKS_PER_SEC / REFERENCE_ITERATIONS;
+}
+
+static void assertGoldenTrace(const char* name, const int32_t expected[GOLDEN_SAMPLE_COUNT][4], const int32_t actual[GOLDEN_SAMPLE_COUNT][4]) {
+  int firstMismatch = -1;
+  for (int i = 0; i < GOLDEN_SAMPLE_COUNT && firstMismatch < 0; i++) {
+    for (int m = 0; m < 4; m++) {
+      if (abs(expected[i][m] - actual[i][m]) > MOTOR_TOLERANCE) {
+        firstMismatch = i;
+      }
+    }
+  }
+
+  if (firstMismatch >= 0) {
+    printf("%s differs at %d ms, the new trace is:\n", name, (firstMismatch + 1) * GOLDEN_SAMPLE_INTERVAL);
+    printf("static const int32_t %s[GOLDEN_SAMPLE_COUNT][4] = {\n", name);
+    for (int i = 0; i < GOLDEN_SAMPLE_COUNT; i++) {
+      printf("  {%d, %d, %d, %d},\n", (int)actual[i][0], (int)actual[i][1], (int)actual[i][2], (int)actual[i][3]);
+    }
+    printf("};\n");
+  }
+
+  TEST_ASSERT_EQUAL_INT(-1, firstMismatch);
+}
+
+static void assertCost(const char* name, const double nsPerCall, const double referenceNs, const double budget) {
+  const double relativeCost = nsPerCall / referenceNs;
+  printf("%s: %.0f ns per call (%.1f references), %.2f%% of a core at 500 Hz, %.2f%% at 1 kHz\n",
+    name, nsPerCall, relativeCost, nsPerCall * 500 / 1e7, nsPerCall * 1000 / 1e7);
+  TEST_ASSERT_TRUE(relativeCost < budget);
+}
@@ -0,0 +1,241 @@
+// File under test mm_sweep_angles.c
+#include "mm_sweep_angles.h"
+
+#include "unity.h"
+
+#include "mock_kalman_core.h"
+#include "outlierFilterLighthouse.h"
+#include "lighthouse_calibration.h"
+
+#include <math.h>
+#include <string.h>
+
+#define MAX_RECORDED_CALLS 8
+// Tilt of the light planes of an LH2 base station, pi / 6
+#define LH2_TILT 0.5235988f
+
+typedef struct {
+  float h[KC_STATE_DIM];
+  float error;
+  float stdMeasNoise;
+} recordedCall_t;
+
+static kalmanCoreData_t this;
+static OutlierFilterLhState_t outlierFilterState;
+static lighthouseCalibrationSweep_t calib;
+
+static recordedCall_t recordedCalls[MAX_RECORDED_CALLS];
+static int recordedCallCount;
+static float stateChangePerCall[3];
+
+static const vec3d sensorPos[SWEEP_ANGLE_BATCH_MAX_SENSORS] = {
+  {-0.015f, 0.0075f, 0.0f},
+  {-0.015f, -0.0075f, 0.0f},
+  {0.015f, 0.0075f, 0.0f},
+  {0.015f, -0.0075f, 0.0f},
+};
+
+static vec3d rotorPos = {-2.0f, 0.5f, 2.5f};
+static mat3d rotorRot;
+static mat3d rotorRotInv;
+
+static void initBatch(sweepAngleBatchMeasurement_t* batch, const float t);
+static void recordScalarUpdate(kalmanCoreData_t* actualThis, arm_matrix_instance_f32* actualHm, float actualError, float actualStdMeasNoise, int cmock_num_calls);
+
+void setUp(void) {
+  memset(&this, 0, sizeof(this));
+  memset(&outlierFilterState, 0, sizeof(outlierFilterState));
+  memset(&calib, 0, sizeof(calib));
+  memset(recordedCalls, 0, sizeof(recordedCalls));
+  memset(stateChangePerCall, 0, sizeof(stateChangePerCall));
+  recordedCallCount = 0;
+
+  // CF slightly rotated around z, in front of the base station
+  const float cfYaw = 0.2f;
+  this.R[0][0] = cosf(cfYaw); this.R[0][1] = -sinf(cfYaw);
+  this.R[1][0] = sinf(cfYaw); this.R[1][1] = cosf(cfYaw);
+  this.R[2][2] = 1.0f;
+  this.S[KC_STATE_X] = 0.5f;
+  this.S[KC_STATE_Y] = 0.3f;
+  this.S[KC_STATE_Z] = 0.2f;
+
+  // Base station tilted down towards the CF
+  const float bsPitch = 0.4f;
+  memset(rotorRot, 0, sizeof(rotorRot));
+  rotorRot[0][0] = cosf(bsPitch); rotorRot[0][2] = sinf(bsPitch);
+  rotorRot[1][1] = 1.0f;
+  rotorRot[2][0] = -sinf(bsPitch); rotorRot[2][2] = cosf(bsPitch);
+  for (int i = 0; i < 3; i++) {
+    for (int j = 0; j < 3; j++) {
+      rotorRotInv[i][j] = rotorRot[j][i];
+    }
+  }
+
+  kalmanCoreScalarUpdate_StubWithCallback(recordScalarUpdate);
+}
+
+void tearDown(void) {
+  // Empty
+}
+
+void testThatBatchGivesSameUpdatesAsSingleSensors() {
+  // Fixture
+  sweepAngleBatchMeasurement_t batch;
+  initBatch(&batch, -LH2_TILT);
+
+  sweepAngleMeasurement_t single = {
+    .rotorPos = batch.rotorPos,
+    .rotorRot = batch.rotorRot,
+    .rotorRotInv = batch.rotorRotInv,
+    .t = batch.t,
+    .stdDev = batch.stdDev,
+    .calib = batch.calib,
+    .calibrationMeasurementModel = batch.calibrationMeasurementModel,
+  };
+
+  for (int sensor = 0; sensor < SWEEP_ANGLE_BATCH_MAX_SENSORS; sensor++) {
+    single.sensorPos = &sensorPos[sensor];
+    single.measuredSweepAngle = batch.measuredSweepAngles[sensor];
+    kalmanCoreUpdateWithSweepAngles(&this, &single, 0, &outlierFilterState);
+  }
+  TEST_ASSERT_EQUAL_INT(SWEEP_ANGLE_BATCH_MAX_SENSORS, recordedCallCount);
+
+  recordedCall_t expectedCalls[SWEEP_ANGLE_BATCH_MAX_SENSORS];
+  memcpy(expectedCalls, recordedCalls, sizeof(expectedCalls));
+  recordedCallCount = 0;
+
+  // Test
+  kalmanCoreUpdateWithSweepAngleBatch(&this, &batch, 0, &outlierFilterState);
+
+  // Assert
+  TEST_ASSERT_EQUAL_INT(SWEEP_ANGLE_BATCH_MAX_SENSORS, recordedCallCount);
+  for (int call = 0; call < SWEEP_ANGLE_BATCH_MAX_SENSORS; call++) {
+    for (int i = 0; i < KC_STATE_DIM; i++) {
+      TEST_ASSERT_FLOAT_WITHIN(1e-5f, expectedCalls[call].h[i], recordedCalls[call].h[i]);
+    }
+    TEST_ASSERT_FLOAT_WITHIN(1e-6f, expectedCalls[call].error, recordedCalls[call].error);
+    TEST_ASSERT_EQUAL_FLOAT(expectedCalls[call].stdMeasNoise, recordedCalls[call].stdMeasNoise);
+  }
+}
+
+void testThatBatchOnlyUsesSensorsInMask() {
+  // Fixture
+  sweepAngleBatchMeasurement_t batch;
+  initBatch(&batch, LH2_TILT);
+  batch.sensorMask = 0x05;
+
+  // Test
+  kalmanCoreUpdateWithSweepAngleBatch(&this, &batch, 0, &outlierFilterState);
+
+  // Assert
+  TEST_ASSERT_EQUAL_INT(2, recordedCallCount);
+}
+
+void testThatBatchErrorIsAdjustedWithStateChangeFromPreviousRows() {
+  // Fixture
+  sweepAngleBatchMeasurement_t batch;
+  initBatch(&batch, -LH2_TILT);
+
+  kalmanCoreUpdateWithSweepAngleBatch(&this, &batch, 0, &outlierFilterState);
+  recordedCall_t unchangedStateCalls[SWEEP_ANGLE_BATCH_MAX_SENSORS];
+  memcpy(unchangedStateCalls, recordedCalls, sizeof(unchangedStateCalls));
+  recordedCallCount = 0;
+
+  // The mocked scalar update moves the state for each call
+  stateChangePerCall[0] = 0.001f;
+  stateChangePerCall[1] = -0.002f;
+  stateChangePerCall[2] = 0.0005f;
+
+  // Test
+  kalmanCoreUpdateWithSweepAngleBatch(&this, &batch, 0, &outlierFilterState);
+
+  // Assert
+  TEST_ASSERT_EQUAL_INT(SWEEP_ANGLE_BATCH_MAX_SENSORS, recordedCallCount);
+  for (int call = 0; call < SWEEP_ANGLE_BATCH_MAX_SENSORS; call++) {
+    const float* h = unchangedStateCalls[call].h;
+    const float hDotStateChange = h[KC_STATE_X] * stateChangePerCall[0] + h[KC_STATE_Y] * stateChangePerCall[1] + h[KC_STATE_Z] * stateChangePerCall[2];
+    const float expectedError = unchangedStateCalls[call].error - call * hDotStateChange;
+    TEST_ASSERT_FLOAT_WITHIN(1e-6f, expectedError, recordedCalls[call].error);
+  }
+}
+
+void testThatPrecomputedCalibrationGivesSameUpdatesAsCalibrationModel() {
+  // Fixture
+  calib.phase = 0.01f;
+  calib.tilt = -0.02f;
+  calib.gibmag = 0.003f;
+  calib.gibphase = 1.2f;
+
+  sweepAngleBatchMeasurement_t batch;
+  initBatch(&batch, LH2_TILT);
+
+  kalmanCoreUpdateWithSweepAngleBatch(&this, &batch, 0, &outlierFilterState);
+  recordedCall_t expectedCalls[SWEEP_ANGLE_BATCH_MAX_SENSORS];
+  memcpy(expectedCalls, recordedCalls, sizeof(expectedCalls));
+  recordedCallCount = 0;
+
+  lighthouseCalibrationSweepLh2Precalc_t precalc;
+  lighthouseCalibrationPrecalcLh2(&calib, LH2_TILT, &precalc);
+  batch.calibPrecalc = &precalc;
+
+  // Test
+  kalmanCoreUpdateWithSweepAngleBatch(&this, &batch, 0, &outlierFilterState);
+
+  // Assert
+  TEST_ASSERT_EQUAL_INT(SWEEP_ANGLE_BATCH_MAX_SENSORS, recordedCallCount);
+  for (int call = 0; call < SWEEP_ANGLE_BATCH_MAX_SENSORS; call++) {
+    for (int i = 0; i < KC_STATE_DIM; i++) {
+      TEST_ASSERT_FLOAT_WITHIN(1e-5f, expectedCalls[call].h[i], recordedCalls[call].h[i]);
+    }
+    TEST_ASSERT_FLOAT_WITHIN(1e-6f, expectedCalls[call].error, recordedCalls[call].error);
+  }
+}
+
+// Helpers
+
+static void initBatch(sweepAngleBatchMeasurement_t* batch, const float t) {
+  memset(batch, 0, sizeof(*batch));
+
+  batch->sensorPos = sensorPos;
+  batch->rotorPos = &rotorPos;
+  batch->rotorRot = &rotorRot;
+  batch->rotorRotInv = &rotorRotInv;
+  batch->sensorMask = 0x0f;
+  batch->t = t;
+  batch->stdDev = 0.001f;
+  batch->calib = &calib;
+  batch->calibrationMeasurementModel = lighthouseCalibrationMeasurementModelLh2;
+
+  // Measured angles close to the predicted ones, with a small error that differs between the sensors
+  for (int sensor = 0; sensor < SWEEP_ANGLE_BATCH_MAX_SENSORS; sensor++) {
+    vec3d sr;
+    for (int i = 0; i < 3; i++) {
+      const float p = this.S[KC_STATE_X + i] + this.R[i][0] * sensorPos[sensor][0] + this.R[i][1] * sensorPos[sensor][1] - rotorPos[i];
+      sr[i] = p;
+    }
+    vec3d srRotor;
+    for (int i = 0; i < 3; i++) {
+      srRotor[i] = rotorRotInv[i][0] * sr[0] + rotorRotInv[i][1] * sr[1] + rotorRotInv[i][2] * sr[2];
+    }
+
+    const float predicted = lighthouseCalibrationMeasurementModelLh2(srRotor[0], srRotor[1], srRotor[2], t, &calib);
+    batch->measuredSweepAngles[sensor] = predicted + 0.001f * (sensor + 1);
+  }
+}
+
+static void recordScalarUpdate(kalmanCoreData_t* actualThis, arm_matrix_instance_f32* actualHm, float actualError, float actualStdMeasNoise, int cmock_num_calls) {
+  TEST_ASSERT_EQUAL_PTR(&this, actualThis);
+  TEST_ASSERT_EQUAL_UINT16(1, actualHm->numRows);
+  TEST_ASSERT_EQUAL_UINT16(KC_STATE_DIM, actualHm->numCols);
+  TEST_ASSERT_LESS_THAN(MAX_RECORDED_CALLS, recordedCallCount);
+
+  recordedCall_t* call = &recordedCalls[recordedCallCount];
+  memcpy(call->h, actualHm->pData, sizeof(call->h));
+  call->error = actualError;
+  call->stdMeasNoise = actualStdMeasNoise;
+  recordedCallCount++;
+
+  actualThis->S[KC_STATE_X] += stateChangePerCall[0];
+  actualThis->S[KC_STATE_Y] += stateChangePerCall[1];
+  actualThis->S[KC_STATE_Z] += stateChangePerCall[2];
+}
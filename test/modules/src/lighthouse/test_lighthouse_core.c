@@ -32,6 +32,7 @@ extern pulseProcessor_t lighthouseCoreState;
 // Functions under test
 void waitForUartSynchFrame();
 bool getUartFrameRaw(lighthouseUartFrame_t *frame);
+int getUartFrameBatch(lighthouseUartFrame_t frames[], const int maxCount, bool* isLastFrameValid);
 lighthouseBaseStationType_t identifyBaseStationType(const lighthouseUartFrame_t* frame, lighthouseBsIdentificationData_t* state);
 
 // Dummy mocks timer
@@ -128,6 +129,64 @@ void testThatTimeStampIsDecodedInUartFrame() {
 }
 
 
+void testThatUartFramesThatAreReceivedAreReadAsABatch() {
+  // Fixture
+  unsigned char sequence[] = {0, 0, 0, 0, 0, 0, 0, 0, 0, 1, 0, 0,
+                              0, 0, 0, 0, 0, 0, 0, 0, 0, 2, 0, 0,
+                              0, 0, 0, 0, 0, 0, 0, 0, 0, 3, 0, 0};
+  uart1SetSequence(sequence, sizeof(sequence));
+  lighthouseUartFrame_t frames[4];
+  bool isLastFrameValid = false;
+
+  // Test
+  int actual = getUartFrameBatch(frames, 4, &isLastFrameValid);
+
+  // Assert
+  TEST_ASSERT_EQUAL_INT(3, actual);
+  TEST_ASSERT_TRUE(isLastFrameValid);
+  TEST_ASSERT_EQUAL_UINT32(1, frames[0].data.timestamp);
+  TEST_ASSERT_EQUAL_UINT32(2, frames[1].data.timestamp);
+  TEST_ASSERT_EQUAL_UINT32(3, frames[2].data.timestamp);
+}
+
+
+void testThatUartFrameBatchIsLimitedToMaxCount() {
+  // Fixture
+  unsigned char sequence[] = {0, 0, 0, 0, 0, 0, 0, 0, 0, 1, 0, 0,
+                              0, 0, 0, 0, 0, 0, 0, 0, 0, 2, 0, 0,
+                              0, 0, 0, 0, 0, 0, 0, 0, 0, 3, 0, 0};
+  uart1SetSequence(sequence, sizeof(sequence));
+  lighthouseUartFrame_t frames[2];
+  bool isLastFrameValid = false;
+
+  // Test
+  int actual = getUartFrameBatch(frames, 2, &isLastFrameValid);
+
+  // Assert
+  TEST_ASSERT_EQUAL_INT(2, actual);
+  TEST_ASSERT_EQUAL_INT(24, uart1BytesRead);
+}
+
+
+void testThatUartFrameBatchStopsAtCorruptFrame() {
+  // Fixture
+  unsigned char sequence[] = {0, 0, 0, 0, 0, 0, 0, 0, 0, 1, 0, 0,
+                              0, 0, 0, 0, 0, 2, 0, 0, 0, 2, 0, 0,
+                              0, 0, 0, 0, 0, 0, 0, 0, 0, 3, 0, 0};
+  uart1SetSequence(sequence, sizeof(sequence));
+  lighthouseUartFrame_t frames[4];
+  bool isLastFrameValid = true;
+
+  // Test
+  int actual = getUartFrameBatch(frames, 4, &isLastFrameValid);
+
+  // Assert
+  TEST_ASSERT_EQUAL_INT(2, actual);
+  TEST_ASSERT_FALSE(isLastFrameValid);
+  TEST_ASSERT_EQUAL_INT(24, uart1BytesRead);
+}
+
+
 void testThatWidthIsDecodedInUartFrame() {
   // Fixture
   unsigned char sequence[] = {0, 1, 2, 0, 0, 0, 0, 0, 0, 0, 0, 0};
@@ -260,6 +319,11 @@ static void uart1ReadCallback(char* ch, int cmock_num_calls) {
 }
 
 static bool uart1GetDataWithTimeoutCallback(char* ch, const uint32_t timeoutTicks, int cmock_num_calls) {
+    // No more data received
+    if (timeoutTicks == 0 && uart1BytesRead >= uart1SequenceLength) {
+        return false;
+    }
+
     uart1ReadCallback(ch, cmock_num_calls);
     return true;
 }
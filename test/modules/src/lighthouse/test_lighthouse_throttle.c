@@ -0,0 +1,142 @@
+// @IGNORE_IF_NOT CONFIG_DECK_LIGHTHOUSE
+
+// File under test lighthouse_throttle.c
+#include "lighthouse_throttle.h"
+
+#include "unity.h"
+#include "mock_estimator.h"
+
+#include <stdbool.h>
+#include <string.h>
+
+#define QUEUE_SIZE 20
+#define SAMPLE_INTERVAL_MS 5
+#define BASE_STATIONS 4
+#define DURATION_MS 3000
+
+static estimatorLoad_t load;
+static bool isDroppingMeasurements;
+
+static void mockEstimatorGetLoad(estimatorLoad_t* actualLoad, int cmock_num_calls);
+static int runSamples(const uint32_t startMs, const uint32_t durationMs, const int baseStationCount);
+
+void setUp(void) {
+  memset(&load, 0, sizeof(load));
+  load.queueSize = QUEUE_SIZE;
+  isDroppingMeasurements = false;
+  estimatorGetLoad_StubWithCallback(mockEstimatorGetLoad);
+
+  throttleLh2Init();
+}
+
+void tearDown(void) {
+  // Empty
+}
+
+
+void testThatRateIsIncreasedWhenEstimatorHasSpareCapacity() {
+  // Fixture
+  load.queueLength = 1;
+  load.updateDurationUs = 100;
+
+  // Run until the rate has settled
+  runSamples(0, DURATION_MS, BASE_STATIONS);
+
+  // Test
+  int actual = runSamples(DURATION_MS, 1000, BASE_STATIONS);
+
+  // Assert
+  // 800 samples/s in, max adaptive rate is 120 samples/s
+  TEST_ASSERT_INT_WITHIN(25, 120, actual);
+}
+
+
+void testThatRateIsDecreasedWhenEstimatorDropsMeasurements() {
+  // Fixture
+  load.queueLength = 1;
+  load.updateDurationUs = 100;
+  isDroppingMeasurements = true;
+
+  runSamples(0, DURATION_MS, BASE_STATIONS);
+
+  // Test
+  int actual = runSamples(DURATION_MS, 1000, BASE_STATIONS);
+
+  // Assert
+  // Min adaptive rate is 30 samples/s
+  TEST_ASSERT_INT_WITHIN(15, 30, actual);
+}
+
+
+void testThatRateIsDecreasedWhenMeasurementUpdateIsSlow() {
+  // Fixture
+  load.queueLength = 0;
+  load.updateDurationUs = 800;
+
+  runSamples(0, DURATION_MS, BASE_STATIONS);
+
+  // Test
+  int actual = runSamples(DURATION_MS, 1000, BASE_STATIONS);
+
+  // Assert
+  TEST_ASSERT_INT_WITHIN(15, 30, actual);
+}
+
+
+void testThatRateIsDecreasedWhenQueueIsFilling() {
+  // Fixture
+  load.queueLength = QUEUE_SIZE - 2;
+  load.updateDurationUs = 100;
+
+  runSamples(0, DURATION_MS, BASE_STATIONS);
+
+  // Test
+  int actual = runSamples(DURATION_MS, 1000, BASE_STATIONS);
+
+  // Assert
+  TEST_ASSERT_INT_WITHIN(15, 30, actual);
+}
+
+
+void testThatSamplesFromBaseStationNotUsedRecentlyAreUsed() {
+  // Fixture
+  load.queueLength = QUEUE_SIZE;
+  load.updateDurationUs = 800;
+
+  // Test and assert
+  for (uint32_t nowMs = 0; nowMs < DURATION_MS; nowMs += SAMPLE_INTERVAL_MS) {
+    for (int bs = 0; bs < BASE_STATIONS - 1; bs++) {
+      throttleLh2Samples(nowMs, bs);
+    }
+
+    // A base station that is only seen now and then
+    if ((nowMs % 600) == 0) {
+      TEST_ASSERT_TRUE(throttleLh2Samples(nowMs, BASE_STATIONS - 1));
+    }
+  }
+}
+
+
+// Helpers
+
+static void mockEstimatorGetLoad(estimatorLoad_t* actualLoad, int cmock_num_calls) {
+  if (isDroppingMeasurements) {
+    load.notAppendedCount++;
+  }
+
+  *actualLoad = load;
+}
+
+static int runSamples(const uint32_t startMs, const uint32_t durationMs, const int baseStationCount) {
+  int usedCount = 0;
+
+  for (uint32_t nowMs = startMs; nowMs < startMs + durationMs; nowMs += SAMPLE_INTERVAL_MS) {
+    for (int bs = 0; bs < baseStationCount; bs++) {
+      if (throttleLh2Samples(nowMs, bs)) {
+        usedCount++;
+      }
+    }
+  }
+
+  return usedCount;
+}
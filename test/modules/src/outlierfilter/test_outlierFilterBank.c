@@ -0,0 +1,217 @@
+// File under test outlierFilterBank.c
+#include "outlierFilterBank.h"
+
+#include "unity.h"
+
+#define GOOD_SOURCE 17
+#define BAD_SOURCE 42
+
+// Normalized innovation squared = ERROR^2 / VARIANCE
+#define VARIANCE 1.0f
+#define GOOD_ERROR 0.5f
+#define BORDERLINE_ERROR 2.5f
+#define BAD_ERROR 10.0f
+
+static outlierFilterBank_t bank;
+
+static uint32_t fixtureCloseBank(outlierFilterBank_t* this, uint32_t nowMs);
+
+void setUp(void) {
+  outlierFilterBankReset(&bank);
+}
+
+void tearDown(void) {
+  // Empty
+}
+
+void testThatBankIsOpenAfterReset() {
+  // Fixture
+
+  // Test
+  bool actual = outlierFilterBankValidate(&bank, GOOD_SOURCE, BAD_ERROR, VARIANCE, 0);
+
+  // Assert
+  TEST_ASSERT_TRUE(actual);
+  TEST_ASSERT_TRUE(bank.isOpen);
+}
+
+void testThatBankClosesWhenSamplesAreGood() {
+  // Fixture
+
+  // Test
+  fixtureCloseBank(&bank, 0);
+
+  // Assert
+  TEST_ASSERT_FALSE(bank.isOpen);
+}
+
+void testThatGoodSampleIsAcceptedWhenClosed() {
+  // Fixture
+  uint32_t nowMs = fixtureCloseBank(&bank, 0);
+
+  // Test
+  bool actual = outlierFilterBankValidate(&bank, GOOD_SOURCE, GOOD_ERROR, VARIANCE, nowMs);
+
+  // Assert
+  TEST_ASSERT_TRUE(actual);
+}
+
+void testThatBadSampleIsRejectedWhenClosed() {
+  // Fixture
+  uint32_t nowMs = fixtureCloseBank(&bank, 0);
+
+  // Test
+  bool actual = outlierFilterBankValidate(&bank, GOOD_SOURCE, BAD_ERROR, VARIANCE, nowMs);
+
+  // Assert
+  TEST_ASSERT_FALSE(actual);
+}
+
+void testThatInnovationVarianceIsUsedForGating() {
+  // Fixture
+  uint32_t nowMs = fixtureCloseBank(&bank, 0);
+
+  // Test
+  bool actual = outlierFilterBankValidate(&bank, GOOD_SOURCE, BAD_ERROR, 100.0f * VARIANCE, nowMs);
+
+  // Assert
+  TEST_ASSERT_TRUE(actual);
+}
+
+void testThatGateIsTightenedForSourceWithManyOutliers() {
+  // Fixture
+  uint32_t nowMs = fixtureCloseBank(&bank, 0);
+  for (int i = 0; i < 12; i++) {
+    outlierFilterBankValidate(&bank, BAD_SOURCE, BAD_ERROR, VARIANCE, nowMs++);
+    outlierFilterBankValidate(&bank, GOOD_SOURCE, GOOD_ERROR, VARIANCE, nowMs++);
+  }
+
+  // Test
+  bool actualGood = outlierFilterBankValidate(&bank, GOOD_SOURCE, BORDERLINE_ERROR, VARIANCE, nowMs++);
+  bool actualBad = outlierFilterBankValidate(&bank, BAD_SOURCE, BORDERLINE_ERROR, VARIANCE, nowMs++);
+
+  // Assert
+  TEST_ASSERT_TRUE(actualGood);
+  TEST_ASSERT_FALSE(actualBad);
+}
+
+void testThatSourceWithMostlyOutliersIsRejected() {
+  // Fixture
+  uint32_t nowMs = fixtureCloseBank(&bank, 0);
+  for (int i = 0; i < 40; i++) {
+    outlierFilterBankValidate(&bank, BAD_SOURCE, BAD_ERROR, VARIANCE, nowMs++);
+    outlierFilterBankValidate(&bank, GOOD_SOURCE, GOOD_ERROR, VARIANCE, nowMs++);
+  }
+
+  // Test
+  bool actual = outlierFilterBankValidate(&bank, BAD_SOURCE, GOOD_ERROR, VARIANCE, nowMs);
+
+  // Assert
+  TEST_ASSERT_FALSE(actual);
+}
+
+void testThatGoodSourceIsNotAffectedByBadSource() {
+  // Fixture
+  uint32_t nowMs = fixtureCloseBank(&bank, 0);
+  int acceptedCount = 0;
+
+  // Test
+  for (int i = 0; i < 100; i++) {
+    outlierFilterBankValidate(&bank, BAD_SOURCE, BAD_ERROR, VARIANCE, nowMs++);
+    if (outlierFilterBankValidate(&bank, GOOD_SOURCE, GOOD_ERROR, VARIANCE, nowMs++)) {
+      acceptedCount++;
+    }
+  }
+
+  // Assert
+  TEST_ASSERT_EQUAL_INT(100, acceptedCount);
+  TEST_ASSERT_FALSE(bank.isOpen);
+}
+
+void testThatBankOpensWhenAllSourcesHaveOutliers() {
+  // Fixture
+  uint32_t nowMs = fixtureCloseBank(&bank, 0);
+
+  // Test
+  for (int i = 0; i < 200; i++) {
+    outlierFilterBankValidate(&bank, BAD_SOURCE, BAD_ERROR, VARIANCE, nowMs++);
+    outlierFilterBankValidate(&bank, GOOD_SOURCE, BAD_ERROR, VARIANCE, nowMs++);
+  }
+
+  // Assert
+  TEST_ASSERT_TRUE(bank.isOpen);
+  TEST_ASSERT_TRUE(outlierFilterBankValidate(&bank, GOOD_SOURCE, BAD_ERROR, VARIANCE, nowMs));
+}
+
+void testThatStatisticsAreKeptPerSource() {
+  // Fixture
+  uint32_t nowMs = fixtureCloseBank(&bank, 0);
+
+  // Test
+  for (int i = 0; i < 20; i++) {
+    outlierFilterBankValidate(&bank, BAD_SOURCE, BAD_ERROR, VARIANCE, nowMs++);
+  }
+
+  // Assert
+  TEST_ASSERT_GREATER_THAN(0.9f, outlierFilterBankGetSource(&bank, GOOD_SOURCE)->acceptanceRate);
+  TEST_ASSERT_LESS_THAN(0.5f, outlierFilterBankGetSource(&bank, BAD_SOURCE)->acceptanceRate);
+}
+
+void testThatUnknownSourceIsNotFound() {
+  // Fixture
+
+  // Test
+  const outlierFilterBankSource_t* actual = outlierFilterBankGetSource(&bank, GOOD_SOURCE);
+
+  // Assert
+  TEST_ASSERT_NULL(actual);
+}
+
+void testThatLeastRecentlyUsedSourceIsReplacedWhenBankIsFull() {
+  // Fixture
+  uint32_t nowMs = 0;
+  const int sourceCount = OUTLIER_FILTER_BANK_SIZE * 2;
+
+  // Test
+  for (int i = 0; i < 10; i++) {
+    for (uint16_t sourceId = 0; sourceId < sourceCount; sourceId++) {
+      outlierFilterBankValidate(&bank, sourceId, GOOD_ERROR, VARIANCE, nowMs++);
+    }
+  }
+
+  // Assert
+  // The most recently used sources are in the bank
+  int foundCount = 0;
+  for (uint16_t sourceId = sourceCount - 8; sourceId < sourceCount; sourceId++) {
+    if (outlierFilterBankGetSource(&bank, sourceId)) {
+      foundCount++;
+    }
+  }
+  TEST_ASSERT_EQUAL_INT(8, foundCount);
+}
+
+void testThatMonitoredSourceIsKeptAfterReset() {
+  // Fixture
+  bank.monitoredSourceId = BAD_SOURCE;
+  outlierFilterBankReset(&bank);
+  uint32_t nowMs = fixtureCloseBank(&bank, 0);
+
+  // Test
+  for (int i = 0; i < 20; i++) {
+    outlierFilterBankValidate(&bank, BAD_SOURCE, BAD_ERROR, VARIANCE, nowMs++);
+  }
+
+  // Assert
+  TEST_ASSERT_EQUAL_UINT16(BAD_SOURCE, bank.monitoredSourceId);
+  TEST_ASSERT_EQUAL_FLOAT(outlierFilterBankGetSource(&bank, BAD_SOURCE)->acceptanceRate, bank.monitoredAcceptanceRate);
+}
+
+// Helpers
+
+static uint32_t fixtureCloseBank(outlierFilterBank_t* this, uint32_t nowMs) {
+  for (int i = 0; i < 200; i++) {
+    outlierFilterBankValidate(this, GOOD_SOURCE, GOOD_ERROR, VARIANCE, nowMs++);
+  }
+
+  return nowMs;
+}
@@ -0,0 +1,235 @@
+// File under test collision_avoidance.c
+#include "collision_avoidance.h"
+
+#include <float.h>
+#include <math.h>
+#include <string.h>
+
+#include "unity.h"
+
+#define MAX_OTHERS 20
+
+static collision_avoidance_params_t params;
+static collision_avoidance_state_t collisionState;
+static float workspace[5 * (MAX_OTHERS + 6)];
+static setpoint_t setpoint;
+static state_t state;
+
+static void fixtureVelocitySetpoint(float vx, float vy, float vz);
+static void fixtureSurroundingNeighbors(float* positions);
+static void assertInBufferedCell(struct vec setPos, const float* otherPositions, int nOthers);
+static struct vec toVec(struct vec3_s v);
+
+void setUp(void) {
+  params = (collision_avoidance_params_t){
+    .ellipsoidRadii = {.x = 0.3, .y = 0.3, .z = 0.9},
+    .bboxMin = {.x = -FLT_MAX, .y = -FLT_MAX, .z = -FLT_MAX},
+    .bboxMax = {.x = FLT_MAX, .y = FLT_MAX, .z = FLT_MAX},
+    .horizonSecs = 1.0f,
+    .maxSpeed = 0.5f,
+    .sidestepThreshold = 0.25f,
+    .maxPeerLocAgeMillis = 5000,
+    .voronoiProjectionTolerance = 1e-5,
+    .voronoiProjectionMaxIters = 100,
+  };
+
+  memset(&collisionState, 0, sizeof(collisionState));
+  collisionState.lastFeasibleSetPosition = mkvec(NAN, NAN, NAN);
+
+  memset(&setpoint, 0, sizeof(setpoint));
+  memset(&state, 0, sizeof(state));
+}
+
+void tearDown(void) {
+  // Empty
+}
+
+void testThatNeighborsOutsideTheHorizonAreCulled() {
+  // Fixture
+  const float others[] = {
+    0.8f, 0.0f, 0.0f,   // Close
+    10.0f, 0.0f, 0.0f,  // Far away
+    0.0f, 0.0f, -2.0f,  // Close, below
+    0.0f, -5.0f, 0.0f,  // Far away
+  };
+  fixtureVelocitySetpoint(0.5f, 0.0f, 0.0f);
+
+  // Test
+  collisionAvoidanceUpdateSetpointCore(&params, &collisionState, 4, others, NULL, workspace, &setpoint, 0, &state);
+
+  // Assert
+  TEST_ASSERT_EQUAL_INT(2, collisionState.nCellNeighbors);
+}
+
+void testThatCulledNeighborsDoNotConstrainTheSetpoint() {
+  // Fixture
+  float others[3 * 8];
+  fixtureSurroundingNeighbors(others);
+  for (int i = 4; i < 8; i++) {
+    // Move some neighbors just outside the horizon
+    others[3 * i + 0] *= 3.0f;
+    others[3 * i + 1] *= 3.0f;
+  }
+  setpoint.mode.x = modeAbs;
+  setpoint.position = (point_t){.x = 3.0f, .y = 3.0f, .z = 0.0f};
+
+  // Test
+  collisionAvoidanceUpdateSetpointCore(&params, &collisionState, 8, others, NULL, workspace, &setpoint, 0, &state);
+
+  // Assert
+  TEST_ASSERT_LESS_THAN(8, collisionState.nCellNeighbors);
+  assertInBufferedCell(toVec(setpoint.position), others, 8);
+}
+
+void testThatWarmStartConvergesToTheSameSetpointInFewerIterations() {
+  // Fixture
+  float others[3 * 8];
+  fixtureSurroundingNeighbors(others);
+  setpoint.mode.x = modeAbs;
+  setpoint.position = (point_t){.x = 0.6f, .y = 0.5f, .z = 0.0f};
+  const setpoint_t original = setpoint;
+
+  collisionAvoidanceUpdateSetpointCore(&params, &collisionState, 8, others, NULL, workspace, &setpoint, 0, &state);
+  const struct vec coldPos = toVec(setpoint.position);
+  const int coldIters = collisionState.nProjectionIters;
+
+  // Test
+  setpoint = original;
+  collisionAvoidanceUpdateSetpointCore(&params, &collisionState, 8, others, NULL, workspace, &setpoint, 0, &state);
+
+  // Assert
+  const struct vec warmPos = toVec(setpoint.position);
+  TEST_ASSERT_FLOAT_WITHIN(1e-4, coldPos.x, warmPos.x);
+  TEST_ASSERT_FLOAT_WITHIN(1e-4, coldPos.y, warmPos.y);
+  TEST_ASSERT_FLOAT_WITHIN(1e-4, coldPos.z, warmPos.z);
+  TEST_ASSERT_GREATER_THAN(1, coldIters);
+  TEST_ASSERT_LESS_THAN(coldIters, collisionState.nProjectionIters);
+}
+
+void testThatWarmStartFollowsTheNeighborsWhenTheirOrderChanges() {
+  // Fixture
+  float others[3 * 8];
+  uint8_t ids[8];
+  fixtureSurroundingNeighbors(others);
+  for (int i = 0; i < 8; i++) {
+    ids[i] = 10 + i;
+  }
+  setpoint.mode.x = modeAbs;
+  setpoint.position = (point_t){.x = 0.6f, .y = 0.5f, .z = 0.0f};
+  const setpoint_t original = setpoint;
+
+  collisionAvoidanceUpdateSetpointCore(&params, &collisionState, 8, others, ids, workspace, &setpoint, 0, &state);
+  const collision_avoidance_state_t firstState = collisionState;
+
+  setpoint = original;
+  collisionAvoidanceUpdateSetpointCore(&params, &collisionState, 8, others, ids, workspace, &setpoint, 0, &state);
+  const struct vec expected = toVec(setpoint.position);
+  const int expectedIters = collisionState.nProjectionIters;
+
+  // The same neighbors in reverse order
+  float reversedOthers[3 * 8];
+  uint8_t reversedIds[8];
+  for (int i = 0; i < 8; i++) {
+    memcpy(&reversedOthers[3 * i], &others[3 * (7 - i)], 3 * sizeof(float));
+    reversedIds[i] = ids[7 - i];
+  }
+  collisionState = firstState;
+
+  // Test
+  setpoint = original;
+  collisionAvoidanceUpdateSetpointCore(&params, &collisionState, 8, reversedOthers, reversedIds, workspace, &setpoint, 0, &state);
+
+  // Assert
+  const struct vec actual = toVec(setpoint.position);
+  TEST_ASSERT_FLOAT_WITHIN(1e-4, expected.x, actual.x);
+  TEST_ASSERT_FLOAT_WITHIN(1e-4, expected.y, actual.y);
+  TEST_ASSERT_FLOAT_WITHIN(1e-4, expected.z, actual.z);
+  TEST_ASSERT_EQUAL_INT(expectedIters, collisionState.nProjectionIters);
+}
+
+void testThatInvalidWarmStartIsIgnored() {
+  // Fixture
+  float others[3 * 8];
+  fixtureSurroundingNeighbors(others);
+  setpoint.mode.x = modeAbs;
+  setpoint.position = (point_t){.x = 0.6f, .y = 0.5f, .z = 0.0f};
+  const setpoint_t original = setpoint;
+
+  collisionAvoidanceUpdateSetpointCore(&params, &collisionState, 8, others, NULL, workspace, &setpoint, 0, &state);
+  const struct vec expected = toVec(setpoint.position);
+
+  for (int i = 0; i < COLLISION_AVOIDANCE_MAX_CELL_ROWS; i++) {
+    collisionState.projectionMultipliers[i] = (i % 2) ? NAN : -1.0f;
+  }
+
+  // Test
+  setpoint = original;
+  collisionAvoidanceUpdateSetpointCore(&params, &collisionState, 8, others, NULL, workspace, &setpoint, 0, &state);
+
+  // Assert
+  const struct vec actual = toVec(setpoint.position);
+  TEST_ASSERT_FLOAT_WITHIN(1e-4, expected.x, actual.x);
+  TEST_ASSERT_FLOAT_WITHIN(1e-4, expected.y, actual.y);
+  TEST_ASSERT_FLOAT_WITHIN(1e-4, expected.z, actual.z);
+}
+
+void testThatWorkspaceCanBeTheSameAsOtherPositions() {
+  // Fixture
+  float others[3 * 8];
+  fixtureSurroundingNeighbors(others);
+  for (int i = 0; i < 3 * 8; i += 6) {
+    others[i] *= 4.0f;
+  }
+  setpoint.mode.x = modeAbs;
+  setpoint.position = (point_t){.x = 0.6f, .y = 0.5f, .z = 0.0f};
+  const setpoint_t original = setpoint;
+
+  collisionAvoidanceUpdateSetpointCore(&params, &collisionState, 8, others, NULL, workspace, &setpoint, 0, &state);
+  const struct vec expected = toVec(setpoint.position);
+
+  memcpy(workspace, others, sizeof(others));
+  memset(&collisionState.projectionMultipliers, 0, sizeof(collisionState.projectionMultipliers));
+
+  // Test
+  setpoint = original;
+  collisionAvoidanceUpdateSetpointCore(&params, &collisionState, 8, workspace, NULL, workspace, &setpoint, 0, &state);
+
+  // Assert
+  const struct vec actual = toVec(setpoint.position);
+  TEST_ASSERT_FLOAT_WITHIN(1e-4, expected.x, actual.x);
+  TEST_ASSERT_FLOAT_WITHIN(1e-4, expected.y, actual.y);
+  TEST_ASSERT_FLOAT_WITHIN(1e-4, expected.z, actual.z);
+}
+
+// Helpers
+
+static void fixtureVelocitySetpoint(float vx, float vy, float vz) {
+  setpoint.mode.x = modeVelocity;
+  setpoint.velocity = (velocity_t){.x = vx, .y = vy, .z = vz};
+}
+
+// Neighbors in a ring around us in the horizontal plane
+static void fixtureSurroundingNeighbors(float* positions) {
+  for (int i = 0; i < 8; i++) {
+    float angle = i * M_PI_F / 4.0f;
+    positions[3 * i + 0] = 1.0f * cosf(angle);
+    positions[3 * i + 1] = 1.0f * sinf(angle);
+    positions[3 * i + 2] = 0.0f;
+  }
+}
+
+static void assertInBufferedCell(struct vec setPos, const float* otherPositions, int nOthers) {
+  const struct vec radiiInv = veltrecip(params.ellipsoidRadii);
+  const struct vec ourPos = toVec(state.position);
+  for (int i = 0; i < nOthers; i++) {
+    // The buffered Voronoi cell constraint, in the stretched coordinate system
+    struct vec toPeer = veltmul(vsub(vloadf(otherPositions + 3 * i), ourPos), radiiInv);
+    struct vec toSetPos = veltmul(vsub(setPos, ourPos), radiiInv);
+    float dist = vmag(toPeer);
+    TEST_ASSERT_LESS_OR_EQUAL(dist / 2.0f - 1.0f + 1e-3f, vdot(toSetPos, toPeer) / dist);
+  }
+}
+
+static struct vec toVec(struct vec3_s v) {
+  return mkvec(v.x, v.y, v.z);
+}
@@ -0,0 +1,146 @@
+/**
+ *    ||          ____  _ __
+ * +------+      / __ )(_) /_______________ _____  ___
+ * | 0xBC |     / __  / / __/ ___/ ___/ __ `/_  / / _ \
+ * +------+    / /_/ / / /_/ /__/ /  / /_/ / / /_/  __/
+ *  ||  ||    /_____/_/\__/\___/_/   \__,_/ /___/\___/
+ *
+ * Crazyflie control firmware
+ *
+ * Copyright (C) 2023 Bitcraze AB
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, in version 3.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ *
+ * test_collision_avoidance_benchmark.c - Update time of collision avoidance
+ *
+ * Collision avoidance is updated at 100 Hz for a drone in a dense formation,
+ * flying towards a goal among 1 to 50 neighbors. Each update is run with the
+ * projection warm started from the previous update, and from scratch. The
+ * results are printed, the tests only fail if the setpoints differ.
+ */
+
+// File under test collision_avoidance.c
+#include "collision_avoidance.h"
+
+#include "unity.h"
+
+#include <float.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+#define MAX_NEIGHBORS (50)
+#define UPDATE_COUNT (1000)
+#define UPDATE_PERIOD (0.01f)
+#define GRID_SPACING (0.7f)
+
+static collision_avoidance_params_t params;
+static float otherPositions[3 * MAX_NEIGHBORS];
+static float workspace[5 * (MAX_NEIGHBORS + 6)];
+
+static double runUpdates(const int nOthers, const bool warmStart, float* checksum, int* nCellNeighbors, int* iterations);
+
+void setUp(void) {
+  params = (collision_avoidance_params_t){
+    .ellipsoidRadii = {.x = 0.3, .y = 0.3, .z = 0.9},
+    .bboxMin = {.x = -FLT_MAX, .y = -FLT_MAX, .z = -FLT_MAX},
+    .bboxMax = {.x = FLT_MAX, .y = FLT_MAX, .z = FLT_MAX},
+    .horizonSecs = 1.0f,
+    .maxSpeed = 0.5f,
+    .sidestepThreshold = 0.25f,
+    .maxPeerLocAgeMillis = 5000,
+    .voronoiProjectionTolerance = 1e-5,
+    .voronoiProjectionMaxIters = 100,
+  };
+
+  // Neighbors in a horizontal grid, spiraling out from us
+  int i = 0;
+  for (int ring = 1; i < MAX_NEIGHBORS; ring++) {
+    for (int x = -ring; x <= ring && i < MAX_NEIGHBORS; x++) {
+      for (int y = -ring; y <= ring && i < MAX_NEIGHBORS; y++) {
+        if (abs(x) == ring || abs(y) == ring) {
+          otherPositions[3 * i + 0] = x * GRID_SPACING;
+          otherPositions[3 * i + 1] = y * GRID_SPACING;
+          otherPositions[3 * i + 2] = 0.0f;
+          i++;
+        }
+      }
+    }
+  }
+}
+
+void tearDown(void) {
+  // Empty
+}
+
+void testBenchmarkNeighborSweep() {
+  const int neighborCounts[] = {1, 2, 5, 10, 20, 50};
+
+  for (unsigned int n = 0; n < sizeof(neighborCounts) / sizeof(neighborCounts[0]); n++) {
+    // Fixture
+    const int nOthers = neighborCounts[n];
+    float expected = 0;
+    float actual = 0;
+    int nCellNeighbors = 0;
+    int coldIterations = 0;
+    int warmIterations = 0;
+
+    // Test
+    double nsPerUpdateCold = runUpdates(nOthers, false, &expected, &nCellNeighbors, &coldIterations);
+    double nsPerUpdateWarm = runUpdates(nOthers, true, &actual, &nCellNeighbors, &warmIterations);
+
+    // Assert
+    printf("%2d neighbors, %2d in cell: %6.0f ns per update, %5.1f iterations, warm start %6.0f ns, %5.1f iterations\n",
+      nOthers, nCellNeighbors,
+      nsPerUpdateCold, (double)coldIterations / UPDATE_COUNT,
+      nsPerUpdateWarm, (double)warmIterations / UPDATE_COUNT);
+    TEST_ASSERT_FLOAT_WITHIN(1e-2, expected, actual);
+  }
+}
+
+// Helpers
+
+static double runUpdates(const int nOthers, const bool warmStart, float* checksum, int* nCellNeighbors, int* iterations) {
+  collision_avoidance_state_t collisionState;
+  memset(&collisionState, 0, sizeof(collisionState));
+  collisionState.lastFeasibleSetPosition = mkvec(NAN, NAN, NAN);
+
+  state_t state;
+  memset(&state, 0, sizeof(state));
+
+  *checksum = 0;
+  *iterations = 0;
+
+  clock_t start = clock();
+  for (int i = 0; i < UPDATE_COUNT; i++) {
+    // A goal circling just outside our cell
+    float angle = i * UPDATE_PERIOD;
+    setpoint_t setpoint;
+    memset(&setpoint, 0, sizeof(setpoint));
+    setpoint.mode.x = modeAbs;
+    setpoint.position = (point_t){.x = 0.5f * cosf(angle), .y = 0.5f * sinf(angle), .z = 0.1f};
+
+    if (!warmStart) {
+      memset(collisionState.projectionMultipliers, 0, sizeof(collisionState.projectionMultipliers));
+    }
+
+    collisionAvoidanceUpdateSetpointCore(&params, &collisionState, nOthers, otherPositions, NULL, workspace, &setpoint, 0, &state);
+
+    *checksum += setpoint.position.x + setpoint.position.y + setpoint.position.z;
+    *iterations += collisionState.nProjectionIters;
+  }
+  clock_t end = clock();
+
+  *nCellNeighbors = collisionState.nCellNeighbors;
+  return (double)(end - start) * 1e9 / CLOCKS_PER_SEC / UPDATE_COUNT;
+}
@@ -0,0 +1,290 @@
+// File under test peer_gossip.c
+#include "peer_gossip.h"
+
+#include "peer_localization.h"
+
+#include "unity.h"
+
+#define OWN_ID 7
+
+static uint32_t nowMs;
+static point_t ownPos;
+static velocity_t ownVel;
+
+static void tellPosition(int id, float x);
+
+void setUp(void) {
+  nowMs = 10000;
+  peerLocalizationInit();
+
+  ownPos = (point_t){.x = 1.2345f, .y = -2.0f, .z = 0.5f};
+  ownVel = (velocity_t){.x = 0.123f, .y = -1.0f, .z = 0.0f};
+}
+
+void tearDown(void) {
+  // Empty
+}
+
+uint32_t xTaskGetTickCount() {
+  return nowMs;
+}
+
+void vPortEnterCritical(void) {
+  // Empty
+}
+
+void vPortExitCritical(void) {
+  // Empty
+}
+
+void testThatPacketWithoutPeersOnlyHoldsOwnState() {
+  // Fixture
+  peerGossipPacket_t packet;
+  int cursor = 0;
+
+  // Test
+  int actual = peerGossipFillPacket(&packet, OWN_ID, &ownPos, &ownVel, nowMs, &cursor);
+
+  // Assert
+  TEST_ASSERT_EQUAL_INT(sizeof(peerGossipEntry_t), actual);
+  TEST_ASSERT_EQUAL_UINT8(OWN_ID, packet.entries[0].id);
+  TEST_ASSERT_EQUAL_UINT8(0, packet.entries[0].age);
+}
+
+void testThatOwnStateIsLeftOutWithoutPosition() {
+  // Fixture
+  peerGossipPacket_t packet;
+  int cursor = 0;
+  tellPosition(3, 1.0f);
+
+  // Test
+  int actual = peerGossipFillPacket(&packet, OWN_ID, NULL, NULL, nowMs, &cursor);
+
+  // Assert
+  TEST_ASSERT_EQUAL_INT(sizeof(peerGossipEntry_t), actual);
+  TEST_ASSERT_EQUAL_UINT8(3, packet.entries[0].id);
+}
+
+void testThatPacketWithoutPositionAndPeersIsEmpty() {
+  // Fixture
+  peerGossipPacket_t packet;
+  int cursor = 0;
+
+  // Test
+  int actual = peerGossipFillPacket(&packet, OWN_ID, NULL, NULL, nowMs, &cursor);
+
+  // Assert
+  TEST_ASSERT_EQUAL_INT(0, actual);
+}
+
+void testThatStateIsQuantizedToMillimetersAndCentimetersPerSecond() {
+  // Fixture
+  peerGossipPacket_t packet;
+  int cursor = 0;
+
+  // Test
+  peerGossipFillPacket(&packet, OWN_ID, &ownPos, &ownVel, nowMs, &cursor);
+
+  // Assert
+  TEST_ASSERT_EQUAL_INT16(1235, packet.entries[0].x);
+  TEST_ASSERT_EQUAL_INT16(-2000, packet.entries[0].y);
+  TEST_ASSERT_EQUAL_INT16(500, packet.entries[0].z);
+  TEST_ASSERT_EQUAL_INT16(12, packet.entries[0].vx);
+  TEST_ASSERT_EQUAL_INT16(-100, packet.entries[0].vy);
+  TEST_ASSERT_EQUAL_INT16(0, packet.entries[0].vz);
+}
+
+void testThatOutOfRangeValuesSaturate() {
+  // Fixture
+  peerGossipPacket_t packet;
+  int cursor = 0;
+  ownPos.x = 100.0f;
+  ownVel.z = -1000.0f;
+
+  // Test
+  peerGossipFillPacket(&packet, OWN_ID, &ownPos, &ownVel, nowMs, &cursor);
+
+  // Assert
+  TEST_ASSERT_EQUAL_INT16(INT16_MAX, packet.entries[0].x);
+  TEST_ASSERT_EQUAL_INT16(INT16_MIN, packet.entries[0].vz);
+}
+
+void testThatPacketFitsInP2PPacket() {
+  // Fixture
+
+  // Test
+  // Assert
+  TEST_ASSERT_TRUE(sizeof(peerGossipPacket_t) <= 60);
+}
+
+void testThatPeersAreRelayedWithTheirAge() {
+  // Fixture
+  peerGossipPacket_t packet;
+  int cursor = 0;
+  tellPosition(20, 3.0f);
+  nowMs += 120;
+
+  // Test
+  int actual = peerGossipFillPacket(&packet, OWN_ID, &ownPos, &ownVel, nowMs, &cursor);
+
+  // Assert
+  TEST_ASSERT_EQUAL_INT(2 * sizeof(peerGossipEntry_t), actual);
+  TEST_ASSERT_EQUAL_UINT8(20, packet.entries[1].id);
+  TEST_ASSERT_EQUAL_UINT8(12, packet.entries[1].age);
+  TEST_ASSERT_EQUAL_INT16(3000, packet.entries[1].x);
+}
+
+void testThatStalePeersAreNotRelayed() {
+  // Fixture
+  peerGossipPacket_t packet;
+  int cursor = 0;
+  tellPosition(20, 3.0f);
+  nowMs += PEER_GOSSIP_MAX_RELAY_AGE_MS + 1;
+
+  // Test
+  int actual = peerGossipFillPacket(&packet, OWN_ID, &ownPos, &ownVel, nowMs, &cursor);
+
+  // Assert
+  TEST_ASSERT_EQUAL_INT(sizeof(peerGossipEntry_t), actual);
+}
+
+void testThatAllPeersAreRelayedRoundRobin() {
+  // Fixture
+  peerGossipPacket_t packet;
+  int cursor = 0;
+  const int peerCount = 10;
+  for (int id = 1; id <= peerCount; id++) {
+    tellPosition(id + 100, 0.0f);
+  }
+  int relayCount[peerCount];
+  for (int i = 0; i < peerCount; i++) {
+    relayCount[i] = 0;
+  }
+
+  // Test
+  const int packetCount = peerCount;
+  for (int i = 0; i < packetCount; i++) {
+    int size = peerGossipFillPacket(&packet, OWN_ID, &ownPos, &ownVel, nowMs, &cursor);
+    TEST_ASSERT_EQUAL_INT(PEER_GOSSIP_MAX_ENTRIES * sizeof(peerGossipEntry_t), size);
+    for (int j = 1; j < PEER_GOSSIP_MAX_ENTRIES; j++) {
+      relayCount[packet.entries[j].id - 101]++;
+    }
+  }
+
+  // Assert
+  for (int i = 0; i < peerCount; i++) {
+    TEST_ASSERT_EQUAL_INT(PEER_GOSSIP_MAX_ENTRIES - 1, relayCount[i]);
+  }
+}
+
+void testThatReceivedStatesAreFedToPeerLocalization() {
+  // Fixture
+  peerGossipPacket_t packet;
+  int cursor = 0;
+  tellPosition(20, 3.0f);
+  nowMs += 100;
+  int size = peerGossipFillPacket(&packet, 30, &ownPos, &ownVel, nowMs, &cursor);
+  peerLocalizationInit();
+
+  // Test
+  int actual = peerGossipHandlePacket(&packet, size, OWN_ID, nowMs);
+
+  // Assert
+  TEST_ASSERT_EQUAL_INT(2, actual);
+
+  peerLocalizationOtherPosition_t* sender = peerLocalizationGetPositionByID(30);
+  TEST_ASSERT_NOT_NULL(sender);
+  TEST_ASSERT_FLOAT_WITHIN(0.0005f, 1.2345f, sender->pos.x);
+  TEST_ASSERT_FLOAT_WITHIN(0.005f, -1.0f, sender->vel.y);
+  TEST_ASSERT_EQUAL_UINT32(nowMs, sender->pos.timestamp);
+
+  peerLocalizationOtherPosition_t* relayed = peerLocalizationGetPositionByID(20);
+  TEST_ASSERT_NOT_NULL(relayed);
+  TEST_ASSERT_FLOAT_WITHIN(0.0005f, 3.0f, relayed->pos.x);
+  TEST_ASSERT_EQUAL_UINT32(nowMs - 100, relayed->pos.timestamp);
+}
+
+void testThatOwnStateIsNotFedToPeerLocalization() {
+  // Fixture
+  peerGossipPacket_t packet;
+  int cursor = 0;
+  int size = peerGossipFillPacket(&packet, OWN_ID, &ownPos, &ownVel, nowMs, &cursor);
+
+  // Test
+  int actual = peerGossipHandlePacket(&packet, size, OWN_ID, nowMs);
+
+  // Assert
+  TEST_ASSERT_EQUAL_INT(0, actual);
+  TEST_ASSERT_NULL(peerLocalizationGetPositionByID(OWN_ID));
+}
+
+void testThatRelayedStateDoesNotOverwriteNewerState() {
+  // Fixture
+  peerGossipPacket_t packet;
+  int cursor = 0;
+  tellPosition(20, 3.0f);
+  nowMs += 100;
+  int size = peerGossipFillPacket(&packet, 30, &ownPos, &ownVel, nowMs, &cursor);
+  peerLocalizationInit();
+  tellPosition(20, 4.0f);
+
+  // Test
+  peerGossipHandlePacket(&packet, size, OWN_ID, nowMs);
+
+  // Assert
+  TEST_ASSERT_EQUAL_FLOAT(4.0f, peerLocalizationGetPositionByID(20)->pos.x);
+}
+
+void testThatPacketWithInvalidSizeIsRejected() {
+  // Fixture
+  peerGossipPacket_t packet = {0};
+
+  // Test
+  // Assert
+  TEST_ASSERT_EQUAL_INT(-1, peerGossipHandlePacket(&packet, 0, OWN_ID, nowMs));
+  TEST_ASSERT_EQUAL_INT(-1, peerGossipHandlePacket(&packet, sizeof(peerGossipEntry_t) + 1, OWN_ID, nowMs));
+  TEST_ASSERT_EQUAL_INT(-1, peerGossipHandlePacket(&packet, sizeof(packet) + sizeof(peerGossipEntry_t), OWN_ID, nowMs));
+}
+
+void testThatAloneCrazyflieUsesMinPeriod() {
+  // Fixture
+
+  // Test
+  uint32_t actual = peerGossipComputePeriodMs(0.0f, 100);
+
+  // Assert
+  TEST_ASSERT_EQUAL_UINT32(PEER_GOSSIP_MIN_PERIOD_MS, actual);
+}
+
+void testThatPeriodSharesChannelBudgetInLargeSwarm() {
+  // Fixture
+  const int crazyflieCount = 40;
+  uint32_t periodMs = PEER_GOSSIP_MIN_PERIOD_MS;
+
+  // Test
+  // All Crazyflies use the same period, we receive the packets from the others
+  for (int i = 0; i < 10; i++) {
+    float rxRate = (crazyflieCount - 1) * 1000.0f / periodMs;
+    periodMs = peerGossipComputePeriodMs(rxRate, periodMs);
+  }
+
+  // Assert
+  TEST_ASSERT_UINT32_WITHIN(1, crazyflieCount * 1000 / PEER_GOSSIP_CHANNEL_BUDGET, periodMs);
+}
+
+void testThatPeriodIsLimitedUnderHeavyLoad() {
+  // Fixture
+
+  // Test
+  uint32_t actual = peerGossipComputePeriodMs(10000.0f, 100);
+
+  // Assert
+  TEST_ASSERT_EQUAL_UINT32(PEER_GOSSIP_MAX_PERIOD_MS, actual);
+}
+
+// Helpers
+
+static void tellPosition(int id, float x) {
+  positionMeasurement_t pos = {.x = x, .y = 0.0f, .z = 0.0f};
+  TEST_ASSERT_TRUE(peerLocalizationTellPosition(id, &pos));
+}
@@ -0,0 +1,296 @@
+// File under test peer_localization.c
+#include "peer_localization.h"
+
+#include "unity.h"
+
+static uint32_t nowMs;
+static int criticalNesting;
+
+static void tellPosition(int id, float x);
+
+void setUp(void) {
+  nowMs = 10000;
+  criticalNesting = 0;
+  peerLocalizationInit();
+}
+
+void tearDown(void) {
+  TEST_ASSERT_EQUAL_INT(0, criticalNesting);
+}
+
+uint32_t xTaskGetTickCount() {
+  return nowMs;
+}
+
+void vPortEnterCritical(void) {
+  criticalNesting++;
+}
+
+void vPortExitCritical(void) {
+  criticalNesting--;
+}
+
+void testThatMoreThanTenPeersAreTracked() {
+  // Fixture
+
+  // Test
+  for (int id = 1; id <= PEER_LOCALIZATION_MAX_NEIGHBORS; id++) {
+    tellPosition(id, id);
+  }
+
+  // Assert
+  TEST_ASSERT_EQUAL_INT(PEER_LOCALIZATION_MAX_NEIGHBORS, peerLocalizationGetCount());
+  for (int id = 1; id <= PEER_LOCALIZATION_MAX_NEIGHBORS; id++) {
+    peerLocalizationOtherPosition_t* actual = peerLocalizationGetPositionByID(id);
+    TEST_ASSERT_NOT_NULL(actual);
+    TEST_ASSERT_EQUAL_UINT8(id, actual->id);
+    TEST_ASSERT_EQUAL_FLOAT(id, actual->pos.x);
+  }
+}
+
+void testThatUnknownIdIsNotFound() {
+  // Fixture
+  tellPosition(17, 1.0f);
+
+  // Test
+  // Assert
+  TEST_ASSERT_NULL(peerLocalizationGetPositionByID(42));
+  TEST_ASSERT_FALSE(peerLocalizationIsIDActive(42));
+  TEST_ASSERT_TRUE(peerLocalizationIsIDActive(17));
+}
+
+void testThatIdZeroIsRejected() {
+  // Fixture
+  positionMeasurement_t pos = {.x = 1.0f};
+
+  // Test
+  bool actual = peerLocalizationTellPosition(0, &pos);
+
+  // Assert
+  TEST_ASSERT_FALSE(actual);
+  TEST_ASSERT_EQUAL_INT(0, peerLocalizationGetCount());
+  TEST_ASSERT_NULL(peerLocalizationGetPositionByID(0));
+}
+
+void testThatUpdateDoesNotAddPeer() {
+  // Fixture
+  tellPosition(17, 1.0f);
+
+  // Test
+  nowMs += 10;
+  tellPosition(17, 2.0f);
+
+  // Assert
+  TEST_ASSERT_EQUAL_INT(1, peerLocalizationGetCount());
+  TEST_ASSERT_EQUAL_FLOAT(2.0f, peerLocalizationGetPositionByID(17)->pos.x);
+  TEST_ASSERT_EQUAL_UINT32(nowMs, peerLocalizationGetPositionByID(17)->pos.timestamp);
+}
+
+void testThatNewPeerIsDroppedWhenTableIsFullOfFreshPeers() {
+  // Fixture
+  for (int id = 1; id <= PEER_LOCALIZATION_MAX_NEIGHBORS; id++) {
+    tellPosition(id, 0.0f);
+  }
+  nowMs += PEER_LOCALIZATION_EVICTION_AGE_MS;
+
+  // Test
+  positionMeasurement_t pos = {.x = 1.0f};
+  bool actual = peerLocalizationTellPosition(200, &pos);
+
+  // Assert
+  TEST_ASSERT_FALSE(actual);
+  TEST_ASSERT_NULL(peerLocalizationGetPositionByID(200));
+  TEST_ASSERT_EQUAL_INT(PEER_LOCALIZATION_MAX_NEIGHBORS, peerLocalizationGetCount());
+}
+
+void testThatStalePeerIsReplacedWhenTableIsFull() {
+  // Fixture
+  for (int id = 1; id <= PEER_LOCALIZATION_MAX_NEIGHBORS; id++) {
+    tellPosition(id, 0.0f);
+  }
+  nowMs += PEER_LOCALIZATION_EVICTION_AGE_MS + 1;
+  for (int id = 1; id <= PEER_LOCALIZATION_MAX_NEIGHBORS; id++) {
+    if (id != 5) {
+      tellPosition(id, 0.0f);
+    }
+  }
+
+  // Test
+  positionMeasurement_t pos = {.x = 1.0f};
+  bool actual = peerLocalizationTellPosition(200, &pos);
+
+  // Assert
+  TEST_ASSERT_TRUE(actual);
+  TEST_ASSERT_NULL(peerLocalizationGetPositionByID(5));
+  TEST_ASSERT_NOT_NULL(peerLocalizationGetPositionByID(200));
+  TEST_ASSERT_EQUAL_INT(PEER_LOCALIZATION_MAX_NEIGHBORS, peerLocalizationGetCount());
+}
+
+void testThatStalePeersAreRemoved() {
+  // Fixture
+  tellPosition(1, 0.0f);
+  tellPosition(2, 0.0f);
+  nowMs += 500;
+  tellPosition(3, 0.0f);
+  nowMs += 500;
+  tellPosition(4, 0.0f);
+
+  // Test
+  peerLocalizationRemoveStale(600);
+
+  // Assert
+  TEST_ASSERT_EQUAL_INT(2, peerLocalizationGetCount());
+  TEST_ASSERT_NULL(peerLocalizationGetPositionByID(1));
+  TEST_ASSERT_NULL(peerLocalizationGetPositionByID(2));
+  TEST_ASSERT_NOT_NULL(peerLocalizationGetPositionByID(3));
+  TEST_ASSERT_NOT_NULL(peerLocalizationGetPositionByID(4));
+}
+
+void testThatStalePeersAreRemovedWhenAnotherPeerIsUpdated() {
+  // Fixture
+  tellPosition(1, 0.0f);
+  tellPosition(2, 0.0f);
+  nowMs += PEER_LOCALIZATION_STALE_AGE_MS / 2;
+  tellPosition(2, 0.0f);
+
+  // Test
+  nowMs += PEER_LOCALIZATION_STALE_AGE_MS / 2 + 1;
+  tellPosition(3, 0.0f);
+
+  // Assert
+  TEST_ASSERT_EQUAL_INT(2, peerLocalizationGetCount());
+  TEST_ASSERT_NULL(peerLocalizationGetPositionByID(1));
+  TEST_ASSERT_NOT_NULL(peerLocalizationGetPositionByID(2));
+  TEST_ASSERT_NOT_NULL(peerLocalizationGetPositionByID(3));
+}
+
+void testThatIterationByIndexOnlyVisitsActivePeers() {
+  // Fixture
+  for (int id = 1; id <= 6; id++) {
+    tellPosition(id * 10, 0.0f);
+  }
+  nowMs += 1000;
+  tellPosition(20, 0.0f);
+  tellPosition(50, 0.0f);
+  peerLocalizationRemoveStale(500);
+
+  // Test
+  int idSum = 0;
+  for (int i = 0; i < peerLocalizationGetCount(); i++) {
+    peerLocalizationOtherPosition_t* other = peerLocalizationGetPositionByIdx(i);
+    TEST_ASSERT_NOT_NULL(other);
+    TEST_ASSERT_EQUAL_PTR(other, peerLocalizationGetPositionByID(other->id));
+    idSum += other->id;
+  }
+
+  // Assert
+  TEST_ASSERT_EQUAL_INT(2, peerLocalizationGetCount());
+  TEST_ASSERT_EQUAL_INT(70, idSum);
+  TEST_ASSERT_NULL(peerLocalizationGetPositionByIdx(2));
+}
+
+void testThatCopyByIndexFailsPastTheLastPeer() {
+  // Fixture
+  tellPosition(17, 1.0f);
+  tellPosition(42, 2.0f);
+  peerLocalizationOtherPosition_t copy = {0};
+
+  // Test
+  bool actualInRange = peerLocalizationCopyPositionByIdx(1, &copy);
+  bool actualPastLast = peerLocalizationCopyPositionByIdx(2, &copy);
+
+  // Assert
+  TEST_ASSERT_TRUE(actualInRange);
+  TEST_ASSERT_FALSE(actualPastLast);
+  TEST_ASSERT_EQUAL_UINT8(42, copy.id);
+  TEST_ASSERT_EQUAL_FLOAT(2.0f, copy.pos.x);
+}
+
+void testThatPositionsAreCopiedWithoutStalePeers() {
+  // Fixture
+  tellPosition(17, 1.0f);
+  nowMs += 1000;
+  tellPosition(42, 2.0f);
+  tellPosition(43, 3.0f);
+  float positions[3 * PEER_LOCALIZATION_MAX_NEIGHBORS];
+  uint8_t ids[PEER_LOCALIZATION_MAX_NEIGHBORS];
+
+  // Test
+  int actualFresh = peerLocalizationCopyPositions(positions, ids, PEER_LOCALIZATION_MAX_NEIGHBORS, 500);
+  int actualLimited = peerLocalizationCopyPositions(positions, ids, 1, -1);
+  int actualAll = peerLocalizationCopyPositions(positions, ids, PEER_LOCALIZATION_MAX_NEIGHBORS, -1);
+
+  // Assert
+  TEST_ASSERT_EQUAL_INT(2, actualFresh);
+  TEST_ASSERT_EQUAL_INT(1, actualLimited);
+  TEST_ASSERT_EQUAL_INT(3, actualAll);
+  TEST_ASSERT_EQUAL_UINT8(17, ids[0]);
+  TEST_ASSERT_EQUAL_FLOAT(1.0f, positions[0]);
+  TEST_ASSERT_EQUAL_UINT8(43, ids[2]);
+  TEST_ASSERT_EQUAL_FLOAT(3.0f, positions[6]);
+}
+
+void testThatVelocityIsEstimated() {
+  // Fixture
+  tellPosition(17, 0.0f);
+
+  // Test
+  for (int i = 1; i <= 20; i++) {
+    nowMs += 10;
+    tellPosition(17, i * 0.01f);
+  }
+
+  // Assert
+  TEST_ASSERT_FLOAT_WITHIN(0.01f, 1.0f, peerLocalizationGetPositionByID(17)->vel.x);
+  TEST_ASSERT_FLOAT_WITHIN(0.01f, 0.0f, peerLocalizationGetPositionByID(17)->vel.y);
+}
+
+void testThatVelocityIsResetAfterLongGap() {
+  // Fixture
+  tellPosition(17, 0.0f);
+  nowMs += 10;
+  tellPosition(17, 0.01f);
+
+  // Test
+  nowMs += PEER_LOCALIZATION_VELOCITY_MAX_DT_MS + 1;
+  tellPosition(17, 5.0f);
+
+  // Assert
+  TEST_ASSERT_EQUAL_FLOAT(0.0f, peerLocalizationGetPositionByID(17)->vel.x);
+}
+
+void testThatRelayedStateIsStoredWithItsTimestamp() {
+  // Fixture
+  point_t pos = {.timestamp = nowMs - 100, .x = 1.0f};
+  velocity_t vel = {.x = 2.0f};
+
+  // Test
+  bool actual = peerLocalizationTellState(17, &pos, &vel);
+
+  // Assert
+  TEST_ASSERT_TRUE(actual);
+  TEST_ASSERT_EQUAL_UINT32(nowMs - 100, peerLocalizationGetPositionByID(17)->pos.timestamp);
+  TEST_ASSERT_EQUAL_FLOAT(1.0f, peerLocalizationGetPositionByID(17)->pos.x);
+  TEST_ASSERT_EQUAL_FLOAT(2.0f, peerLocalizationGetPositionByID(17)->vel.x);
+}
+
+void testThatOlderRelayedStateIsIgnored() {
+  // Fixture
+  tellPosition(17, 1.0f);
+  point_t pos = {.timestamp = nowMs - 100, .x = 5.0f};
+  velocity_t vel = {.x = 0.0f};
+
+  // Test
+  bool actual = peerLocalizationTellState(17, &pos, &vel);
+
+  // Assert
+  TEST_ASSERT_FALSE(actual);
+  TEST_ASSERT_EQUAL_FLOAT(1.0f, peerLocalizationGetPositionByID(17)->pos.x);
+}
+
+// Helpers
+
+static void tellPosition(int id, float x) {
+  positionMeasurement_t pos = {.x = x, .y = 0.0f, .z = 0.0f};
+  TEST_ASSERT_TRUE(peerLocalizationTellPosition(id, &pos));
+}
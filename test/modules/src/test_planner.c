@@ -0,0 +1,95 @@
+// File under test planner.c
+#include "planner.h"
+
+#include "pptraj.h"
+#include "pptraj_compressed.h"
+#include "pptraj_stream.h"
+
+#include "unity.h"
+
+#define CAPACITY 4
+#define PIECE_DURATION 1.0f
+
+static struct planner planner;
+static struct poly4d ringBuffer[CAPACITY];
+static struct piecewise_traj_stream stream;
+
+static void fixtureAppendPieces(const int count);
+static void fixtureStartStream(const float t, const float timescale, const bool relative, const struct vec start_from);
+
+void setUp(void) {
+  plan_init(&planner);
+  piecewise_stream_init(&stream, ringBuffer, CAPACITY);
+}
+
+void tearDown(void) {
+  // Empty
+}
+
+void testThatRelativeStreamStartsAtStartPosition() {
+  // Fixture
+  fixtureAppendPieces(CAPACITY);
+
+  // Test
+  fixtureStartStream(10, 1, true, mkvec(5, 0, 1));
+
+  // Assert
+  struct traj_eval actual = plan_current_goal(&planner, 10);
+  TEST_ASSERT_FLOAT_WITHIN(1e-5, 5.0f, actual.pos.x);
+}
+
+void testThatRestartedRelativeStreamContinuesFromStartPosition() {
+  // Fixture
+  fixtureAppendPieces(CAPACITY);
+  fixtureStartStream(10, 1, false, vzero());
+  // Fly half way into the third piece, the first two pieces are freed
+  plan_current_goal(&planner, 10 + 2.5f);
+  TEST_ASSERT_EQUAL_UINT8(2, piecewise_stream_free_count(&stream));
+
+  // Test
+  fixtureStartStream(20, 2, true, mkvec(5, 0, 1));
+
+  // Assert
+  // The restart continues from the start of the oldest piece that is left, x = 2
+  struct traj_eval actual = plan_current_goal(&planner, 20);
+  TEST_ASSERT_FLOAT_WITHIN(1e-5, 5.0f, actual.pos.x);
+  actual = plan_current_goal(&planner, 20 + 1);
+  TEST_ASSERT_FLOAT_WITHIN(1e-5, 5.5f, actual.pos.x);
+}
+
+void testThatChangedPiecesAreUsedForTheFinishedCheck() {
+  // Fixture
+  struct poly4d pieces[2] = {
+    poly4d_linear(PIECE_DURATION, mkvec(0, 0, 1), mkvec(1, 0, 1), 0, 0),
+    poly4d_linear(PIECE_DURATION, mkvec(1, 0, 1), mkvec(2, 0, 1), 0, 0),
+  };
+  struct piecewise_traj trajectory = {.t_begin = 10, .timescale = 1, .n_pieces = 2, .pieces = pieces};
+  plan_start_trajectory(&planner, &trajectory, false, false, vzero());
+  TEST_ASSERT_TRUE(plan_is_finished(&planner, 10 + 2.5f));
+
+  // Test
+  // The pieces are overwritten in memory while flying
+  pieces[1].duration = 2 * PIECE_DURATION;
+  plan_trajectory_changed(&planner);
+
+  // Assert
+  TEST_ASSERT_FALSE(plan_is_finished(&planner, 10 + 2.5f));
+  TEST_ASSERT_TRUE(plan_is_finished(&planner, 10 + 3.0f));
+}
+
+// Helpers
+
+// Pieces along the x-axis at 1 m/s, piece i starts at x = i
+static void fixtureAppendPieces(const int count) {
+  for (int i = 0; i < count; i++) {
+    struct poly4d piece = poly4d_linear(PIECE_DURATION, mkvec(i, 0, 1), mkvec(i + 1, 0, 1), 0, 0);
+    TEST_ASSERT_TRUE(piecewise_stream_append(&stream, &piece));
+  }
+}
+
+// Start the stream the same way as the high level commander
+static void fixtureStartStream(const float t, const float timescale, const bool relative, const struct vec start_from) {
+  stream.t_begin = t - stream.head_begin * timescale;
+  stream.timescale = timescale;
+  TEST_ASSERT_EQUAL_INT(0, plan_start_stream_trajectory(&planner, &stream, relative, start_from));
+}
@@ -9,6 +9,13 @@
 
 // #define SHOW_OUTPUT
 
+static struct traj_eval referenceEval(struct piecewise_traj const *traj, float t, bool reversed);
+static void assertTrajEvalWithin(struct traj_eval const *expected, struct traj_eval const *actual);
+static void fixtureLinearCompressedTrajectory(uint8_t* data, int n_pieces);
+static struct vec linearCompressedTrajectoryPosition(int n_pieces, float t);
+static int linearPieceDurationMsec(int k);
+static uint8_t* appendInt16(uint8_t* ptr, int16_t value);
+
 struct poly4d figure8_pieces[] = {
   {
     .p = {
@@ -431,3 +438,284 @@ void testCompressedFigure8RandomOrderQueries(void) {
   printf("Maximum difference = %.4f\n", maxdiff);
 #endif
 }
+
+void testCompressedSeekInLongTrajectory(void) {
+  // Fixture
+  const int n_pieces = 100;
+  uint8_t data[8 + 100 * 9 + 3];
+  struct piecewise_traj_compressed traj;
+
+  fixtureLinearCompressedTrajectory(data, n_pieces);
+  piecewise_compressed_load(&traj, data);
+  traj.t_begin = 2;
+
+  float duration = piecewise_compressed_duration(&traj);
+  TEST_ASSERT_GREATER_THAN(1, traj.index_stride);
+  TEST_ASSERT_LESS_OR_EQUAL(PPTRAJ_COMPRESSED_INDEX_SIZE, traj.index_count);
+
+  // Test
+  // Jump around in the trajectory, both backwards and forwards
+  for (int j = 0; j < 500; j++) {
+    float t = duration * ((j * 137) % 500) / 500.0f;
+    struct traj_eval actual = piecewise_compressed_eval(&traj, traj.t_begin + t);
+
+    // Assert
+    struct vec expected = linearCompressedTrajectoryPosition(n_pieces, t);
+    TEST_ASSERT_FLOAT_WITHIN(1e-4, expected.x, actual.pos.x);
+    TEST_ASSERT_FLOAT_WITHIN(1e-4, expected.y, actual.pos.y);
+    TEST_ASSERT_FLOAT_WITHIN(1e-4, expected.z, actual.pos.z);
+  }
+}
+
+void testCompressedTimescale(void) {
+  // Fixture
+  struct piecewise_traj_compressed traj;
+  struct piecewise_traj_compressed scaled;
+
+  piecewise_compressed_load(&traj, figure8_compressed_pieces);
+  traj.t_begin = 2;
+  piecewise_compressed_load(&scaled, figure8_compressed_pieces);
+  scaled.t_begin = 2;
+  scaled.timescale = 2;
+
+  float duration = piecewise_compressed_duration(&traj);
+
+  // Test
+  for (float t = 0; t < duration; t += 0.1) {
+    struct traj_eval expected = piecewise_compressed_eval(&traj, traj.t_begin + t);
+    struct traj_eval actual = piecewise_compressed_eval(&scaled, scaled.t_begin + 2 * t);
+
+    // Assert
+    TEST_ASSERT_FLOAT_WITHIN(1e-5, expected.pos.x, actual.pos.x);
+    TEST_ASSERT_FLOAT_WITHIN(1e-5, expected.pos.y, actual.pos.y);
+    TEST_ASSERT_FLOAT_WITHIN(1e-5, expected.vel.x / 2, actual.vel.x);
+    TEST_ASSERT_FLOAT_WITHIN(1e-5, expected.vel.y / 2, actual.vel.y);
+    TEST_ASSERT_FLOAT_WITHIN(1e-5, expected.acc.x / 4, actual.acc.x);
+    TEST_ASSERT_FALSE(piecewise_compressed_is_finished(&scaled, scaled.t_begin + 2 * t));
+  }
+  TEST_ASSERT_TRUE(piecewise_compressed_is_finished(&scaled, scaled.t_begin + 2 * duration));
+}
+
+void testCompressedReversedEvaluation(void) {
+  // Fixture
+  struct piecewise_traj_compressed traj;
+  struct piecewise_traj_compressed reversed;
+
+  piecewise_compressed_load(&traj, figure8_compressed_pieces);
+  traj.t_begin = 2;
+  traj.shift = mkvec(-1, 2, 3);
+  piecewise_compressed_load(&reversed, figure8_compressed_pieces);
+  reversed.t_begin = 2;
+  reversed.shift = mkvec(-1, 2, 3);
+
+  float duration = piecewise_compressed_duration(&traj);
+
+  // Test
+  for (float t = 0; t < duration; t += 0.1) {
+    struct traj_eval expected = piecewise_compressed_eval(&traj, traj.t_begin + duration - t);
+    struct traj_eval actual = piecewise_compressed_eval_reversed(&reversed, reversed.t_begin + t);
+
+    // Assert
+    TEST_ASSERT_FLOAT_WITHIN(1e-5, expected.pos.x, actual.pos.x);
+    TEST_ASSERT_FLOAT_WITHIN(1e-5, expected.pos.y, actual.pos.y);
+    TEST_ASSERT_FLOAT_WITHIN(1e-5, expected.pos.z, actual.pos.z);
+    TEST_ASSERT_FLOAT_WITHIN(1e-5, -expected.vel.x, actual.vel.x);
+    TEST_ASSERT_FLOAT_WITHIN(1e-5, -expected.vel.y, actual.vel.y);
+    TEST_ASSERT_FLOAT_WITHIN(1e-5, expected.acc.x, actual.acc.x);
+  }
+
+  // Stays at the start point when finished
+  struct traj_eval start = piecewise_compressed_eval(&traj, traj.t_begin);
+  struct traj_eval actual = piecewise_compressed_eval_reversed(&reversed, reversed.t_begin + duration + 1);
+  TEST_ASSERT_FLOAT_WITHIN(1e-5, start.pos.x, actual.pos.x);
+  TEST_ASSERT_FLOAT_WITHIN(1e-5, start.pos.y, actual.pos.y);
+  TEST_ASSERT_EQUAL_FLOAT(0, actual.vel.x);
+  TEST_ASSERT_EQUAL_FLOAT(0, actual.vel.y);
+}
+
+void testCursorEvaluationMatchesStretchedPieces(void) {
+  // Fixture
+  struct piecewise_traj traj;
+  struct piecewise_cursor cursor;
+  float duration, t;
+
+  traj.t_begin = 2;
+  traj.timescale = 1.5;
+  traj.n_pieces = sizeof(figure8_pieces) / sizeof(figure8_pieces[0]);
+  traj.pieces = figure8_pieces;
+  traj.shift = mkvec(-1, 2, 3);
+  piecewise_cursor_reset(&cursor, &traj);
+
+  // Test
+  duration = piecewise_duration(&traj);
+  for (t = traj.t_begin - 0.5; t < traj.t_begin + duration + 0.5; t += 0.01) {
+    struct traj_eval actual = piecewise_eval_cursor(&traj, &cursor, t);
+    struct traj_eval expected = referenceEval(&traj, t, false);
+
+    // Assert
+    assertTrajEvalWithin(&expected, &actual);
+    TEST_ASSERT(piecewise_is_finished_cursor(&traj, &cursor, t) == piecewise_is_finished(&traj, t));
+  }
+}
+
+void testReversedCursorEvaluationMatchesReflectedPieces(void) {
+  // Fixture
+  struct piecewise_traj traj;
+  struct piecewise_cursor cursor;
+  float duration, t;
+
+  traj.t_begin = 2;
+  traj.timescale = 0.8;
+  traj.n_pieces = sizeof(figure8_pieces) / sizeof(figure8_pieces[0]);
+  traj.pieces = figure8_pieces;
+  traj.shift = mkvec(-1, 2, 3);
+  piecewise_cursor_reset(&cursor, &traj);
+
+  // Test
+  duration = piecewise_duration(&traj);
+  for (t = traj.t_begin - 0.5; t < traj.t_begin + duration + 0.5; t += 0.01) {
+    struct traj_eval actual = piecewise_eval_reversed_cursor(&traj, &cursor, t);
+    struct traj_eval expected = referenceEval(&traj, t, true);
+
+    // Assert
+    assertTrajEvalWithin(&expected, &actual);
+  }
+}
+
+void testCursorEvaluationInRandomOrder(void) {
+  // Fixture
+  struct piecewise_traj traj;
+  struct piecewise_cursor cursor;
+  float duration, t;
+
+  traj.t_begin = 2;
+  traj.timescale = 1;
+  traj.n_pieces = sizeof(figure8_pieces) / sizeof(figure8_pieces[0]);
+  traj.pieces = figure8_pieces;
+  traj.shift = vzero();
+  piecewise_cursor_reset(&cursor, &traj);
+
+  // Test
+  duration = piecewise_duration(&traj);
+  for (int i = 0; i < 100; i++) {
+    t = traj.t_begin + (rand() / (float)RAND_MAX) * (duration + 1) - 0.5;
+
+    struct traj_eval actual = piecewise_eval_cursor(&traj, &cursor, t);
+    struct traj_eval expected = referenceEval(&traj, t, false);
+
+    // Assert
+    assertTrajEvalWithin(&expected, &actual);
+  }
+}
+
+void testPolynomialAndDerivativesAreEvaluatedInOnePass(void) {
+  // Fixture
+  float p[PP_SIZE];
+  memcpy(p, figure8_pieces[3].p[0], sizeof(p));
+  const float t = 0.7;
+
+  float expected[4];
+  for (int i = 0; i < 4; i++) {
+    expected[i] = polyval(p, t);
+    polyder(p);
+  }
+
+  // Test
+  float actual[4];
+  polyval_derivs(figure8_pieces[3].p[0], t, actual);
+
+  // Assert
+  for (int i = 0; i < 4; i++) {
+    TEST_ASSERT_FLOAT_WITHIN(1e-5, expected[i], actual[i]);
+  }
+}
+
+// Helpers
+
+// Evaluation by modifying the coefficients of the pieces, as done before the cursor was introduced
+static struct traj_eval referenceEval(struct piecewise_traj const *traj, float t, bool reversed) {
+  t = t - traj->t_begin;
+  for (int i = 0; i < traj->n_pieces; i++) {
+    int cursor = reversed ? traj->n_pieces - 1 - i : i;
+    struct poly4d piece = traj->pieces[cursor];
+    float duration = piece.duration * traj->timescale;
+    if (t <= duration) {
+      poly4d_shift(&piece, traj->shift.x, traj->shift.y, traj->shift.z, 0);
+      poly4d_stretchtime(&piece, traj->timescale);
+      if (reversed) {
+        for (int j = 0; j < 4; j++) {
+          polyreflect(piece.p[j]);
+        }
+        t = t - duration;
+      }
+      return poly4d_eval(&piece, t);
+    }
+    t -= duration;
+  }
+
+  struct poly4d const *end_piece = &traj->pieces[reversed ? 0 : traj->n_pieces - 1];
+  struct traj_eval ev = poly4d_eval(end_piece, reversed ? 0.0f : end_piece->duration);
+  ev.pos = vadd(ev.pos, traj->shift);
+  ev.vel = vzero();
+  ev.acc = vzero();
+  ev.omega = vzero();
+  return ev;
+}
+
+static void assertTrajEvalWithin(struct traj_eval const *expected, struct traj_eval const *actual) {
+  TEST_ASSERT_FLOAT_WITHIN(1e-4, expected->pos.x, actual->pos.x);
+  TEST_ASSERT_FLOAT_WITHIN(1e-4, expected->pos.y, actual->pos.y);
+  TEST_ASSERT_FLOAT_WITHIN(1e-4, expected->pos.z, actual->pos.z);
+  TEST_ASSERT_FLOAT_WITHIN(1e-4, expected->yaw, actual->yaw);
+  TEST_ASSERT_FLOAT_WITHIN(1e-3, expected->vel.x, actual->vel.x);
+  TEST_ASSERT_FLOAT_WITHIN(1e-3, expected->vel.y, actual->vel.y);
+  TEST_ASSERT_FLOAT_WITHIN(1e-3, expected->acc.x, actual->acc.x);
+  TEST_ASSERT_FLOAT_WITHIN(1e-3, expected->acc.y, actual->acc.y);
+  TEST_ASSERT_FLOAT_WITHIN(1e-2, expected->omega.x, actual->omega.x);
+  TEST_ASSERT_FLOAT_WITHIN(1e-2, expected->omega.y, actual->omega.y);
+}
+
+// A compressed trajectory of linear pieces with varying durations, x and y are linear, z is constant at 1 m
+static void fixtureLinearCompressedTrajectory(uint8_t* data, int n_pieces) {
+  uint8_t* ptr = data;
+  ptr = appendInt16(ptr, 0);
+  ptr = appendInt16(ptr, 0);
+  ptr = appendInt16(ptr, 1000);
+  ptr = appendInt16(ptr, 0);
+
+  for (int k = 0; k < n_pieces; k++) {
+    *ptr++ = 0x45;
+    ptr = appendInt16(ptr, linearPieceDurationMsec(k));
+    ptr = appendInt16(ptr, (k + 1) * 10);
+    ptr = appendInt16(ptr, -(k + 1) * 5);
+    ptr = appendInt16(ptr, 0);
+  }
+
+  // End of the trajectory
+  *ptr++ = 0;
+  ptr = appendInt16(ptr, 0);
+}
+
+static struct vec linearCompressedTrajectoryPosition(int n_pieces, float t) {
+  float t_begin = 0;
+  for (int k = 0; k < n_pieces; k++) {
+    float duration = linearPieceDurationMsec(k) / 1000.0f;
+    if (t < t_begin + duration) {
+      float fraction = (t - t_begin) / duration;
+      return mkvec((k + fraction) * 0.01f, -(k + fraction) * 0.005f, 1.0f);
+    }
+    t_begin += duration;
+  }
+
+  return mkvec(n_pieces * 0.01f, -n_pieces * 0.005f, 1.0f);
+}
+
+static int linearPieceDurationMsec(int k) {
+  return 100 + 10 * (k % 5);
+}
+
+static uint8_t* appendInt16(uint8_t* ptr, int16_t value) {
+  ptr[0] = value & 0xff;
+  ptr[1] = (value >> 8) & 0xff;
+  return ptr + 2;
+}
@@ -0,0 +1,121 @@
+/**
+ *    ||          ____  _ __
+ * +------+      / __ )(_) /_______________ _____  ___
+ * | 0xBC |     / __  / / __/ ___/ ___/ __ `/_  / / _ \
+ * +------+    / /_/ / / /_/ /__/ /  / /_/ / / /_/  __/
+ *  ||  ||    /_____/_/\__/\___/_/   \__,_/ /___/\___/
+ *
+ * Crazyflie control firmware
+ *
+ * Copyright (C) 2023 Bitcraze AB
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, in version 3.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ *
+ * test_pptraj_benchmark.c - Evaluation time of long piecewise trajectories
+ *
+ * A long trajectory is evaluated at 500 Hz from start to end, as done by the
+ * high level commander, with and without a cursor. The results are printed,
+ * the tests only fail if the evaluations differ.
+ */
+
+// File under test pptraj.c
+#include "pptraj.h"
+
+#include "unity.h"
+
+#include <stdio.h>
+#include <time.h>
+
+#define PIECE_COUNT (250)
+#define PIECE_DURATION (0.5f)
+#define EVAL_RATE (500)
+#define ITERATIONS (10)
+
+static struct poly4d pieces[PIECE_COUNT];
+static struct piecewise_traj traj;
+
+static double runEvaluations(const bool useCursor, const bool reversed, float* checksum);
+
+void setUp(void) {
+  // A zig-zag, the end of each piece matches the start of the next
+  for (int i = 0; i < PIECE_COUNT; i++) {
+    struct vec p0 = mkvec(i * 0.1f, (i % 2) * 0.5f, 1.0f);
+    struct vec p1 = mkvec((i + 1) * 0.1f, ((i + 1) % 2) * 0.5f, 1.0f);
+    pieces[i] = poly4d_linear(PIECE_DURATION, p0, p1, 0, 0);
+  }
+
+  traj.t_begin = 1;
+  traj.timescale = 1.2;
+  traj.shift = mkvec(1, 2, 0);
+  traj.n_pieces = PIECE_COUNT;
+  traj.pieces = pieces;
+}
+
+void tearDown(void) {
+  // Empty
+}
+
+void testBenchmarkForwardEvaluation() {
+  // Fixture
+  float expected = 0;
+  float actual = 0;
+
+  // Test
+  double nsPerEvalSearch = runEvaluations(false, false, &expected);
+  double nsPerEvalCursor = runEvaluations(true, false, &actual);
+
+  // Assert
+  printf("%d pieces: %.0f ns per evaluation, %.0f ns with cursor\n", PIECE_COUNT, nsPerEvalSearch, nsPerEvalCursor);
+  TEST_ASSERT_EQUAL_FLOAT(expected, actual);
+}
+
+void testBenchmarkReversedEvaluation() {
+  // Fixture
+  float expected = 0;
+  float actual = 0;
+
+  // Test
+  double nsPerEvalSearch = runEvaluations(false, true, &expected);
+  double nsPerEvalCursor = runEvaluations(true, true, &actual);
+
+  // Assert
+  printf("%d pieces reversed: %.0f ns per evaluation, %.0f ns with cursor\n", PIECE_COUNT, nsPerEvalSearch, nsPerEvalCursor);
+  TEST_ASSERT_EQUAL_FLOAT(expected, actual);
+}
+
+// Helpers
+
+static double runEvaluations(const bool useCursor, const bool reversed, float* checksum) {
+  struct piecewise_cursor cursor;
+  const int evalCount = piecewise_duration(&traj) * EVAL_RATE;
+
+  *checksum = 0;
+
+  clock_t start = clock();
+  for (int iteration = 0; iteration < ITERATIONS; iteration++) {
+    piecewise_cursor_reset(&cursor, &traj);
+    for (int i = 0; i < evalCount; i++) {
+      const float t = traj.t_begin + (float)i / EVAL_RATE;
+
+      struct traj_eval ev;
+      if (useCursor) {
+        ev = reversed ? piecewise_eval_reversed_cursor(&traj, &cursor, t) : piecewise_eval_cursor(&traj, &cursor, t);
+      } else {
+        ev = reversed ? piecewise_eval_reversed(&traj, t) : piecewise_eval(&traj, t);
+      }
+      *checksum += ev.pos.x + ev.pos.y + ev.vel.x;
+    }
+  }
+
+  return (double)(clock() - start) * 1e9 / CLOCKS_PER_SEC / (ITERATIONS * evalCount);
+}
@@ -0,0 +1,256 @@
+// File under test pptraj_minsnap.c
+#include "pptraj_minsnap.h"
+#include "pptraj.h"
+
+#include <math.h>
+
+#include "unity.h"
+
+#define N_PIECES 4
+
+static struct poly4d pieces[PPTRAJ_MINSNAP_MAX_PIECES + 1];
+static struct piecewise_traj traj;
+
+static const struct vec waypoints[N_PIECES + 1] = {
+  {0.0f, 0.0f, 1.0f},
+  {1.0f, 0.5f, 1.2f},
+  {1.5f, 1.5f, 1.0f},
+  {0.5f, 2.0f, 0.8f},
+  {0.0f, 1.0f, 1.0f},
+};
+static const float yaws[N_PIECES + 1] = {0.0f, 0.5f, 1.0f, 0.5f, 0.0f};
+static const float durations[N_PIECES] = {1.0f, 1.5f, 0.8f, 2.0f};
+
+static void assertVecWithin(float delta, struct vec expected, struct vec actual);
+static void assertContinuousAtEndOfPiece(int piece);
+static void assertHigherDerivativesContinuousAtEndOfPiece(int piece);
+static float snapCost(void);
+
+void setUp(void) {
+  traj.pieces = pieces;
+  traj.t_begin = 0;
+}
+
+void tearDown(void) {
+  // Empty
+}
+
+void testThatTrajectoryPassesThroughWaypoints() {
+  // Fixture
+
+  // Test
+  int actual = piecewise_plan_min_snap(&traj, waypoints, yaws, 0, durations, N_PIECES);
+
+  // Assert
+  TEST_ASSERT_EQUAL_INT(0, actual);
+  TEST_ASSERT_EQUAL_INT(N_PIECES, traj.n_pieces);
+  float t = 0;
+  for (int k = 0; k <= N_PIECES; k++) {
+    struct traj_eval ev = piecewise_eval(&traj, t);
+    assertVecWithin(1e-4, waypoints[k], ev.pos);
+    TEST_ASSERT_FLOAT_WITHIN(1e-4, yaws[k], ev.yaw);
+    if (k < N_PIECES) {
+      t += durations[k];
+    }
+  }
+}
+
+void testThatTrajectoryStartsAndEndsAtRest() {
+  // Fixture
+
+  // Test
+  piecewise_plan_min_snap(&traj, waypoints, yaws, 0, durations, N_PIECES);
+
+  // Assert
+  struct traj_eval start = poly4d_eval(&pieces[0], 0);
+  struct traj_eval end = poly4d_eval(&pieces[N_PIECES - 1], durations[N_PIECES - 1]);
+  assertVecWithin(1e-4, vzero(), start.vel);
+  assertVecWithin(1e-4, vzero(), start.acc);
+  assertVecWithin(1e-3, vzero(), end.vel);
+  assertVecWithin(1e-3, vzero(), end.acc);
+}
+
+void testThatTrajectoryIsContinuousAtWaypoints() {
+  // Fixture
+
+  // Test
+  piecewise_plan_min_snap(&traj, waypoints, yaws, 0, durations, N_PIECES);
+
+  // Assert
+  for (int k = 0; k < N_PIECES - 1; k++) {
+    assertContinuousAtEndOfPiece(k);
+  }
+}
+
+void testThatSnapAndItsDerivativesAreContinuousAtFreeWaypoints() {
+  // Fixture
+
+  // Test
+  piecewise_plan_min_snap(&traj, waypoints, yaws, 0, durations, N_PIECES);
+
+  // Assert
+  // Derivatives 4 to 6 are continuous for the minimum snap trajectory
+  for (int k = 0; k < N_PIECES - 1; k++) {
+    assertHigherDerivativesContinuousAtEndOfPiece(k);
+  }
+}
+
+void testThatVelocityConstraintsAreMet() {
+  // Fixture
+  struct vec velocities[N_PIECES + 1];
+  for (int k = 0; k <= N_PIECES; k++) {
+    velocities[k] = mkvec(NAN, NAN, NAN);
+  }
+  velocities[0] = vzero();
+  velocities[2] = mkvec(0.5f, NAN, -0.2f);
+  velocities[N_PIECES] = mkvec(0.1f, 0.2f, 0.3f);
+
+  // Test
+  int actual = piecewise_plan_min_snap(&traj, waypoints, yaws, velocities, durations, N_PIECES);
+
+  // Assert
+  TEST_ASSERT_EQUAL_INT(0, actual);
+  struct traj_eval atWaypoint = poly4d_eval(&pieces[2], 0);
+  TEST_ASSERT_FLOAT_WITHIN(1e-3, 0.5f, atWaypoint.vel.x);
+  TEST_ASSERT_FLOAT_WITHIN(1e-3, -0.2f, atWaypoint.vel.z);
+  struct traj_eval end = poly4d_eval(&pieces[N_PIECES - 1], durations[N_PIECES - 1]);
+  assertVecWithin(1e-3, velocities[N_PIECES], end.vel);
+  assertContinuousAtEndOfPiece(1);
+}
+
+void testThatSinglePieceIsTheRestToRestPolynomial() {
+  // Fixture
+  struct poly4d expectedPieces[1];
+  struct piecewise_traj expected = {.pieces = expectedPieces};
+  piecewise_plan_7th_order_no_jerk(&expected, 2.0f,
+    waypoints[0], yaws[0], vzero(), 0, vzero(),
+    waypoints[1], yaws[1], vzero(), 0, vzero());
+
+  // Test
+  piecewise_plan_min_snap(&traj, waypoints, yaws, 0, (float[]){2.0f}, 1);
+
+  // Assert
+  for (int axis = 0; axis < 4; axis++) {
+    for (int i = 0; i < PP_SIZE; i++) {
+      TEST_ASSERT_FLOAT_WITHIN(1e-4, expectedPieces[0].p[axis][i], pieces[0].p[axis][i]);
+    }
+  }
+}
+
+void testThatPerturbedTrajectoryHasHigherSnapCost() {
+  // Fixture
+  piecewise_plan_min_snap(&traj, waypoints, yaws, 0, durations, N_PIECES);
+  float optimal = snapCost();
+
+  // Test
+  // Any change of the velocity at a waypoint gives a trajectory with more snap
+  struct vec velocities[N_PIECES + 1];
+  for (int k = 0; k <= N_PIECES; k++) {
+    velocities[k] = mkvec(NAN, NAN, NAN);
+  }
+  velocities[0] = velocities[N_PIECES] = vzero();
+  struct traj_eval atWaypoint = poly4d_eval(&pieces[2], 0);
+  velocities[2] = vadd(atWaypoint.vel, mkvec(0.05f, -0.05f, 0.05f));
+  piecewise_plan_min_snap(&traj, waypoints, yaws, velocities, durations, N_PIECES);
+  float perturbed = snapCost();
+
+  // Assert
+  TEST_ASSERT_TRUE(perturbed > optimal);
+}
+
+void testThatInvalidInputIsRejected() {
+  // Fixture
+  const float zeroDuration[N_PIECES] = {1.0f, 0.0f, 1.0f, 1.0f};
+
+  // Test
+  // Assert
+  TEST_ASSERT_EQUAL_INT(-1, piecewise_plan_min_snap(&traj, waypoints, yaws, 0, durations, 0));
+  TEST_ASSERT_EQUAL_INT(-1, piecewise_plan_min_snap(&traj, waypoints, yaws, 0, durations, PPTRAJ_MINSNAP_MAX_PIECES + 1));
+  TEST_ASSERT_EQUAL_INT(-1, piecewise_plan_min_snap(&traj, waypoints, yaws, 0, zeroDuration, N_PIECES));
+}
+
+void testThatMaxNumberOfPiecesCanBePlanned() {
+  // Fixture
+  struct vec manyWaypoints[PPTRAJ_MINSNAP_MAX_PIECES + 1];
+  float manyDurations[PPTRAJ_MINSNAP_MAX_PIECES];
+  for (int k = 0; k <= PPTRAJ_MINSNAP_MAX_PIECES; k++) {
+    manyWaypoints[k] = mkvec(cosf(k * 0.5f), sinf(k * 0.5f), 1.0f + 0.1f * k);
+    if (k < PPTRAJ_MINSNAP_MAX_PIECES) {
+      manyDurations[k] = 0.5f + 0.1f * (k % 3);
+    }
+  }
+
+  // Test
+  int actual = piecewise_plan_min_snap(&traj, manyWaypoints, 0, 0, manyDurations, PPTRAJ_MINSNAP_MAX_PIECES);
+
+  // Assert
+  TEST_ASSERT_EQUAL_INT(0, actual);
+  for (int k = 0; k < PPTRAJ_MINSNAP_MAX_PIECES; k++) {
+    struct traj_eval end = poly4d_eval(&pieces[k], manyDurations[k]);
+    assertVecWithin(1e-3, manyWaypoints[k + 1], end.pos);
+    TEST_ASSERT_EQUAL_FLOAT(0, end.yaw);
+  }
+}
+
+// Helpers
+
+static void assertVecWithin(float delta, struct vec expected, struct vec actual) {
+  TEST_ASSERT_FLOAT_WITHIN(delta, expected.x, actual.x);
+  TEST_ASSERT_FLOAT_WITHIN(delta, expected.y, actual.y);
+  TEST_ASSERT_FLOAT_WITHIN(delta, expected.z, actual.z);
+}
+
+static void assertContinuousAtEndOfPiece(int piece) {
+  for (int axis = 0; axis < 4; axis++) {
+    float before[4];
+    float after[4];
+    polyval_derivs(pieces[piece].p[axis], pieces[piece].duration, before);
+    polyval_derivs(pieces[piece + 1].p[axis], 0, after);
+    for (int i = 0; i < 4; i++) {
+      TEST_ASSERT_FLOAT_WITHIN(1e-2, before[i], after[i]);
+    }
+  }
+}
+
+static void assertHigherDerivativesContinuousAtEndOfPiece(int piece) {
+  for (int axis = 0; axis < 4; axis++) {
+    float before[PP_SIZE];
+    float after[PP_SIZE];
+    for (int i = 0; i < PP_SIZE; i++) {
+      before[i] = pieces[piece].p[axis][i];
+      after[i] = pieces[piece + 1].p[axis][i];
+    }
+    for (int order = 1; order <= 6; order++) {
+      polyder(before);
+      polyder(after);
+      if (order >= 4) {
+        float expected = polyval(before, pieces[piece].duration);
+        float actual = polyval(after, 0);
+        TEST_ASSERT_FLOAT_WITHIN(1e-2 * (1.0f + fabsf(expected)), expected, actual);
+      }
+    }
+  }
+}
+
+// Integral of the squared snap over the trajectory, x, y and z
+static float snapCost(void) {
+  float cost = 0;
+  for (int k = 0; k < traj.n_pieces; k++) {
+    for (int axis = 0; axis < 3; axis++) {
+      float p[PP_SIZE];
+      for (int i = 0; i < PP_SIZE; i++) {
+        p[i] = pieces[k].p[axis][i];
+      }
+      for (int i = 0; i < 4; i++) {
+        polyder(p);
+      }
+      const int steps = 1000;
+      const float dt = pieces[k].duration / steps;
+      for (int i = 0; i < steps; i++) {
+        float snap = polyval(p, (i + 0.5f) * dt);
+        cost += snap * snap * dt;
+      }
+    }
+  }
+  return cost;
+}
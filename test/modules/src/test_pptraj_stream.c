@@ -0,0 +1,166 @@
+// File under test pptraj_stream.c
+#include "pptraj_stream.h"
+
+#include "unity.h"
+
+#define CAPACITY 4
+#define PIECE_DURATION 1.0f
+
+static struct poly4d ringBuffer[CAPACITY];
+static struct piecewise_traj_stream traj;
+
+static struct poly4d fixturePiece(const int index);
+static void fixtureAppendPieces(const int count);
+
+void setUp(void) {
+  piecewise_stream_init(&traj, ringBuffer, CAPACITY);
+  traj.t_begin = 10;
+}
+
+void tearDown(void) {
+  // Empty
+}
+
+void testThatEmptyStreamIsInvalid() {
+  // Fixture
+
+  // Test
+  struct traj_eval actual = piecewise_stream_eval(&traj, 10);
+
+  // Assert
+  TEST_ASSERT_FALSE(is_traj_eval_valid(&actual));
+}
+
+void testThatPiecesAreAppendedUntilFull() {
+  // Fixture
+  fixtureAppendPieces(CAPACITY);
+  struct poly4d piece = fixturePiece(CAPACITY);
+
+  // Test
+  bool actual = piecewise_stream_append(&traj, &piece);
+
+  // Assert
+  TEST_ASSERT_FALSE(actual);
+  TEST_ASSERT_EQUAL_UINT8(0, piecewise_stream_free_count(&traj));
+}
+
+void testThatPositionIsEvaluatedInTheRightPiece() {
+  // Fixture
+  fixtureAppendPieces(3);
+
+  // Test
+  struct traj_eval actual = piecewise_stream_eval(&traj, 10 + 1.5f);
+
+  // Assert
+  TEST_ASSERT_FLOAT_WITHIN(1e-5, 1.5f, actual.pos.x);
+  TEST_ASSERT_FLOAT_WITHIN(1e-5, 1.0f, actual.vel.x);
+}
+
+void testThatTimescaleIsApplied() {
+  // Fixture
+  fixtureAppendPieces(3);
+  traj.timescale = 2;
+
+  // Test
+  struct traj_eval actual = piecewise_stream_eval(&traj, 10 + 3);
+
+  // Assert
+  TEST_ASSERT_FLOAT_WITHIN(1e-5, 1.5f, actual.pos.x);
+  TEST_ASSERT_FLOAT_WITHIN(1e-5, 0.5f, actual.vel.x);
+}
+
+void testThatPassedPiecesAreFreed() {
+  // Fixture
+  fixtureAppendPieces(CAPACITY);
+
+  // Test
+  piecewise_stream_eval(&traj, 10 + 2.5f);
+
+  // Assert
+  TEST_ASSERT_EQUAL_UINT8(2, piecewise_stream_free_count(&traj));
+}
+
+void testThatFreedSpaceIsReused() {
+  // Fixture
+  fixtureAppendPieces(CAPACITY);
+  piecewise_stream_eval(&traj, 10 + 1.5f);
+  struct poly4d piece = fixturePiece(CAPACITY);
+  TEST_ASSERT_TRUE(piecewise_stream_append(&traj, &piece));
+
+  // Test
+  struct traj_eval actual = piecewise_stream_eval(&traj, 10 + CAPACITY + 0.5f);
+
+  // Assert
+  TEST_ASSERT_FLOAT_WITHIN(1e-4, CAPACITY + 0.5f, actual.pos.x);
+}
+
+void testThatTrajectoryIsPausedOnUnderrun() {
+  // Fixture
+  fixtureAppendPieces(2);
+
+  // Test
+  struct traj_eval actual = piecewise_stream_eval(&traj, 10 + 3);
+
+  // Assert
+  TEST_ASSERT_FLOAT_WITHIN(1e-5, 2.0f, actual.pos.x);
+  TEST_ASSERT_EQUAL_FLOAT(0.0f, actual.vel.x);
+  TEST_ASSERT_EQUAL_UINT32(1, traj.underrun_count);
+  TEST_ASSERT_FALSE(piecewise_stream_is_finished(&traj, 10 + 3));
+}
+
+void testThatTrajectoryContinuesAfterUnderrun() {
+  // Fixture
+  fixtureAppendPieces(2);
+  piecewise_stream_eval(&traj, 10 + 3);
+  struct poly4d piece = fixturePiece(2);
+  piecewise_stream_append(&traj, &piece);
+
+  // Test
+  struct traj_eval actual = piecewise_stream_eval(&traj, 10 + 3.5f);
+
+  // Assert
+  // Paused for 1 s
+  TEST_ASSERT_FLOAT_WITHIN(1e-5, 2.5f, actual.pos.x);
+  TEST_ASSERT_FLOAT_WITHIN(1e-5, 1.0f, actual.vel.x);
+}
+
+void testThatClosedTrajectoryIsFinished() {
+  // Fixture
+  fixtureAppendPieces(2);
+  piecewise_stream_close(&traj);
+
+  // Test
+  struct traj_eval actual = piecewise_stream_eval(&traj, 10 + 3);
+
+  // Assert
+  TEST_ASSERT_FLOAT_WITHIN(1e-5, 2.0f, actual.pos.x);
+  TEST_ASSERT_EQUAL_UINT32(0, traj.underrun_count);
+  TEST_ASSERT_TRUE(piecewise_stream_is_finished(&traj, 10 + 3));
+}
+
+void testThatPiecesCanNotBeAppendedWhenClosed() {
+  // Fixture
+  fixtureAppendPieces(1);
+  piecewise_stream_close(&traj);
+  struct poly4d piece = fixturePiece(1);
+
+  // Test
+  bool actual = piecewise_stream_append(&traj, &piece);
+
+  // Assert
+  TEST_ASSERT_FALSE(actual);
+}
+
+// Helpers
+
+// Pieces along the x-axis at 1 m/s, piece i starts at x = i
+static struct poly4d fixturePiece(const int index) {
+  return poly4d_linear(PIECE_DURATION, mkvec(index, 0, 1), mkvec(index + 1, 0, 1), 0, 0);
+}
+
+static void fixtureAppendPieces(const int count) {
+  for (int i = 0; i < count; i++) {
+    struct poly4d piece = fixturePiece(i);
+    TEST_ASSERT_TRUE(piecewise_stream_append(&traj, &piece));
+  }
+}
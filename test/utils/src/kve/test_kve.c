@@ -1,6 +1,7 @@
 // File under test kve.c
 #include "kve/kve.h"
 #include "kve/kve_storage.h"
+#include "kve/kve_index.h"
 
 #include <stdlib.h>
 #include <string.h>
@@ -13,6 +14,10 @@
 
 uint8_t kveData[KVE_PARTITION_LENGTH];
 
+// Number of writes that reach the memory before a simulated reset, -1 for no limit
+static int writeBudget;
+static size_t bytesWritten;
+
 static size_t read(size_t address, void* data, size_t length)
 {
   if ((length == 0) || (address + length > KVE_PARTITION_LENGTH)) {
@@ -30,6 +35,13 @@ static size_t write(size_t address, const void* data, size_t length)
     return 0;
   }
 
+  if (writeBudget == 0) {
+    return 0;
+  } else if (writeBudget > 0) {
+    writeBudget--;
+  }
+  bytesWritten += length;
+
   memcpy(&kveData[address], data, length);
 
   return length;
@@ -100,9 +112,47 @@ static void fillKveMemory(void)
   //printf("Nr stored:%i\n", i);
 }
 
+// Items of different sizes separated by holes smaller than, equal to and
+// larger than the items following them
+static const char *fragmentedKeys[] = {"aa", "bb", "ccc.long.key", "dd", "e", "f.key", "gggg", "hh"};
+#define FRAGMENTED_KEY_COUNT (sizeof(fragmentedKeys) / sizeof(fragmentedKeys[0]))
+
+static void fragmentKveMemory(void)
+{
+  for (uint32_t i = 0; i < FRAGMENTED_KEY_COUNT; i++) {
+    kveStore(&kve, fragmentedKeys[i], &i, sizeof(i));
+  }
+
+  kveDelete(&kve, "aa");
+  kveDelete(&kve, "dd");
+  kveDelete(&kve, "e");
+  kveStore(&kve, "extra", fragmentedKeys, 12);
+  kveDelete(&kve, "gggg");
+}
+
+static void assertFragmentedItemsIntact(void)
+{
+  const uint32_t expected[] = {1, 2, 5, 7};
+  const char *keys[] = {"bb", "ccc.long.key", "f.key", "hh"};
+
+  for (int i = 0; i < 4; i++) {
+    uint32_t actual = 0;
+    TEST_ASSERT_EQUAL(sizeof(actual), kveFetch(&kve, keys[i], &actual, sizeof(actual)));
+    TEST_ASSERT_EQUAL_UINT32(expected[i], actual);
+  }
+
+  // No item lost or duplicated
+  kveStats_t stats;
+  kveGetStats(&kve, &stats);
+  TEST_ASSERT_EQUAL(5, stats.totalItems);
+}
+
 //-----------------------------Test cases -------------------------------- //
 
 void setUp(void) {
+  writeBudget = -1;
+  bytesWritten = 0;
+
   // The full memory is initialized to zero
   memset(kveData, 0, KVE_PARTITION_LENGTH);
   kveFormat(&kve);
@@ -247,4 +297,146 @@ void testFragmentationStatisticsIncreaseWhenFragmented(void) {
   kveGetStats(&kve, &stats);
   // Assert
   TEST_ASSERT_NOT_EQUAL(0, stats.fragmentation);
-}
\ No newline at end of file
+}
+
+void testHoleCountStatistics(void) {
+  // Fixture
+  fragmentKveMemory();
+  // Test
+  kveStats_t stats;
+  kveGetStats(&kve, &stats);
+  // Assert
+  TEST_ASSERT_EQUAL(4, stats.holeCount);
+}
+
+void testOverwriteWithSameSizeLeavesNoHole(void) {
+  // Fixture
+  uint32_t value = 1;
+  kveStore(&kve, "hello", &value, sizeof(value));
+  value = 2;
+  bool leftHole = true;
+  // Test
+  bool actual = kveStoreReportHole(&kve, "hello", &value, sizeof(value), &leftHole);
+  // Assert
+  TEST_ASSERT_TRUE(actual);
+  TEST_ASSERT_FALSE(leftHole);
+  kveStats_t stats;
+  kveGetStats(&kve, &stats);
+  TEST_ASSERT_EQUAL(0, stats.holeCount);
+}
+
+void testOverwriteWithOtherSizeLeavesHole(void) {
+  // Fixture
+  uint32_t value = 1;
+  kveStore(&kve, "hello", &value, sizeof(value));
+  uint64_t bigger = 2;
+  bool leftHole = false;
+  // Test
+  bool actual = kveStoreReportHole(&kve, "hello", &bigger, sizeof(bigger), &leftHole);
+  // Assert
+  TEST_ASSERT_TRUE(actual);
+  TEST_ASSERT_TRUE(leftHole);
+  kveStats_t stats;
+  kveGetStats(&kve, &stats);
+  TEST_ASSERT_EQUAL(1, stats.holeCount);
+}
+
+void testDefragStepRemovesAllHoles(void) {
+  // Fixture
+  fragmentKveMemory();
+  // Test
+  int steps = 0;
+  while (!kveDefragStep(&kve, 16) && steps < 100) {
+    steps++;
+  }
+  // Assert
+  kveStats_t stats;
+  kveGetStats(&kve, &stats);
+  TEST_ASSERT_EQUAL(0, stats.holeSize);
+  TEST_ASSERT_EQUAL(0, stats.holeCount);
+  TEST_ASSERT_TRUE(kveCheck(&kve));
+  assertFragmentedItemsIntact();
+}
+
+void testDefragStepOnUnfragmentedMemoryIsDone(void) {
+  // Fixture
+  uint32_t value = 42;
+  kveStore(&kve, "hello", &value, sizeof(value));
+  bytesWritten = 0;
+  // Test
+  bool actual = kveDefragStep(&kve, 16);
+  // Assert
+  TEST_ASSERT_EQUAL(true, actual);
+  TEST_ASSERT_EQUAL(0, bytesWritten);
+}
+
+void testDefragStepMovesAtMostMaxBytes(void) {
+  // Fixture
+  fillKveMemory();
+  for (int i = 0; i < 100; i += 2) {
+    char keyString[30];
+    sprintf(keyString, "prm/test.value%i", i);
+    kveDelete(&kve, keyString);
+  }
+  bytesWritten = 0;
+  // Test
+  bool actual = kveDefragStep(&kve, 64);
+  // Assert
+  // Item data plus the headers of the moved items and holes
+  TEST_ASSERT_EQUAL(false, actual);
+  TEST_ASSERT_LESS_OR_EQUAL(64 * 2, bytesWritten);
+}
+
+void testDefragStepStopsWhenThereIsNoRoomToMoveAnItem(void) {
+  // Fixture
+  // A small hole before a large item, in a full table
+  uint32_t small = 1;
+  uint8_t large[200] = {0x5a};
+  uint8_t filler[64] = {0};
+  kveStore(&kve, "small", &small, sizeof(small));
+  kveStore(&kve, "large", large, sizeof(large));
+  char keyString[30];
+  int fillers = 0;
+  do {
+    sprintf(keyString, "filler%i", fillers++);
+  } while (kveStore(&kve, keyString, filler, sizeof(filler)));
+  kveDelete(&kve, "small");
+  bytesWritten = 0;
+  // Test
+  bool actual = kveDefragStep(&kve, 16);
+  // Assert
+  TEST_ASSERT_EQUAL(true, actual);
+  TEST_ASSERT_EQUAL(0, bytesWritten);
+  kveStats_t stats;
+  kveGetStats(&kve, &stats);
+  TEST_ASSERT_EQUAL(1, stats.holeCount);
+  TEST_ASSERT_TRUE(kveCheck(&kve));
+  uint8_t actualLarge[200];
+  TEST_ASSERT_EQUAL(sizeof(large), kveFetch(&kve, "large", actualLarge, sizeof(actualLarge)));
+  TEST_ASSERT_EQUAL_UINT8_ARRAY(large, actualLarge, sizeof(large));
+}
+
+void testDefragStepSurvivesResetAtAnyWrite(void) {
+  // Fixture
+  static uint8_t fragmented[KVE_PARTITION_LENGTH];
+  fragmentKveMemory();
+  memcpy(fragmented, kveData, KVE_PARTITION_LENGTH);
+
+  // Count the writes of an uninterrupted defrag
+  writeBudget = 1000;
+  while (!kveDefragStep(&kve, 16));
+  int totalWrites = 1000 - writeBudget;
+
+  for (int resetAt = 0; resetAt <= totalWrites; resetAt++) {
+    memcpy(kveData, fragmented, KVE_PARTITION_LENGTH);
+
+    // Test
+    writeBudget = resetAt;
+    for (int i = 0; i < 20 && writeBudget != 0 && !kveDefragStep(&kve, 16); i++);
+    writeBudget = -1;
+
+    // Assert
+    TEST_ASSERT_TRUE(kveCheck(&kve));
+    assertFragmentedItemsIntact();
+  }
+}
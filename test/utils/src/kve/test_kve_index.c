@@ -0,0 +1,289 @@
+// File under test kve_index.c
+#include "kve/kve_index.h"
+#include "kve/kve_storage.h"
+#include "kve/kve.h"
+
+#include <string.h>
+#include <stdio.h>
+
+#include "unity.h"
+
+#define TEST_MEMORY_SIZE (7*1024)
+#define INDEX_SIZE 64
+
+static uint8_t memory[TEST_MEMORY_SIZE];
+static int readCount;
+
+static size_t memoryRead(size_t address, void* data, size_t length)
+{
+  if ((length == 0) || (address + length > TEST_MEMORY_SIZE)) {
+    return 0;
+  }
+
+  memcpy(data, &memory[address], length);
+  readCount++;
+
+  return length;
+}
+
+static size_t memoryWrite(size_t address, const void* data, size_t length)
+{
+  if ((length == 0) || (address + length > TEST_MEMORY_SIZE)) {
+    return 0;
+  }
+
+  memcpy(&memory[address], data, length);
+
+  return length;
+}
+
+static void memoryFlush(void)
+{
+  // Not valid for RAM memory implementation.
+}
+
+static kveIndexEntry_t entries[INDEX_SIZE];
+static kveIndex_t kveIndex = {
+  .entries = entries,
+  .size = INDEX_SIZE,
+};
+
+static kveMemory_t kve = {
+  .memorySize = TEST_MEMORY_SIZE,
+  .read = memoryRead,
+  .write = memoryWrite,
+  .flush = memoryFlush,
+  .index = &kveIndex,
+};
+
+static void storeNumberedKeys(int count)
+{
+  char key[30];
+  for (int i = 0; i < count; i++) {
+    sprintf(key, "prm/test.value%i", i);
+    kveStore(&kve, key, &i, sizeof(i));
+  }
+}
+
+void setUp(void) {
+  memset(memory, 0, TEST_MEMORY_SIZE);
+  memset(entries, 0xa5, sizeof(entries));
+  kveIndex.valid = false;
+  kveIndex.used = 0;
+  kveFormat(&kve);
+  readCount = 0;
+}
+
+void testThatFormatClearsTheIndex() {
+  // Fixture
+  // Test
+  // Assert
+  TEST_ASSERT_TRUE(kveIndexIsValid(&kve));
+  TEST_ASSERT_EQUAL(0, kveIndex.used);
+  TEST_ASSERT_FALSE(KVE_STORAGE_IS_VALID(kveIndexFind(&kve, "hello")));
+}
+
+void testThatStoredItemIsFoundInTheIndex() {
+  // Fixture
+  uint32_t value = 42;
+  kveStore(&kve, "hello", &value, sizeof(value));
+
+  // Test
+  size_t actual = kveIndexFind(&kve, "hello");
+
+  // Assert
+  TEST_ASSERT_EQUAL(kveStorageFindItemByKey(&kve, 1, "hello"), actual);
+  TEST_ASSERT_EQUAL(1, kveIndex.used);
+}
+
+void testThatIndexIsBuiltByCheck() {
+  // Fixture
+  storeNumberedKeys(20);
+  kveIndex.valid = false;
+
+  // Test
+  bool actual = kveCheck(&kve);
+
+  // Assert
+  TEST_ASSERT_TRUE(actual);
+  TEST_ASSERT_TRUE(kveIndexIsValid(&kve));
+  TEST_ASSERT_EQUAL(20, kveIndex.used);
+  TEST_ASSERT_EQUAL(kveStorageFindItemByKey(&kve, 1, "prm/test.value13"), kveIndexFind(&kve, "prm/test.value13"));
+}
+
+void testThatIndexIsNotBuiltForCorruptedTable() {
+  // Fixture
+  storeNumberedKeys(5);
+  memset(&memory[1], 0, 2);
+
+  // Test
+  bool actual = kveCheck(&kve);
+
+  // Assert
+  TEST_ASSERT_FALSE(actual);
+  TEST_ASSERT_FALSE(kveIndexIsValid(&kve));
+}
+
+void testThatDeletedItemIsRemovedFromTheIndex() {
+  // Fixture
+  storeNumberedKeys(10);
+
+  // Test
+  kveDelete(&kve, "prm/test.value3");
+
+  // Assert
+  TEST_ASSERT_EQUAL(9, kveIndex.used);
+  TEST_ASSERT_FALSE(KVE_STORAGE_IS_VALID(kveIndexFind(&kve, "prm/test.value3")));
+  TEST_ASSERT_TRUE(KVE_STORAGE_IS_VALID(kveIndexFind(&kve, "prm/test.value4")));
+}
+
+void testThatItemStoredWithNewSizeIsMovedInTheIndex() {
+  // Fixture
+  uint32_t small = 1;
+  uint64_t big = 2;
+  uint64_t actual = 0;
+  kveStore(&kve, "a", &small, sizeof(small));
+  kveStore(&kve, "b", &small, sizeof(small));
+
+  // Test
+  kveStore(&kve, "a", &big, sizeof(big));
+
+  // Assert
+  TEST_ASSERT_EQUAL(2, kveIndex.used);
+  TEST_ASSERT_EQUAL(kveStorageFindItemByKey(&kve, 1, "a"), kveIndexFind(&kve, "a"));
+  TEST_ASSERT_EQUAL(sizeof(big), kveFetch(&kve, "a", &actual, sizeof(actual)));
+  TEST_ASSERT_EQUAL(big, actual);
+}
+
+void testThatIndexFollowsItemsMovedByDefrag() {
+  // Fixture
+  storeNumberedKeys(30);
+  for (int i = 0; i < 30; i += 3) {
+    char key[30];
+    sprintf(key, "prm/test.value%i", i);
+    kveDelete(&kve, key);
+  }
+
+  // Test
+  kveDefrag(&kve);
+
+  // Assert
+  TEST_ASSERT_TRUE(kveIndexIsValid(&kve));
+  TEST_ASSERT_EQUAL(20, kveIndex.used);
+  for (int i = 0; i < 30; i++) {
+    char key[30];
+    sprintf(key, "prm/test.value%i", i);
+    TEST_ASSERT_EQUAL(kveStorageFindItemByKey(&kve, 1, key), kveIndexFind(&kve, key));
+  }
+}
+
+void testThatIndexFollowsItemsMovedByDefragStep() {
+  // Fixture
+  storeNumberedKeys(30);
+  for (int i = 0; i < 30; i += 4) {
+    char key[30];
+    sprintf(key, "prm/test.value%i", i);
+    kveDelete(&kve, key);
+  }
+
+  // Test
+  while (!kveDefragStep(&kve, 32));
+
+  // Assert
+  TEST_ASSERT_TRUE(kveIndexIsValid(&kve));
+  for (int i = 0; i < 30; i++) {
+    char key[30];
+    sprintf(key, "prm/test.value%i", i);
+    TEST_ASSERT_EQUAL(kveStorageFindItemByKey(&kve, 1, key), kveIndexFind(&kve, key));
+  }
+}
+
+void testThatKeyLongerThanAnyStoredKeyIsNotFound() {
+  // Fixture
+  storeNumberedKeys(INDEX_SIZE / 2);
+  char key[300];
+  memset(key, 'a', sizeof(key) - 1);
+  key[sizeof(key) - 1] = '\0';
+
+  // Test
+  size_t actual = kveIndexFind(&kve, key);
+
+  // Assert
+  TEST_ASSERT_FALSE(KVE_STORAGE_IS_VALID(actual));
+}
+
+void testThatIndexIsInvalidatedWhenFull() {
+  // Fixture
+  // Test
+  storeNumberedKeys(INDEX_SIZE);
+
+  // Assert
+  TEST_ASSERT_FALSE(kveIndexIsValid(&kve));
+}
+
+void testThatFetchFallsBackToScanningWhenIndexIsFull() {
+  // Fixture
+  int actual = -1;
+  storeNumberedKeys(INDEX_SIZE);
+
+  // Test
+  kveFetch(&kve, "prm/test.value60", &actual, sizeof(actual));
+
+  // Assert
+  TEST_ASSERT_EQUAL(60, actual);
+}
+
+void testThatHashCollisionsAreResolvedAgainstMemory() {
+  // Fixture
+  // Half full index, lookups have to probe past other keys
+  storeNumberedKeys(INDEX_SIZE / 2);
+
+  // Test
+  // Assert
+  for (int i = 0; i < INDEX_SIZE / 2; i++) {
+    char key[30];
+    int actual = -1;
+    sprintf(key, "prm/test.value%i", i);
+    TEST_ASSERT_EQUAL(sizeof(actual), kveFetch(&kve, key, &actual, sizeof(actual)));
+    TEST_ASSERT_EQUAL(i, actual);
+  }
+}
+
+void testThatIndexedFetchCostDoesNotDependOnItemPosition() {
+  // Fixture
+  int actual;
+  storeNumberedKeys(50);
+
+  // Test
+  readCount = 0;
+  kveFetch(&kve, "prm/test.value0", &actual, sizeof(actual));
+  int firstItemReads = readCount;
+
+  readCount = 0;
+  kveFetch(&kve, "prm/test.value49", &actual, sizeof(actual));
+  int lastItemReads = readCount;
+
+  // Assert
+  TEST_ASSERT_EQUAL(firstItemReads, lastItemReads);
+  TEST_ASSERT_EQUAL(49, actual);
+}
+
+void testThatIndexedFetchReadsLessThanScanning() {
+  // Fixture
+  int actual;
+  storeNumberedKeys(50);
+
+  // Test
+  readCount = 0;
+  kveFetch(&kve, "prm/test.value49", &actual, sizeof(actual));
+  int indexedReads = readCount;
+
+  kveIndexInvalidate(&kve);
+  readCount = 0;
+  kveFetch(&kve, "prm/test.value49", &actual, sizeof(actual));
+  int scanningReads = readCount;
+
+  // Assert
+  TEST_ASSERT_LESS_THAN(10, indexedReads);
+  TEST_ASSERT_GREATER_THAN(50, scanningReads);
+}
@@ -0,0 +1,143 @@
+// @IGNORE_IF_NOT CONFIG_DECK_LIGHTHOUSE
+
+/**
+ *    ||          ____  _ __
+ * +------+      / __ )(_) /_______________ _____  ___
+ * | 0xBC |     / __  / / __/ ___/ ___/ __ `/_  / / _ \
+ * +------+    / /_/ / / /_/ /__/ /  / /_/ / / /_/  __/
+ *  ||  ||    /_____/_/\__/\___/_/   \__,_/ /___/\___/
+ *
+ * Crazyflie control firmware
+ *
+ * Copyright (C) 2023 Bitcraze AB
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, in version 3.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ *
+ * test_pulse_processor_v2_benchmark.c - Throughput of the lighthouse V2 pulse processor
+ *
+ * One recorded rotation of a base station is replayed for a number of
+ * channels, as if received from several base stations, and the time spent
+ * in the pulse processor per frame is measured. The results are printed, the
+ * tests only fail if the expected angles are not found.
+ */
+
+// File under test pulse_processor_v2.c
+#include "pulse_processor_v2.h"
+
+#include "unity.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+#include "mock_ootx_decoder.h"
+#include "mock_lighthouse_calibration.h"
+#include "mock_usec_time.h"
+#include "mock_pulse_processor.h"
+
+#define ROTATIONS (20000)
+
+// One rotation of base station on channel 0, from testRecordedSequence1Bs_1 in test_pulse_processor_v2.c
+#define FRAMES_PER_ROTATION (8)
+#define TICKS_PER_ROTATION (478494)
+static const pulseProcessorFrame_t recordedRotation[FRAMES_PER_ROTATION] = {
+    {.sensor = 0, .timestamp = 2156620, .offset = 0,      .channelFound = false},
+    {.sensor = 2, .timestamp = 2156972, .offset = 165916, .channelFound = true},
+    {.sensor = 1, .timestamp = 2157193, .offset = 0,      .channelFound = true},
+    {.sensor = 3, .timestamp = 2157561, .offset = 0,      .channelFound = true},
+
+    {.sensor = 2, .timestamp = 2290186, .offset = 0,      .channelFound = false},
+    {.sensor = 0, .timestamp = 2290608, .offset = 299556, .channelFound = true},
+    {.sensor = 3, .timestamp = 2290750, .offset = 0,      .channelFound = true},
+    {.sensor = 1, .timestamp = 2291154, .offset = 0,      .channelFound = true},
+};
+
+// Time between the sweeps of two base stations, the sweeps must not overlap
+#define TICKS_BETWEEN_CHANNELS (25000)
+
+#define TIMESTAMP_MASK (0x00ffffff)
+
+static pulseProcessor_t state;
+static pulseProcessorResult_t angles;
+
+static double runRotations(const int channelCount, int* anglesFound);
+
+void setUp(void) {
+    memset(&state, 0, sizeof(state));
+    memset(&angles, 0, sizeof(angles));
+
+    usecTimestamp_IgnoreAndReturn(0);
+    ootxDecoderProcessBit_IgnoreAndReturn(false);
+    pulseProcessorClear_Ignore();
+}
+
+void tearDown(void) {
+    // Empty
+}
+
+void testBenchmarkOneBaseStation() {
+    // Fixture
+    int anglesFound = 0;
+
+    // Test
+    double nsPerFrame = runRotations(1, &anglesFound);
+
+    // Assert
+    printf("1 base station: %.0f ns per frame, %.0f frames per second\n", nsPerFrame, 1e9 / nsPerFrame);
+    // The angles of the last rotation are not completed until the next frame
+    TEST_ASSERT_GREATER_THAN(ROTATIONS - 2, anglesFound);
+}
+
+void testBenchmarkFourBaseStations() {
+    // Fixture
+    int anglesFound = 0;
+    const int channelCount = 4;
+
+    // Test
+    double nsPerFrame = runRotations(channelCount, &anglesFound);
+
+    // Assert
+    printf("%d base stations: %.0f ns per frame, %.0f frames per second\n", channelCount, nsPerFrame, 1e9 / nsPerFrame);
+    TEST_ASSERT_GREATER_THAN(ROTATIONS * channelCount - 2, anglesFound);
+}
+
+// Helpers
+
+static double runRotations(const int channelCount, int* anglesFound) {
+    int baseStation = 0;
+    int axis = 0;
+    bool calibDataIsDecoded = false;
+    int frameCount = 0;
+
+    *anglesFound = 0;
+
+    clock_t start = clock();
+    for (int rotation = 0; rotation < ROTATIONS; rotation++) {
+        for (int sweep = 0; sweep < FRAMES_PER_ROTATION; sweep += PULSE_PROCESSOR_N_SENSORS) {
+            for (int channel = 0; channel < channelCount; channel++) {
+                for (int i = sweep; i < sweep + PULSE_PROCESSOR_N_SENSORS; i++) {
+                    pulseProcessorFrame_t frame = recordedRotation[i];
+                    frame.channel = channel;
+                    frame.timestamp = (frame.timestamp + (uint32_t)rotation * TICKS_PER_ROTATION + channel * TICKS_BETWEEN_CHANNELS) & TIMESTAMP_MASK;
+
+                    if (pulseProcessorV2ProcessPulse(&state, &frame, &angles, &baseStation, &axis, &calibDataIsDecoded)) {
+                        (*anglesFound)++;
+                    }
+                    frameCount++;
+                }
+            }
+        }
+    }
+
+    return (double)(clock() - start) * 1e9 / CLOCKS_PER_SEC / frameCount;
+}
@@ -0,0 +1,240 @@
+/**
+ *    ||          ____  _ __
+ * +------+      / __ )(_) /_______________ _____  ___
+ * | 0xBC |     / __  / / __/ ___/ ___/ __ `/_  / / _ \
+ * +------+    / /_/ / / /_/ /__/ /  / /_/ / / /_/  __/
+ *  ||  ||    /_____/_/\__/\___/_/   \__,_/ /___/\___/
+ *
+ * Crazyflie control firmware
+ *
+ * Copyright (C) 2023 Bitcraze AB
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, in version 3.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ *
+ * test_tdoa_fixed_point.c - Compares the fixed point and double precision TDoA math
+ *
+ * Simulated packet streams from two anchors with drifting clocks are processed
+ * in the same way as in the TDoA engine, using both the double precision and
+ * the fixed point clock correction functions. The resulting distance
+ * differences are compared to each other and to the true value.
+ */
+
+// File under test
+#include "clockCorrectionEngine.h"
+#include "tdoaEngine.h" // @NO_MODULE
+
+#include "unity.h"
+
+#include <math.h>
+#include <string.h>
+
+#define TS_FREQ (499.2e6 * 128)
+#define SPEED_OF_LIGHT_IN_AIR (299792458.0)
+#define PACKET_COUNT (5000)
+
+// One time stamp tick is 4.7 mm. Both versions truncate the time difference
+// to whole ticks, but in different ways, which adds up to two ticks.
+#define MAX_DEVIATION_FROM_DOUBLE (0.015)
+#define MAX_DEVIATION_FROM_TRUE_VALUE (0.05)
+// Samples close to the accepted noise limit may be classified differently
+#define MAX_RELIABLE_MISMATCH_COUNT (PACKET_COUNT / 20)
+
+typedef struct {
+  double drift;
+  double offset;
+} simClock_t;
+
+typedef struct {
+  // Configuration
+  simClock_t tagClock;
+  simClock_t anchorClock[2];
+  double anchorDistance;
+  double tagDistance[2];
+  double rxNoiseTicks;
+  uint32_t seed;
+
+  // Result
+  int comparedCount;
+  int reliableMismatchCount;
+  double maxDeviationFromDouble;
+  double maxDeviationFromTrueValue;
+} simStream_t;
+
+static void runStream(simStream_t* stream);
+
+void setUp(void) {
+}
+
+void testFixedPointMatchesDoubleWithoutNoise() {
+  // Fixture
+  simStream_t stream = {
+    .tagClock = {.drift = 3e-6, .offset = 1000.0},
+    .anchorClock = {{.drift = -5e-6, .offset = 12345678.0}, {.drift = 7e-6, .offset = 9876543210.0}},
+    .anchorDistance = 5.0,
+    .tagDistance = {2.0, 4.5},
+    .rxNoiseTicks = 0.0,
+    .seed = 1,
+  };
+
+  // Test
+  runStream(&stream);
+
+  // Assert
+  TEST_ASSERT_GREATER_THAN(PACKET_COUNT / 2, stream.comparedCount);
+  TEST_ASSERT_EQUAL_INT(0, stream.reliableMismatchCount);
+  TEST_ASSERT_LESS_THAN(MAX_DEVIATION_FROM_DOUBLE, stream.maxDeviationFromDouble);
+  TEST_ASSERT_LESS_THAN(MAX_DEVIATION_FROM_TRUE_VALUE, stream.maxDeviationFromTrueValue);
+}
+
+void testFixedPointMatchesDoubleWithNoise() {
+  // Fixture
+  simStream_t stream = {
+    .tagClock = {.drift = -8e-6, .offset = 0.0},
+    .anchorClock = {{.drift = 2e-6, .offset = 500000.0}, {.drift = -9e-6, .offset = 70000000000.0}},
+    .anchorDistance = 8.0,
+    .tagDistance = {6.0, 3.0},
+    .rxNoiseTicks = 20.0,
+    .seed = 42,
+  };
+
+  // Test
+  runStream(&stream);
+
+  // Assert
+  TEST_ASSERT_GREATER_THAN(PACKET_COUNT / 2, stream.comparedCount);
+  TEST_ASSERT_LESS_THAN(MAX_RELIABLE_MISMATCH_COUNT, stream.reliableMismatchCount);
+  TEST_ASSERT_LESS_THAN(MAX_DEVIATION_FROM_DOUBLE, stream.maxDeviationFromDouble);
+}
+
+void testFixedPointMatchesDoubleWhenTimeStampsWrapAround() {
+  // Fixture
+  // The 40 bit anchor and tag time stamps wrap around every 17 seconds, the stream is longer than that
+  simStream_t stream = {
+    .tagClock = {.drift = 9e-6, .offset = 1099500000000.0},
+    .anchorClock = {{.drift = -9e-6, .offset = 1099511000000.0}, {.drift = 0.0, .offset = 1099000000000.0}},
+    .anchorDistance = 12.0,
+    .tagDistance = {1.0, 11.5},
+    .rxNoiseTicks = 5.0,
+    .seed = 4711,
+  };
+
+  // Test
+  runStream(&stream);
+
+  // Assert
+  TEST_ASSERT_GREATER_THAN(PACKET_COUNT / 2, stream.comparedCount);
+  TEST_ASSERT_LESS_THAN(MAX_RELIABLE_MISMATCH_COUNT, stream.reliableMismatchCount);
+  TEST_ASSERT_LESS_THAN(MAX_DEVIATION_FROM_DOUBLE, stream.maxDeviationFromDouble);
+  TEST_ASSERT_LESS_THAN(MAX_DEVIATION_FROM_TRUE_VALUE, stream.maxDeviationFromTrueValue);
+}
+
+// Helpers
+
+#define TIMESTAMP_MASK 0xFFFFFFFFFF
+
+static uint32_t nextRandom(uint32_t* seed) {
+  *seed = *seed * 1664525 + 1013904223;
+  return *seed >> 8;
+}
+
+static double randomUniform(uint32_t* seed) {
+  return (double)nextRandom(seed) / (1 << 24);
+}
+
+static int64_t timeStamp(const simClock_t* clock, const double time_s) {
+  const double ticks = clock->offset + time_s * TS_FREQ * (1.0 + clock->drift);
+  return (int64_t)fmod(ticks, (double)TIMESTAMP_MASK + 1.0);
+}
+
+typedef struct {
+  // Latest packet from the anchor, as received by the tag
+  int64_t rxByTag;
+  int64_t tx;
+
+  // Latest packet from the other anchor, as received by this anchor
+  int64_t rxOfOther;
+  bool hasRxOfOther;
+
+  clockCorrectionStorage_t clockCorrection;
+  clockCorrectionStorage_t clockCorrectionFixed;
+} simAnchorState_t;
+
+static void runStream(simStream_t* stream) {
+  simAnchorState_t anchors[2];
+  memset(anchors, 0, sizeof(anchors));
+
+  stream->comparedCount = 0;
+  stream->reliableMismatchCount = 0;
+  stream->maxDeviationFromDouble = 0.0;
+  stream->maxDeviationFromTrueValue = 0.0;
+
+  const double trueDistanceDiff = stream->tagDistance[1] - stream->tagDistance[0];
+
+  double time_s = 0.0;
+  for (int i = 0; i < PACKET_COUNT; i++) {
+    // Anchors transmit in turns with a random interval, as in TDoA3
+    const int an = i % 2;
+    const int ar = 1 - an;
+    time_s += 0.002 + 0.004 * randomUniform(&stream->seed);
+
+    simAnchorState_t* anchor = &anchors[an];
+    simAnchorState_t* other = &anchors[ar];
+
+    const int64_t tx = timeStamp(&stream->anchorClock[an], time_s);
+    const double noise = stream->rxNoiseTicks * (randomUniform(&stream->seed) - 0.5);
+    const double rxTime_s = time_s + stream->tagDistance[an] / SPEED_OF_LIGHT_IN_AIR + noise / TS_FREQ;
+    const int64_t rxByTag = timeStamp(&stream->tagClock, rxTime_s);
+
+    const double tofTime_s = stream->anchorDistance / SPEED_OF_LIGHT_IN_AIR;
+    const int64_t tof = (int64_t)(tofTime_s * TS_FREQ * (1.0 + stream->anchorClock[an].drift));
+
+    if (anchor->rxByTag != 0) {
+      const double candidate = clockCorrectionEngineCalculate(rxByTag, anchor->rxByTag, tx, anchor->tx, TDOA_ENGINE_TRUNCATE_TO_ANCHOR_TS_BITMAP);
+      const bool isReliable = clockCorrectionEngineUpdate(&anchor->clockCorrection, candidate);
+
+      const uint32_t candidateFixed = clockCorrectionEngineCalculateFixed(rxByTag, anchor->rxByTag, tx, anchor->tx, TDOA_ENGINE_TRUNCATE_TO_ANCHOR_TS_BITMAP);
+      const bool isReliableFixed = clockCorrectionEngineUpdateFixed(&anchor->clockCorrectionFixed, candidateFixed);
+
+      if (isReliable != isReliableFixed) {
+        stream->reliableMismatchCount++;
+      }
+
+      if (isReliable && isReliableFixed && anchor->hasRxOfOther && other->rxByTag != 0) {
+        const int64_t delta_tx = tof + tdoaEngineTruncateToAnchorTimeStamp(tx - anchor->rxOfOther);
+        const int64_t delta_rx = tdoaEngineTruncateToAnchorTimeStamp(rxByTag - other->rxByTag);
+
+        const int64_t tdoa = tdoaEngineCalcTdoa(delta_rx, delta_tx, clockCorrectionEngineGet(&anchor->clockCorrection));
+        const int64_t tdoaFixed = tdoaEngineCalcTdoaFixed(delta_rx, delta_tx, clockCorrectionEngineGetFixed(&anchor->clockCorrectionFixed));
+
+        const double distanceDiff = SPEED_OF_LIGHT_IN_AIR * tdoa / TS_FREQ;
+        const float metersPerTick = SPEED_OF_LIGHT_IN_AIR / TS_FREQ;
+        const float distanceDiffFixed = tdoaFixed * metersPerTick;
+
+        // The engine reports the distance difference as (other anchor, this anchor)
+        const double expected = (an == 1) ? trueDistanceDiff : -trueDistanceDiff;
+
+        stream->comparedCount++;
+        stream->maxDeviationFromDouble = fmax(stream->maxDeviationFromDouble, fabs(distanceDiffFixed - distanceDiff));
+        stream->maxDeviationFromTrueValue = fmax(stream->maxDeviationFromTrueValue, fabs(distanceDiffFixed - expected));
+      }
+    }
+
+    anchor->rxByTag = rxByTag;
+    anchor->tx = tx;
+
+    // The other anchor hears this packet
+    const double rxByOther_s = time_s + tofTime_s;
+    other->rxOfOther = timeStamp(&stream->anchorClock[ar], rxByOther_s);
+    other->hasRxOfOther = true;
+  }
+}
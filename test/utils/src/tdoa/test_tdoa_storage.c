@@ -38,12 +38,12 @@
 #define ANCHOR_POSITION_VALIDITY_PERIOD (2 * 1000)
 
 
-static tdaoAnchorInfoArray_t storage;
+static tdoaAnchorStorage_t storage;
 static void fixtureSetRemoteRxTime(tdoaAnchorContext_t* context, const uint8_t anchor, const uint32_t storageTime, const uint8_t remoteAnchor, const uint64_t remoteRxTime, const uint8_t seqNr);
 static void fixtureSetTof(tdoaAnchorContext_t* context, const uint8_t anchor, const uint32_t storageTime, const uint8_t remoteAnchor, const uint64_t tof);
 
 void setUp(void) {
-  tdoaStorageInitialize(storage);
+  tdoaStorageInitialize(&storage);
 }
 
 void testThatCurrentTimeIsSetInContextForGet() {
@@ -53,7 +53,7 @@ void testThatCurrentTimeIsSetInContextForGet() {
 
   // Test
   tdoaAnchorContext_t result;
-  tdoaStorageGetAnchorCtx(storage, anchor, expectedTime, &result);
+  tdoaStorageGetAnchorCtx(&storage, anchor, expectedTime, &result);
 
   // Assert
   TEST_ASSERT_EQUAL_UINT8(expectedTime, result.currentTime_ms);
@@ -67,7 +67,7 @@ void testThatCurrentTimeIsSetInContextForGetCreate() {
 
   // Test
   tdoaAnchorContext_t result;
-  tdoaStorageGetCreateAnchorCtx(storage, anchor, expectedTime, &result);
+  tdoaStorageGetCreateAnchorCtx(&storage, anchor, expectedTime, &result);
 
   // Assert
   TEST_ASSERT_EQUAL_UINT8(expectedTime, result.currentTime_ms);
@@ -81,7 +81,7 @@ void testThatNoAnchorIsReturnedWhenItDoesNotExistInStorage() {
 
   // Test
   tdoaAnchorContext_t result;
-  bool actual = tdoaStorageGetAnchorCtx(storage, anchor, currentTime, &result);
+  bool actual = tdoaStorageGetAnchorCtx(&storage, anchor, currentTime, &result);
 
   // Assert
   // False indicates that the anchor did not exist
@@ -97,7 +97,7 @@ void testThatANewAnchorContextIsReturnedWhenItDoesNotExistInStorage() {
 
   // Test
   tdoaAnchorContext_t result;
-  bool actual = tdoaStorageGetCreateAnchorCtx(storage, anchor, currentTime, &result);
+  bool actual = tdoaStorageGetCreateAnchorCtx(&storage, anchor, currentTime, &result);
 
   // Assert
   // False indicates that the anchor did not exist
@@ -113,11 +113,11 @@ void testThatTheSameAnchorContextIsReturnedWhenItAlreadyExistsInStorageForGet()
 
   // Make sure the anchor exists
   tdoaAnchorContext_t firstContext;
-  tdoaStorageGetCreateAnchorCtx(storage, anchor, currentTime, &firstContext);
+  tdoaStorageGetCreateAnchorCtx(&storage, anchor, currentTime, &firstContext);
 
   // Test
   tdoaAnchorContext_t result;
-  bool actual = tdoaStorageGetAnchorCtx(storage, anchor, currentTime, &result);
+  bool actual = tdoaStorageGetAnchorCtx(&storage, anchor, currentTime, &result);
 
   // Assert
   // False indicates that the anchor did exist
@@ -133,11 +133,11 @@ void testThatTheSameAnchorContextIsReturnedWhenItAlreadyExistsInStorageForGetCre
 
   // Make sure the anchor exists
   tdoaAnchorContext_t firstContext;
-  tdoaStorageGetCreateAnchorCtx(storage, anchor, currentTime, &firstContext);
+  tdoaStorageGetCreateAnchorCtx(&storage, anchor, currentTime, &firstContext);
 
   // Test
   tdoaAnchorContext_t result;
-  bool actual = tdoaStorageGetCreateAnchorCtx(storage, anchor, currentTime, &result);
+  bool actual = tdoaStorageGetCreateAnchorCtx(&storage, anchor, currentTime, &result);
 
   // Assert
   // False indicates that the anchor did exist
@@ -160,7 +160,7 @@ void testThatTheOldestAnchorContextIsReplacedWhenStorageIsFull() {
   // time for one slot to be oldest
   tdoaAnchorContext_t context;
   for (int id = 0; id < ANCHOR_STORAGE_COUNT; id++) {
-    tdoaStorageGetCreateAnchorCtx(storage, id, currentTime, &context);
+    tdoaStorageGetCreateAnchorCtx(&storage, id, currentTime, &context);
 
     uint32_t updateTime = baseAnchorTime + id;
     if (id == oldestAnchor) {
@@ -173,12 +173,66 @@ void testThatTheOldestAnchorContextIsReplacedWhenStorageIsFull() {
 
   // Test
   tdoaAnchorContext_t result;
-  bool actual = tdoaStorageGetCreateAnchorCtx(storage, newAnchor, currentTime, &result);
+  bool actual = tdoaStorageGetCreateAnchorCtx(&storage, newAnchor, currentTime, &result);
 
   // Assert
   TEST_ASSERT_FALSE(actual);
-  TEST_ASSERT_TRUE(tdoaStorageIsAnchorInStorage(storage, newAnchor));
-  TEST_ASSERT_FALSE(tdoaStorageIsAnchorInStorage(storage, oldestAnchor));
+  TEST_ASSERT_TRUE(tdoaStorageIsAnchorInStorage(&storage, newAnchor));
+  TEST_ASSERT_FALSE(tdoaStorageIsAnchorInStorage(&storage, oldestAnchor));
+}
+
+
+void testThatAllSlotsAreUsedBeforeAnAnchorIsReplaced() {
+  // Fixture
+  const uint32_t currentTime = 2000;
+  const uint8_t firstId = 200;
+  tdoaAnchorContext_t context;
+
+  // Test
+  for (int i = 0; i < ANCHOR_STORAGE_COUNT; i++) {
+    tdoaStorageGetCreateAnchorCtx(&storage, firstId + i, currentTime, &context);
+    context.currentTime_ms = currentTime - 10 + i;
+    tdoaStorageSetRxTxData(&context, 0, 0, 0);
+  }
+
+  // Assert
+  for (int i = 0; i < ANCHOR_STORAGE_COUNT; i++) {
+    TEST_ASSERT_TRUE(tdoaStorageIsAnchorInStorage(&storage, firstId + i));
+  }
+}
+
+
+void testThatAReplacedAnchorCanBeAddedAgain() {
+  // Fixture
+  const uint32_t currentTime = 2000;
+  tdoaAnchorContext_t context;
+
+  for (int id = 0; id < ANCHOR_STORAGE_COUNT; id++) {
+    tdoaStorageGetCreateAnchorCtx(&storage, id, currentTime, &context);
+    context.currentTime_ms = 1000 + id;
+    tdoaStorageSetRxTxData(&context, 0, 0, 0);
+  }
+
+  // Replaces anchor 0, the oldest
+  tdoaStorageGetCreateAnchorCtx(&storage, ANCHOR_STORAGE_COUNT, currentTime, &context);
+  context.currentTime_ms = currentTime;
+  tdoaStorageSetRxTxData(&context, 0, 0, 0);
+
+  // Test
+  // Replaces anchor 1, the oldest
+  bool actual = tdoaStorageGetCreateAnchorCtx(&storage, 0, currentTime, &context);
+
+  // Assert
+  TEST_ASSERT_FALSE(actual);
+  TEST_ASSERT_EQUAL_UINT8(0, tdoaStorageGetId(&context));
+  TEST_ASSERT_TRUE(tdoaStorageIsAnchorInStorage(&storage, 0));
+  TEST_ASSERT_TRUE(tdoaStorageIsAnchorInStorage(&storage, ANCHOR_STORAGE_COUNT));
+  TEST_ASSERT_FALSE(tdoaStorageIsAnchorInStorage(&storage, 1));
+
+  tdoaAnchorContext_t result;
+  TEST_ASSERT_FALSE(tdoaStorageGetAnchorCtx(&storage, 1, currentTime, &result));
+  TEST_ASSERT_TRUE(tdoaStorageGetAnchorCtx(&storage, 0, currentTime, &result));
+  TEST_ASSERT_EQUAL_PTR(context.anchorInfo, result.anchorInfo);
 }
 
 
@@ -193,14 +247,14 @@ void testThatAListOfAnchorIdsIsReturned() {
 
   uint8_t expectedCount = 3;
 
-  tdoaStorageGetCreateAnchorCtx(storage, expectedId0, currentTime, &context);
-  tdoaStorageGetCreateAnchorCtx(storage, expectedId1, currentTime, &context);
-  tdoaStorageGetCreateAnchorCtx(storage, expectedId2, currentTime, &context);
+  tdoaStorageGetCreateAnchorCtx(&storage, expectedId0, currentTime, &context);
+  tdoaStorageGetCreateAnchorCtx(&storage, expectedId1, currentTime, &context);
+  tdoaStorageGetCreateAnchorCtx(&storage, expectedId2, currentTime, &context);
 
   uint8_t unorderedAnchorList[10];
 
   // Test
-  uint8_t actualCount = tdoaStorageGetListOfAnchorIds(storage, unorderedAnchorList, 10);
+  uint8_t actualCount = tdoaStorageGetListOfAnchorIds(&storage, unorderedAnchorList, 10);
 
   // Assert
   TEST_ASSERT_EQUAL_INT8(expectedCount, actualCount);
@@ -220,14 +274,14 @@ void testThatAListOfAnchorIdsIsReturnedButNotMoreThanTheListLength() {
 
   uint8_t expectedCount = 2;
 
-  tdoaStorageGetCreateAnchorCtx(storage, expectedId0, currentTime, &context);
-  tdoaStorageGetCreateAnchorCtx(storage, expectedId1, currentTime, &context);
-  tdoaStorageGetCreateAnchorCtx(storage, expectedId2, currentTime, &context);
+  tdoaStorageGetCreateAnchorCtx(&storage, expectedId0, currentTime, &context);
+  tdoaStorageGetCreateAnchorCtx(&storage, expectedId1, currentTime, &context);
+  tdoaStorageGetCreateAnchorCtx(&storage, expectedId2, currentTime, &context);
 
   uint8_t unorderedAnchorList[10];
 
   // Test
-  uint8_t actualCount = tdoaStorageGetListOfAnchorIds(storage, unorderedAnchorList, expectedCount);
+  uint8_t actualCount = tdoaStorageGetListOfAnchorIds(&storage, unorderedAnchorList, expectedCount);
 
   // Assert
   TEST_ASSERT_EQUAL_INT8(expectedCount, actualCount);
@@ -251,19 +305,19 @@ void testThatAListOfActiveAnchorIdsIsReturned() {
 
   uint8_t expectedCount = 2;
 
-  tdoaStorageGetCreateAnchorCtx(storage, otherId, oldTime, &context);
+  tdoaStorageGetCreateAnchorCtx(&storage, otherId, oldTime, &context);
   tdoaStorageSetRxTxData(&context, 0, 0, 0);
 
-  tdoaStorageGetCreateAnchorCtx(storage, expectedId0, recentTime, &context);
+  tdoaStorageGetCreateAnchorCtx(&storage, expectedId0, recentTime, &context);
   tdoaStorageSetRxTxData(&context, 0, 0, 0);
 
-  tdoaStorageGetCreateAnchorCtx(storage, expectedId1, recentTime, &context);
+  tdoaStorageGetCreateAnchorCtx(&storage, expectedId1, recentTime, &context);
   tdoaStorageSetRxTxData(&context, 0, 0, 0);
 
   uint8_t unorderedAnchorList[10];
 
   // Test
-  uint8_t actualCount = tdoaStorageGetListOfActiveAnchorIds(storage, unorderedAnchorList, 10, currentTime);
+  uint8_t actualCount = tdoaStorageGetListOfActiveAnchorIds(&storage, unorderedAnchorList, 10, currentTime);
 
   // Assert
   TEST_ASSERT_EQUAL_INT8(expectedCount, actualCount);
@@ -283,16 +337,16 @@ void testThatAListOfActiveAnchorIdsIsReturnedButNotMoreThanTheListLength() {
 
   uint8_t expectedCount = 1;
 
-  tdoaStorageGetCreateAnchorCtx(storage, expectedId0, currentTime, &context);
+  tdoaStorageGetCreateAnchorCtx(&storage, expectedId0, currentTime, &context);
   tdoaStorageSetRxTxData(&context, 0, 0, 0);
 
-  tdoaStorageGetCreateAnchorCtx(storage, otherId, currentTime, &context);
+  tdoaStorageGetCreateAnchorCtx(&storage, otherId, currentTime, &context);
   tdoaStorageSetRxTxData(&context, 0, 0, 0);
 
   uint8_t unorderedAnchorList[10];
 
   // Test
-  uint8_t actualCount = tdoaStorageGetListOfActiveAnchorIds(storage, unorderedAnchorList, expectedCount, currentTime);
+  uint8_t actualCount = tdoaStorageGetListOfActiveAnchorIds(&storage, unorderedAnchorList, expectedCount, currentTime);
 
   // Assert
   TEST_ASSERT_EQUAL_INT8(expectedCount, actualCount);
@@ -308,12 +362,12 @@ void testThatAnchorPositionIsSetAndGet() {
   uint32_t expectedTime = 1234;
 
   tdoaAnchorContext_t context;
-  tdoaStorageGetCreateAnchorCtx(storage, 0, expectedTime, &context);
+  tdoaStorageGetCreateAnchorCtx(&storage, 0, expectedTime, &context);
 
   tdoaStorageSetAnchorPosition(&context, expectedX, expectedY, expectedZ);
 
   uint32_t now = 2345;
-  tdoaStorageGetAnchorCtx(storage, 0, now, &context);
+  tdoaStorageGetAnchorCtx(&storage, 0, now, &context);
   point_t actual;
 
   // Test
@@ -336,7 +390,7 @@ void testThatAnchorPositionIsNotReturnedWhenTooOld() {
   uint32_t now = 1234;
 
   tdoaAnchorContext_t context;
-  tdoaStorageGetCreateAnchorCtx(storage, 0, now, &context);
+  tdoaStorageGetCreateAnchorCtx(&storage, 0, now, &context);
 
   tdoaStorageSetAnchorPosition(&context, x, y, z);
 
@@ -359,7 +413,7 @@ void testThatRxTxDataIsSet() {
   uint8_t expectedSeqNr = 17;
 
   tdoaAnchorContext_t context;
-  tdoaStorageGetCreateAnchorCtx(storage, 0, expectedUpdateTime, &context);
+  tdoaStorageGetCreateAnchorCtx(&storage, 0, expectedUpdateTime, &context);
 
   // Test
   tdoaStorageSetRxTxData(&context, expectedRxTime, expectedTxTime, expectedSeqNr);
@@ -375,7 +429,7 @@ void testThatRxTxDataIsSet() {
 void testThatClockCorrectionIsReturned() {
   // Fixture
   tdoaAnchorContext_t context;
-  tdoaStorageGetCreateAnchorCtx(storage, 0, 0, &context);
+  tdoaStorageGetCreateAnchorCtx(&storage, 0, 0, &context);
 
   double expected = 123.456;
   clockCorrectionStorage_t* clockCorrectionStorage = tdoaStorageGetClockCorrectionStorage(&context);
@@ -392,7 +446,7 @@ void testThatClockCorrectionIsReturned() {
 void testThatRemoteRxTimeIsReturned() {
   // Fixture
   tdoaAnchorContext_t context;
-  tdoaStorageGetCreateAnchorCtx(storage, 0, 0, &context);
+  tdoaStorageGetCreateAnchorCtx(&storage, 0, 0, &context);
 
   const uint8_t seqNr = 13;
   const uint8_t remoteAnchor = 17;
@@ -419,7 +473,7 @@ void testThatRemoteRxTimeIsNotReturnedWhenOutdated() {
   const uint8_t remoteAnchor = 17;
   fixtureSetRemoteRxTime(&context, anchor, storageTime, remoteAnchor, 4711, seqNr);
 
-  tdoaStorageGetCreateAnchorCtx(storage, anchor, expiryTime, &context);
+  tdoaStorageGetCreateAnchorCtx(&storage, anchor, expiryTime, &context);
   const int64_t expectedRemoteRxTime = 0;
 
   // Test
@@ -433,7 +487,7 @@ void testThatRemoteRxTimeIsNotReturnedWhenOutdated() {
 void testThatRemoteRxTimeIsNotReturnedForUnknownRemoteAnchor() {
   // Fixture
   tdoaAnchorContext_t context;
-  tdoaStorageGetCreateAnchorCtx(storage, 0, 0, &context);
+  tdoaStorageGetCreateAnchorCtx(&storage, 0, 0, &context);
   const uint8_t unkownRemoteAnchor = 17;
   const int64_t expectedRemoteRxTime = 0;
 
@@ -448,7 +502,7 @@ void testThatRemoteRxTimeIsNotReturnedForUnknownRemoteAnchor() {
 void testThatRemoteRxTimeIsOverwrittenWhenSetWithTheSameRemoteId() {
   // Fixture
   tdoaAnchorContext_t context;
-  tdoaStorageGetCreateAnchorCtx(storage, 0, 0, &context);
+  tdoaStorageGetCreateAnchorCtx(&storage, 0, 0, &context);
 
   const uint8_t seqNr = 13;
   const uint8_t remoteAnchor = 17;
@@ -510,7 +564,7 @@ void testThatRemoteRxTimeReplacesTheOldestEntryWhenStorageIsFull() {
 void testThatRemoteRxTimeAndSequenceNumberIsReturned() {
   // Fixture
   tdoaAnchorContext_t context;
-  tdoaStorageGetCreateAnchorCtx(storage, 0, 0, &context);
+  tdoaStorageGetCreateAnchorCtx(&storage, 0, 0, &context);
 
   const uint8_t remoteAnchor = 17;
   const uint8_t expectedRemoteSeqNr = 13;
@@ -531,7 +585,7 @@ void testThatRemoteRxTimeAndSequenceNumberIsReturned() {
 void testThatRemoteRxTimeAndSequenceNumberIsNotReturnedWhenNotInList() {
   // Fixture
   tdoaAnchorContext_t context;
-  tdoaStorageGetCreateAnchorCtx(storage, 0, 0, &context);
+  tdoaStorageGetCreateAnchorCtx(&storage, 0, 0, &context);
 
   const uint8_t remoteAnchor = 17;
 
@@ -544,47 +598,80 @@ void testThatRemoteRxTimeAndSequenceNumberIsNotReturnedWhenNotInList() {
   TEST_ASSERT_FALSE(actual);
 }
 
-void testThatAListOfSequenceNumbersAndIdsOfRemoteAnchorsIsReturned() {
+void testThatRemoteDataIsReturnedInRecencyOrder() {
   // Fixture
   tdoaAnchorContext_t context;
   const uint8_t anchor = 5;
+  const uint32_t storageTime = 1234;
 
-  // Add remote data that is too old
-  const uint8_t oldRemoteAncor = 3;
-  const uint8_t oldSeqNr = 100;
-  const uint32_t oldStorageTime = 1117;
-  const uint64_t someRemoteRxTime = 1234;
-
-  fixtureSetRemoteRxTime(&context, anchor, oldStorageTime, oldRemoteAncor, someRemoteRxTime, oldSeqNr);
+  // Set in a different order than the receive times
+  fixtureSetRemoteRxTime(&context, anchor, storageTime, 11, 2000, 101);
+  fixtureSetRemoteRxTime(&context, anchor, storageTime, 12, 3000, 102);
+  fixtureSetRemoteRxTime(&context, anchor, storageTime, 13, 1000, 103);
 
-  // Add remote data for two more anchors that are not too old
-  const uint8_t activeRemoteAnchor0 = 11;
-  const uint8_t activeSeqNr0 = 101;
-  const uint8_t activeRemoteAnchor1 = 17;
-  const uint8_t activeSeqNr1 = 102;
-  const uint32_t activeStorageTime = oldStorageTime + 1;
+  // Test
+  uint8_t actualIds[3];
+  uint8_t actualSeqNrs[3];
+  bool actualValid0 = tdoaStorageGetRemoteByRecency(&context, 0, &actualIds[0], &actualSeqNrs[0]);
+  bool actualValid1 = tdoaStorageGetRemoteByRecency(&context, 1, &actualIds[1], &actualSeqNrs[1]);
+  bool actualValid2 = tdoaStorageGetRemoteByRecency(&context, 2, &actualIds[2], &actualSeqNrs[2]);
+  bool actualValid3 = tdoaStorageGetRemoteByRecency(&context, 3, &actualIds[0], &actualSeqNrs[0]);
 
-  fixtureSetRemoteRxTime(&context, anchor, activeStorageTime, activeRemoteAnchor0, someRemoteRxTime, activeSeqNr0);
-  fixtureSetRemoteRxTime(&context, anchor, activeStorageTime, activeRemoteAnchor1, someRemoteRxTime, activeSeqNr1);
+  // Assert
+  TEST_ASSERT_TRUE(actualValid0);
+  TEST_ASSERT_TRUE(actualValid1);
+  TEST_ASSERT_TRUE(actualValid2);
+  TEST_ASSERT_FALSE(actualValid3);
+
+  TEST_ASSERT_EQUAL_UINT8(12, actualIds[0]);
+  TEST_ASSERT_EQUAL_UINT8(102, actualSeqNrs[0]);
+  TEST_ASSERT_EQUAL_UINT8(11, actualIds[1]);
+  TEST_ASSERT_EQUAL_UINT8(13, actualIds[2]);
+}
 
-  const uint32_t currentTime = oldStorageTime + REMOTE_DATA_VALIDITY_PERIOD;
-  tdoaStorageGetCreateAnchorCtx(storage, anchor, currentTime, &context);
+void testThatUpdatedRemoteDataMovesToTheFrontOfTheRecencyOrder() {
+  // Fixture
+  tdoaAnchorContext_t context;
+  const uint8_t anchor = 5;
+  const uint32_t storageTime = 1234;
 
-  int actualRemoteCount;
-  uint8_t actualSequenceNumbers[REMOTE_ANCHOR_DATA_COUNT];
-  uint8_t actualIds[REMOTE_ANCHOR_DATA_COUNT];
+  fixtureSetRemoteRxTime(&context, anchor, storageTime, 11, 0xFFFFF000, 101);
+  fixtureSetRemoteRxTime(&context, anchor, storageTime, 12, 0xFFFFF800, 102);
 
   // Test
-  tdoaStorageGetRemoteSeqNrList(&context, &actualRemoteCount, actualSequenceNumbers, actualIds);
+  // A later packet from anchor 11, with a receive time that has wrapped around
+  fixtureSetRemoteRxTime(&context, anchor, storageTime + 5, 11, 0x100000100, 111);
 
   // Assert
-  TEST_ASSERT_EQUAL_INT32(2, actualRemoteCount);
+  uint8_t actualId;
+  uint8_t actualSeqNr;
+  TEST_ASSERT_TRUE(tdoaStorageGetRemoteByRecency(&context, 0, &actualId, &actualSeqNr));
+  TEST_ASSERT_EQUAL_UINT8(11, actualId);
+  TEST_ASSERT_EQUAL_UINT8(111, actualSeqNr);
+
+  TEST_ASSERT_TRUE(tdoaStorageGetRemoteByRecency(&context, 1, &actualId, &actualSeqNr));
+  TEST_ASSERT_EQUAL_UINT8(12, actualId);
+}
+
+void testThatExpiredRemoteDataIsNotReturnedInRecencyOrder() {
+  // Fixture
+  tdoaAnchorContext_t context;
+  const uint8_t anchor = 5;
+  const uint32_t oldStorageTime = 1117;
+
+  fixtureSetRemoteRxTime(&context, anchor, oldStorageTime, 11, 5000, 101);
 
-  TEST_ASSERT_EQUAL_INT8(actualIds[0], activeRemoteAnchor0);
-  TEST_ASSERT_EQUAL_INT8(actualSequenceNumbers[0], activeSeqNr0);
+  // Test
+  // The old data has expired, new data is ordered before it even if the receive time is earlier
+  const uint32_t newStorageTime = oldStorageTime + REMOTE_DATA_VALIDITY_PERIOD;
+  fixtureSetRemoteRxTime(&context, anchor, newStorageTime, 12, 1000, 102);
 
-  TEST_ASSERT_EQUAL_INT8(actualIds[1], activeRemoteAnchor1);
-  TEST_ASSERT_EQUAL_INT8(actualSequenceNumbers[1], activeSeqNr1);
+  // Assert
+  uint8_t actualId;
+  uint8_t actualSeqNr;
+  TEST_ASSERT_TRUE(tdoaStorageGetRemoteByRecency(&context, 0, &actualId, &actualSeqNr));
+  TEST_ASSERT_EQUAL_UINT8(12, actualId);
+  TEST_ASSERT_FALSE(tdoaStorageGetRemoteByRecency(&context, 1, &actualId, &actualSeqNr));
 }
 
 
@@ -596,7 +683,7 @@ void testThatNoTimeOfFlightIsReturnedWhenRemoteAnchorIsNotInStorage() {
   const uint8_t remoteAnchor = 17;
   const uint64_t expected = 0;
 
-  tdoaStorageGetCreateAnchorCtx(storage, anchor, storageTime, &context);
+  tdoaStorageGetCreateAnchorCtx(&storage, anchor, storageTime, &context);
 
   // Test
   int64_t actual = tdoaStorageGetTimeOfFlight(&context, remoteAnchor);
@@ -682,15 +769,114 @@ void testThatTofReplacesTheOldestEntryWhenStorageIsFull() {
   TEST_ASSERT_EQUAL_INT64(0, actualReplaced);
 }
 
+void testThatRestoredAnchorPositionIsReturned() {
+  // Fixture
+  const uint8_t anchor = 17;
+  const uint32_t now = 1234;
+  tdoaPersistedAnchor_t persisted = {.id = anchor, .x = 1.0f, .y = 2.0f, .z = 3.0f, .clockCorrection = CLOCK_CORRECTION_FIXED_ONE};
+  clockCorrectionEngineSeed_Ignore();
+
+  // Test
+  tdoaStorageRestoreAnchor(&storage, &persisted, now);
+
+  // Assert
+  tdoaAnchorContext_t context;
+  tdoaStorageGetAnchorCtx(&storage, anchor, now + ANCHOR_POSITION_VALIDITY_PERIOD + 1, &context);
+  point_t actual;
+  TEST_ASSERT_TRUE(tdoaStorageGetAnchorPosition(&context, &actual));
+  TEST_ASSERT_EQUAL_FLOAT(2.0f, actual.y);
+}
+
+void testThatRestoredTimeOfFlightIsDroppedWhenLivePositionDiffers() {
+  // Fixture
+  const uint8_t anchor = 17;
+  const uint8_t remoteAnchor = 3;
+  const uint32_t now = 1234;
+  tdoaPersistedAnchor_t persisted = {.id = anchor, .x = 1.0f, .y = 2.0f, .z = 3.0f, .tofCount = 1, .tof = {{.id = remoteAnchor, .tof = 4711}}};
+  clockCorrectionEngineSeed_Ignore();
+  tdoaStorageRestoreAnchor(&storage, &persisted, now);
+
+  tdoaAnchorContext_t context;
+  tdoaStorageGetAnchorCtx(&storage, anchor, now, &context);
+
+  // Test
+  tdoaStorageSetAnchorPosition(&context, 1.0f, 2.5f, 3.0f);
+
+  // Assert
+  TEST_ASSERT_EQUAL_INT64(0, tdoaStorageGetTimeOfFlight(&context, remoteAnchor));
+}
+
+void testThatRestoredTimeOfFlightIsKeptWhenLivePositionMatches() {
+  // Fixture
+  const uint8_t anchor = 17;
+  const uint8_t remoteAnchor = 3;
+  const uint32_t now = 1234;
+  tdoaPersistedAnchor_t persisted = {.id = anchor, .x = 1.0f, .y = 2.0f, .z = 3.0f, .tofCount = 1, .tof = {{.id = remoteAnchor, .tof = 4711}}};
+  clockCorrectionEngineSeed_Ignore();
+  tdoaStorageRestoreAnchor(&storage, &persisted, now);
+
+  tdoaAnchorContext_t context;
+  tdoaStorageGetAnchorCtx(&storage, anchor, now, &context);
+
+  // Test
+  tdoaStorageSetAnchorPosition(&context, 1.0f, 2.01f, 3.0f);
+
+  // Assert
+  TEST_ASSERT_EQUAL_INT64(4711, tdoaStorageGetTimeOfFlight(&context, remoteAnchor));
+}
+
+void testThatRestoredAnchorIsNotPersistedUntilConfirmed() {
+  // Fixture
+  const uint8_t anchor = 17;
+  const uint32_t now = 1234;
+  tdoaPersistedAnchor_t persisted = {.id = anchor, .x = 1.0f, .y = 2.0f, .z = 3.0f};
+  clockCorrectionEngineSeed_Ignore();
+  tdoaStorageRestoreAnchor(&storage, &persisted, now);
+
+  tdoaAnchorContext_t context;
+  tdoaStorageGetAnchorCtx(&storage, anchor, now, &context);
+
+  // Test
+  tdoaPersistedAnchor_t actual;
+  bool actualResult = tdoaStorageGetPersistedAnchor(&context, &actual);
+
+  // Assert
+  TEST_ASSERT_FALSE(actualResult);
+}
+
+void testThatLiveAnchorDataIsPersisted() {
+  // Fixture
+  const uint8_t anchor = 17;
+  const uint8_t remoteAnchor = 3;
+  const uint32_t now = 1234;
+  tdoaAnchorContext_t context;
+  fixtureSetTof(&context, anchor, now, remoteAnchor, 4711);
+  tdoaStorageSetAnchorPosition(&context, 1.0f, 2.0f, 3.0f);
+  clockCorrectionEngineGet_IgnoreAndReturn(1.0);
+
+  // Test
+  tdoaPersistedAnchor_t actual;
+  bool actualResult = tdoaStorageGetPersistedAnchor(&context, &actual);
+
+  // Assert
+  TEST_ASSERT_TRUE(actualResult);
+  TEST_ASSERT_EQUAL_UINT8(anchor, actual.id);
+  TEST_ASSERT_EQUAL_FLOAT(3.0f, actual.z);
+  TEST_ASSERT_EQUAL_UINT32(CLOCK_CORRECTION_FIXED_ONE, actual.clockCorrection);
+  TEST_ASSERT_EQUAL_UINT8(1, actual.tofCount);
+  TEST_ASSERT_EQUAL_UINT8(remoteAnchor, actual.tof[0].id);
+  TEST_ASSERT_EQUAL_UINT16(4711, actual.tof[0].tof);
+}
+
 
 // Helpers ///////////////
 
 static void fixtureSetRemoteRxTime(tdoaAnchorContext_t* context, const uint8_t anchor, const uint32_t storageTime, const uint8_t remoteAnchor, const uint64_t remoteRxTime, const uint8_t seqNr) {
-  tdoaStorageGetCreateAnchorCtx(storage, anchor, storageTime, context);
+  tdoaStorageGetCreateAnchorCtx(&storage, anchor, storageTime, context);
   tdoaStorageSetRemoteRxTime(context, remoteAnchor, remoteRxTime, seqNr);
 }
 
 static void fixtureSetTof(tdoaAnchorContext_t* context, const uint8_t anchor, const uint32_t storageTime, const uint8_t remoteAnchor, const uint64_t tof) {
-  tdoaStorageGetCreateAnchorCtx(storage, anchor, storageTime, context);
+  tdoaStorageGetCreateAnchorCtx(&storage, anchor, storageTime, context);
   tdoaStorageSetTimeOfFlight(context, remoteAnchor, tof);
 }
@@ -0,0 +1,129 @@
+/**
+ *    ||          ____  _ __
+ * +------+      / __ )(_) /_______________ _____  ___
+ * | 0xBC |     / __  / / __/ ___/ ___/ __ `/_  / / _ \
+ * +------+    / /_/ / / /_/ /__/ /  / /_/ / / /_/  __/
+ *  ||  ||    /_____/_/\__/\___/_/   \__,_/ /___/\___/
+ *
+ * Crazyflie control firmware
+ *
+ * Copyright (C) 2023 Bitcraze AB
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, in version 3.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ *
+ * test_tdoa_storage_benchmark.c - Benchmarks for tdoa storage with many anchors
+ *
+ * Times the storage operations done for each received TDoA3 packet. The
+ * results are printed, the tests only fail if the storage returns
+ * unexpected data.
+ */
+
+// File under test
+#include "tdoaStorage.h"
+
+#include "unity.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include "clockCorrectionEngine.h"
+
+#define PACKETS (200000)
+#define REMOTE_ANCHORS_PER_PACKET (8)
+
+static tdoaAnchorStorage_t storage;
+
+static double runPackets(const int anchorCount, int* tofFound);
+
+void setUp(void) {
+  tdoaStorageInitialize(&storage);
+}
+
+void testBenchmarkPacketProcessingWhenAllAnchorsFitInStorage() {
+  // Fixture
+  int tofFound = 0;
+
+  // Test
+  double nsPerPacket = runPackets(ANCHOR_STORAGE_COUNT, &tofFound);
+
+  // Assert
+  printf("%d anchors, storage %d: %.0f ns per packet\n", ANCHOR_STORAGE_COUNT, ANCHOR_STORAGE_COUNT, nsPerPacket);
+  // All remote anchors are in storage after the first round
+  TEST_ASSERT_TRUE(tofFound > (PACKETS * REMOTE_ANCHORS_PER_PACKET) / 2);
+}
+
+void testBenchmarkPacketProcessingWithMoreAnchorsThanStorage() {
+  // Fixture
+  int tofFound = 0;
+  const int anchorCount = ANCHOR_STORAGE_COUNT * 3 / 2;
+
+  // Test
+  double nsPerPacket = runPackets(anchorCount, &tofFound);
+
+  // Assert
+  printf("%d anchors, storage %d: %.0f ns per packet\n", anchorCount, ANCHOR_STORAGE_COUNT, nsPerPacket);
+  uint8_t ids[ANCHOR_STORAGE_COUNT];
+  TEST_ASSERT_EQUAL_UINT8(ANCHOR_STORAGE_COUNT, tdoaStorageGetListOfAnchorIds(&storage, ids, ANCHOR_STORAGE_COUNT));
+}
+
+void testBenchmarkLookupOfExistingAnchors() {
+  // Fixture
+  tdoaAnchorContext_t context;
+  for (int id = 0; id < ANCHOR_STORAGE_COUNT; id++) {
+    tdoaStorageGetCreateAnchorCtx(&storage, id, 1000, &context);
+  }
+
+  // Test
+  int found = 0;
+  clock_t start = clock();
+  for (int i = 0; i < PACKETS * 10; i++) {
+    found += tdoaStorageGetAnchorCtx(&storage, i % ANCHOR_STORAGE_COUNT, 1000, &context);
+  }
+  double ns = (double)(clock() - start) * 1e9 / CLOCKS_PER_SEC / (PACKETS * 10);
+
+  // Assert
+  printf("Anchor lookup, storage %d: %.1f ns\n", ANCHOR_STORAGE_COUNT, ns);
+  TEST_ASSERT_EQUAL_INT(PACKETS * 10, found);
+}
+
+// Helpers ///////////////
+
+// The packet from an anchor contains rx times of the other anchors, the
+// engine stores them and looks up the tof to the remote anchors.
+static double runPackets(const int anchorCount, int* tofFound) {
+  tdoaAnchorContext_t context;
+  uint32_t now_ms = 1000;
+
+  clock_t start = clock();
+  for (int i = 0; i < PACKETS; i++) {
+    const uint8_t anchor = i % anchorCount;
+    if (anchor == 0) {
+      now_ms++;
+    }
+
+    tdoaStorageGetCreateAnchorCtx(&storage, anchor, now_ms, &context);
+    tdoaStorageSetRxTxData(&context, i, i, i & 0x7f);
+
+    for (int r = 1; r <= REMOTE_ANCHORS_PER_PACKET; r++) {
+      const uint8_t remoteAnchor = (anchor + r) % anchorCount;
+      tdoaStorageSetRemoteRxTime(&context, remoteAnchor, i, i & 0x7f);
+      if (tdoaStorageGetTimeOfFlight(&context, remoteAnchor)) {
+        (*tofFound)++;
+      } else {
+        tdoaStorageSetTimeOfFlight(&context, remoteAnchor, 1000 + r);
+      }
+    }
+  }
+
+  return (double)(clock() - start) * 1e9 / CLOCKS_PER_SEC / PACKETS;
+}
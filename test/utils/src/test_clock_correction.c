@@ -200,3 +200,133 @@ void testUpdateClockCorrectionWithSampleInTheInnerLimitOfTheAcceptableNoise() {
   TEST_ASSERT_EQUAL_DOUBLE(expectedClockCorrection, clockCorrectionStorage.clockCorrection);
   TEST_ASSERT_EQUAL_UINT(expectedClockCorrectionBucket, clockCorrectionStorage.clockCorrectionBucket);
 }
+
+void testCalculateFixedClockCorrectionWithValidInputDataWithWrapAround() {
+  // Fixture
+  const double clockCorrection = 1.0000157;
+  const uint64_t mask = 0xFFFFFFFFFF; // 40 bits
+  const uint64_t difference_in_cl_x = 1000000000;
+
+  const uint64_t old_t_in_cl_x = mask - difference_in_cl_x / 2;
+  const uint64_t new_t_in_cl_x = (old_t_in_cl_x + difference_in_cl_x) & mask; // Wraps around
+  const uint64_t old_t_in_cl_reference = 56789;
+  const uint64_t new_t_in_cl_reference = old_t_in_cl_reference + clockCorrection * difference_in_cl_x; // Does not wrap around
+
+  // Test
+  const uint32_t result = clockCorrectionEngineCalculateFixed(new_t_in_cl_reference, old_t_in_cl_reference, new_t_in_cl_x, old_t_in_cl_x, mask);
+
+  // Assert
+  const uint32_t expectedClockCorrection = clockCorrection * CLOCK_CORRECTION_FIXED_ONE;
+  TEST_ASSERT_UINT32_WITHIN(1, expectedClockCorrection, result);
+}
+
+void testCalculateFixedClockCorrectionWithInvalidInputData() {
+  // Fixture
+  const uint64_t mask = 0xFFFFFFFFFF; // 40 bits
+
+  // Test
+  const uint32_t result = clockCorrectionEngineCalculateFixed(56789, 56789, 1000, 1000, mask);
+
+  // Assert
+  TEST_ASSERT_EQUAL_UINT32(0, result);
+}
+
+void testCalculateFixedClockCorrectionSaturatesWhenOutOfRange() {
+  // Fixture
+  const uint64_t mask = 0xFFFFFFFFFF; // 40 bits
+
+  // Test
+  const uint32_t result = clockCorrectionEngineCalculateFixed(3000, 1000, 2000, 1000, mask);
+
+  // Assert
+  TEST_ASSERT_EQUAL_UINT32(UINT32_MAX, result);
+}
+
+void testUpdateFixedClockCorrectionWithSampleInTheAcceptableNoise() {
+  // Fixture
+  const uint32_t clockCorrection = (1.0 + 10e-6) * CLOCK_CORRECTION_FIXED_ONE;
+  const unsigned int clockCorrectionBucket = 2;
+  const uint32_t clockCorrectionCandidate = clockCorrection + 50;
+
+  clockCorrectionStorage_t clockCorrectionStorage = {
+    .clockCorrectionFixed = clockCorrection,
+    .clockCorrectionBucket = clockCorrectionBucket
+  };
+
+  // Test
+  const bool sampleIsReliable = clockCorrectionEngineUpdateFixed(&clockCorrectionStorage, clockCorrectionCandidate);
+
+  // Assert
+  const uint32_t expectedClockCorrection = clockCorrection + 45;
+  const unsigned int expectedClockCorrectionBucket = clockCorrectionBucket + 1;
+  TEST_ASSERT_TRUE(sampleIsReliable);
+  TEST_ASSERT_EQUAL_UINT32(expectedClockCorrection, clockCorrectionStorage.clockCorrectionFixed);
+  TEST_ASSERT_EQUAL_UINT(expectedClockCorrectionBucket, clockCorrectionStorage.clockCorrectionBucket);
+}
+
+void testUpdateFixedClockCorrectionWithSampleOutOfTheSpecsWithEmptyBucket() {
+  // Fixture
+  const uint32_t clockCorrection = CLOCK_CORRECTION_FIXED_ONE;
+  const uint32_t clockCorrectionCandidate = CLOCK_CORRECTION_SPEC_MAX * CLOCK_CORRECTION_FIXED_ONE;
+
+  clockCorrectionStorage_t clockCorrectionStorage = {
+    .clockCorrectionFixed = clockCorrection,
+    .clockCorrectionBucket = 0
+  };
+
+  // Test
+  const bool sampleIsReliable = clockCorrectionEngineUpdateFixed(&clockCorrectionStorage, clockCorrectionCandidate);
+
+  // Assert
+  TEST_ASSERT_FALSE(sampleIsReliable);
+  TEST_ASSERT_EQUAL_UINT32(clockCorrection, clockCorrectionStorage.clockCorrectionFixed);
+}
+
+void testUpdateFixedClockCorrectionWithSampleInTheSpecsWithEmptyBucket() {
+  // Fixture
+  const uint32_t clockCorrectionCandidate = (1.0 - 15e-6) * CLOCK_CORRECTION_FIXED_ONE;
+
+  clockCorrectionStorage_t clockCorrectionStorage = {
+    .clockCorrectionFixed = 0,
+    .clockCorrectionBucket = 0
+  };
+
+  // Test
+  const bool sampleIsReliable = clockCorrectionEngineUpdateFixed(&clockCorrectionStorage, clockCorrectionCandidate);
+
+  // Assert
+  TEST_ASSERT_FALSE(sampleIsReliable);
+  TEST_ASSERT_EQUAL_UINT32(clockCorrectionCandidate, clockCorrectionStorage.clockCorrectionFixed);
+}
+
+void testApplyFixedClockCorrectionToLargePositiveAndNegativeTimes() {
+  // Fixture
+  const double clockCorrection = 1.0000157;
+  const uint32_t clockCorrectionFixed = clockCorrection * CLOCK_CORRECTION_FIXED_ONE;
+  const int64_t time = 0x12345678912; // More than 32 bits
+
+  // Test
+  const int64_t result1 = clockCorrectionEngineApplyFixed(time, clockCorrectionFixed);
+  const int64_t result2 = clockCorrectionEngineApplyFixed(-time, clockCorrectionFixed);
+
+  // Assert
+  const double expected = time * ((double)clockCorrectionFixed / CLOCK_CORRECTION_FIXED_ONE);
+  TEST_ASSERT_INT64_WITHIN(1, (int64_t)expected, result1);
+  TEST_ASSERT_INT64_WITHIN(1, -(int64_t)expected, result2);
+}
+
+void testSeedClockCorrectionSetsFloatingAndFixedPointValues() {
+  // Fixture
+  const uint32_t clockCorrectionFixed = (1.0 + 5e-6) * CLOCK_CORRECTION_FIXED_ONE;
+  clockCorrectionStorage_t clockCorrectionStorage = {
+    .clockCorrectionBucket = CLOCK_CORRECTION_BUCKET_MAX
+  };
+
+  // Test
+  clockCorrectionEngineSeed(&clockCorrectionStorage, clockCorrectionFixed);
+
+  // Assert
+  TEST_ASSERT_EQUAL_UINT32(clockCorrectionFixed, clockCorrectionEngineGetFixed(&clockCorrectionStorage));
+  TEST_ASSERT_DOUBLE_WITHIN(1e-9, 1.0 + 5e-6, clockCorrectionEngineGet(&clockCorrectionStorage));
+  TEST_ASSERT_EQUAL_UINT(0, clockCorrectionStorage.clockCorrectionBucket);
+}
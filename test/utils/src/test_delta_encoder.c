@@ -0,0 +1,276 @@
+/**
+ *    ||          ____  _ __
+ * +------+      / __ )(_) /_______________ _____  ___
+ * | 0xBC |     / __  / / __/ ___/ ___/ __ `/_  / / _ \
+ * +------+    / /_/ / / /_/ /__/ /  / /_/ / / /_/  __/
+ *  ||  ||    /_____/_/\__/\___/_/   \__,_/ /___/\___/
+ *
+ * Crazyflie control firmware
+ *
+ * Copyright (C) 2023 Bitcraze AB
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, in version 3.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ *
+ * Unit tests for delta_encoder
+ */
+
+// Module under test
+#include "delta_encoder.h"
+
+#include "unity.h"
+#include <string.h>
+
+#define NUM_FIELDS 4
+static const uint8_t fieldSizes[NUM_FIELDS] = {1, 2, 4, 4};
+#define NUM_BYTES (1 + 2 + 4 + 4)
+
+typedef struct {
+    uint8_t u8;
+    int16_t i16;
+    uint32_t u32;
+    float f;
+} __attribute__((packed)) record_t;
+
+static deltaEncoder_t encoder;
+static uint8_t previous[NUM_BYTES];
+static uint8_t out[64];
+
+static uint8_t decodedValues[NUM_BYTES];
+static uint64_t decodedTimestamp;
+
+// Helpers
+
+static uint16_t decode(const uint8_t* data, uint8_t* tag);
+static uint16_t encode(uint64_t timestamp, const record_t* record);
+static void assertRoundTrip(uint64_t timestamp, const record_t* record);
+
+void setUp(void) {
+  memset(&encoder, 0, sizeof(encoder));
+  memset(previous, 0, sizeof(previous));
+  memset(out, 0, sizeof(out));
+  memset(decodedValues, 0, sizeof(decodedValues));
+  decodedTimestamp = 0;
+
+  deltaEncoderInit(&encoder, fieldSizes, NUM_FIELDS, previous, 10);
+}
+
+void tearDown(void) {}
+
+void testThatVarintOfSmallValueIsOneByte() {
+  // Fixture
+  uint8_t buf[DELTA_ENCODER_MAX_VARINT64_SIZE];
+
+  // Test
+  uint8_t actual = deltaEncoderWriteVarint(127, buf);
+
+  // Assert
+  TEST_ASSERT_EQUAL_UINT8(1, actual);
+  TEST_ASSERT_EQUAL_UINT8(127, buf[0]);
+}
+
+void testThatVarintIsWrittenLeastSignificantGroupFirst() {
+  // Fixture
+  uint8_t buf[DELTA_ENCODER_MAX_VARINT64_SIZE];
+
+  // Test
+  uint8_t actual = deltaEncoderWriteVarint(300, buf);
+
+  // Assert
+  TEST_ASSERT_EQUAL_UINT8(2, actual);
+  TEST_ASSERT_EQUAL_UINT8(0xac, buf[0]);
+  TEST_ASSERT_EQUAL_UINT8(0x02, buf[1]);
+}
+
+void testThatVarintOfLargestValueFitsMaxSize() {
+  // Fixture
+  uint8_t buf[DELTA_ENCODER_MAX_VARINT64_SIZE];
+
+  // Test
+  uint8_t actual = deltaEncoderWriteVarint(UINT64_MAX, buf);
+
+  // Assert
+  TEST_ASSERT_EQUAL_UINT8(DELTA_ENCODER_MAX_VARINT64_SIZE, actual);
+}
+
+void testZigzag() {
+  // Fixture
+  // Test
+  // Assert
+  TEST_ASSERT_EQUAL_UINT64(0, deltaEncoderZigzag(0));
+  TEST_ASSERT_EQUAL_UINT64(1, deltaEncoderZigzag(-1));
+  TEST_ASSERT_EQUAL_UINT64(2, deltaEncoderZigzag(1));
+  TEST_ASSERT_EQUAL_UINT64(3, deltaEncoderZigzag(-2));
+  TEST_ASSERT_EQUAL_UINT64(UINT64_MAX, deltaEncoderZigzag(INT64_MIN));
+}
+
+void testThatFirstRecordIsARawKeyframe() {
+  // Fixture
+  record_t record = {.u8 = 1, .i16 = -2, .u32 = 3, .f = 4.0f};
+  uint64_t timestamp = 123456789;
+
+  // Test
+  uint16_t actual = deltaEncoderEncode(&encoder, 5, timestamp, (uint8_t*)&record, out);
+
+  // Assert
+  TEST_ASSERT_EQUAL_UINT16(1 + 8 + NUM_BYTES, actual);
+  TEST_ASSERT_EQUAL_UINT8(5 | DELTA_ENCODER_KEYFRAME_FLAG, out[0]);
+  TEST_ASSERT_EQUAL_MEMORY(&timestamp, &out[1], 8);
+  TEST_ASSERT_EQUAL_MEMORY(&record, &out[9], NUM_BYTES);
+}
+
+void testThatSmallChangesGiveSmallRecords() {
+  // Fixture
+  record_t record = {.u8 = 1, .i16 = -2, .u32 = 3, .f = 4.0f};
+  encode(1000, &record);
+  record.u8 = 2;
+  record.i16 = -3;
+  record.u32 = 1;
+
+  // Test
+  uint16_t actual = encode(2000, &record);
+
+  // Assert
+  // Tag, two bytes of timestamp and one byte per field
+  TEST_ASSERT_EQUAL_UINT16(1 + 2 + NUM_FIELDS, actual);
+  TEST_ASSERT_EQUAL_UINT8(0, out[0] & DELTA_ENCODER_KEYFRAME_FLAG);
+}
+
+void testThatRecordsAreDecodedToTheOriginalValues() {
+  // Fixture
+  record_t records[] = {
+    {.u8 = 1, .i16 = -2, .u32 = 3, .f = 4.0f},
+    {.u8 = 255, .i16 = 32767, .u32 = 0xffffffff, .f = -4.5f},
+    {.u8 = 0, .i16 = -32768, .u32 = 0, .f = 1e-30f},
+    {.u8 = 17, .i16 = 100, .u32 = 123456, .f = 3.14f},
+  };
+
+  // Test
+  // Assert
+  uint64_t timestamp = 1000;
+  for (int i = 0; i < sizeof(records) / sizeof(records[0]); i++) {
+    assertRoundTrip(timestamp, &records[i]);
+    timestamp += 997;
+  }
+}
+
+void testThatDecreasingTimestampIsDecoded() {
+  // Fixture
+  record_t record = {.u8 = 1, .i16 = -2, .u32 = 3, .f = 4.0f};
+  assertRoundTrip(5000, &record);
+
+  // Test
+  // Assert
+  assertRoundTrip(4000, &record);
+}
+
+void testThatKeyframeIsWrittenAtInterval() {
+  // Fixture
+  record_t record = {.u8 = 1, .i16 = -2, .u32 = 3, .f = 4.0f};
+  int keyframes = 0;
+
+  // Test
+  for (int i = 0; i < 30; i++) {
+    encode(i, &record);
+    if (out[0] & DELTA_ENCODER_KEYFRAME_FLAG) {
+      keyframes++;
+    }
+  }
+
+  // Assert
+  TEST_ASSERT_EQUAL_INT(3, keyframes);
+}
+
+void testThatResetForcesKeyframe() {
+  // Fixture
+  record_t record = {.u8 = 1, .i16 = -2, .u32 = 3, .f = 4.0f};
+  encode(1, &record);
+
+  // Test
+  deltaEncoderReset(&encoder);
+  encode(2, &record);
+
+  // Assert
+  TEST_ASSERT_EQUAL_UINT8(DELTA_ENCODER_KEYFRAME_FLAG, out[0] & DELTA_ENCODER_KEYFRAME_FLAG);
+}
+
+void testThatRecordsNeverExceedMaxRecordSize() {
+  // Fixture
+  record_t a = {.u8 = 0, .i16 = -32768, .u32 = 0, .f = 0.0f};
+  record_t b = {.u8 = 128, .i16 = 0, .u32 = 0x80000000, .f = -1e30f};
+  uint16_t maxSize = deltaEncoderMaxRecordSize(&encoder);
+
+  // Test
+  uint16_t keyframeSize = encode(0, &a);
+  uint16_t deltaSize = encode(UINT64_MAX / 2, &b);
+
+  // Assert
+  TEST_ASSERT_LESS_OR_EQUAL_UINT16(maxSize, keyframeSize);
+  TEST_ASSERT_LESS_OR_EQUAL_UINT16(maxSize, deltaSize);
+}
+
+// Helpers
+
+static uint64_t readVarint(const uint8_t* data, uint16_t* index) {
+  uint64_t value = 0;
+  int shift = 0;
+  while (data[*index] & 0x80) {
+    value |= (uint64_t)(data[(*index)++] & 0x7f) << shift;
+    shift += 7;
+  }
+  value |= (uint64_t)data[(*index)++] << shift;
+  return value;
+}
+
+static int64_t unzigzag(uint64_t value) {
+  return (int64_t)(value >> 1) ^ -(int64_t)(value & 1);
+}
+
+static uint16_t decode(const uint8_t* data, uint8_t* tag) {
+  uint16_t index = 0;
+  *tag = data[index++];
+
+  if (*tag & DELTA_ENCODER_KEYFRAME_FLAG) {
+    memcpy(&decodedTimestamp, &data[index], 8);
+    index += 8;
+    memcpy(decodedValues, &data[index], NUM_BYTES);
+    index += NUM_BYTES;
+  } else {
+    decodedTimestamp += unzigzag(readVarint(data, &index));
+    uint16_t offset = 0;
+    for (int i = 0; i < NUM_FIELDS; i++) {
+      uint32_t value = 0;
+      memcpy(&value, &decodedValues[offset], fieldSizes[i]);
+      value += (uint32_t)unzigzag(readVarint(data, &index));
+      memcpy(&decodedValues[offset], &value, fieldSizes[i]);
+      offset += fieldSizes[i];
+    }
+  }
+
+  return index;
+}
+
+static uint16_t encode(uint64_t timestamp, const record_t* record) {
+  return deltaEncoderEncode(&encoder, 1, timestamp, (const uint8_t*)record, out);
+}
+
+static void assertRoundTrip(uint64_t timestamp, const record_t* record) {
+  uint16_t encodedSize = encode(timestamp, record);
+
+  uint8_t tag;
+  uint16_t decodedSize = decode(out, &tag);
+
+  TEST_ASSERT_EQUAL_UINT16(encodedSize, decodedSize);
+  TEST_ASSERT_EQUAL_UINT8(1, tag & ~DELTA_ENCODER_KEYFRAME_FLAG);
+  TEST_ASSERT_EQUAL_UINT64(timestamp, decodedTimestamp);
+  TEST_ASSERT_EQUAL_MEMORY(record, decodedValues, NUM_BYTES);
+}
@@ -28,3 +28,49 @@ def test_that_traj_eval_invalid_is_actually_invalid():
 
     # Assert
     assert not valid
+
+
+def test_that_batch_evaluation_matches_single_evaluation():
+    # Fixture
+    data = np.zeros((2, 33))
+    data[0, 0] = 1.0
+    data[0, 1:9] = [0, 1, 0.5, 0, 0, 0, 0, 0]
+    data[0, 25:33] = [0, 0.1, 0, 0, 0, 0, 0, 0]
+    data[1, 0] = 2.0
+    data[1, 1:9] = [1.5, 2, 0, 0, 0, 0, 0, 0]
+    data[1, 9:17] = [0, 0, 0.25, 0, 0, 0, 0, 0]
+
+    traj = cffirmware.piecewise_traj()
+    traj.t_begin = 0
+    traj.timescale = 1
+    traj.shift = cffirmware.mkvec(0, 0, 0)
+    cffirmware.piecewise_load(traj, data)
+    t = np.linspace(0, 3.5, 50)
+
+    # Test
+    pos, vel, acc, omega, yaw = cffirmware.piecewise_eval_many(traj, t)
+
+    # Assert
+    assert traj.n_pieces == 2
+    for i, ti in enumerate(t):
+        expected = cffirmware.piecewise_eval(traj, ti)
+        assert np.allclose(np.array(expected.pos), pos[i], atol=1e-5)
+        assert np.allclose(np.array(expected.vel), vel[i], atol=1e-5)
+        assert np.allclose(np.array(expected.acc), acc[i], atol=1e-5)
+        assert np.allclose(np.array(expected.omega), omega[i], atol=1e-5)
+        assert np.isclose(expected.yaw, yaw[i], atol=1e-5)
+
+    cffirmware.poly4d_free(traj.pieces)
+
+
+def test_that_loading_an_array_of_the_wrong_shape_fails():
+    # Fixture
+    traj = cffirmware.piecewise_traj()
+
+    # Test
+    # Assert
+    try:
+        cffirmware.piecewise_load(traj, np.zeros((2, 32)))
+        assert False
+    except ValueError:
+        pass
@@ -0,0 +1,173 @@
+#!/usr/bin/env python
+
+import os
+import struct
+import sys
+import zlib
+
+import numpy as np
+import pytest
+
+sys.path.insert(0, os.path.join(os.path.dirname(__file__), '..', 'tools', 'usdlog'))
+import cfusdlog
+
+pytestmark = pytest.mark.skipif(cfusdlog._cfusdlog is None, reason="native decoder not built, run make usdlog_python")
+
+EVENTS = [
+    (7, 'myEvent', [('var1', 'B'), ('var2', 'h')]),
+    (0xFFFF, 'fixedFrequency', [('stateEstimate.x', 'f'), ('pm.vbat', 'e'), ('tick', 'I')]),
+]
+
+
+def _header(version):
+    data = struct.pack('<BHH', 0xBC, version, len(EVENTS))
+    for event_id, name, variables in EVENTS:
+        data += struct.pack('<H', event_id) + name.encode() + b'\0'
+        data += struct.pack('<H', len(variables))
+        for var_name, var_type in variables:
+            data += '{}({})'.format(var_name, var_type).encode() + b'\0'
+    return data
+
+
+def _values(i):
+    return [
+        [(i * 7) & 0xFF, -300 + 13 * i],
+        [np.sin(i * 0.1), 3.7 - i * 0.001, (0xFFFFFFF0 + i) & 0xFFFFFFFF],
+    ]
+
+
+def _varint(value):
+    data = b''
+    while value >= 0x80:
+        data += bytes([(value & 0x7F) | 0x80])
+        value >>= 7
+    return data + bytes([value])
+
+
+def _zigzag(value):
+    return (value << 1) ^ (value >> 63)
+
+
+def _write(tmp_path, version, count, keyframe_interval=4):
+    data = _header(version)
+    previous = {}
+    for i in range(count):
+        for index, (event_id, _, variables) in enumerate(EVENTS):
+            if index == 0 and i % 3 != 0:
+                continue
+            fmt = '<' + ''.join(t for _, t in variables)
+            raw = struct.pack(fmt, *_values(i)[index])
+            ticks = 1000 * i + index
+            if version == 1:
+                data += struct.pack('<HI', event_id, ticks) + raw
+            elif version == 2:
+                data += struct.pack('<HQ', event_id, ticks) + raw
+            elif index not in previous or previous[index][2] >= keyframe_interval:
+                data += struct.pack('<BQ', index | 0x80, ticks) + raw
+                previous[index] = (ticks, raw, 1)
+            else:
+                prev_ticks, prev_raw, since = previous[index]
+                data += bytes([index]) + _varint(_zigzag(ticks - prev_ticks))
+                offset = 0
+                for _, t in variables:
+                    size = struct.calcsize('<' + t)
+                    mask = (1 << (8 * size)) - 1
+                    delta = (int.from_bytes(raw[offset:offset+size], 'little') -
+                             int.from_bytes(prev_raw[offset:offset+size], 'little')) & mask
+                    if delta >= (1 << (8 * size - 1)):
+                        delta -= 1 << (8 * size)
+                    data += _varint(_zigzag(delta))
+                    offset += size
+                previous[index] = (ticks, raw, since + 1)
+
+    data += struct.pack('<I', zlib.crc32(data))
+    path = tmp_path / 'log{}'.format(version)
+    path.write_bytes(data)
+    return str(path)
+
+
+def _assert_same(expected, actual):
+    assert list(expected.keys()) == list(actual.keys())
+    for event_name in expected:
+        assert list(expected[event_name].keys()) == list(actual[event_name].keys())
+        for var_name in expected[event_name]:
+            assert expected[event_name][var_name].dtype == actual[event_name][var_name].dtype
+            assert np.array_equal(expected[event_name][var_name], actual[event_name][var_name])
+
+
+@pytest.mark.parametrize('version', [1, 2, 3])
+def test_that_native_decoder_gives_same_result_as_python_decoder(tmp_path, version):
+    # Fixture
+    filename = _write(tmp_path, version, 100)
+
+    # Test
+    expected = cfusdlog._decode_python(filename)
+    actual = cfusdlog._decode_native(filename)
+
+    # Assert
+    _assert_same(expected, actual)
+    assert len(actual['myEvent']['timestamp']) == 34
+    assert len(actual['fixedFrequency']['timestamp']) == 100
+
+
+def test_that_native_decoder_returns_python_dtypes(tmp_path):
+    # Fixture
+    filename = _write(tmp_path, 3, 10)
+
+    # Test
+    actual = cfusdlog._decode_native(filename)
+
+    # Assert
+    assert actual['myEvent']['var1'].dtype == np.array([1]).dtype
+    assert actual['myEvent']['var2'].dtype == np.array([1]).dtype
+    assert actual['fixedFrequency']['stateEstimate.x'].dtype == np.float64
+    assert actual['fixedFrequency']['pm.vbat'].dtype == np.float64
+    assert actual['fixedFrequency']['timestamp'].dtype == np.float64
+
+
+def test_that_native_decoder_reports_bad_crc(tmp_path, capsys):
+    # Fixture
+    filename = _write(tmp_path, 2, 10)
+    with open(filename, 'r+b') as f:
+        f.seek(-1, os.SEEK_END)
+        f.write(b'\0')
+
+    # Test
+    cfusdlog._decode_native(filename)
+
+    # Assert
+    assert 'CRC does not match' in capsys.readouterr().out
+
+
+def test_that_native_decoder_keeps_events_before_truncation(tmp_path):
+    # Fixture
+    filename = _write(tmp_path, 2, 10)
+    with open(filename, 'r+b') as f:
+        # Remove the CRC and half of the last event
+        f.truncate(os.path.getsize(filename) - 4 - 10)
+
+    # Test
+    actual = cfusdlog._decode_native(filename)
+
+    # Assert
+    assert len(actual['fixedFrequency']['timestamp']) == 9
+
+
+@pytest.mark.parametrize('version', [2, 3])
+def test_that_decoders_stop_at_zero_padding(tmp_path, version):
+    # Fixture
+    filename = _write(tmp_path, version, 100)
+    with open(filename, 'r+b') as f:
+        # A preallocated file that was not closed, no CRC and zeros up to the end of the file
+        f.truncate(os.path.getsize(filename) - 4)
+        f.seek(0, os.SEEK_END)
+        f.write(bytes(4096))
+
+    # Test
+    expected = cfusdlog._decode_python(filename)
+    actual = cfusdlog._decode_native(filename)
+
+    # Assert
+    _assert_same(expected, actual)
+    assert len(actual['myEvent']['timestamp']) == 34
+    assert len(actual['fixedFrequency']['timestamp']) == 100
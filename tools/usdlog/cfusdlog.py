@@ -7,6 +7,12 @@ from zlib import crc32
 import struct
 import numpy as np
 
+# Native decoder, built with "make usdlog_python"
+try:
+    import _cfusdlog
+except ImportError:
+    _cfusdlog = None
+
 # extract null-terminated string
 def _get_name(data, idx):
     endIdx = idx
@@ -14,7 +20,69 @@ def _get_name(data, idx):
         endIdx = endIdx + 1
     return data[idx:endIdx].decode("utf-8"), endIdx + 1
 
+# extract unsigned varint, 7 bits per byte, least significant group first
+def _get_varint(data, idx):
+    value = 0
+    shift = 0
+    while True:
+        b = data[idx]
+        idx += 1
+        value |= (b & 0x7F) << shift
+        if b < 0x80:
+            return value, idx
+        shift += 7
+
+# a preallocated log file that was not closed ends with zeros, no valid event
+# starts with this many zeros
+_ZERO_PADDING = bytes(16)
+
+def _unzigzag(value):
+    return (value >> 1) ^ -(value & 1)
+
+# decode one record of the compressed format (version 3), updates the previous
+# raw values of the event in place
+def _decode_compressed(data, idx, event):
+    tag = data[idx]
+    idx += 1
+    if tag & 0x80:
+        # keyframe, raw timestamp and values
+        timestamp, = struct.unpack('<Q', data[idx:idx+8])
+        idx += 8
+        event['previous'][:] = data[idx:idx+event['numBytes']]
+        idx += event['numBytes']
+    else:
+        delta, idx = _get_varint(data, idx)
+        timestamp = event['timestamp'] + _unzigzag(delta)
+        offset = 0
+        for size in event['fieldSizes']:
+            delta, idx = _get_varint(data, idx)
+            previous = int.from_bytes(event['previous'][offset:offset+size], 'little')
+            value = (previous + _unzigzag(delta)) % (1 << (8 * size))
+            event['previous'][offset:offset+size] = value.to_bytes(size, 'little')
+            offset += size
+    event['timestamp'] = timestamp
+    return timestamp, idx
+
 def decode(filename):
+    if _cfusdlog is not None:
+        return _decode_native(filename)
+    return _decode_python(filename)
+
+def _decode_native(filename):
+    try:
+        result, crc_valid, truncated = _cfusdlog.decode(filename)
+    except ValueError as e:
+        print(str(e) + "!")
+        return
+
+    if not crc_valid:
+        print("WARNING: CRC does not match!")
+    if truncated:
+        print("WARNING: Incomplete event at the end of the file!")
+
+    return result
+
+def _decode_python(filename):
     # read file as binary
     with open(filename, 'rb') as f:
         data = f.read()
@@ -32,12 +100,13 @@ def decode(filename):
 
     # check version
     version, num_event_types = struct.unpack('HH', data[1:5])
-    if version != 1 and version != 2:
+    if version not in (1, 2, 3):
         print("Unsupported version!", version)
         return
 
     result = dict()
     event_by_id = dict()
+    event_by_index = []
 
     # read header with data types
     idx = 5
@@ -63,20 +132,38 @@ def decode(filename):
             'fmtStr': fmtStr,
             'numBytes': struct.calcsize(fmtStr),
             'variables': variables,
+            'fieldSizes': [struct.calcsize('<' + t) for t in fmtStr[1:]],
+            'previous': bytearray(struct.calcsize(fmtStr)),
+            'timestamp': 0,
             }
+        event_by_index.append(event_by_id[event_id])
 
     while idx < len(data) - 4:
-        if version == 1:
-            event_id, timestamp, = struct.unpack('<HI', data[idx:idx+6])
-            idx += 6
-        elif version == 2:
-            event_id, timestamp, = struct.unpack('<HQ', data[idx:idx+10])
-            timestamp = timestamp / 1000.0
-            idx += 10
-        event = event_by_id[event_id]
-        fmtStr = event['fmtStr']
-        eventData = struct.unpack(fmtStr, data[idx:idx+event['numBytes']])
-        idx += event['numBytes']
+        # anything that is not an event ends the log, the file was not closed
+        if data[idx:idx+len(_ZERO_PADDING)] == _ZERO_PADDING:
+            print("WARNING: Incomplete event at the end of the file!")
+            break
+        try:
+            if version == 3:
+                event = event_by_index[data[idx] & 0x7F]
+                timestamp, idx = _decode_compressed(data, idx, event)
+                timestamp = timestamp / 1000.0
+                eventData = struct.unpack(event['fmtStr'], event['previous'])
+            else:
+                if version == 1:
+                    event_id, timestamp, = struct.unpack('<HI', data[idx:idx+6])
+                    idx += 6
+                elif version == 2:
+                    event_id, timestamp, = struct.unpack('<HQ', data[idx:idx+10])
+                    timestamp = timestamp / 1000.0
+                    idx += 10
+                event = event_by_id[event_id]
+                fmtStr = event['fmtStr']
+                eventData = struct.unpack(fmtStr, data[idx:idx+event['numBytes']])
+                idx += event['numBytes']
+        except (IndexError, KeyError, ValueError, struct.error):
+            print("WARNING: Incomplete event at the end of the file!")
+            break
         for v,d in zip(event['variables'], eventData):
             result[event['name']][v].append(d)
         result[event['name']]["timestamp"].append(timestamp)
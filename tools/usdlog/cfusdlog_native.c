@@ -0,0 +1,201 @@
+/**
+ * ,---------,       ____  _ __
+ * |  ,-^-,  |      / __ )(_) /_______________ _____  ___
+ * | (  O  ) |     / __  / / __/ ___/ ___/ __ `/_  / / _ \
+ * | / ,--´  |    / /_/ / / /_/ /__/ /  / /_/ / / /_/  __/
+ *    +------`   /_____/_/\__/\___/_/   \__,_/ /___/\___/
+ *
+ * Crazyflie control firmware
+ *
+ * Copyright (C) 2023 Bitcraze AB
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, in version 3.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ *
+ *
+ *
+ * cfusdlog_native.c - Python extension for the native uSD log decoder
+ *
+ * decode(filename) returns a tuple (result, crcValid, truncated) where
+ * result has the same layout as cfusdlog.decode(), a dict of event names
+ * with a dict of variable names and numpy arrays. The arrays use the
+ * column buffers of the decoder directly and have the type of the logged
+ * variable.
+ */
+
+#define PY_SSIZE_T_CLEAN
+#include <Python.h>
+
+#define NPY_NO_DEPRECATED_API NPY_1_7_API_VERSION
+#include <numpy/arrayobject.h>
+
+#include "usdlog_decoder.h"
+
+// Before numpy 2, the default integer type of numpy is a C long
+#ifndef NPY_DEFAULT_INT
+#define NPY_DEFAULT_INT NPY_LONG
+#endif
+
+static void freeCapsule(PyObject* capsule) {
+    free(PyCapsule_GetPointer(capsule, NULL));
+}
+
+static int numpyType(const char type) {
+    switch (type) {
+        case 'B': return NPY_UINT8;
+        case 'b': return NPY_INT8;
+        case 'H': return NPY_UINT16;
+        case 'h': return NPY_INT16;
+        case 'I': return NPY_UINT32;
+        case 'i': return NPY_INT32;
+        case 'f': return NPY_FLOAT32;
+        case 'e': return NPY_FLOAT16;
+        default: return NPY_NOTYPE;
+    }
+}
+
+// The pure Python decoder builds its columns from lists of Python ints and floats
+static int pythonType(const int type) {
+    return PyTypeNum_ISINTEGER(type) ? NPY_DEFAULT_INT : NPY_DOUBLE;
+}
+
+// Wraps a column in a numpy array that takes over ownership of the memory
+static PyObject* wrapColumn(void** data, const size_t count, const int type) {
+    npy_intp dims[1] = {(npy_intp)count};
+    PyObject* array = PyArray_SimpleNewFromData(1, dims, type, *data);
+    if (!array) {
+        return NULL;
+    }
+
+    PyObject* capsule = PyCapsule_New(*data, NULL, freeCapsule);
+    if (!capsule) {
+        Py_DECREF(array);
+        return NULL;
+    }
+
+    // The capsule owns the memory from here, also if setting the base fails since that steals the capsule
+    *data = NULL;
+    if (PyArray_SetBaseObject((PyArrayObject*)array, capsule) != 0) {
+        Py_DECREF(array);
+        return NULL;
+    }
+
+    return array;
+}
+
+// Adds a column with the same dtype as the pure Python decoder would give it
+static int addColumn(PyObject* dict, const char* name, void** data, const size_t count, const int type, const int resultType) {
+    PyObject* array = wrapColumn(data, count, type);
+    if (!array) {
+        return -1;
+    }
+    PyObject* converted = PyArray_Cast((PyArrayObject*)array, resultType);
+    Py_DECREF(array);
+    if (!converted) {
+        return -1;
+    }
+    const int result = PyDict_SetItemString(dict, name, converted);
+    Py_DECREF(converted);
+    return result;
+}
+
+static PyObject* buildResult(usdlogFile_t* log) {
+    PyObject* result = PyDict_New();
+    if (!result) {
+        return NULL;
+    }
+
+    for (int i = 0; i < log->numEvents; i++) {
+        usdlogEvent_t* event = &log->events[i];
+
+        // Like cfusdlog.py, events without data are not included
+        if (event->count == 0) {
+            continue;
+        }
+
+        PyObject* eventDict = PyDict_New();
+        if (!eventDict || PyDict_SetItemString(result, event->name, eventDict) != 0) {
+            Py_XDECREF(eventDict);
+            Py_DECREF(result);
+            return NULL;
+        }
+        Py_DECREF(eventDict);
+
+        // Version 1 timestamps are integer ticks
+        const int timestampType = log->version == 1 ? NPY_DEFAULT_INT : NPY_DOUBLE;
+        if (addColumn(eventDict, "timestamp", (void**)&event->timestamps, event->count, NPY_FLOAT64, timestampType) != 0) {
+            Py_DECREF(result);
+            return NULL;
+        }
+
+        for (int j = 0; j < event->numVariables; j++) {
+            usdlogVariable_t* variable = &event->variables[j];
+            const int type = numpyType(variable->type);
+            if (addColumn(eventDict, variable->name, &variable->data, event->count, type, pythonType(type)) != 0) {
+                Py_DECREF(result);
+                return NULL;
+            }
+        }
+    }
+
+    return result;
+}
+
+static PyObject* decode(PyObject* self, PyObject* args) {
+    const char* filename;
+    if (!PyArg_ParseTuple(args, "s", &filename)) {
+        return NULL;
+    }
+
+    usdlogFile_t log;
+    usdlogResult_t decodeResult;
+    Py_BEGIN_ALLOW_THREADS
+    decodeResult = usdlogDecodeFile(filename, &log);
+    Py_END_ALLOW_THREADS
+
+    if (decodeResult != usdlogOk) {
+        if (log.version != 0 && decodeResult == usdlogErrorVersion) {
+            PyErr_Format(PyExc_ValueError, "%s %d", usdlogResultString(decodeResult), log.version);
+        } else {
+            PyErr_SetString(decodeResult == usdlogErrorFile ? PyExc_OSError : PyExc_ValueError, usdlogResultString(decodeResult));
+        }
+        usdlogFree(&log);
+        return NULL;
+    }
+
+    PyObject* result = buildResult(&log);
+    PyObject* tuple = NULL;
+    if (result) {
+        tuple = Py_BuildValue("(NOO)", result, log.crcValid ? Py_True : Py_False, log.truncated ? Py_True : Py_False);
+    }
+
+    usdlogFree(&log);
+    return tuple;
+}
+
+static PyMethodDef methods[] = {
+    {"decode", decode, METH_VARARGS, "Decode a uSD card log file, returns (result, crcValid, truncated)"},
+    {NULL, NULL, 0, NULL},
+};
+
+static struct PyModuleDef module = {
+    PyModuleDef_HEAD_INIT,
+    "_cfusdlog",
+    "Native decoder for uSD card deck logs",
+    -1,
+    methods,
+};
+
+PyMODINIT_FUNC PyInit__cfusdlog(void) {
+    import_array();
+    return PyModule_Create(&module);
+}
@@ -0,0 +1,41 @@
+"""Compiles the native uSD card log decoder used by cfusdlog.py."""
+
+import distutils.command.build
+from distutils.core import setup, Extension
+import numpy
+
+include = [
+    "tools/usdlog",
+    "src/utils/interface",
+    "src/modules/interface",
+    numpy.get_include(),
+]
+
+sources = [
+    "tools/usdlog/usdlog_decoder.c",
+    "tools/usdlog/cfusdlog_native.c",
+    "src/utils/src/crc32.c",
+]
+
+cfusdlog_native = Extension(
+    "_cfusdlog",
+    include_dirs=include,
+    sources=sources,
+    extra_compile_args=[
+        "-O3",
+        "-DUNIT_TEST_MODE",
+    ],
+)
+
+# Override build command to specify custom "build" directory
+class BuildCommand(distutils.command.build.build):
+    def initialize_options(self):
+        distutils.command.build.build.initialize_options(self)
+        self.build_base = "build"
+
+setup(
+    name="cfusdlog",
+    version="1.0",
+    cmdclass={"build": BuildCommand},
+    ext_modules=[cfusdlog_native],
+)
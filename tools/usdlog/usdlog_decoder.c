@@ -0,0 +1,432 @@
+/**
+ * ,---------,       ____  _ __
+ * |  ,-^-,  |      / __ )(_) /_______________ _____  ___
+ * | (  O  ) |     / __  / / __/ ___/ ___/ __ `/_  / / _ \
+ * | / ,--´  |    / /_/ / / /_/ /__/ /  / /_/ / / /_/  __/
+ *    +------`   /_____/_/\__/\___/_/   \__,_/ /___/\___/
+ *
+ * Crazyflie control firmware
+ *
+ * Copyright (C) 2023 Bitcraze AB
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, in version 3.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ *
+ *
+ *
+ * usdlog_decoder.c - Decoder for event logs written by the uSD card deck
+ *
+ */
+
+#include "usdlog_decoder.h"
+
+#include <fcntl.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "crc32.h"
+
+#define MAGIC (0xBC)
+#define CRC_SIZE (4)
+#define KEYFRAME_FLAG (0x80)
+#define MAX_COMPRESSED_EVENT_TYPES (128)
+// A preallocated log file that was not closed ends with zeros. No valid log has this many zeros at the start of an
+// event, a version 2 event would have id 0 and timestamp 0, and version 3 events would repeat the same timestamp.
+#define ZERO_PADDING_SIZE (16)
+
+typedef struct {
+    const uint8_t* data;
+    size_t size;
+    size_t index;
+} reader_t;
+
+static bool hasBytes(const reader_t* reader, const size_t count) {
+    return reader->index + count <= reader->size;
+}
+
+static uint64_t readLittleEndian(reader_t* reader, const uint8_t size) {
+    uint64_t value = 0;
+    for (int i = 0; i < size; i++) {
+        value |= (uint64_t)reader->data[reader->index + i] << (8 * i);
+    }
+    reader->index += size;
+    return value;
+}
+
+static bool readVarint(reader_t* reader, uint64_t* value) {
+    *value = 0;
+    for (int shift = 0; shift < 64; shift += 7) {
+        if (!hasBytes(reader, 1)) {
+            return false;
+        }
+        const uint8_t byte = reader->data[reader->index++];
+        *value |= (uint64_t)(byte & 0x7f) << shift;
+        if (byte < 0x80) {
+            return true;
+        }
+    }
+    return false;
+}
+
+static bool isZeroPadding(const reader_t* reader) {
+    if (!hasBytes(reader, ZERO_PADDING_SIZE)) {
+        return false;
+    }
+    for (int i = 0; i < ZERO_PADDING_SIZE; i++) {
+        if (reader->data[reader->index + i] != 0) {
+            return false;
+        }
+    }
+    return true;
+}
+
+static int64_t unzigzag(const uint64_t value) {
+    return (int64_t)(value >> 1) ^ -(int64_t)(value & 1);
+}
+
+static char* readString(reader_t* reader) {
+    const uint8_t* start = &reader->data[reader->index];
+    const uint8_t* end = memchr(start, 0, reader->size - reader->index);
+    if (!end) {
+        return 0;
+    }
+
+    reader->index += end - start + 1;
+    return strdup((const char*)start);
+}
+
+static uint8_t typeSize(const char type) {
+    switch (type) {
+        case 'B': case 'b':
+            return 1;
+        case 'H': case 'h': case 'e':
+            return 2;
+        case 'I': case 'i': case 'f':
+            return 4;
+        default:
+            return 0;
+    }
+}
+
+static usdlogResult_t decodeHeader(reader_t* reader, usdlogFile_t* log) {
+    if (!hasBytes(reader, 5) || reader->data[0] != MAGIC) {
+        return usdlogErrorFormat;
+    }
+    reader->index = 1;
+
+    log->version = readLittleEndian(reader, 2);
+    if (log->version < 1 || log->version > 3) {
+        return usdlogErrorVersion;
+    }
+
+    log->numEvents = readLittleEndian(reader, 2);
+    if (log->version == 3 && log->numEvents > MAX_COMPRESSED_EVENT_TYPES) {
+        return usdlogErrorFormat;
+    }
+
+    log->events = calloc(log->numEvents, sizeof(usdlogEvent_t));
+    if (!log->events && log->numEvents > 0) {
+        return usdlogErrorMemory;
+    }
+
+    for (int i = 0; i < log->numEvents; i++) {
+        usdlogEvent_t* event = &log->events[i];
+
+        if (!hasBytes(reader, 2)) {
+            return usdlogErrorFormat;
+        }
+        event->id = readLittleEndian(reader, 2);
+        event->name = readString(reader);
+        if (!event->name || !hasBytes(reader, 2)) {
+            return usdlogErrorFormat;
+        }
+
+        event->numVariables = readLittleEndian(reader, 2);
+        event->variables = calloc(event->numVariables, sizeof(usdlogVariable_t));
+        if (!event->variables && event->numVariables > 0) {
+            return usdlogErrorMemory;
+        }
+
+        for (int j = 0; j < event->numVariables; j++) {
+            usdlogVariable_t* variable = &event->variables[j];
+
+            // Stored as "name(T)"
+            variable->name = readString(reader);
+            if (!variable->name) {
+                return usdlogErrorFormat;
+            }
+            const size_t length = strlen(variable->name);
+            if (length < 3) {
+                return usdlogErrorFormat;
+            }
+            variable->type = variable->name[length - 2];
+            variable->size = typeSize(variable->type);
+            variable->name[length - 3] = 0;
+            if (variable->size == 0) {
+                return usdlogErrorFormat;
+            }
+
+            event->numBytes += variable->size;
+        }
+
+        event->previous = calloc(1, event->numBytes + 1);
+        if (!event->previous) {
+            return usdlogErrorMemory;
+        }
+    }
+
+    return usdlogOk;
+}
+
+static usdlogEvent_t* findEvent(usdlogFile_t* log, const uint16_t id) {
+    for (int i = 0; i < log->numEvents; i++) {
+        if (log->events[i].id == id) {
+            return &log->events[i];
+        }
+    }
+    return 0;
+}
+
+static void storeEvent(usdlogEvent_t* event, const double timestamp, const uint8_t* values) {
+    size_t offset = 0;
+    for (int i = 0; i < event->numVariables; i++) {
+        usdlogVariable_t* variable = &event->variables[i];
+        memcpy((uint8_t*)variable->data + event->count * variable->size, &values[offset], variable->size);
+        offset += variable->size;
+    }
+    event->timestamps[event->count] = timestamp;
+}
+
+// Applies a compressed record to the previous values of the event, returns false if the data ends
+static bool decodeCompressed(reader_t* reader, usdlogEvent_t* event, const bool isKeyframe) {
+    if (isKeyframe) {
+        if (!hasBytes(reader, sizeof(uint64_t) + event->numBytes)) {
+            return false;
+        }
+        event->previousTimestamp = readLittleEndian(reader, sizeof(uint64_t));
+        memcpy(event->previous, &reader->data[reader->index], event->numBytes);
+        reader->index += event->numBytes;
+        return true;
+    }
+
+    uint64_t delta;
+    if (!readVarint(reader, &delta)) {
+        return false;
+    }
+    event->previousTimestamp += unzigzag(delta);
+
+    size_t offset = 0;
+    for (int i = 0; i < event->numVariables; i++) {
+        const uint8_t size = event->variables[i].size;
+        if (!readVarint(reader, &delta)) {
+            return false;
+        }
+
+        uint32_t value = 0;
+        memcpy(&value, &event->previous[offset], size);
+        value += (uint32_t)unzigzag(delta);
+        memcpy(&event->previous[offset], &value, size);
+        offset += size;
+    }
+
+    return true;
+}
+
+// Decodes all events, only counts them if store is false
+static usdlogResult_t decodeEvents(reader_t reader, usdlogFile_t* log, const bool store) {
+    const size_t end = reader.size - CRC_SIZE;
+
+    while (reader.index < end) {
+        usdlogEvent_t* event;
+        double timestamp;
+        const uint8_t* values;
+
+        // Anything that is not an event ends the log, the file was not closed
+        if (isZeroPadding(&reader)) {
+            log->truncated = true;
+            break;
+        }
+
+        if (log->version == 3) {
+            const uint8_t tag = reader.data[reader.index++];
+            if ((tag & ~KEYFRAME_FLAG) >= log->numEvents) {
+                log->truncated = true;
+                break;
+            }
+            event = &log->events[tag & ~KEYFRAME_FLAG];
+            if (!decodeCompressed(&reader, event, tag & KEYFRAME_FLAG)) {
+                log->truncated = true;
+                break;
+            }
+            timestamp = event->previousTimestamp / 1000.0;
+            values = event->previous;
+        } else {
+            const uint8_t timestampSize = log->version == 1 ? sizeof(uint32_t) : sizeof(uint64_t);
+            if (!hasBytes(&reader, sizeof(uint16_t) + timestampSize)) {
+                log->truncated = true;
+                break;
+            }
+            event = findEvent(log, readLittleEndian(&reader, sizeof(uint16_t)));
+            if (!event) {
+                log->truncated = true;
+                break;
+            }
+            const uint64_t ticks = readLittleEndian(&reader, timestampSize);
+            // Version 1 is in ms, version 2 in us
+            timestamp = log->version == 1 ? (double)ticks : ticks / 1000.0;
+
+            if (!hasBytes(&reader, event->numBytes)) {
+                log->truncated = true;
+                break;
+            }
+            values = &reader.data[reader.index];
+            reader.index += event->numBytes;
+        }
+
+        if (store) {
+            storeEvent(event, timestamp, values);
+        }
+        event->count++;
+    }
+
+    return usdlogOk;
+}
+
+static usdlogResult_t allocateColumns(usdlogFile_t* log) {
+    for (int i = 0; i < log->numEvents; i++) {
+        usdlogEvent_t* event = &log->events[i];
+
+        // Allocate at least one element, malloc(0) may return NULL
+        const size_t count = event->count > 0 ? event->count : 1;
+        event->timestamps = malloc(count * sizeof(double));
+        if (!event->timestamps) {
+            return usdlogErrorMemory;
+        }
+
+        for (int j = 0; j < event->numVariables; j++) {
+            usdlogVariable_t* variable = &event->variables[j];
+            variable->data = malloc(count * variable->size);
+            if (!variable->data) {
+                return usdlogErrorMemory;
+            }
+        }
+
+        // Start over, the second pass stores the events
+        event->count = 0;
+        event->previousTimestamp = 0;
+        memset(event->previous, 0, event->numBytes);
+    }
+
+    return usdlogOk;
+}
+
+// Public API
+
+usdlogResult_t usdlogDecode(const uint8_t* data, const size_t size, usdlogFile_t* log) {
+    memset(log, 0, sizeof(usdlogFile_t));
+
+    reader_t reader = {.data = data, .size = size, .index = 0};
+    usdlogResult_t result = decodeHeader(&reader, log);
+    if (result != usdlogOk) {
+        return result;
+    }
+
+    // The header is longer than the CRC
+    crc32Context_t context;
+    crc32ContextInit(&context);
+    crc32Update(&context, data, size - CRC_SIZE);
+    reader_t crcReader = {.data = data, .size = size, .index = size - CRC_SIZE};
+    log->crcValid = crc32Out(&context) == readLittleEndian(&crcReader, CRC_SIZE);
+
+    result = decodeEvents(reader, log, false);
+    if (result != usdlogOk) {
+        return result;
+    }
+
+    result = allocateColumns(log);
+    if (result != usdlogOk) {
+        return result;
+    }
+
+    log->truncated = false;
+    return decodeEvents(reader, log, true);
+}
+
+usdlogResult_t usdlogDecodeFile(const char* filename, usdlogFile_t* log) {
+    memset(log, 0, sizeof(usdlogFile_t));
+
+    const int fd = open(filename, O_RDONLY);
+    if (fd < 0) {
+        return usdlogErrorFile;
+    }
+
+    struct stat fileStat;
+    if (fstat(fd, &fileStat) != 0) {
+        close(fd);
+        return usdlogErrorFile;
+    }
+    if (fileStat.st_size == 0) {
+        close(fd);
+        return usdlogErrorFormat;
+    }
+
+    const size_t size = fileStat.st_size;
+    void* data = mmap(0, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (data == MAP_FAILED) {
+        return usdlogErrorFile;
+    }
+
+    // The file is read front to back, twice
+    madvise(data, size, MADV_SEQUENTIAL);
+
+    const usdlogResult_t result = usdlogDecode(data, size, log);
+    munmap(data, size);
+
+    return result;
+}
+
+void usdlogFree(usdlogFile_t* log) {
+    for (int i = 0; i < log->numEvents && log->events; i++) {
+        usdlogEvent_t* event = &log->events[i];
+        for (int j = 0; j < event->numVariables && event->variables; j++) {
+            free(event->variables[j].name);
+            free(event->variables[j].data);
+        }
+        free(event->variables);
+        free(event->name);
+        free(event->timestamps);
+        free(event->previous);
+    }
+    free(log->events);
+    memset(log, 0, sizeof(usdlogFile_t));
+}
+
+const char* usdlogResultString(const usdlogResult_t result) {
+    switch (result) {
+        case usdlogOk:
+            return "OK";
+        case usdlogErrorFile:
+            return "Could not read file";
+        case usdlogErrorMemory:
+            return "Out of memory";
+        case usdlogErrorFormat:
+            return "Unsupported format";
+        case usdlogErrorVersion:
+            return "Unsupported version";
+        default:
+            return "Unknown error";
+    }
+}
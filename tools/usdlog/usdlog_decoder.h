@@ -0,0 +1,119 @@
+/**
+ * ,---------,       ____  _ __
+ * |  ,-^-,  |      / __ )(_) /_______________ _____  ___
+ * | (  O  ) |     / __  / / __/ ___/ ___/ __ `/_  / / _ \
+ * | / ,--´  |    / /_/ / / /_/ /__/ /  / /_/ / / /_/  __/
+ *    +------`   /_____/_/\__/\___/_/   \__,_/ /___/\___/
+ *
+ * Crazyflie control firmware
+ *
+ * Copyright (C) 2023 Bitcraze AB
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, in version 3.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ *
+ *
+ *
+ * usdlog_decoder.h - Decoder for event logs written by the uSD card deck
+ *
+ * Decodes all versions (1 - 3) of the format written by usddeck.c into one
+ * contiguous array (column) per variable and event type. The result is
+ * identical to tools/usdlog/cfusdlog.py, but much faster for large files.
+ */
+
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+typedef enum {
+    usdlogOk = 0,
+    usdlogErrorFile,
+    usdlogErrorMemory,
+    usdlogErrorFormat,
+    usdlogErrorVersion,
+} usdlogResult_t;
+
+typedef struct {
+    char* name;
+    // Type character as used by Python struct, B b H h I i f or e
+    char type;
+    uint8_t size;
+    // count * size bytes
+    void* data;
+} usdlogVariable_t;
+
+typedef struct {
+    uint16_t id;
+    char* name;
+
+    uint16_t numVariables;
+    usdlogVariable_t* variables;
+    uint16_t numBytes;
+
+    size_t count;
+    // Timestamps in ms, count entries
+    double* timestamps;
+
+    // State of the compressed format
+    uint8_t* previous;
+    uint64_t previousTimestamp;
+} usdlogEvent_t;
+
+typedef struct {
+    uint16_t version;
+    uint16_t numEvents;
+    usdlogEvent_t* events;
+
+    bool crcValid;
+    // The file ends with an incomplete event, zero padding or data that is not an event, for instance when a
+    // preallocated file was not closed. The events before it are decoded.
+    bool truncated;
+} usdlogFile_t;
+
+/**
+ * @brief Decode a log file
+ *
+ * The file is memory mapped and decoded in two passes, the first one counts the events so that all columns can
+ * be allocated with their final size. Must be freed with usdlogFree(), also when an error is returned.
+ *
+ * @param filename Path to the file
+ * @param log The decoded log
+ * @return usdlogResult_t usdlogOk on success
+ */
+usdlogResult_t usdlogDecodeFile(const char* filename, usdlogFile_t* log);
+
+/**
+ * @brief Decode a log from memory
+ *
+ * @param data The content of a log file
+ * @param size Size of the data
+ * @param log The decoded log
+ * @return usdlogResult_t usdlogOk on success
+ */
+usdlogResult_t usdlogDecode(const uint8_t* data, const size_t size, usdlogFile_t* log);
+
+/**
+ * @brief Free a decoded log
+ *
+ * Columns that have been set to NULL, for instance because their ownership was handed over to someone else,
+ * are not freed.
+ *
+ * @param log The decoded log
+ */
+void usdlogFree(usdlogFile_t* log);
+
+/**
+ * @brief A human readable description of a result
+ */
+const char* usdlogResultString(const usdlogResult_t result);